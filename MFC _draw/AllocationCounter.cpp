@@ -0,0 +1,47 @@
+// AllocationCounter.cpp: 堆分配计数的实现
+//
+
+#include "pch.h"
+#include "AllocationCounter.h"
+
+#if defined(_DEBUG) && defined(_MSC_VER) && !defined(DRAW_HEADLESS)
+#include <crtdbg.h>
+#define ALLOCATION_COUNTER_CRT_HOOK
+#endif
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+thread_local size_t CAllocationCounter::s_nCount = 0;
+thread_local size_t CAllocationCounter::s_nBytes = 0;
+std::atomic<bool> CAllocationCounter::s_bActive(false);
+
+#ifdef ALLOCATION_COUNTER_CRT_HOOK
+static _CRT_ALLOC_HOOK s_pfnPreviousHook = nullptr;
+
+// 只统计分配和重新分配；CRT 内部块（_CRT_BLOCK）不是程序代码的分配，忽略
+static int __cdecl CountingAllocHook(int nAllocType, void* pvData, size_t nSize, int nBlockUse, long lRequest,
+	const unsigned char* szFileName, int nLine)
+{
+	if ((nAllocType == _HOOK_ALLOC || nAllocType == _HOOK_REALLOC) && _BLOCK_TYPE(nBlockUse) != _CRT_BLOCK)
+		CAllocationCounter::OnAllocation(nSize);
+	if (s_pfnPreviousHook != nullptr)
+		return s_pfnPreviousHook(nAllocType, pvData, nSize, nBlockUse, lRequest, szFileName, nLine);
+	return TRUE;
+}
+#endif
+
+bool CAllocationCounter::Install()
+{
+#ifdef ALLOCATION_COUNTER_CRT_HOOK
+	if (!IsActive())
+	{
+		s_pfnPreviousHook = _CrtSetAllocHook(CountingAllocHook);
+		MarkActive();
+	}
+	return true;
+#else
+	return IsActive();
+#endif
+}
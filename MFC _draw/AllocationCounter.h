@@ -0,0 +1,52 @@
+// AllocationCounter.h: 堆分配计数
+// 按线程统计堆分配的次数和字节数，用来确认热路径（如鼠标移动的处理）在稳定状态下不分配内存。
+// 计数来自可替换的分配钩子，钩子对每次分配调用 OnAllocation：调试版本的应用程序用 Install 安装
+// CRT 调试堆的分配钩子（_CrtSetAllocHook），没有调试堆的环境（如 bench）替换全局 operator new 后调用 MarkActive。
+// 没有安装钩子时计数始终为 0，IsActive 返回 false。
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+class CAllocationCounter
+{
+private:
+	static thread_local size_t s_nCount;
+	static thread_local size_t s_nBytes;
+	static std::atomic<bool> s_bActive;
+
+public:
+	// 由分配钩子调用：记录当前线程的一次分配；不能分配内存
+	static void OnAllocation(size_t nBytes)
+	{
+		s_nCount++;
+		s_nBytes += nBytes;
+	}
+
+	// 当前线程累计的分配次数和字节数
+	static size_t GetCount() { return s_nCount; }
+	static size_t GetBytes() { return s_nBytes; }
+
+	// 安装 CRT 调试堆的分配钩子（只在调试版本的 Visual C++ 中可用），返回是否安装成功；可以重复调用
+	static bool Install();
+	// 由自行提供钩子的环境调用，表示计数有效
+	static void MarkActive() { s_bActive.store(true, std::memory_order_relaxed); }
+	// 是否安装了钩子（计数是否有意义）
+	static bool IsActive() { return s_bActive.load(std::memory_order_relaxed); }
+};
+
+// 统计一段代码中当前线程的分配：构造时记下计数，GetCount/GetBytes 返回之后新增的分配
+class CAllocationScope
+{
+private:
+	size_t m_nStartCount;
+	size_t m_nStartBytes;
+
+public:
+	CAllocationScope() : m_nStartCount(CAllocationCounter::GetCount()), m_nStartBytes(CAllocationCounter::GetBytes()) {}
+
+	size_t GetCount() const { return CAllocationCounter::GetCount() - m_nStartCount; }
+	size_t GetBytes() const { return CAllocationCounter::GetBytes() - m_nStartBytes; }
+};
@@ -0,0 +1,29 @@
+// ArchiveArray.h: 从文档读取整块保存的数组
+// 数组的元素个数来自文件，不可信：按块读取，内存随实际读到的数据增长，
+// 损坏或伪造的文件在分配大量内存之前就会读到文件结尾。
+//
+
+#pragma once
+
+#include <afxwin.h>
+#include <vector>
+
+// 每块读取的字节数；元素个数不超过一块的数组与直接整块读取相同，只分配一次
+static const size_t ARCHIVE_ARRAY_CHUNK_BYTES = 1 << 20;
+
+// 读取 nCount 个按原始内存写入的元素到 items（原有内容被替换），数据不足时抛出 CArchiveException
+template <typename T>
+void LoadArchiveArray(CArchive& ar, std::vector<T>& items, ULONGLONG nCount)
+{
+	const ULONGLONG nChunkItems = ARCHIVE_ARRAY_CHUNK_BYTES / sizeof(T);
+	items.clear();
+	while (items.size() < nCount)
+	{
+		const size_t nLoaded = items.size();
+		const size_t nChunk = static_cast<size_t>(min(nCount - nLoaded, nChunkItems));
+		items.resize(nLoaded + nChunk);
+		const UINT nBytes = static_cast<UINT>(nChunk * sizeof(T));
+		if (ar.Read(items.data() + nLoaded, nBytes) != nBytes)
+			AfxThrowArchiveException(CArchiveException::endOfFile, ar.m_strFileName);
+	}
+}
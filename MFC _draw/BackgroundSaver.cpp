@@ -0,0 +1,191 @@
+// BackgroundSaver.cpp: 后台保存图像的实现
+//
+
+#include "pch.h"
+#include "BackgroundSaver.h"
+#include "OffscreenExporter.h"
+#include "PngWriter.h"
+#include "SvgWriter.h"
+#include "TraceProfiler.h"
+
+#include <fstream>
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+static double ElapsedMs(LONGLONG llStart)
+{
+	LARGE_INTEGER frequency, now;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&now);
+	return (now.QuadPart - llStart) * 1000.0 / frequency.QuadPart;
+}
+
+CBackgroundSaver::CBackgroundSaver()
+	: m_pThread(nullptr), m_nBusy(0)
+{
+}
+
+CBackgroundSaver::~CBackgroundSaver()
+{
+	if (m_pThread != nullptr)
+	{
+		WaitForSingleObject(m_pThread->m_hThread, INFINITE);
+		delete m_pThread;
+		m_pThread = nullptr;
+	}
+}
+
+BOOL CBackgroundSaver::Start(const CDocumentSnapshot& snapshot, const CRect& rectSource, CSize sizeOutput, COLORREF bkColor,
+	const CString& strPath, HWND hNotifyWnd, LONGLONG llRequestTime)
+{
+	if (sizeOutput.cx <= 0 || sizeOutput.cy <= 0 || rectSource.IsRectEmpty())
+		return FALSE;
+	if (InterlockedCompareExchange(&m_nBusy, 1, 0) != 0)
+		return FALSE;
+
+	// 上一个线程已经结束，释放它的线程对象
+	if (m_pThread != nullptr)
+	{
+		WaitForSingleObject(m_pThread->m_hThread, INFINITE);
+		delete m_pThread;
+		m_pThread = nullptr;
+	}
+
+	CSaveJob* pJob = new CSaveJob;
+	pJob->snapshot = snapshot;
+	pJob->rectSource = rectSource;
+	pJob->sizeOutput = sizeOutput;
+	pJob->bkColor = bkColor;
+	pJob->strPath = strPath;
+	pJob->hNotifyWnd = hNotifyWnd;
+	pJob->dStallMs = 0.0;
+	pJob->pOwner = this;
+
+	m_pThread = AfxBeginThread(SaveThreadProc, pJob, THREAD_PRIORITY_BELOW_NORMAL, 0, CREATE_SUSPENDED);
+	if (m_pThread == nullptr)
+	{
+		delete pJob;
+		InterlockedExchange(&m_nBusy, 0);
+		return FALSE;
+	}
+	m_pThread->m_bAutoDelete = FALSE;
+
+	pJob->dStallMs = ElapsedMs(llRequestTime);
+	m_pThread->ResumeThread();
+	return TRUE;
+}
+
+UINT AFX_CDECL CBackgroundSaver::SaveThreadProc(LPVOID pParam)
+{
+	PROFILE_FUNCTION();
+	CSaveJob* pJob = static_cast<CSaveJob*>(pParam);
+
+	LARGE_INTEGER start;
+	QueryPerformanceCounter(&start);
+
+	CBackgroundSaveResult* pResult = new CBackgroundSaveResult;
+	pResult->hr = RenderAndSave(*pJob);
+	pResult->strPath = pJob->strPath;
+	pResult->dStallMs = pJob->dStallMs;
+	pResult->dWorkMs = ElapsedMs(start.QuadPart);
+
+	TRACE(_T("Background save finished: hr=0x%08X, UI stall %.3f ms, worker %.1f ms\n"),
+		pResult->hr, pResult->dStallMs, pResult->dWorkMs);
+
+	HWND hNotifyWnd = pJob->hNotifyWnd;
+	CBackgroundSaver* pOwner = pJob->pOwner;
+	delete pJob;  // 释放快照
+
+	InterlockedExchange(&pOwner->m_nBusy, 0);
+	if (!::IsWindow(hNotifyWnd) || !::PostMessage(hNotifyWnd, WM_BACKGROUND_SAVE_DONE, 0, reinterpret_cast<LPARAM>(pResult)))
+	{
+		delete pResult;
+	}
+	return 0;
+}
+
+HRESULT CBackgroundSaver::RenderAndSave(const CSaveJob& job)
+{
+	PROFILE_FUNCTION();
+	COffscreenExporter exporter(job.snapshot, job.rectSource, job.sizeOutput, job.bkColor);
+	HWND hNotifyWnd = job.hNotifyWnd;
+	int nLastPercent = -1;
+
+	CString strExt = job.strPath.Mid(job.strPath.ReverseFind(_T('.')) + 1);
+	if (strExt.CompareNoCase(_T("svg")) == 0)
+		return SaveSvg(job);
+
+	BOOL bBmp = strExt.CompareNoCase(_T("bmp")) == 0;
+	BOOL bPng = strExt.CompareNoCase(_T("png")) == 0;
+	if (bBmp || bPng)
+	{
+		// BMP 和 PNG 边渲染边写入文件（PNG 在多个线程中并行压缩），渲染完成时保存也完成
+		std::ofstream file(job.strPath.GetString(), std::ios::binary | std::ios::trunc);
+		if (!file)
+			return HRESULT_FROM_WIN32(ERROR_OPEN_FAILED);
+
+		CBmpRowWriter bmpWriter(file);
+		CPngRowWriter pngWriter(file);
+		IImageRowSink& writer = bBmp ? static_cast<IImageRowSink&>(bmpWriter) : pngWriter;
+		BOOL bResult = exporter.Export(writer, [hNotifyWnd, &nLastPercent](int nPercent) {
+			if (nPercent != nLastPercent)
+			{
+				::PostMessage(hNotifyWnd, WM_BACKGROUND_SAVE_PROGRESS, nPercent, 0);
+				nLastPercent = nPercent;
+			}
+		});
+		file.close();
+		return bResult && !file.fail() ? S_OK : E_FAIL;
+	}
+
+	// 其他格式先收集整幅图像再由 CImage 编码；编码阶段没有进度回调，渲染占前 80% 的进度
+	const int nRenderPercent = 80;
+	CImageRowSink sink;
+	BOOL bResult = exporter.Export(sink, [hNotifyWnd, &nLastPercent](int nPercent) {
+		nPercent = nPercent * nRenderPercent / 100;
+		if (nPercent != nLastPercent)
+		{
+			::PostMessage(hNotifyWnd, WM_BACKGROUND_SAVE_PROGRESS, nPercent, 0);
+			nLastPercent = nPercent;
+		}
+	});
+	if (!bResult)
+	{
+		TRACE(_T("Failed to render image for background save\n"));
+		return E_FAIL;
+	}
+	return sink.Save(job.strPath);
+}
+
+HRESULT CBackgroundSaver::SaveSvg(const CSaveJob& job)
+{
+	std::ofstream file(job.strPath.GetString(), std::ios::binary | std::ios::trunc);
+	if (!file)
+		return HRESULT_FROM_WIN32(ERROR_OPEN_FAILED);
+
+	// 逐条命令写出矢量元素，内存占用与命令数量无关
+	CSvgWriter writer(file);
+	if (!writer.Begin(job.rectSource, job.sizeOutput, job.bkColor))
+		return E_FAIL;
+
+	size_t nCount = job.snapshot.GetCommandCount();
+	int nLastPercent = -1;
+	for (CCommandVector::const_iterator it = job.snapshot.GetCommands().begin(); it != job.snapshot.GetCommands().end(); ++it)
+	{
+		writer.WriteCommand((*it)->GetData(), (*it)->GetText(), job.snapshot.GetColorPalette());
+
+		int nPercent = static_cast<int>((it.index() + 1) * 100 / nCount);
+		if (nPercent != nLastPercent)
+		{
+			::PostMessage(job.hNotifyWnd, WM_BACKGROUND_SAVE_PROGRESS, nPercent, 0);
+			nLastPercent = nPercent;
+		}
+	}
+
+	if (!writer.End())
+		return E_FAIL;
+	file.close();
+	return file.fail() ? E_FAIL : S_OK;
+}
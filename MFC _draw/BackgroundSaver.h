@@ -0,0 +1,62 @@
+// BackgroundSaver.h: 后台保存图像
+// 在界面线程中只获取文档快照并启动工作线程，渲染和编码都在工作线程中完成
+//
+
+#pragma once
+
+#include <afxwin.h>
+#include "CommandHistory.h"
+
+// 工作线程发给通知窗口的消息
+#define WM_BACKGROUND_SAVE_PROGRESS  (WM_APP + 1)  // WPARAM: 进度百分比
+#define WM_BACKGROUND_SAVE_DONE      (WM_APP + 2)  // LPARAM: CBackgroundSaveResult*，由接收方删除
+
+// 保存结果
+struct CBackgroundSaveResult
+{
+	HRESULT hr;
+	CString strPath;
+	double dStallMs;  // 界面线程停顿时间（从请求保存到工作线程启动）
+	double dWorkMs;   // 工作线程耗时（渲染 + 编码）
+};
+
+class CBackgroundSaver
+{
+private:
+	// 交给工作线程的任务，由工作线程删除
+	struct CSaveJob
+	{
+		CDocumentSnapshot snapshot;
+		CRect rectSource;
+		CSize sizeOutput;
+		COLORREF bkColor;
+		CString strPath;
+		HWND hNotifyWnd;
+		double dStallMs;
+		CBackgroundSaver* pOwner;
+	};
+
+	CWinThread* m_pThread;
+	volatile LONG m_nBusy;
+
+	// 禁止拷贝构造和赋值
+	CBackgroundSaver(const CBackgroundSaver&) = delete;
+	CBackgroundSaver& operator=(const CBackgroundSaver&) = delete;
+
+	static UINT AFX_CDECL SaveThreadProc(LPVOID pParam);
+	static HRESULT RenderAndSave(const CSaveJob& job);
+	static HRESULT SaveSvg(const CSaveJob& job);
+
+public:
+	CBackgroundSaver();
+	// 析构时等待未完成的保存
+	~CBackgroundSaver();
+
+	// 是否有保存正在进行
+	BOOL IsBusy() const { return m_nBusy != 0; }
+
+	// 开始后台保存：把快照中 rectSource 区域渲染为 sizeOutput 大小的图像并保存到 strPath（格式由扩展名决定）
+	// llRequestTime 为发起保存时的 QueryPerformanceCounter 计数，用于统计界面线程停顿时间
+	BOOL Start(const CDocumentSnapshot& snapshot, const CRect& rectSource, CSize sizeOutput, COLORREF bkColor,
+		const CString& strPath, HWND hNotifyWnd, LONGLONG llRequestTime);
+};
@@ -0,0 +1,145 @@
+// BoundsIndex.cpp: 命令外接矩形空间索引的实现
+//
+
+#include "pch.h"
+#include "BoundsIndex.h"
+
+#include <algorithm>
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+int CBoundsIndex::GetLevel(const CRect& bounds)
+{
+	LONGLONG nExtent = std::max(static_cast<LONGLONG>(bounds.right) - bounds.left, static_cast<LONGLONG>(bounds.bottom) - bounds.top);
+	for (int nLevel = 0; nLevel < LEVEL_COUNT; nLevel++)
+	{
+		if (nExtent <= (1LL << (MIN_CELL_SHIFT + nLevel)))
+			return nLevel;
+	}
+	return LEVEL_COUNT;
+}
+
+template <typename Func>
+void CBoundsIndex::ForEachOwnCell(const CRect& bounds, Func func)
+{
+	if (bounds.IsRectEmpty())
+		return;  // 空矩形与任何区域都不相交，不登记
+
+	int nLevel = GetLevel(bounds);
+	if (nLevel == LEVEL_COUNT)
+	{
+		func(m_large, nullptr, 0);
+		return;
+	}
+	CCellMap& cells = m_levels[nLevel];
+	for (int y = CellCoord(bounds.top, nLevel); y <= CellCoord(bounds.bottom - 1, nLevel); y++)
+	{
+		for (int x = CellCoord(bounds.left, nLevel); x <= CellCoord(bounds.right - 1, nLevel); x++)
+			func(cells[MakeKey(x, y)], &cells, MakeKey(x, y));
+	}
+}
+
+void CBoundsIndex::Add(const CRect& bounds)
+{
+	ASSERT(m_bounds.size() < UINT32_MAX);
+	uint32_t nIndex = static_cast<uint32_t>(m_bounds.size());
+	m_bounds.push_back(bounds);
+	// 新命令的序号最大，直接放在各格子末尾
+	ForEachOwnCell(bounds, [nIndex](CCell& cell, CCellMap*, uint64_t) { cell.push_back(nIndex); });
+}
+
+void CBoundsIndex::RemoveLast()
+{
+	ASSERT(!m_bounds.empty());
+	uint32_t nIndex = static_cast<uint32_t>(m_bounds.size() - 1);
+	CRect bounds = m_bounds.back();
+	m_bounds.pop_back();
+	ForEachOwnCell(bounds, [nIndex](CCell& cell, CCellMap* pCells, uint64_t nKey)
+	{
+		ASSERT(!cell.empty() && cell.back() == nIndex);
+		(void)nIndex;
+		cell.pop_back();
+		if (cell.empty() && pCells != nullptr)
+			pCells->erase(nKey);
+	});
+}
+
+void CBoundsIndex::Update(size_t i, const CRect& bounds)
+{
+	ASSERT(i < m_bounds.size());
+	uint32_t nIndex = static_cast<uint32_t>(i);
+	// 在格子中间删除和插入，保持序号递增
+	ForEachOwnCell(m_bounds[i], [nIndex](CCell& cell, CCellMap* pCells, uint64_t nKey)
+	{
+		CCell::iterator it = std::lower_bound(cell.begin(), cell.end(), nIndex);
+		ASSERT(it != cell.end() && *it == nIndex);
+		cell.erase(it);
+		if (cell.empty() && pCells != nullptr)
+			pCells->erase(nKey);
+	});
+	m_bounds[i] = bounds;
+	ForEachOwnCell(bounds, [nIndex](CCell& cell, CCellMap*, uint64_t)
+	{
+		cell.insert(std::lower_bound(cell.begin(), cell.end(), nIndex), nIndex);
+	});
+}
+
+void CBoundsIndex::Clear()
+{
+	for (CCellMap& cells : m_levels)
+		cells.clear();
+	m_large.clear();
+	m_bounds.clear();
+}
+
+size_t CBoundsIndex::GetMemorySize() const
+{
+	size_t nSize = m_bounds.capacity() * sizeof(CRect) + m_large.capacity() * sizeof(uint32_t);
+	for (const CCellMap& cells : m_levels)
+	{
+		nSize += cells.bucket_count() * sizeof(void*);
+		for (const auto& entry : cells)
+			nSize += sizeof(entry) + sizeof(void*) + entry.second.capacity() * sizeof(uint32_t);
+	}
+	return nSize;
+}
+
+void CBoundsIndex::Query(const CRect& rect, std::vector<size_t>& results) const
+{
+	results.clear();
+	if (rect.IsRectEmpty())
+		return;
+	ForEachCell(rect, [&](const CCell& cell)
+	{
+		for (uint32_t nIndex : cell)
+		{
+			if (Overlaps(m_bounds[nIndex], rect))
+				results.push_back(nIndex);
+		}
+	});
+	std::sort(results.begin(), results.end());
+	results.erase(std::unique(results.begin(), results.end()), results.end());
+}
+
+size_t CBoundsIndex::FindFirst(const CRect& rect, size_t nStart) const
+{
+	size_t nFirst = m_bounds.size();
+	if (rect.IsRectEmpty() || nStart >= nFirst)
+		return nFirst;
+	ForEachCell(rect, [&](const CCell& cell)
+	{
+		// 每个格子只需从 nStart 开始找到第一条相交的命令，且不必超过已找到的结果
+		for (CCell::const_iterator it = std::lower_bound(cell.begin(), cell.end(), static_cast<uint32_t>(nStart));
+			it != cell.end() && *it < nFirst; ++it)
+		{
+			if (Overlaps(m_bounds[*it], rect))
+			{
+				nFirst = *it;
+				break;
+			}
+		}
+	});
+	return nFirst;
+}
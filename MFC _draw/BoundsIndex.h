@@ -0,0 +1,148 @@
+// BoundsIndex.h: 命令外接矩形的空间索引
+// 多级网格：第 k 级的格子边长为 64·2^k，每条命令放在格子边长不小于其外接矩形长边的最低一级，
+// 命令登记在它覆盖的每个格子中，因此最多登记 2×2 个格子；超过最高一级的命令单独存放。查询时每一级只检查与查询区域相交的几个格子。
+// 格子中的命令序号按加入顺序递增，命令通常只在末尾加入和移除（与命令历史相同），撤销时从各格子末尾弹出即可；
+// 替换命令时在格子中间删除和插入，代价与格子中的命令数量成正比。
+// 外接矩形另外按序号连续保存一份，筛选候选命令时不需要访问命令对象。
+//
+
+#pragma once
+
+#include <afxwin.h>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class CBoundsIndex
+{
+public:
+	static const size_t NO_INDEX = static_cast<size_t>(-1);
+
+private:
+	static const int MIN_CELL_SHIFT = 6;  // 最低一级的格子边长为 64
+	static const int LEVEL_COUNT = 11;    // 最高一级的格子边长为 65536
+
+	typedef std::vector<uint32_t> CCell;
+	typedef std::unordered_map<uint64_t, CCell> CCellMap;
+
+	CCellMap m_levels[LEVEL_COUNT];
+	CCell m_large;  // 超过最高一级格子的命令
+	std::vector<CRect> m_bounds;  // 第 i 条命令的外接矩形
+
+	static uint64_t MakeKey(int x, int y)
+	{
+		return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+	}
+	// 向负无穷取整的格子坐标
+	static int CellCoord(int v, int nLevel) { return v >= 0 ? v >> (MIN_CELL_SHIFT + nLevel) : -((-v - 1) >> (MIN_CELL_SHIFT + nLevel)) - 1; }
+	// 外接矩形所在的级别，超过最高一级时返回 LEVEL_COUNT
+	static int GetLevel(const CRect& bounds);
+	// 依次取得登记 bounds 的每个格子：func(格子, 所在的散列表, 键)，单独存放的命令散列表为 nullptr
+	template <typename Func>
+	void ForEachOwnCell(const CRect& bounds, Func func);
+
+	// 依次取得与 rect 相交的每个非空格子（含单独存放的命令）
+	template <typename Visit>
+	void ForEachCell(const CRect& rect, Visit visit) const
+	{
+		if (!m_large.empty())
+			visit(m_large);
+		for (int nLevel = 0; nLevel < LEVEL_COUNT; nLevel++)
+		{
+			const CCellMap& cells = m_levels[nLevel];
+			if (cells.empty())
+				continue;
+			int x0 = CellCoord(rect.left, nLevel), x1 = CellCoord(rect.right - 1, nLevel);
+			int y0 = CellCoord(rect.top, nLevel), y1 = CellCoord(rect.bottom - 1, nLevel);
+			if ((static_cast<double>(x1) - x0 + 1) * (static_cast<double>(y1) - y0 + 1) > static_cast<double>(cells.size()))
+			{
+				// 查询区域覆盖的格子比已有的格子还多时，直接遍历已有的格子
+				for (const auto& entry : cells)
+				{
+					int x = static_cast<int>(static_cast<uint32_t>(entry.first >> 32));
+					int y = static_cast<int>(static_cast<uint32_t>(entry.first));
+					if (x >= x0 && x <= x1 && y >= y0 && y <= y1)
+						visit(entry.second);
+				}
+				continue;
+			}
+			for (int y = y0; y <= y1; y++)
+			{
+				for (int x = x0; x <= x1; x++)
+				{
+					CCellMap::const_iterator it = cells.find(MakeKey(x, y));
+					if (it != cells.end())
+						visit(it->second);
+				}
+			}
+		}
+	}
+
+	// 与 CRect 的相交规则相同，右边和下边不包含在内
+	static bool Overlaps(const CRect& a, const CRect& b)
+	{
+		return a.left < b.right && b.left < a.right && a.top < b.bottom && b.top < a.bottom;
+	}
+
+public:
+	// 在末尾加入一条命令的外接矩形（序号为当前数量）
+	void Add(const CRect& bounds);
+	// 批量加入前预留共 nCount 条命令的容量（按倍数增长，分批调用时不会反复重新分配）
+	void Reserve(size_t nCount)
+	{
+		if (nCount > m_bounds.capacity())
+			m_bounds.reserve(nCount > m_bounds.capacity() * 2 ? nCount : m_bounds.capacity() * 2);
+	}
+	// 移除最后加入的命令
+	void RemoveLast();
+	// 第 i 条命令被替换（移动、缩放）后更新其外接矩形
+	void Update(size_t i, const CRect& bounds);
+	void Clear();
+
+	size_t GetCount() const { return m_bounds.size(); }
+	const CRect& GetBounds(size_t i) const { return m_bounds[i]; }
+	size_t GetMemorySize() const;
+
+	// 外接矩形与 rect 相交的所有命令，结果为递增的序号
+	void Query(const CRect& rect, std::vector<size_t>& results) const;
+	// 序号不小于 nStart、外接矩形与 rect 相交的第一条命令，没有时返回 GetCount()
+	size_t FindFirst(const CRect& rect, size_t nStart) const;
+
+	// 按序号从大到小检查外接矩形与 rect 相交的命令，返回第一条使 accept(i) 为 true 的命令，没有时返回 NO_INDEX
+	template <typename Accept>
+	size_t FindLast(const CRect& rect, Accept accept) const
+	{
+		// 各格子中的序号递增，从末尾开始多路归并；同一条命令在相邻格子中可能出现多次，只检查一次
+		struct CCursor
+		{
+			const uint32_t* pBegin;
+			const uint32_t* pEnd;  // 下一个取出的是 pEnd[-1]
+		};
+		std::vector<CCursor> cursors;
+		ForEachCell(rect, [&](const CCell& cell)
+		{
+			CCursor cursor = { cell.data(), cell.data() + cell.size() };
+			cursors.push_back(cursor);
+		});
+
+		uint32_t nPrevious = UINT32_MAX;
+		for (;;)
+		{
+			CCursor* pMax = nullptr;
+			for (size_t i = 0; i < cursors.size(); i++)
+			{
+				if (cursors[i].pEnd != cursors[i].pBegin && (pMax == nullptr || cursors[i].pEnd[-1] > pMax->pEnd[-1]))
+					pMax = &cursors[i];
+			}
+			if (pMax == nullptr)
+				return NO_INDEX;
+
+			uint32_t nIndex = *--pMax->pEnd;
+			if (nIndex == nPrevious)
+				continue;
+			nPrevious = nIndex;
+			if (Overlaps(m_bounds[nIndex], rect) && accept(nIndex))
+				return nIndex;
+		}
+	}
+};
@@ -0,0 +1,83 @@
+// BufferedWriter.h: 固定大小缓冲区的文本写入器
+// 用于流式导出：内容先写入固定大小的缓冲区，满了再整块写到输出流，
+// 整数直接转换为十进制字符，不经过格式化函数和临时字符串。
+//
+
+#pragma once
+
+#include <cstring>
+#include <ostream>
+#include <vector>
+
+class CBufferedWriter
+{
+private:
+	static const size_t BUFFER_SIZE = 64 * 1024;
+
+	std::ostream& m_out;
+	std::vector<char> m_buffer;
+	size_t m_nUsed;
+
+	// 禁止拷贝构造和赋值
+	CBufferedWriter(const CBufferedWriter&) = delete;
+	CBufferedWriter& operator=(const CBufferedWriter&) = delete;
+
+public:
+	explicit CBufferedWriter(std::ostream& out) : m_out(out), m_buffer(BUFFER_SIZE), m_nUsed(0) {}
+	~CBufferedWriter() { Flush(); }
+
+	void Write(const char* pData, size_t nSize)
+	{
+		if (nSize > BUFFER_SIZE - m_nUsed)
+		{
+			Flush();
+			if (nSize > BUFFER_SIZE)
+			{
+				m_out.write(pData, nSize);
+				return;
+			}
+		}
+		memcpy(m_buffer.data() + m_nUsed, pData, nSize);
+		m_nUsed += nSize;
+	}
+
+	void Write(const char* psz) { Write(psz, strlen(psz)); }
+
+	void Write(char ch)
+	{
+		if (m_nUsed == BUFFER_SIZE)
+			Flush();
+		m_buffer[m_nUsed++] = ch;
+	}
+
+	// 写入十进制整数
+	void WriteInt(long long nValue)
+	{
+		char digits[24];
+		int nCount = 0;
+		unsigned long long nAbs = nValue < 0 ? 0ULL - static_cast<unsigned long long>(nValue) : static_cast<unsigned long long>(nValue);
+		do
+		{
+			digits[nCount++] = static_cast<char>('0' + nAbs % 10);
+			nAbs /= 10;
+		} while (nAbs != 0);
+
+		if (nCount + 1 > static_cast<int>(BUFFER_SIZE - m_nUsed))
+			Flush();
+		if (nValue < 0)
+			m_buffer[m_nUsed++] = '-';
+		while (nCount > 0)
+			m_buffer[m_nUsed++] = digits[--nCount];
+	}
+
+	// 把缓冲区中的内容写到输出流
+	bool Flush()
+	{
+		if (m_nUsed > 0)
+		{
+			m_out.write(m_buffer.data(), m_nUsed);
+			m_nUsed = 0;
+		}
+		return m_out.good();
+	}
+};
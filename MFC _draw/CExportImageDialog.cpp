@@ -0,0 +1,56 @@
+﻿// CExportImageDialog.cpp: 实现文件
+//
+
+#include "pch.h"
+#include "MFC _draw.h"
+#include "afxdialogex.h"
+#include "CExportImageDialog.h"
+
+
+// CExportImageDialog 对话框
+
+IMPLEMENT_DYNAMIC(CExportImageDialog, CDialogEx)
+
+CExportImageDialog::CExportImageDialog(CSize sizeDocument, CWnd* pParent /*=nullptr*/)
+	: CDialogEx(IDD_EXPORT_IMAGE, pParent)
+	, m_sizeDocument(sizeDocument)
+	, m_nDpi(SCREEN_DPI)
+	, m_nWidth(sizeDocument.cx)
+	, m_nHeight(sizeDocument.cy)
+{
+
+}
+
+CExportImageDialog::~CExportImageDialog()
+{
+}
+
+void CExportImageDialog::DoDataExchange(CDataExchange* pDX)
+{
+	CDialogEx::DoDataExchange(pDX);
+	DDX_Text(pDX, IDC_EXPORT_DPI, m_nDpi);
+	DDV_MinMaxInt(pDX, m_nDpi, 1, SCREEN_DPI * 100);
+	DDX_Text(pDX, IDC_EXPORT_WIDTH, m_nWidth);
+	DDV_MinMaxInt(pDX, m_nWidth, 1, MAX_EXPORT_SIZE);
+	DDX_Text(pDX, IDC_EXPORT_HEIGHT, m_nHeight);
+	DDV_MinMaxInt(pDX, m_nHeight, 1, MAX_EXPORT_SIZE);
+}
+
+
+BEGIN_MESSAGE_MAP(CExportImageDialog, CDialogEx)
+	ON_EN_CHANGE(IDC_EXPORT_DPI, &CExportImageDialog::OnChangeDpi)
+END_MESSAGE_MAP()
+
+
+// CExportImageDialog 消息处理程序
+
+void CExportImageDialog::OnChangeDpi()
+{
+	BOOL bTranslated = FALSE;
+	int nDpi = static_cast<int>(GetDlgItemInt(IDC_EXPORT_DPI, &bTranslated, FALSE));
+	if (!bTranslated || nDpi <= 0)
+		return;
+
+	SetDlgItemInt(IDC_EXPORT_WIDTH, max(1, MulDiv(m_sizeDocument.cx, nDpi, SCREEN_DPI)), FALSE);
+	SetDlgItemInt(IDC_EXPORT_HEIGHT, max(1, MulDiv(m_sizeDocument.cy, nDpi, SCREEN_DPI)), FALSE);
+}
@@ -0,0 +1,35 @@
+﻿#pragma once
+#include "afxdialogex.h"
+
+
+// CExportImageDialog 对话框
+// 选择导出图像的分辨率：修改 DPI 时按文档范围换算宽度和高度，也可以直接输入宽度和高度
+
+class CExportImageDialog : public CDialogEx
+{
+	DECLARE_DYNAMIC(CExportImageDialog)
+
+public:
+	static const int SCREEN_DPI = 96;       // 文档坐标对应的分辨率
+	static const int MAX_EXPORT_SIZE = 65535;
+
+	CExportImageDialog(CSize sizeDocument, CWnd* pParent = nullptr);   // 标准构造函数
+	virtual ~CExportImageDialog();
+
+// 对话框数据
+#ifdef AFX_DESIGN_TIME
+	enum { IDD = IDD_EXPORT_IMAGE };
+#endif
+
+protected:
+	virtual void DoDataExchange(CDataExchange* pDX);    // DDX/DDV 支持
+
+	DECLARE_MESSAGE_MAP()
+public:
+	afx_msg void OnChangeDpi();
+
+	CSize m_sizeDocument;  // 文档范围（逻辑单位）
+	int m_nDpi;
+	int m_nWidth;
+	int m_nHeight;
+};
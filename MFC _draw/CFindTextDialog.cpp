@@ -0,0 +1,36 @@
+﻿// CFindTextDialog.cpp: 实现文件
+//
+
+#include "pch.h"
+#include "MFC _draw.h"
+#include "afxdialogex.h"
+#include "CFindTextDialog.h"
+
+
+// CFindTextDialog 对话框
+
+IMPLEMENT_DYNAMIC(CFindTextDialog, CDialogEx)
+
+CFindTextDialog::CFindTextDialog(const CString& strText, CWnd* pParent /*=nullptr*/)
+	: CDialogEx(IDD_FIND_TEXT, pParent)
+	, m_strText(strText)
+{
+
+}
+
+CFindTextDialog::~CFindTextDialog()
+{
+}
+
+void CFindTextDialog::DoDataExchange(CDataExchange* pDX)
+{
+	CDialogEx::DoDataExchange(pDX);
+	DDX_Text(pDX, IDC_FIND_TEXT, m_strText);
+}
+
+
+BEGIN_MESSAGE_MAP(CFindTextDialog, CDialogEx)
+END_MESSAGE_MAP()
+
+
+// CFindTextDialog 消息处理程序
@@ -0,0 +1,27 @@
+﻿#pragma once
+#include "afxdialogex.h"
+
+
+// CFindTextDialog 对话框
+// 输入要在文本对象中查找的内容（不区分大小写）
+
+class CFindTextDialog : public CDialogEx
+{
+	DECLARE_DYNAMIC(CFindTextDialog)
+
+public:
+	CFindTextDialog(const CString& strText, CWnd* pParent = nullptr);   // 标准构造函数
+	virtual ~CFindTextDialog();
+
+// 对话框数据
+#ifdef AFX_DESIGN_TIME
+	enum { IDD = IDD_FIND_TEXT };
+#endif
+
+protected:
+	virtual void DoDataExchange(CDataExchange* pDX);    // DDX/DDV 支持
+
+	DECLARE_MESSAGE_MAP()
+public:
+	CString m_strText;
+};
@@ -0,0 +1,49 @@
+// ColorPalette.cpp: 文档颜色表的实现
+//
+
+#include "pch.h"
+#include "ColorPalette.h"
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+CColorPalette::CColorPalette() : m_nCount(1), m_nCapacity(FIRST_BLOCK_SIZE)
+{
+	m_blocks[0].reset(new COLORREF[FIRST_BLOCK_SIZE]);
+	m_blocks[0][BLACK_INDEX] = RGB(0, 0, 0);
+}
+
+CColorPalette::ColorIndex CColorPalette::Intern(COLORREF color)
+{
+	if (color == RGB(0, 0, 0))
+		return BLACK_INDEX;
+
+	auto it = m_lookup.find(color);
+	if (it != m_lookup.end())
+		return it->second;
+
+	// 只有 COLORREF 的高字节不为 0（非 RGB 颜色）时才可能超过 MAX_COLORS 种
+	if (m_nCount >= MAX_COLORS)
+	{
+		TRACE(_T("文档颜色表已满\n"));
+		AfxThrowMemoryException();
+	}
+
+	// 新的块在写入颜色之前分配，已有的块不移动
+	ColorIndex nIndex = m_nCount;
+	if (nIndex == m_nCapacity)
+	{
+		const UINT nBlock = HighestBit(nIndex + FIRST_BLOCK_SIZE) - FIRST_BLOCK_BITS;
+		m_blocks[nBlock].reset(new COLORREF[FIRST_BLOCK_SIZE << nBlock]);
+		m_nCapacity += FIRST_BLOCK_SIZE << nBlock;
+	}
+
+	// 先写入颜色再返回序号，其他线程只能通过之后创建的快照读到这个序号
+	const UINT nOffset = nIndex + FIRST_BLOCK_SIZE;
+	const UINT nBlock = HighestBit(nOffset) - FIRST_BLOCK_BITS;
+	m_blocks[nBlock][nOffset - (FIRST_BLOCK_SIZE << nBlock)] = color;
+	m_nCount++;
+	m_lookup.emplace(color, nIndex);
+	return nIndex;
+}
@@ -0,0 +1,69 @@
+// ColorPalette.h: 文档颜色表
+// 实际文档只用到少量颜色，绘图数据中只保存颜色在文档颜色表中的序号（24 位，见 DrawData），重放时按序号取数组元素，
+// 不需要判断和查找。颜色表属于文档（CDocumentModel），只追加，已分配的序号在颜色表的生命周期内不变，
+// 所以后台线程通过快照读取命令颜色时不需要加锁；清空文档时换成新的颜色表，旧快照仍使用原来的颜色表。
+// 颜色保存在按需分配的块中，每块是前一块的两倍大，追加时已有的块不移动；内存随用到的颜色数量增长。
+// 24 位序号能容纳所有 RGB 颜色，不会用其他颜色代替新的颜色。
+// 保存文档时只把用到的颜色写成文件中的颜色表（见 CDocumentModel::StoreCommands）。
+// 只在拥有者（界面）线程中追加。
+//
+
+#pragma once
+
+#include <afxwin.h>
+#include <memory>
+#include <unordered_map>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+class CColorPalette
+{
+public:
+	typedef UINT ColorIndex;
+	static const UINT INDEX_BITS = 24;
+	static const UINT MAX_COLORS = 1 << INDEX_BITS;
+	static const ColorIndex BLACK_INDEX = 0;  // 序号 0 固定为黑色（绘图数据的默认颜色）
+
+	CColorPalette();
+
+	// 返回颜色的序号，颜色表中没有时追加；超过 MAX_COLORS 种颜色时抛出 CMemoryException
+	ColorIndex Intern(COLORREF color);
+	// 获取序号对应的颜色（可在任意线程调用，序号必须已分配）
+	COLORREF Get(ColorIndex nIndex) const
+	{
+		const UINT nOffset = nIndex + FIRST_BLOCK_SIZE;
+		const UINT nBlock = HighestBit(nOffset) - FIRST_BLOCK_BITS;
+		return m_blocks[nBlock][nOffset - (FIRST_BLOCK_SIZE << nBlock)];
+	}
+	// 已分配的序号数量（包括黑色）
+	UINT GetCount() const { return m_nCount; }
+	// 已分配的块占用的内存（字节），不含查找表
+	size_t GetMemorySize() const { return m_nCapacity * sizeof(COLORREF); }
+
+private:
+	// 第 k 块保存序号 [FIRST_BLOCK_SIZE * (2^k - 1), FIRST_BLOCK_SIZE * (2^(k+1) - 1))，共 FIRST_BLOCK_SIZE << k 种颜色
+	static const UINT FIRST_BLOCK_BITS = 4;
+	static const UINT FIRST_BLOCK_SIZE = 1 << FIRST_BLOCK_BITS;
+	static const UINT BLOCK_COUNT = INDEX_BITS - FIRST_BLOCK_BITS + 1;
+
+	std::unique_ptr<COLORREF[]> m_blocks[BLOCK_COUNT];
+	std::unordered_map<COLORREF, ColorIndex> m_lookup;
+	UINT m_nCount;
+	UINT m_nCapacity;  // 已分配的块能容纳的颜色数量
+
+	static UINT HighestBit(UINT n)
+	{
+#ifdef _MSC_VER
+		unsigned long nBit;
+		_BitScanReverse(&nBit, n);
+		return nBit;
+#else
+		return 31 - __builtin_clz(n);
+#endif
+	}
+
+	// 禁止拷贝构造和赋值（快照通过 shared_ptr 共享同一个颜色表）
+	CColorPalette(const CColorPalette&) = delete;
+	CColorPalette& operator=(const CColorPalette&) = delete;
+};
@@ -0,0 +1,250 @@
+// CommandHistory.cpp: 命令历史与文档快照的实现
+//
+
+#include "pch.h"
+#include "CommandHistory.h"
+
+// CDocumentSnapshot 实现
+void CDocumentSnapshot::RedrawAll(CDC* pDC) const
+{
+	for (const CDrawCommandPtr& cmd : m_commands)
+	{
+		cmd->Execute(pDC, *m_pPalette);
+	}
+}
+
+CRect CDocumentSnapshot::GetExtent() const
+{
+	CRect extent(0, 0, 0, 0);
+	for (const CDrawCommandPtr& cmd : m_commands)
+	{
+		const CRect& bounds = cmd->GetBounds();
+		if (bounds.IsRectEmpty())
+			continue;
+		extent.left = min(extent.left, bounds.left);
+		extent.top = min(extent.top, bounds.top);
+		extent.right = max(extent.right, bounds.right);
+		extent.bottom = max(extent.bottom, bounds.bottom);
+	}
+	return extent;
+}
+
+// CCommandHistory 实现
+CCommandHistory::CCommandHistory()
+	: m_nCurrent(0), m_nGroupSteps(0), m_bGroupOpen(FALSE)
+{
+	Clear();
+}
+
+CCommandHistory::CNode& CCommandHistory::AddNode()
+{
+	size_t nNode = m_nodes.size();
+	m_nodes.emplace_back();
+	CNode& node = m_nodes.back();
+	node.nParent = m_nCurrent;
+	node.nFirstChild = NO_NODE;
+	node.nNextSibling = NO_NODE;
+	node.nRedoChild = NO_NODE;
+	node.nUnitSteps = m_bGroupOpen ? 0 : 1;
+	node.nLastVisited = NO_NODE;
+
+	// 新分支排在最后，并成为重做的方向
+	CNode& parent = m_nodes[m_nCurrent];
+	if (parent.nFirstChild == NO_NODE)
+	{
+		parent.nFirstChild = nNode;
+	}
+	else
+	{
+		size_t nLast = parent.nFirstChild;
+		while (m_nodes[nLast].nNextSibling != NO_NODE)
+			nLast = m_nodes[nLast].nNextSibling;
+		m_nodes[nLast].nNextSibling = nNode;
+	}
+	parent.nRedoChild = nNode;
+	m_nCurrent = nNode;
+	if (m_bGroupOpen)
+		m_nGroupSteps++;
+	return node;
+}
+
+void CCommandHistory::BeginGroup()
+{
+	ASSERT(!m_bGroupOpen);
+	m_bGroupOpen = TRUE;
+	m_nGroupSteps = 0;
+}
+
+size_t CCommandHistory::EndGroup()
+{
+	ASSERT(m_bGroupOpen);
+	m_bGroupOpen = FALSE;
+	if (m_nGroupSteps > 0)
+		m_nodes[m_nCurrent].nUnitSteps = m_nGroupSteps;
+	return m_nGroupSteps;
+}
+
+void CCommandHistory::AddCommand(CDrawCommand* pCommand)
+{
+	if (pCommand == nullptr)
+		return;
+
+	AddCommand(CDrawCommandPtr(pCommand));
+}
+
+void CCommandHistory::AddCommand(CDrawCommandPtr command)
+{
+	if (!command)
+		return;
+
+	m_done.push_back(command);
+	AddNode().command = std::move(command);
+}
+
+void CCommandHistory::AddBaseCommand(CDrawCommandPtr command)
+{
+	ASSERT(m_nodes.size() == 1 && !m_bGroupOpen);
+	if (!command)
+		return;
+
+	m_done.push_back(std::move(command));
+}
+
+CHistoryStep CCommandHistory::ReplaceCommands(std::vector<CCommandReplacement>&& replacements)
+{
+	CHistoryStep step;
+	if (replacements.empty())
+		return step;
+
+	for (CCommandReplacement& replacement : replacements)
+	{
+		ASSERT(replacement.nIndex < m_done.size() && replacement.after);
+		replacement.before = m_done[replacement.nIndex];
+		m_done.set(replacement.nIndex, replacement.after);
+	}
+	CNode& node = AddNode();
+	node.replacements.reset(new std::vector<CCommandReplacement>(std::move(replacements)));
+	step.pReplacements = node.replacements.get();
+	return step;
+}
+
+CHistoryStep CCommandHistory::UndoStep()
+{
+	CHistoryStep step;
+	CNode& node = m_nodes[m_nCurrent];
+	ASSERT(node.nParent != NO_NODE);
+	if (node.command)
+	{
+		ASSERT(m_done.back() == node.command);
+		m_done.pop_back();
+		step.pCommand = node.command.get();
+	}
+	else
+	{
+		// 换回原来的命令（倒序，同一条命令被替换多次时最后换回最早的版本）
+		for (auto it = node.replacements->rbegin(); it != node.replacements->rend(); ++it)
+			m_done.set(it->nIndex, it->before);
+		step.pReplacements = node.replacements.get();
+	}
+
+	// 重做时回到刚离开的分支
+	m_nodes[node.nParent].nRedoChild = m_nCurrent;
+	m_nCurrent = node.nParent;
+	return step;
+}
+
+CHistoryStep CCommandHistory::RedoStep(size_t nChild)
+{
+	CHistoryStep step;
+	CNode& node = m_nodes[nChild];
+	ASSERT(node.nParent == m_nCurrent);
+	if (node.command)
+	{
+		m_done.push_back(node.command);
+		step.pCommand = node.command.get();
+	}
+	else
+	{
+		for (const CCommandReplacement& replacement : *node.replacements)
+			m_done.set(replacement.nIndex, replacement.after);
+		step.pReplacements = node.replacements.get();
+	}
+
+	m_nodes[m_nCurrent].nRedoChild = nChild;
+	m_nCurrent = nChild;
+	return step;
+}
+
+size_t CCommandHistory::FindFork(size_t* pnChild) const
+{
+	// 当前节点本身有多个子节点时，所在的分支是重做的方向
+	size_t nChild = m_nodes[m_nCurrent].nRedoChild;
+	for (size_t nNode = m_nCurrent; nNode != NO_NODE; nChild = nNode, nNode = m_nodes[nNode].nParent)
+	{
+		const CNode& node = m_nodes[nNode];
+		if (node.nFirstChild != NO_NODE && m_nodes[node.nFirstChild].nNextSibling != NO_NODE)
+		{
+			if (pnChild != nullptr)
+				*pnChild = nChild;
+			return nNode;
+		}
+	}
+	return NO_NODE;
+}
+
+size_t CCommandHistory::GetSiblingBranch(size_t nFork, size_t nChild, BOOL bNext) const
+{
+	size_t nFirst = m_nodes[nFork].nFirstChild;
+	if (bNext)
+	{
+		size_t nNext = m_nodes[nChild].nNextSibling;
+		return nNext != NO_NODE ? nNext : nFirst;
+	}
+
+	// 上一个：nChild 前面的兄弟节点，nChild 是第一个时取最后一个
+	size_t nPrevious = nFirst;
+	if (nChild == nFirst)
+	{
+		while (m_nodes[nPrevious].nNextSibling != NO_NODE)
+			nPrevious = m_nodes[nPrevious].nNextSibling;
+		return nPrevious;
+	}
+	while (m_nodes[nPrevious].nNextSibling != nChild)
+		nPrevious = m_nodes[nPrevious].nNextSibling;
+	return nPrevious;
+}
+
+BOOL CCommandHistory::GetBranchPosition(size_t& nBranch, size_t& nBranches) const
+{
+	size_t nChild;
+	size_t nFork = FindFork(&nChild);
+	if (nFork == NO_NODE)
+		return FALSE;
+
+	nBranch = 0;
+	nBranches = 0;
+	for (size_t n = m_nodes[nFork].nFirstChild; n != NO_NODE; n = m_nodes[n].nNextSibling)
+	{
+		nBranches++;
+		if (n == nChild)
+			nBranch = nBranches;
+	}
+	return TRUE;
+}
+
+void CCommandHistory::Clear()
+{
+	m_done.clear();
+	m_nodes.clear();
+	m_nodes.emplace_back();
+	CNode& root = m_nodes.back();
+	root.nParent = NO_NODE;
+	root.nFirstChild = NO_NODE;
+	root.nNextSibling = NO_NODE;
+	root.nRedoChild = NO_NODE;
+	root.nUnitSteps = 0;
+	root.nLastVisited = NO_NODE;
+	m_nCurrent = 0;
+	m_nGroupSteps = 0;
+	m_bGroupOpen = FALSE;
+}
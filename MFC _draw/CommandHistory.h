@@ -0,0 +1,190 @@
+﻿// CommandHistory.h: 命令历史（撤销/重做）与文档快照的声明
+// 设计模式：命令模式 + 持久化数据结构
+//
+
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <vector>
+#include "DrawCommand.h"
+#include "PersistentVector.h"
+
+typedef std::shared_ptr<CDrawCommand> CDrawCommandPtr;
+typedef CPersistentVector<CDrawCommandPtr> CCommandVector;
+
+// 文档快照：某一时刻命令列表的不可变版本
+// 获取快照只复制两个引用计数指针（O(1)，不分配内存），之后文档继续编辑不会影响快照。
+// 快照可以传给其他线程（保存、导出、缩略图、后台渲染）读取；命令对象和文档颜色表由快照共同持有，
+// 不会在读取期间被释放。
+class CDocumentSnapshot
+{
+private:
+	CCommandVector m_commands;
+	std::shared_ptr<const CColorPalette> m_pPalette;  // 命令颜色序号所指的文档颜色表
+
+public:
+	CDocumentSnapshot() {}
+	CDocumentSnapshot(const CCommandVector& commands, const std::shared_ptr<const CColorPalette>& pPalette)
+		: m_commands(commands), m_pPalette(pPalette) {}
+
+	// 获取命令数量
+	size_t GetCommandCount() const { return m_commands.size(); }
+	// 获取第 i 条命令
+	CDrawCommand* GetCommand(size_t i) const { return m_commands[i].get(); }
+	// 获取命令列表（用于顺序遍历）
+	const CCommandVector& GetCommands() const { return m_commands; }
+	// 获取文档颜色表（用于重放和导出命令）
+	const CColorPalette& GetColorPalette() const { return *m_pPalette; }
+	// 共享文档颜色表（只保留部分命令、不保留快照时使用，如剪贴板）
+	const std::shared_ptr<const CColorPalette>& GetSharedColorPalette() const { return m_pPalette; }
+	// 按顺序重放所有命令
+	void RedrawAll(CDC* pDC) const;
+	// 计算文档范围：原点到所有命令外接矩形的并集
+	CRect GetExtent() const;
+};
+
+// 替换已有命令（移动、缩放选中的图形）时的一条记录：第 nIndex 条命令由 before 换成 after
+struct CCommandReplacement
+{
+	size_t nIndex;
+	CDrawCommandPtr before;
+	CDrawCommandPtr after;
+};
+
+// 撤销或重做的一步：删除或追加了末尾的一条命令 pCommand，或者替换了一组命令 pReplacements
+// （撤销时由 after 换回 before，重做时由 before 换成 after）；两者都为空时表示没有可撤销/重做的操作
+struct CHistoryStep
+{
+	CDrawCommand* pCommand;
+	const std::vector<CCommandReplacement>* pReplacements;
+
+	CHistoryStep() : pCommand(nullptr), pReplacements(nullptr) {}
+	BOOL IsEmpty() const { return pCommand == nullptr && pReplacements == nullptr; }
+};
+
+// 命令历史：撤销树
+// 每一步操作（追加一条命令或替换一组命令）是树中的一个节点，只保存这一步本身；从根到某个节点的路径就是得到该状态的操作序列，
+// 所以各分支共用前面相同的部分，保留一个分支只需要它自己的那些步骤。撤销后再做新操作时，新操作成为同一节点的另一个子节点，
+// 原来的操作仍然保留在树中，可以通过 SwitchBranch 切换回去。
+// 当前文档的命令列表单独保存在持久化向量中：追加、撤销时在末尾追加、弹出，替换通过 set 完成，只复制被修改的路径，
+// 之前获取的快照不受影响。切换分支时先撤销到分叉点，再沿另一个分支重做，只有两条路径上的步骤影响的区域需要重绘。
+// BeginGroup 和 EndGroup 之间的多步组成一个撤销单元：中间的节点标记为 0 步，最后一个节点记下整个分组的步数；
+// 分组期间不能撤销，所以分组中间的节点不会分叉。
+class CCommandHistory
+{
+private:
+	static const size_t NO_NODE = static_cast<size_t>(-1);
+
+	struct CNode
+	{
+		size_t nParent;       // 根节点为 NO_NODE
+		size_t nFirstChild;   // 子节点按创建顺序通过 nNextSibling 连接
+		size_t nNextSibling;
+		size_t nRedoChild;    // 重做时前往的子节点：最近一次创建或离开的分支，没有子节点时为 NO_NODE
+		size_t nUnitSteps;    // 以本节点结束的撤销单元包含的步数；分组中间的节点为 0
+		size_t nLastVisited;  // 分叉点的子节点：通过 SwitchBranch 离开这个分支时所在的节点，没有时为 NO_NODE
+		CDrawCommandPtr command;  // 追加的命令；替换时为空
+		std::unique_ptr<std::vector<CCommandReplacement>> replacements;  // 替换的命令（很少使用，单独分配）
+	};
+
+	CCommandVector m_done;       // 当前状态的命令列表
+	std::deque<CNode> m_nodes;   // 撤销树，m_nodes[0] 为根（空文档或打开的文件内容）；按块分配，增长时不移动已有节点
+	size_t m_nCurrent;           // 当前状态所在的节点
+	size_t m_nGroupSteps;        // 当前分组已有的步数
+	BOOL m_bGroupOpen;
+
+	// 在当前节点下添加一步并移到该节点
+	CNode& AddNode();
+	// 撤销当前节点的一步，移到父节点
+	CHistoryStep UndoStep();
+	// 重做子节点 nChild 的一步，移到该节点
+	CHistoryStep RedoStep(size_t nChild);
+	// 当前节点及其祖先中离当前节点最近的分叉点（有多个子节点），pnChild 返回当前所在的分支；没有时返回 NO_NODE
+	size_t FindFork(size_t* pnChild = nullptr) const;
+	// 分叉点 nFork 下 nChild 的下一个或上一个兄弟节点（循环）
+	size_t GetSiblingBranch(size_t nFork, size_t nChild, BOOL bNext) const;
+
+public:
+	CCommandHistory();
+
+	// 添加命令（接管所有权），作为当前节点下新的一步（之前撤销的操作保留在原来的分支中）
+	void AddCommand(CDrawCommand* pCommand);
+	void AddCommand(CDrawCommandPtr command);
+	// 添加文档的初始命令（打开文件时使用）：只追加到命令列表，不成为撤销的一步，撤销不会删除它；
+	// 只能在撤销树为空时调用
+	void AddBaseCommand(CDrawCommandPtr command);
+	// 作为一步操作替换一组命令（调用方填入 nIndex 和 after，before 由这里填入当前命令）；
+	// 返回的 CHistoryStep 与重做时相同
+	CHistoryStep ReplaceCommands(std::vector<CCommandReplacement>&& replacements);
+	// 开始一个分组：之后直到 EndGroup 的所有步骤作为一个撤销单元；分组不能嵌套，分组期间不能撤销、重做或切换分支
+	void BeginGroup();
+	// 结束分组，返回分组包含的步数
+	size_t EndGroup();
+	BOOL IsGroupOpen() const { return m_bGroupOpen; }
+
+	// 撤销最近的一个撤销单元（一步操作或一个分组中的所有步骤），每撤销一步调用一次 onStep(step)，
+	// step 只在回调期间有效；没有可撤销的操作时返回 FALSE
+	template <typename OnStep>
+	BOOL Undo(OnStep onStep)
+	{
+		ASSERT(!m_bGroupOpen);
+		size_t nSteps = m_nodes[m_nCurrent].nUnitSteps;
+		for (size_t i = 0; i < nSteps; i++)
+			onStep(UndoStep());
+		return nSteps > 0;
+	}
+	// 沿当前分支重做下一个撤销单元，onStep 同上
+	template <typename OnStep>
+	BOOL Redo(OnStep onStep)
+	{
+		ASSERT(!m_bGroupOpen);
+		size_t nChild = m_nodes[m_nCurrent].nRedoChild;
+		if (nChild == NO_NODE)
+			return FALSE;
+		do
+		{
+			onStep(RedoStep(nChild));
+			nChild = m_nodes[m_nCurrent].nRedoChild;
+		} while (m_nodes[m_nCurrent].nUnitSteps == 0);
+		return TRUE;
+	}
+	// 切换到最近的分叉点的下一个（bNext 为 TRUE）或上一个分支（循环）：先撤销到分叉点，再沿新分支重做，
+	// 每一步调用一次 onStep(step, bUndo)。之前通过切换离开过该分支时停在离开时所在的节点（当时已撤销的步骤不会重做），
+	// 否则重做到该分支的末端；没有分叉时返回 FALSE
+	template <typename OnStep>
+	BOOL SwitchBranch(BOOL bNext, OnStep onStep)
+	{
+		ASSERT(!m_bGroupOpen);
+		size_t nChild;
+		size_t nFork = FindFork(&nChild);
+		if (nFork == NO_NODE)
+			return FALSE;
+
+		size_t nTarget = GetSiblingBranch(nFork, nChild, bNext);
+		if (m_nCurrent != nFork)
+			m_nodes[nChild].nLastVisited = m_nCurrent;
+		while (m_nCurrent != nFork)
+			onStep(UndoStep(), TRUE);
+		// 离开时所在的节点之后又在分支中分叉时，它可能不在重做的方向上，这时重做到末端
+		const size_t nStop = m_nodes[nTarget].nLastVisited;
+		for (size_t n = nTarget; n != NO_NODE && m_nCurrent != nStop; n = m_nodes[m_nCurrent].nRedoChild)
+			onStep(RedoStep(n), FALSE);
+		return TRUE;
+	}
+	// 清除所有命令和整个撤销树（仍被快照引用的命令会在快照释放后删除）
+	void Clear();
+
+	BOOL CanUndo() const { return m_nodes[m_nCurrent].nUnitSteps > 0; }
+	BOOL CanRedo() const { return m_nodes[m_nCurrent].nRedoChild != NO_NODE; }
+	BOOL CanSwitchBranch() const { return FindFork() != NO_NODE; }
+	// 最近的分叉点的分支数量和当前所在分支的序号（从 1 开始，按创建顺序）；没有分叉时返回 FALSE
+	BOOL GetBranchPosition(size_t& nBranch, size_t& nBranches) const;
+	// 撤销树的节点数量（根节点除外），即所有分支的步数之和
+	size_t GetStepCount() const { return m_nodes.size() - 1; }
+
+	// 获取当前命令数量
+	size_t GetCommandCount() const { return m_done.size(); }
+	// 获取当前命令列表（仅供拥有者线程使用）
+	const CCommandVector& GetCommands() const { return m_done; }
+};
@@ -0,0 +1,654 @@
+// DocumentModel.cpp: 文档模型的实现
+//
+
+#include "pch.h"
+#include "DocumentModel.h"
+#include "DrawRecordReader.h"
+#include "Metrics.h"
+#include "TraceProfiler.h"
+
+#include <cmath>
+#include <memory>
+#include <utility>
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+static bool RectsOverlap(const CRect& a, const CRect& b)
+{
+	return a.left < b.right && b.left < a.right && a.top < b.bottom && b.top < a.bottom;
+}
+
+// 获取重放时的可见区域（逻辑坐标）；无法取得时返回 FALSE，此时重放所有命令
+static BOOL GetVisibleRect(CDC* pDC, CRect& rect)
+{
+	int nResult = pDC->GetClipBox(&rect);
+	if (nResult == ERROR)
+		return FALSE;
+	if (nResult == NULLREGION)
+		rect.SetRectEmpty();
+	return TRUE;
+}
+
+// 重放时的筛选：不在可见区域内的命令跳过；缩小显示时小于一个像素的命令也跳过，其余命令低细节绘制
+class CRedrawFilter
+{
+private:
+	const CColorPalette& m_palette;
+	CRect m_rectVisible;
+	BOOL m_bCull;
+	BOOL m_bLowDetail;
+	double m_dPixel;  // 一个像素对应的文档长度
+
+public:
+	CRedrawFilter(CDC* pDC, const CColorPalette& palette, double dScale) : m_palette(palette)
+	{
+		m_bCull = GetVisibleRect(pDC, m_rectVisible);
+		m_bLowDetail = dScale > 0 && dScale < 1.0;
+		m_dPixel = m_bLowDetail ? 1.0 / dScale : 1.0;
+	}
+
+	bool IsVisible(const CDrawCommand* pCommand) const
+	{
+		const CRect& bounds = pCommand->GetBounds();
+		if (m_bCull && !RectsOverlap(bounds, m_rectVisible))
+			return false;
+		return !m_bLowDetail || bounds.Width() >= m_dPixel || bounds.Height() >= m_dPixel;
+	}
+
+	void Draw(CDrawCommand* pCommand, CDC* pDC) const
+	{
+		if (m_bLowDetail)
+			pCommand->ExecuteLowDetail(pDC, m_palette, m_dPixel / 2);
+		else
+			pCommand->Execute(pDC, m_palette);
+	}
+};
+
+// 跳过的命令（不可见或小于一个像素）都计入 nCulled
+static void CountRedraw(size_t nReplayed, size_t nCulled)
+{
+	static CMetricCounter& s_replayed = CMetricsRegistry::Instance().GetCounter(DrawMetrics::COMMANDS_REPLAYED);
+	static CMetricCounter& s_culled = CMetricsRegistry::Instance().GetCounter(DrawMetrics::COMMANDS_CULLED);
+	s_replayed.Add(static_cast<long long>(nReplayed));
+	s_culled.Add(static_cast<long long>(nCulled));
+}
+
+void CDocumentModel::AddCommand(CDrawCommand* pCommand)
+{
+	PROFILE_FUNCTION();
+	if (pCommand == nullptr)
+		return;
+
+	// 添加到命令历史（作为撤销树当前节点下新的一步）
+	m_history.AddCommand(pCommand);
+	OnCommandAppended(pCommand);
+	if (m_nTransactionDepth > 0)
+		m_rectTransaction.UnionRect(&m_rectTransaction, &pCommand->GetBounds());
+}
+
+void CDocumentModel::AppendDrawData(DrawData&& data)
+{
+	CDrawCommandPtr command = MakeSharedDrawCommand(std::move(data), m_stringPool);
+	if (!command)
+		return;
+	m_history.AddCommand(command);
+	OnCommandAppended(command.get());
+	if (m_nTransactionDepth > 0)
+		m_rectTransaction.UnionRect(&m_rectTransaction, &command->GetBounds());
+}
+
+void CDocumentModel::AddDrawData(const DrawData* pFirst, const DrawData* pLast, CRect* pChanged)
+{
+	PROFILE_FUNCTION();
+	BeginTransaction();
+	m_boundsIndex.Reserve(GetCommandCount() + static_cast<size_t>(pLast - pFirst));
+	for (const DrawData* p = pFirst; p != pLast; ++p)
+		AppendDrawData(DrawData(*p));
+	EndTransaction(pChanged);
+}
+
+void CDocumentModel::AddDrawData(std::vector<DrawData>&& data, CRect* pChanged)
+{
+	PROFILE_FUNCTION();
+	BeginTransaction();
+	m_boundsIndex.Reserve(GetCommandCount() + data.size());
+	for (DrawData& item : data)
+		AppendDrawData(std::move(item));
+	data.clear();
+	EndTransaction(pChanged);
+}
+
+BOOL CDocumentModel::ImportDrawRecords(std::istream& in, size_t* pnImported, size_t* pnErrorLine, CRect* pChanged)
+{
+	PROFILE_FUNCTION();
+	// 每条记录读入同一个 DrawData 后移入命令，读取本身不为每条记录分配内存（铅笔轨迹的点除外）
+	CDrawRecordReader reader(in, *m_pColorPalette);
+	DrawData data;
+	CString text;
+	size_t nImported = 0;
+	BeginTransaction();
+	while (reader.Read(data, text))
+	{
+		if (nImported % IMPORT_BATCH_SIZE == 0)
+			m_boundsIndex.Reserve(GetCommandCount() + IMPORT_BATCH_SIZE);
+		if (data.drawType == DrawData::DrawType::Text)
+			data.nTextId = m_stringPool.Intern(text);
+		AppendDrawData(std::move(data));
+		nImported++;
+	}
+	EndTransaction(pChanged);
+
+	if (pnImported != nullptr)
+		*pnImported = nImported;
+	if (pnErrorLine != nullptr)
+		*pnErrorLine = reader.HasError() ? reader.GetLineNumber() : 0;
+	return !reader.HasError();
+}
+
+void CDocumentModel::PasteCommands(const std::vector<CDrawCommandPtr>& commands, const CColorPalette& palette,
+	const DrawTransform& transform, CRect* pChanged)
+{
+	PROFILE_FUNCTION();
+	BeginTransaction();
+	m_boundsIndex.Reserve(GetCommandCount() + commands.size());
+	for (const CDrawCommandPtr& cmd : commands)
+	{
+		DrawData data(cmd->GetData());
+		transform.Apply(data);
+		data.SetPenColor(*m_pColorPalette, data.GetPenColor(palette));
+		data.SetBrushColor(*m_pColorPalette, data.GetBrushColor(palette));
+		data.nTextId = m_stringPool.Intern(cmd->GetText());
+		AppendDrawData(std::move(data));
+	}
+	EndTransaction(pChanged);
+}
+
+BOOL CDocumentModel::TransformCommands(const std::vector<size_t>& indices, const DrawTransform& transform, CRect* pChanged)
+{
+	PROFILE_FUNCTION();
+	if (pChanged != nullptr)
+		pChanged->SetRectEmpty();
+	if (indices.empty() || transform.IsIdentity())
+		return FALSE;
+
+	// 新命令替换原来的命令，序号和绘制顺序不变
+	std::vector<CCommandReplacement> replacements;
+	replacements.reserve(indices.size());
+	for (size_t i : indices)
+	{
+		CCommandReplacement replacement;
+		replacement.nIndex = i;
+		replacement.after.reset(GetCommand(i)->CreateTransformed(transform));
+		replacements.push_back(std::move(replacement));
+	}
+	CRect rectChanged(0, 0, 0, 0);
+	OnHistoryStep(m_history.ReplaceCommands(std::move(replacements)), FALSE, rectChanged);
+	if (m_nTransactionDepth > 0)
+		m_rectTransaction.UnionRect(&m_rectTransaction, &rectChanged);
+	if (pChanged != nullptr)
+		*pChanged = rectChanged;
+	return TRUE;
+}
+
+void CDocumentModel::BeginTransaction()
+{
+	if (m_nTransactionDepth++ == 0)
+	{
+		m_history.BeginGroup();
+		m_rectTransaction.SetRectEmpty();
+	}
+}
+
+BOOL CDocumentModel::EndTransaction(CRect* pChanged)
+{
+	ASSERT(m_nTransactionDepth > 0);
+	if (pChanged != nullptr)
+		pChanged->SetRectEmpty();
+	if (m_nTransactionDepth <= 0 || --m_nTransactionDepth > 0)
+		return FALSE;
+
+	if (m_history.EndGroup() == 0)
+		return FALSE;
+	if (pChanged != nullptr)
+		*pChanged = m_rectTransaction;
+	return TRUE;
+}
+
+BOOL CDocumentModel::Undo(CRect* pChanged)
+{
+	PROFILE_FUNCTION();
+	if (pChanged != nullptr)
+		pChanged->SetRectEmpty();
+	ASSERT(m_nTransactionDepth == 0);
+	if (m_nTransactionDepth > 0)
+		return FALSE;
+
+	// 移除最后一条命令（仍保留在撤销树中），或者换回被替换的命令；事务中的各步倒序撤销，受影响的区域合并后一起返回
+	CRect rectChanged(0, 0, 0, 0);
+	if (!m_history.Undo([&](const CHistoryStep& step) { OnHistoryStep(step, TRUE, rectChanged); }))
+		return FALSE;
+	if (pChanged != nullptr)
+		*pChanged = rectChanged;
+	return TRUE;
+}
+
+BOOL CDocumentModel::Redo(CRect* pChanged)
+{
+	PROFILE_FUNCTION();
+	if (pChanged != nullptr)
+		pChanged->SetRectEmpty();
+	ASSERT(m_nTransactionDepth == 0);
+	if (m_nTransactionDepth > 0)
+		return FALSE;
+
+	// 移回命令列表末尾，或者再次替换
+	CRect rectChanged(0, 0, 0, 0);
+	if (!m_history.Redo([&](const CHistoryStep& step) { OnHistoryStep(step, FALSE, rectChanged); }))
+		return FALSE;
+	if (pChanged != nullptr)
+		*pChanged = rectChanged;
+	return TRUE;
+}
+
+BOOL CDocumentModel::SwitchBranch(BOOL bNext, CRect* pChanged)
+{
+	PROFILE_FUNCTION();
+	if (pChanged != nullptr)
+		pChanged->SetRectEmpty();
+	ASSERT(m_nTransactionDepth == 0);
+	if (m_nTransactionDepth > 0)
+		return FALSE;
+
+	// 撤销到分叉点再沿另一个分支重做，只经过两个分支不同的步骤
+	CRect rectChanged(0, 0, 0, 0);
+	if (!m_history.SwitchBranch(bNext, [&](const CHistoryStep& step, BOOL bUndo) { OnHistoryStep(step, bUndo, rectChanged); }))
+		return FALSE;
+	if (pChanged != nullptr)
+		*pChanged = rectChanged;
+	return TRUE;
+}
+
+void CDocumentModel::OnHistoryStep(const CHistoryStep& step, BOOL bUndo, CRect& rectChanged)
+{
+	if (step.pCommand != nullptr)
+	{
+		if (bUndo)
+			OnCommandRemoved(step.pCommand);
+		else
+			OnCommandAppended(step.pCommand);
+		rectChanged.UnionRect(rectChanged, step.pCommand->GetBounds());
+	}
+	else
+	{
+		for (const CCommandReplacement& replacement : *step.pReplacements)
+		{
+			const CDrawCommand* pOld = bUndo ? replacement.after.get() : replacement.before.get();
+			const CDrawCommand* pNew = bUndo ? replacement.before.get() : replacement.after.get();
+			OnCommandReplaced(replacement.nIndex, pOld, pNew);
+			rectChanged.UnionRect(rectChanged, pOld->GetBounds());
+			rectChanged.UnionRect(rectChanged, pNew->GetBounds());
+		}
+	}
+}
+
+void CDocumentModel::Clear()
+{
+	PROFILE_FUNCTION();
+	// 清除撤销树和所有命令
+	// 仍被快照引用的命令由快照负责在释放时删除
+	m_history.Clear();
+	m_searchIndex.Clear();
+	m_boundsIndex.Clear();
+	m_stringPool.Clear();
+	m_pColorPalette = std::make_shared<CColorPalette>();
+	m_nCommandBytes = 0;
+	// 事务中清除时，之后的操作仍属于同一个事务
+	if (m_nTransactionDepth > 0)
+		m_history.BeginGroup();
+}
+
+size_t CDocumentModel::GetMemoryUsage() const
+{
+	return m_nCommandBytes + m_stringPool.GetMemorySize() + m_pColorPalette->GetMemorySize()
+		+ m_searchIndex.GetSearchContent().GetLength() * sizeof(TCHAR) + m_boundsIndex.GetMemorySize();
+}
+
+void CDocumentModel::OnCommandAppended(const CDrawCommand* pCommand)
+{
+	// 命令已在列表末尾
+	m_nCommandBytes += pCommand->GetMemorySize();
+	m_boundsIndex.Add(pCommand->GetBounds());
+	if (pCommand->GetData().drawType == DrawData::DrawType::Text)
+		m_searchIndex.AddText(m_history.GetCommandCount() - 1, pCommand->GetText());
+}
+
+void CDocumentModel::OnCommandRemoved(const CDrawCommand* pCommand)
+{
+	// 命令原来位于列表末尾，即当前命令数量处
+	m_nCommandBytes -= pCommand->GetMemorySize();
+	m_boundsIndex.RemoveLast();
+	if (pCommand->GetData().drawType == DrawData::DrawType::Text)
+		m_searchIndex.RemoveText(m_history.GetCommandCount(), pCommand->GetText());
+}
+
+void CDocumentModel::OnCommandReplaced(size_t nIndex, const CDrawCommand* pBefore, const CDrawCommand* pAfter)
+{
+	// 变换不改变文本内容，搜索索引不需要更新
+	ASSERT(pBefore->GetText() == pAfter->GetText());
+	m_nCommandBytes += pAfter->GetMemorySize();
+	m_nCommandBytes -= pBefore->GetMemorySize();
+	m_boundsIndex.Update(nIndex, pAfter->GetBounds());
+}
+
+void CDocumentModel::FindText(const CString& strQuery, std::vector<size_t>& results) const
+{
+	PROFILE_FUNCTION();
+	results.clear();
+	std::vector<size_t> candidates;
+	m_searchIndex.FindCandidates(strQuery, candidates);
+	if (candidates.empty())
+		return;
+
+	// 索引只保证包含查询中的每个字和相邻两字，还要用实际文本确认
+	CString strLower(strQuery);
+	strLower.MakeLower();
+	const CCommandVector& commands = m_history.GetCommands();
+	for (size_t i : candidates)
+	{
+		CString strText(commands[i]->GetText());
+		strText.MakeLower();
+		if (strText.Find(strLower) >= 0)
+			results.push_back(i);
+	}
+}
+
+size_t CDocumentModel::FindIntersecting(const CRect& rect, size_t nStart) const
+{
+	ASSERT(m_boundsIndex.GetCount() == m_history.GetCommandCount());
+	return m_boundsIndex.FindFirst(rect, nStart);
+}
+
+size_t CDocumentModel::HitTest(CPoint point, double dTolerance) const
+{
+	PROFILE_FUNCTION();
+	// 外接矩形已包含画笔宽度，只需按容差扩大查询区域
+	int nTolerance = static_cast<int>(std::ceil(dTolerance));
+	CRect rect(point.x - nTolerance, point.y - nTolerance, point.x + nTolerance + 1, point.y + nTolerance + 1);
+	const CCommandVector& commands = m_history.GetCommands();
+	return m_boundsIndex.FindLast(rect, [&](size_t i)
+	{
+		return commands[i]->HitTest(point, dTolerance) != FALSE;
+	});
+}
+
+void CDocumentModel::SelectInRect(const CRect& rect, BOOL bContainedOnly, std::vector<size_t>& results) const
+{
+	PROFILE_FUNCTION();
+	CRect rectSelect(rect);
+	rectSelect.NormalizeRect();
+	m_boundsIndex.Query(rectSelect, results);
+
+	// 外接矩形只是候选，还要按图形本身判断
+	const CCommandVector& commands = m_history.GetCommands();
+	size_t nSelected = 0;
+	for (size_t i : results)
+	{
+		const CDrawCommand* pCommand = commands[i].get();
+		if (pCommand->GetData().drawType == DrawData::DrawType::Eraser)
+			continue;
+		// 外接矩形完全落在选择框内时图形也一定在内，不需要精确判断
+		const CRect& bounds = m_boundsIndex.GetBounds(i);
+		BOOL bContained = bounds.left >= rectSelect.left && bounds.top >= rectSelect.top && bounds.right <= rectSelect.right && bounds.bottom <= rectSelect.bottom;
+		if (bContained || (!bContainedOnly && pCommand->IntersectsRect(rectSelect)))
+			results[nSelected++] = i;
+	}
+	results.resize(nSelected);
+}
+
+void CDocumentModel::RedrawAll(CDC* pDC, double dScale) const
+{
+	PROFILE_FUNCTION();
+	CRedrawFilter filter(pDC, *m_pColorPalette, dScale);
+
+	size_t nReplayed = 0;
+	size_t i = 0;
+	for (const CDrawCommandPtr& cmd : m_history.GetCommands())
+	{
+		if (filter.IsVisible(cmd.get()))
+		{
+			PROFILE_SCOPE_ARG("Execute", "command", i);
+			filter.Draw(cmd.get(), pDC);
+			nReplayed++;
+		}
+		i++;
+	}
+	CountRedraw(nReplayed, m_history.GetCommandCount() - nReplayed);
+}
+
+void CDocumentModel::RedrawSelection(CDC* pDC, const std::vector<size_t>& selection, BOOL bSelected, double dScale) const
+{
+	PROFILE_FUNCTION();
+	CRedrawFilter filter(pDC, *m_pColorPalette, dScale);
+	const CCommandVector& commands = m_history.GetCommands();
+
+	size_t nReplayed = 0;
+	size_t nConsidered = 0;
+	if (bSelected)
+	{
+		for (size_t i : selection)
+		{
+			if (filter.IsVisible(commands[i].get()))
+			{
+				filter.Draw(commands[i].get(), pDC);
+				nReplayed++;
+			}
+		}
+		nConsidered = selection.size();
+	}
+	else
+	{
+		// selection 递增，与顺序遍历同步前进即可跳过选中的命令
+		std::vector<size_t>::const_iterator itSelected = selection.begin();
+		size_t i = 0;
+		for (const CDrawCommandPtr& cmd : commands)
+		{
+			if (itSelected != selection.end() && *itSelected == i)
+			{
+				++itSelected;
+			}
+			else
+			{
+				if (filter.IsVisible(cmd.get()))
+				{
+					filter.Draw(cmd.get(), pDC);
+					nReplayed++;
+				}
+				nConsidered++;
+			}
+			i++;
+		}
+	}
+	CountRedraw(nReplayed, nConsidered - nReplayed);
+}
+
+size_t CDocumentModel::RedrawSlice(CDC* pDC, size_t nStart, LONGLONG llDeadline, double dScale) const
+{
+	PROFILE_FUNCTION();
+	// 每重放若干条命令检查一次时间，减少计时本身的开销
+	const size_t nCheckInterval = 16;
+
+	CRedrawFilter filter(pDC, *m_pColorPalette, dScale);
+
+	const CCommandVector& commands = m_history.GetCommands();
+	size_t nCount = commands.size();
+	size_t i = nStart;
+	size_t nReplayed = 0;
+	for (CCommandVector::const_iterator it = commands.iterator_at(nStart); i < nCount; ++it)
+	{
+		if (filter.IsVisible(it->get()))
+		{
+			PROFILE_SCOPE_ARG("Execute", "command", i);
+			filter.Draw(it->get(), pDC);
+			nReplayed++;
+		}
+		i++;
+
+		if ((i - nStart) % nCheckInterval == 0)
+		{
+			LARGE_INTEGER now;
+			QueryPerformanceCounter(&now);
+			if (now.QuadPart >= llDeadline)
+				break;
+		}
+	}
+	CountRedraw(nReplayed, i - nStart - nReplayed);
+	return i;
+}
+
+void CDocumentModel::StoreCommands(CArchive& ar, const CDocumentSnapshot& snapshot, BOOL bStorePyramids) const
+{
+	PROFILE_FUNCTION();
+	// 只保存当前命令用到的字符串和颜色，池中已撤销命令的文本不写入文件
+	// fileColorIds 中保存文件颜色表序号加 1，0 表示尚未加入
+	std::vector<DWORD> fileTextIds(m_stringPool.GetCount(), 0);
+	std::vector<UINT> tableIds;
+	const CColorPalette& palette = snapshot.GetColorPalette();
+	std::vector<DWORD> fileColorIds(palette.GetCount(), 0);
+	std::vector<CColorPalette::ColorIndex> colorTable;
+	// 返回颜色在文件颜色表中的序号，尚未加入时追加
+	auto addColor = [&fileColorIds, &colorTable](CColorPalette::ColorIndex nIndex) {
+		DWORD& nFileId = fileColorIds[nIndex];
+		if (nFileId == 0)
+		{
+			colorTable.push_back(nIndex);
+			nFileId = static_cast<DWORD>(colorTable.size());
+		}
+		return nFileId - 1;
+	};
+	for (const CDrawCommandPtr& cmd : snapshot.GetCommands())
+	{
+		const DrawData& data = cmd->GetData();
+		UINT nTextId = data.nTextId;
+		if (nTextId != CStringPool::EMPTY_ID && nTextId < fileTextIds.size() && fileTextIds[nTextId] == 0)
+		{
+			tableIds.push_back(nTextId);
+			fileTextIds[nTextId] = static_cast<DWORD>(tableIds.size());
+		}
+		addColor(data.GetPenColorIndex());
+		addColor(data.GetBrushColorIndex());
+	}
+	ar << static_cast<DWORD>(tableIds.size());
+	for (UINT nTextId : tableIds)
+	{
+		ar << m_stringPool.Get(nTextId);
+	}
+	ar << static_cast<DWORD>(colorTable.size());
+	for (CColorPalette::ColorIndex nIndex : colorTable)
+	{
+		ar << palette.Get(nIndex);
+	}
+
+	ar << static_cast<DWORD>(snapshot.GetCommandCount());
+	for (const CDrawCommandPtr& cmd : snapshot.GetCommands())
+	{
+		const DrawData& data = cmd->GetData();
+		UINT nTextId = data.nTextId;
+		// 颜色都已在上面加入，addColor 只返回序号
+		StoreDrawData(ar, data, nTextId < fileTextIds.size() ? fileTextIds[nTextId] : 0,
+			addColor(data.GetPenColorIndex()), addColor(data.GetBrushColorIndex()));
+	}
+
+	// 金字塔表：先统计数量再写入，读取时可以按数量逐个校验
+	std::vector<std::pair<DWORD, const CStrokePyramid*>> pyramids;
+	if (bStorePyramids)
+	{
+		DWORD nIndex = 0;
+		for (const CDrawCommandPtr& cmd : snapshot.GetCommands())
+		{
+			if (CStrokeCommand::IsStroke(cmd->GetData()))
+			{
+				const CStrokePyramid* pPyramid = static_cast<const CStrokeCommand*>(cmd.get())->GetBuiltStrokePyramid();
+				if (pPyramid != nullptr)
+					pyramids.emplace_back(nIndex, pPyramid);
+			}
+			nIndex++;
+		}
+	}
+	ar << static_cast<DWORD>(pyramids.size());
+	for (const auto& entry : pyramids)
+	{
+		ar << entry.first;
+		entry.second->Store(ar);
+	}
+}
+
+void CDocumentModel::LoadCommands(CArchive& ar)
+{
+	PROFILE_FUNCTION();
+	// 文件中的数量不可信，预先分配的空间不超过 LOAD_RESERVE_LIMIT 个元素，更多的元素随实际读到的数据增长
+	static const DWORD LOAD_RESERVE_LIMIT = 1 << 16;
+
+	// 文件字符串表中的序号 -> 字符串池中的序号
+	DWORD nStrings;
+	ar >> nStrings;
+	std::vector<UINT> textIds;
+	textIds.reserve(static_cast<size_t>(min(nStrings, LOAD_RESERVE_LIMIT)) + 1);
+	textIds.push_back(CStringPool::EMPTY_ID);
+	for (DWORD i = 0; i < nStrings; i++)
+	{
+		CString text;
+		ar >> text;
+		textIds.push_back(m_stringPool.Intern(text));
+	}
+
+	// 文件颜色表中的序号 -> 文档颜色表中的序号
+	DWORD nColors;
+	ar >> nColors;
+	std::vector<CColorPalette::ColorIndex> colorIds;
+	colorIds.reserve(min(nColors, LOAD_RESERVE_LIMIT));
+	for (DWORD i = 0; i < nColors; i++)
+	{
+		COLORREF color;
+		ar >> color;
+		colorIds.push_back(m_pColorPalette->Intern(color));
+	}
+
+	DWORD nCount;
+	ar >> nCount;
+	// 本次读取的笔迹命令，非笔迹命令为 nullptr，用于对应后面的金字塔表
+	std::vector<CStrokeCommand*> strokes;
+	strokes.reserve(min(nCount, LOAD_RESERVE_LIMIT));
+	for (DWORD i = 0; i < nCount; i++)
+	{
+		DrawData data;
+		LoadDrawData(ar, data, textIds, colorIds);
+		const BOOL bStroke = CStrokeCommand::IsStroke(data);
+		CDrawCommandPtr command = MakeSharedDrawCommand(std::move(data), m_stringPool);
+		if (command)
+		{
+			// 文件内容是历史的起点，不加入撤销树
+			m_history.AddBaseCommand(command);
+			OnCommandAppended(command.get());
+		}
+		strokes.push_back(bStroke ? static_cast<CStrokeCommand*>(command.get()) : nullptr);
+	}
+
+	DWORD nPyramids;
+	ar >> nPyramids;
+	if (nPyramids > nCount)
+		AfxThrowArchiveException(CArchiveException::badIndex, ar.m_strFileName);
+	for (DWORD i = 0; i < nPyramids; i++)
+	{
+		DWORD nIndex;
+		ar >> nIndex;
+		if (nIndex >= strokes.size() || strokes[nIndex] == nullptr)
+			AfxThrowArchiveException(CArchiveException::badIndex, ar.m_strFileName);
+
+		std::unique_ptr<CStrokePyramid> pPyramid(new CStrokePyramid);
+		if (!pPyramid->Load(ar, strokes[nIndex]->GetData().pencilPoints.size()))
+			AfxThrowArchiveException(CArchiveException::badIndex, ar.m_strFileName);
+		strokes[nIndex]->SetStrokePyramid(pPyramid.release());
+	}
+}
@@ -0,0 +1,152 @@
+// DocumentModel.h: 文档模型
+// CMFCdrawDoc 中与界面无关的部分：命令历史、文本搜索索引、字符串池、颜色表，以及文档文件中命令部分的读写。
+// bench 目录下的基准测试直接创建和驱动这个类，不经过 CMFCdrawDoc。
+//
+
+#pragma once
+
+#include <afxwin.h>
+#include <istream>
+#include <memory>
+#include <vector>
+#include "BoundsIndex.h"
+#include "ColorPalette.h"
+#include "DrawCommand.h"
+#include "CommandHistory.h"
+#include "StringPool.h"
+#include "TextSearchIndex.h"
+
+class CDocumentModel
+{
+private:
+	CCommandHistory m_history;  // 命令历史（撤销树及当前所有命令）
+	CTextSearchIndex m_searchIndex;  // 当前所有文本命令的搜索内容和倒排索引
+	CBoundsIndex m_boundsIndex;  // 当前所有命令外接矩形的空间索引
+	CStringPool m_stringPool;  // 文档中所有文本（包括已撤销命令的文本）
+	std::shared_ptr<CColorPalette> m_pColorPalette;  // 文档中所有颜色（包括已撤销命令的颜色），与快照共享
+	size_t m_nCommandBytes;  // 当前所有命令占用的内存（估算值）
+	int m_nTransactionDepth;  // 嵌套的事务层数
+	CRect m_rectTransaction;  // 当前事务中所有操作影响区域的并集
+
+	// 命令追加到列表末尾、从末尾移除或被替换后更新搜索索引和空间索引
+	void OnCommandAppended(const CDrawCommand* pCommand);
+	void OnCommandRemoved(const CDrawCommand* pCommand);
+	void OnCommandReplaced(size_t nIndex, const CDrawCommand* pBefore, const CDrawCommand* pAfter);
+	// 批量添加的一条：绘图数据移入命令，与 AddCommand 相同地更新索引
+	void AppendDrawData(DrawData&& data);
+	// 撤销/重做一步后更新索引，受影响的区域（文档坐标）并入 rectChanged
+	void OnHistoryStep(const CHistoryStep& step, BOOL bUndo, CRect& rectChanged);
+
+public:
+	static const WORD FILE_VERSION = 1;  // StoreCommands 写入的文件版本
+	static const size_t NO_COMMAND = CBoundsIndex::NO_INDEX;  // HitTest 没有点中任何命令
+	static const size_t IMPORT_BATCH_SIZE = 4096;  // ImportDrawRecords 每批预留的命令数量
+
+	CDocumentModel() : m_pColorPalette(std::make_shared<CColorPalette>()), m_nCommandBytes(0), m_nTransactionDepth(0)
+	{
+		m_rectTransaction.SetRectEmpty();
+	}
+
+	// 添加命令（接管所有权）；之前撤销的操作保留在撤销树的另一个分支中
+	void AddCommand(CDrawCommand* pCommand);
+	// 批量添加：为 [pFirst, pLast) 中的绘图数据（文本已通过 InternText 加入字符串池，颜色已加入 GetColorPalette）生成命令并追加到末尾，
+	// 作为一个撤销单元；空间索引预先预留容量，命令与引用计数一次分配。pChanged 不为空时返回新命令外接矩形的并集
+	void AddDrawData(const DrawData* pFirst, const DrawData* pLast, CRect* pChanged = nullptr);
+	// 同上，铅笔轨迹的点直接移入命令而不复制；data 之后为空
+	void AddDrawData(std::vector<DrawData>&& data, CRect* pChanged = nullptr);
+	// 从 in 流式读取绘图记录（格式见 DrawRecordReader.h）并分批添加，作为一个撤销单元，内存占用与文件大小无关；
+	// pnImported 返回添加的命令数量。格式错误时已读取的记录保留（可以一次撤销），返回 FALSE，pnErrorLine 返回出错的行号
+	BOOL ImportDrawRecords(std::istream& in, size_t* pnImported = nullptr, size_t* pnErrorLine = nullptr, CRect* pChanged = nullptr);
+	// 粘贴：把 commands（颜色序号指向 palette，可以来自其他文档）按 transform 变换后作为新命令追加到末尾，
+	// 文本和颜色重新加入本文档的字符串池和颜色表；作为一个撤销单元，pChanged 不为空时返回新命令外接矩形的并集
+	void PasteCommands(const std::vector<CDrawCommandPtr>& commands, const CColorPalette& palette, const DrawTransform& transform,
+		CRect* pChanged = nullptr);
+	// 把 indices 中的命令按 transform 变换（移动、缩放），作为一步可撤销的操作；
+	// pChanged 不为空时返回变换前后外接矩形的并集（需要重绘的区域），没有命令被变换时返回 FALSE
+	BOOL TransformCommands(const std::vector<size_t>& indices, const DrawTransform& transform, CRect* pChanged = nullptr);
+	// 事务：BeginTransaction 与 EndTransaction 之间的所有操作（添加、变换命令）合并为一个撤销单元；
+	// 可以嵌套，只有最外层的 EndTransaction 结束事务，事务进行中不能撤销或重做
+	void BeginTransaction();
+	// 结束事务；最外层的事务中有操作时返回 TRUE，pChanged 不为空时返回所有操作影响区域的并集（文档坐标）
+	BOOL EndTransaction(CRect* pChanged = nullptr);
+	BOOL IsInTransaction() const { return m_nTransactionDepth > 0; }
+	// 撤销最近一步操作（或一个事务），没有可撤销的操作时返回 FALSE；pChanged 不为空时返回受影响的区域（文档坐标）
+	BOOL Undo(CRect* pChanged = nullptr);
+	// 沿当前分支重做下一步操作，没有可重做的操作时返回 FALSE；pChanged 同上
+	BOOL Redo(CRect* pChanged = nullptr);
+	// 切换到最近的分叉点的下一个或上一个分支，文档回到上次切换离开该分支时的状态（没有离开过时为分支末端）；没有分叉时返回 FALSE。
+	// pChanged 不为空时返回两个分支中不同的步骤影响区域的并集（共同的部分不需要重绘）
+	BOOL SwitchBranch(BOOL bNext, CRect* pChanged = nullptr);
+	// 清除所有命令、搜索索引和字符串池，换用新的颜色表（快照仍持有原来的颜色表）
+	void Clear();
+
+	BOOL CanUndo() const { return m_history.CanUndo(); }
+	BOOL CanRedo() const { return m_history.CanRedo(); }
+	BOOL CanSwitchBranch() const { return m_history.CanSwitchBranch(); }
+	// 最近的分叉点的分支数量和当前分支的序号（从 1 开始），没有分叉时返回 FALSE
+	BOOL GetBranchPosition(size_t& nBranch, size_t& nBranches) const { return m_history.GetBranchPosition(nBranch, nBranches); }
+
+	// 获取当前命令数量
+	size_t GetCommandCount() const { return m_history.GetCommandCount(); }
+	// 获取第 i 条命令
+	CDrawCommand* GetCommand(size_t i) const { return m_history.GetCommands()[i].get(); }
+	// 获取当前命令列表（仅供拥有者线程使用）
+	const CCommandVector& GetCommands() const { return m_history.GetCommands(); }
+	// 获取当前状态的快照
+	CDocumentSnapshot GetSnapshot() const { return CDocumentSnapshot(m_history.GetCommands(), m_pColorPalette); }
+
+	// 查找内容包含 strQuery（不区分大小写）的文本命令，结果为命令序号（递增）
+	void FindText(const CString& strQuery, std::vector<size_t>& results) const;
+	// 从 nStart 开始查找第一条外接矩形与 rect 相交的命令，返回其序号；没有时返回命令数量
+	size_t FindIntersecting(const CRect& rect, size_t nStart) const;
+	// 点选：返回与 point 的距离不超过 dTolerance（逻辑单位）的最上层（最后绘制的）命令，没有时返回 NO_COMMAND
+	size_t HitTest(CPoint point, double dTolerance) const;
+	// 框选：bContainedOnly 为 TRUE 时选择外接矩形完全落在 rect 内的命令，否则选择图形与 rect 相交的命令；
+	// 结果为命令序号（递增），橡皮擦轨迹不参与选择
+	void SelectInRect(const CRect& rect, BOOL bContainedOnly, std::vector<size_t>& results) const;
+	// 搜索处理程序使用的内容
+	const CString& GetSearchContent() const { return m_searchIndex.GetSearchContent(); }
+
+	// 把文本加入字符串池，返回其序号（相同的文本只保存一份）
+	UINT InternText(const CString& text) { return m_stringPool.Intern(text); }
+	const CStringPool& GetStringPool() const { return m_stringPool; }
+	// 文档颜色表：绘图数据中的颜色序号指向这里（DrawData::SetPenColor 把颜色加入颜色表）
+	CColorPalette& GetColorPalette() { return *m_pColorPalette; }
+	const CColorPalette& GetColorPalette() const { return *m_pColorPalette; }
+
+	// 估算文档占用的内存（字节）：当前命令、字符串池、颜色表、搜索内容和空间索引，不含撤销栈中的命令
+	size_t GetMemoryUsage() const;
+
+	// 按顺序重放与 pDC 裁剪区域相交的命令
+	// dScale 为一个文档单位显示的像素数；小于 1（缩小显示）时按低细节规则重放：
+	// 跳过外接矩形小于一个像素的命令，铅笔和橡皮擦轨迹按半个像素的容差简化后绘制
+	void RedrawAll(CDC* pDC, double dScale = 1.0) const;
+	// 只重放 selection（递增的命令序号）中的命令（bSelected 为 TRUE）或其余的命令（bSelected 为 FALSE），
+	// 用于拖动选中的图形时分别生成图形和背景；dScale 与 RedrawAll 相同
+	void RedrawSelection(CDC* pDC, const std::vector<size_t>& selection, BOOL bSelected, double dScale = 1.0) const;
+	// 分片重绘：从 nStart 开始重放与裁剪区域相交的命令，直到全部完成或超过截止时间（QueryPerformanceCounter 计数）
+	// 返回下一次应继续重放的位置；dScale 与 RedrawAll 相同
+	size_t RedrawSlice(CDC* pDC, size_t nStart, LONGLONG llDeadline, double dScale = 1.0) const;
+
+	// 写入文档文件的命令部分：字符串表、颜色表和 snapshot 中的所有命令（格式见 MFC _drawDoc.cpp）
+	// bStorePyramids 为 TRUE 时同时写入已经建立的笔迹多分辨率金字塔（保存时不会建立新的金字塔），否则只写入空的金字塔表
+	void StoreCommands(CArchive& ar, const CDocumentSnapshot& snapshot, BOOL bStorePyramids = FALSE) const;
+	// 读取文档文件的命令部分（文件版本为 FILE_VERSION）作为空文档的初始内容：不产生撤销步骤，读取后不能撤销
+	void LoadCommands(CArchive& ar);
+};
+
+// 事务范围：构造时开始事务，析构时结束（提前返回或抛出异常时，已完成的操作同样合并为一个撤销单元）；
+// TDocument 为 CDocumentModel 或 CMFCdrawDoc
+template <typename TDocument>
+class CTransactionScope
+{
+private:
+	TDocument& m_document;
+
+	CTransactionScope(const CTransactionScope&) = delete;
+	CTransactionScope& operator=(const CTransactionScope&) = delete;
+
+public:
+	explicit CTransactionScope(TDocument& document) : m_document(document) { m_document.BeginTransaction(); }
+	~CTransactionScope() { m_document.EndTransaction(); }
+};
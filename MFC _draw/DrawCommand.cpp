@@ -3,17 +3,300 @@
 
 #include "pch.h"
 #include "DrawCommand.h"
+#include "ArchiveArray.h"
 #include "GdiObjectWrapper.h"
+#include "HitGeometry.h"
+#include "TextRunCache.h"
+
+#include <cmath>
+
+// 文本命令使用 DC 的默认字体输出，这里按系统字体的字符单元估算文本范围
+static const int TEXT_CELL_WIDTH = 8;    // 半角字符宽度
+static const int TEXT_CELL_HEIGHT = 16;  // 行高
+
+CRect CalcDrawDataBounds(const DrawData& data, const CString& text)
+{
+	CRect bounds;
+	switch (data.drawType)
+	{
+	case DrawData::DrawType::Pencil:
+	case DrawData::DrawType::Eraser:
+		if (data.pencilPoints.empty())
+			return CRect(0, 0, 0, 0);
+		bounds.SetRect(data.pencilPoints[0], data.pencilPoints[0]);
+		for (const CPoint& point : data.pencilPoints)
+		{
+			bounds.left = min(bounds.left, point.x);
+			bounds.top = min(bounds.top, point.y);
+			bounds.right = max(bounds.right, point.x);
+			bounds.bottom = max(bounds.bottom, point.y);
+		}
+		break;
+
+	case DrawData::DrawType::Text:
+	{
+		int nWidth = 0;
+		for (int i = 0; i < text.GetLength(); i++)
+		{
+			// 全角字符占两个字符单元
+			nWidth += text[i] < 0x80 ? TEXT_CELL_WIDTH : TEXT_CELL_WIDTH * 2;
+		}
+		return CRect(data.pointBegin, CSize(nWidth, TEXT_CELL_HEIGHT));
+	}
+
+	default:
+		bounds.SetRect(data.pointBegin, data.pointEnd);
+		bounds.NormalizeRect();
+		break;
+	}
+
+	// 包含画笔宽度，右下边界不包含在内
+	int nHalfPen = (max(data.penSize, 1) + 1) / 2;
+	bounds.InflateRect(nHalfPen, nHalfPen, nHalfPen + 1, nHalfPen + 1);
+	return bounds;
+}
+
+// 文件中的颜色序号：小于 COLOR_INDEX_ESCAPE 时占一个字节，否则写入 COLOR_INDEX_ESCAPE 后跟 DWORD 序号
+static const BYTE COLOR_INDEX_ESCAPE = 0xFF;
+
+static void StoreColorIndex(CArchive& ar, DWORD nIndex)
+{
+	if (nIndex < COLOR_INDEX_ESCAPE)
+		ar << static_cast<BYTE>(nIndex);
+	else
+		ar << COLOR_INDEX_ESCAPE << nIndex;
+}
+
+// 读取文件颜色表中的序号，超出 nColors 时抛出 CArchiveException
+static DWORD LoadColorIndex(CArchive& ar, size_t nColors)
+{
+	BYTE nShort;
+	ar >> nShort;
+	DWORD nIndex = nShort;
+	if (nShort == COLOR_INDEX_ESCAPE)
+		ar >> nIndex;
+	if (nIndex >= nColors)
+		AfxThrowArchiveException(CArchiveException::badIndex);
+	return nIndex;
+}
+
+void StoreDrawData(CArchive& ar, const DrawData& data, DWORD nTextId, DWORD nPenColor, DWORD nBrushColor)
+{
+	ar << static_cast<BYTE>(data.drawType);
+	ar << data.pointBegin << data.pointEnd;
+	ar << static_cast<LONG>(data.penSize);
+	StoreColorIndex(ar, nPenColor);
+	StoreColorIndex(ar, nBrushColor);
+	ar << nTextId;
+
+	// 点数组按原始内存整块写入
+	ar << static_cast<DWORD>(data.pencilPoints.size());
+	if (!data.pencilPoints.empty())
+		ar.Write(data.pencilPoints.data(), static_cast<UINT>(data.pencilPoints.size() * sizeof(CPoint)));
+}
+
+void LoadDrawData(CArchive& ar, DrawData& data, const std::vector<UINT>& textIds,
+	const std::vector<CColorPalette::ColorIndex>& colorIds)
+{
+	BYTE drawType;
+	LONG penSize;
+	DWORD nTextId;
+	DWORD nPoints;
+	ar >> drawType;
+	ar >> data.pointBegin >> data.pointEnd;
+	ar >> penSize;
+	data.SetPenColorIndex(colorIds[LoadColorIndex(ar, colorIds.size())]);
+	data.SetBrushColorIndex(colorIds[LoadColorIndex(ar, colorIds.size())]);
+	ar >> nTextId;
+	if (nTextId >= textIds.size())
+		AfxThrowArchiveException(CArchiveException::badIndex);
+	data.nTextId = textIds[nTextId];
+	ar >> nPoints;
+
+	if (drawType > static_cast<BYTE>(DrawData::DrawType::Eraser))
+		AfxThrowArchiveException(CArchiveException::badIndex);
+	data.drawType = static_cast<DrawData::DrawType>(drawType);
+	data.penSize = penSize;
+
+	LoadArchiveArray(ar, data.pencilPoints, nPoints);
+}
+
+const CString& CDrawCommand::GetText() const
+{
+	static const CString strEmpty;
+	return strEmpty;
+}
+
+BOOL CDrawCommand::HitTest(CPoint point, double dTolerance) const
+{
+	CRect rect(m_bounds);
+	int nTolerance = static_cast<int>(dTolerance + 0.5);
+	rect.InflateRect(nTolerance, nTolerance);
+	return rect.PtInRect(point);
+}
+
+BOOL CDrawCommand::IntersectsRect(const CRect& rect) const
+{
+	CRect rectIntersect;
+	return rectIntersect.IntersectRect(m_bounds, rect);
+}
+
+// 点选和框选时轮廓向两侧延伸的距离：画笔宽度的一半加上容差
+static double GetHitRadius(const DrawData& data, double dTolerance)
+{
+	return max(data.penSize, 1) / 2.0 + dTolerance;
+}
+
+// 矩形轮廓的四条边
+static void GetRectangleEdges(const DrawData& data, CPoint edges[5])
+{
+	CRect rect(data.pointBegin, data.pointEnd);
+	rect.NormalizeRect();
+	edges[0] = rect.TopLeft();
+	edges[1] = CPoint(rect.right, rect.top);
+	edges[2] = rect.BottomRight();
+	edges[3] = CPoint(rect.left, rect.bottom);
+	edges[4] = edges[0];
+}
+
+// 线段 ab 的外接矩形向外扩大 dRadius 后是否与闭区间 [left, right] × [top, bottom] 相交（逐段精确判断前的快速排除）
+static bool SegmentBoxOverlaps(CPoint a, CPoint b, double left, double top, double right, double bottom, double dRadius)
+{
+	return min(a.x, b.x) - dRadius <= right && max(a.x, b.x) + dRadius >= left
+		&& min(a.y, b.y) - dRadius <= bottom && max(a.y, b.y) + dRadius >= top;
+}
+
+// point 到折线的距离是否不超过 dRadius
+static BOOL PointNearPolyline(CPoint point, const CPoint* pPoints, size_t nCount, double dRadius)
+{
+	double dRadiusSquared = dRadius * dRadius;
+	if (nCount == 1)
+		return PointSegmentDistanceSquared(point.x, point.y, pPoints[0], pPoints[0]) <= dRadiusSquared;
+	for (size_t i = 1; i < nCount; i++)
+	{
+		if (SegmentBoxOverlaps(pPoints[i - 1], pPoints[i], point.x, point.y, point.x, point.y, dRadius)
+			&& PointSegmentDistanceSquared(point.x, point.y, pPoints[i - 1], pPoints[i]) <= dRadiusSquared)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+// 折线与 rect 的距离是否不超过 dRadius
+static BOOL PolylineNearRect(const CPoint* pPoints, size_t nCount, const CRect& rect, double dRadius)
+{
+	if (nCount == 1)
+		return SegmentNearRect(pPoints[0], pPoints[0], rect, dRadius);
+	// rect 的右边和下边不包含在内
+	for (size_t i = 1; i < nCount; i++)
+	{
+		if (SegmentBoxOverlaps(pPoints[i - 1], pPoints[i], rect.left, rect.top, rect.right - 1, rect.bottom - 1, dRadius)
+			&& SegmentNearRect(pPoints[i - 1], pPoints[i], rect, dRadius))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+CDrawCommand* CreateDrawCommand(const DrawData& data, const CStringPool& pool)
+{
+	if (data.drawType == DrawData::DrawType::Text)
+		return new CTextCommand(data, pool.Get(data.nTextId));
+	return CreateDrawCommand(data, CString());
+}
+
+CDrawCommand* CreateDrawCommand(const DrawData& data, const CString& text)
+{
+	switch (data.drawType)
+	{
+	case DrawData::DrawType::LineSegment: return new CLineSegmentCommand(data);
+	case DrawData::DrawType::Circle:      return new CCircleCommand(data);
+	case DrawData::DrawType::Rectangle:   return new CRectangleCommand(data);
+	case DrawData::DrawType::Ellipse:     return new CEllipseCommand(data);
+	case DrawData::DrawType::Pencil:      return new CPencilCommand(data);
+	case DrawData::DrawType::Text:        return new CTextCommand(data, text);
+	case DrawData::DrawType::Eraser:      return new CEraserCommand(data);
+	}
+	return nullptr;
+}
+
+std::shared_ptr<CDrawCommand> MakeSharedDrawCommand(DrawData&& data, const CStringPool& pool)
+{
+	switch (data.drawType)
+	{
+	case DrawData::DrawType::LineSegment: return std::make_shared<CLineSegmentCommand>(data);
+	case DrawData::DrawType::Circle:      return std::make_shared<CCircleCommand>(data);
+	case DrawData::DrawType::Rectangle:   return std::make_shared<CRectangleCommand>(data);
+	case DrawData::DrawType::Ellipse:     return std::make_shared<CEllipseCommand>(data);
+	case DrawData::DrawType::Pencil:      return std::make_shared<CPencilCommand>(std::move(data));
+	case DrawData::DrawType::Text:        return std::make_shared<CTextCommand>(data, pool.Get(data.nTextId));
+	case DrawData::DrawType::Eraser:      return std::make_shared<CEraserCommand>(std::move(data));
+	}
+	return nullptr;
+}
+
+CDrawCommand* CDrawCommand::CreateTransformed(const DrawTransform& transform) const
+{
+	// 文本与原命令共享字符串池中的缓冲区
+	DrawData data(m_data);
+	transform.Apply(data);
+	return CreateDrawCommand(data, GetText());
+}
+
+// DrawTransform 实现
+CPoint DrawTransform::Apply(CPoint point) const
+{
+	return CPoint(ptAnchor.x + static_cast<int>(std::lround((point.x - ptAnchor.x) * dScaleX)) + offset.cx,
+		ptAnchor.y + static_cast<int>(std::lround((point.y - ptAnchor.y) * dScaleY)) + offset.cy);
+}
+
+CRect DrawTransform::Apply(const CRect& rect) const
+{
+	CRect rectResult(Apply(rect.TopLeft()), Apply(rect.BottomRight()));
+	rectResult.NormalizeRect();
+	return rectResult;
+}
+
+void DrawTransform::Apply(DrawData& data) const
+{
+	data.pointBegin = Apply(data.pointBegin);
+	if (data.drawType == DrawData::DrawType::Text)
+		return;
+	data.pointEnd = Apply(data.pointEnd);
+	for (CPoint& point : data.pencilPoints)
+		point = Apply(point);
+}
+
+// CStrokeCommand 实现
+// 低细节绘制折线：取金字塔中与容差相符的一级，一次 Polyline 画出
+void CStrokeCommand::DrawLowDetail(CDC* pDC, COLORREF color, double dTolerance) const
+{
+	const CPoint* pPoints = m_data.pencilPoints.data();
+	int nCount = static_cast<int>(m_data.pencilPoints.size());
+	const CStrokePyramid* pPyramid = GetStrokePyramid();
+	if (pPyramid != nullptr)
+	{
+		int nLevelCount;
+		const CPoint* pLevel = pPyramid->GetLevel(dTolerance, nLevelCount);
+		if (pLevel != nullptr)
+		{
+			pPoints = pLevel;
+			nCount = nLevelCount;
+		}
+	}
+
+	CPenWrapper pen(PS_SOLID, m_data.penSize, color);
+	CGdiObjectSelector<CPen, CPen> penSelector(pDC, pen.Get());
+	pDC->Polyline(pPoints, nCount);
+}
 
 // CLineSegmentCommand 实现
-void CLineSegmentCommand::Execute(CDC* pDC)
+void CLineSegmentCommand::Execute(CDC* pDC, const CColorPalette& palette)
 {
 	if (pDC == nullptr)
 		return;
 	
 	try
 	{
-		CPenWrapper pen(PS_SOLID, m_data.penSize, m_data.penColor);
+		CPenWrapper pen(PS_SOLID, m_data.penSize, m_data.GetPenColor(palette));
 		CGdiObjectSelector<CPen, CPen> penSelector(pDC, pen.Get());
 		
 		pDC->MoveTo(m_data.pointBegin);
@@ -53,15 +336,26 @@ CDrawCommand* CLineSegmentCommand::Clone() const
 	return new CLineSegmentCommand(m_data);
 }
 
+BOOL CLineSegmentCommand::HitTest(CPoint point, double dTolerance) const
+{
+	double dRadius = GetHitRadius(m_data, dTolerance);
+	return PointSegmentDistanceSquared(point.x, point.y, m_data.pointBegin, m_data.pointEnd) <= dRadius * dRadius;
+}
+
+BOOL CLineSegmentCommand::IntersectsRect(const CRect& rect) const
+{
+	return SegmentNearRect(m_data.pointBegin, m_data.pointEnd, rect, GetHitRadius(m_data, 0));
+}
+
 // CRectangleCommand 实现
-void CRectangleCommand::Execute(CDC* pDC)
+void CRectangleCommand::Execute(CDC* pDC, const CColorPalette& palette)
 {
 	if (pDC == nullptr)
 		return;
 	
 	try
 	{
-		CPenWrapper pen(PS_SOLID, m_data.penSize, m_data.penColor);
+		CPenWrapper pen(PS_SOLID, m_data.penSize, m_data.GetPenColor(palette));
 		CGdiObjectSelector<CPen, CPen> penSelector(pDC, pen.Get());
 		pDC->SelectStockObject(NULL_BRUSH);
 		
@@ -104,15 +398,30 @@ CDrawCommand* CRectangleCommand::Clone() const
 	return new CRectangleCommand(m_data);
 }
 
+BOOL CRectangleCommand::HitTest(CPoint point, double dTolerance) const
+{
+	// 空心矩形只能点中边框
+	CPoint edges[5];
+	GetRectangleEdges(m_data, edges);
+	return PointNearPolyline(point, edges, _countof(edges), GetHitRadius(m_data, dTolerance));
+}
+
+BOOL CRectangleCommand::IntersectsRect(const CRect& rect) const
+{
+	CPoint edges[5];
+	GetRectangleEdges(m_data, edges);
+	return PolylineNearRect(edges, _countof(edges), rect, GetHitRadius(m_data, 0));
+}
+
 // CCircleCommand 实现
-void CCircleCommand::Execute(CDC* pDC)
+void CCircleCommand::Execute(CDC* pDC, const CColorPalette& palette)
 {
 	if (pDC == nullptr)
 		return;
 	
 	try
 	{
-		CPenWrapper pen(PS_SOLID, m_data.penSize, m_data.penColor);
+		CPenWrapper pen(PS_SOLID, m_data.penSize, m_data.GetPenColor(palette));
 		CGdiObjectSelector<CPen, CPen> penSelector(pDC, pen.Get());
 		pDC->SelectStockObject(NULL_BRUSH);
 		
@@ -155,15 +464,25 @@ CDrawCommand* CCircleCommand::Clone() const
 	return new CCircleCommand(m_data);
 }
 
+BOOL CCircleCommand::HitTest(CPoint point, double dTolerance) const
+{
+	return PointNearEllipseOutline(point, CRect(m_data.pointBegin, m_data.pointEnd), GetHitRadius(m_data, dTolerance));
+}
+
+BOOL CCircleCommand::IntersectsRect(const CRect& rect) const
+{
+	return EllipseOutlineIntersectsRect(CRect(m_data.pointBegin, m_data.pointEnd), GetHitRadius(m_data, 0), rect);
+}
+
 // CEllipseCommand 实现
-void CEllipseCommand::Execute(CDC* pDC)
+void CEllipseCommand::Execute(CDC* pDC, const CColorPalette& palette)
 {
 	if (pDC == nullptr)
 		return;
 	
 	try
 	{
-		CPenWrapper pen(PS_SOLID, m_data.penSize, m_data.penColor);
+		CPenWrapper pen(PS_SOLID, m_data.penSize, m_data.GetPenColor(palette));
 		CGdiObjectSelector<CPen, CPen> penSelector(pDC, pen.Get());
 		pDC->SelectStockObject(NULL_BRUSH);
 		
@@ -206,15 +525,25 @@ CDrawCommand* CEllipseCommand::Clone() const
 	return new CEllipseCommand(m_data);
 }
 
+BOOL CEllipseCommand::HitTest(CPoint point, double dTolerance) const
+{
+	return PointNearEllipseOutline(point, CRect(m_data.pointBegin, m_data.pointEnd), GetHitRadius(m_data, dTolerance));
+}
+
+BOOL CEllipseCommand::IntersectsRect(const CRect& rect) const
+{
+	return EllipseOutlineIntersectsRect(CRect(m_data.pointBegin, m_data.pointEnd), GetHitRadius(m_data, 0), rect);
+}
+
 // CPencilCommand 实现
-void CPencilCommand::Execute(CDC* pDC)
+void CPencilCommand::Execute(CDC* pDC, const CColorPalette& palette)
 {
 	if (pDC == nullptr || m_data.pencilPoints.size() < 2)
 		return;
 	
 	try
 	{
-		CPenWrapper pen(PS_SOLID, m_data.penSize, m_data.penColor);
+		CPenWrapper pen(PS_SOLID, m_data.penSize, m_data.GetPenColor(palette));
 		CGdiObjectSelector<CPen, CPen> penSelector(pDC, pen.Get());
 		
 		for (size_t i = 1; i < m_data.pencilPoints.size(); i++)
@@ -259,8 +588,38 @@ CDrawCommand* CPencilCommand::Clone() const
 	return new CPencilCommand(m_data);
 }
 
+void CPencilCommand::ExecuteLowDetail(CDC* pDC, const CColorPalette& palette, double dTolerance)
+{
+	if (pDC == nullptr || m_data.pencilPoints.size() < 2)
+		return;
+	
+	try
+	{
+		DrawLowDetail(pDC, m_data.GetPenColor(palette), dTolerance);
+	}
+	catch (const CGdiObjectException&)
+	{
+		// 错误处理：记录日志或显示错误消息
+		TRACE(_T("Failed to execute pencil command (low detail)\n"));
+	}
+}
+
+BOOL CPencilCommand::HitTest(CPoint point, double dTolerance) const
+{
+	if (m_data.pencilPoints.empty())
+		return FALSE;
+	return PointNearPolyline(point, m_data.pencilPoints.data(), m_data.pencilPoints.size(), GetHitRadius(m_data, dTolerance));
+}
+
+BOOL CPencilCommand::IntersectsRect(const CRect& rect) const
+{
+	if (m_data.pencilPoints.empty())
+		return FALSE;
+	return PolylineNearRect(m_data.pencilPoints.data(), m_data.pencilPoints.size(), rect, GetHitRadius(m_data, 0));
+}
+
 // CEraserCommand 实现
-void CEraserCommand::Execute(CDC* pDC)
+void CEraserCommand::Execute(CDC* pDC, const CColorPalette& /*palette*/)
 {
 	if (pDC == nullptr || m_data.pencilPoints.size() < 2)
 		return;
@@ -316,11 +675,34 @@ CDrawCommand* CEraserCommand::Clone() const
 	return new CEraserCommand(m_data);
 }
 
+void CEraserCommand::ExecuteLowDetail(CDC* pDC, const CColorPalette& /*palette*/, double dTolerance)
+{
+	if (pDC == nullptr || m_data.pencilPoints.size() < 2)
+		return;
+	
+	try
+	{
+		DrawLowDetail(pDC, pDC->GetBkColor(), dTolerance);
+	}
+	catch (const CGdiObjectException&)
+	{
+		// 错误处理：记录日志或显示错误消息
+		TRACE(_T("Failed to execute eraser command (low detail)\n"));
+	}
+}
+
 // CTextCommand 实现
-void CTextCommand::Execute(CDC* pDC)
+CTextCommand::CTextCommand(const DrawData& data, const CString& text)
+	: CDrawCommand(data, text), m_strText(text), m_nTextHash(CTextRunCache::HashText(text))
+{
+}
+
+void CTextCommand::Execute(CDC* pDC, const CColorPalette& palette)
 {
-	pDC->SetTextColor(m_data.penColor);
-	pDC->TextOutW(m_data.pointBegin.x, m_data.pointBegin.y, m_data.textContent);
+	pDC->SetTextColor(m_data.GetPenColor(palette));
+	// 优先复制缓存的绘制结果，不适用时（缩放、打印、透明背景等）直接输出文本
+	if (!CTextRunCache::ForCurrentThread().Draw(pDC, m_data.pointBegin, m_strText, m_nTextHash))
+		pDC->TextOutW(m_data.pointBegin.x, m_data.pointBegin.y, m_strText);
 }
 
 void CTextCommand::Undo(CDC* pDC)
@@ -328,11 +710,11 @@ void CTextCommand::Undo(CDC* pDC)
 	// 使用背景色重绘文本区域以擦除
 	COLORREF bgColor = pDC->GetBkColor();
 	pDC->SetTextColor(bgColor);
-	pDC->TextOutW(m_data.pointBegin.x, m_data.pointBegin.y, m_data.textContent);
+	pDC->TextOutW(m_data.pointBegin.x, m_data.pointBegin.y, m_strText);
 }
 
 CDrawCommand* CTextCommand::Clone() const
 {
-	return new CTextCommand(m_data);
+	return new CTextCommand(m_data, m_strText);
 }
 
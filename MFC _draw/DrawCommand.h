@@ -3,127 +3,242 @@
 
 #pragma once
 
+#include <memory>
+#include <utility>
 #include <vector>
 #include <afxwin.h>
+#include "ColorPalette.h"
+#include "StringPool.h"
+#include "StrokePyramid.h"
 
 // 绘图数据结构
 struct DrawData
 {
-	enum class DrawType {
+	enum class DrawType : BYTE {
 		LineSegment, Circle, Rectangle, Ellipse, Pencil, Text, Eraser
 	};
 
 	DrawType drawType;
+	// 颜色在文档颜色表中的 24 位序号：低 16 位和高 8 位分开保存，高位放在 drawType 之后原本的填充字节中，
+	// 颜色只占 6 个字节。通过 GetPenColorIndex、SetPenColorIndex 等访问
+	BYTE penColorIndexHigh;
+	BYTE brushColorIndexHigh;
 	CPoint pointBegin;
 	CPoint pointEnd;
 	int penSize;
-	COLORREF penColor;
-	COLORREF brushColor;
-	CString textContent;  // 用于文本输入
+	WORD penColorIndexLow;
+	WORD brushColorIndexLow;
+	UINT nTextId;  // 文本在文档字符串池中的序号（用于文本输入）
 	std::vector<CPoint> pencilPoints;  // 用于铅笔和橡皮擦的连续点
 
-	DrawData() : drawType(DrawType::LineSegment), penSize(1), 
-		penColor(RGB(0, 0, 0)), brushColor(RGB(0, 0, 0)) {}
+	DrawData() : drawType(DrawType::LineSegment), penColorIndexHigh(0), brushColorIndexHigh(0), penSize(1),
+		penColorIndexLow(CColorPalette::BLACK_INDEX), brushColorIndexLow(CColorPalette::BLACK_INDEX), nTextId(CStringPool::EMPTY_ID) {}
+
+	CColorPalette::ColorIndex GetPenColorIndex() const { return penColorIndexLow | static_cast<UINT>(penColorIndexHigh) << 16; }
+	CColorPalette::ColorIndex GetBrushColorIndex() const { return brushColorIndexLow | static_cast<UINT>(brushColorIndexHigh) << 16; }
+	void SetPenColorIndex(CColorPalette::ColorIndex nIndex)
+	{
+		penColorIndexLow = static_cast<WORD>(nIndex);
+		penColorIndexHigh = static_cast<BYTE>(nIndex >> 16);
+	}
+	void SetBrushColorIndex(CColorPalette::ColorIndex nIndex)
+	{
+		brushColorIndexLow = static_cast<WORD>(nIndex);
+		brushColorIndexHigh = static_cast<BYTE>(nIndex >> 16);
+	}
+	// palette 为命令所属文档的颜色表
+	COLORREF GetPenColor(const CColorPalette& palette) const { return palette.Get(GetPenColorIndex()); }
+	COLORREF GetBrushColor(const CColorPalette& palette) const { return palette.Get(GetBrushColorIndex()); }
+	// 把颜色加入 palette 并设置
+	void SetPenColor(CColorPalette& palette, COLORREF color) { SetPenColorIndex(palette.Intern(color)); }
+	void SetBrushColor(CColorPalette& palette, COLORREF color) { SetBrushColorIndex(palette.Intern(color)); }
 };
 
+// 图形变换（移动、缩放选中的图形）：以 ptAnchor 为中心按 dScaleX、dScaleY 缩放，再平移 offset
+struct DrawTransform
+{
+	CPoint ptAnchor;
+	double dScaleX;
+	double dScaleY;
+	CSize offset;
+
+	DrawTransform() : ptAnchor(0, 0), dScaleX(1.0), dScaleY(1.0), offset(0, 0) {}
+
+	BOOL IsIdentity() const { return dScaleX == 1.0 && dScaleY == 1.0 && offset == CSize(0, 0); }
+	CPoint Apply(CPoint point) const;
+	// 变换矩形的两个角（结果已规范化）
+	CRect Apply(const CRect& rect) const;
+	// 变换绘图数据中的点；画笔宽度不变，文本只移动位置
+	void Apply(DrawData& data) const;
+};
+
+// 计算绘图数据的外接矩形（包含画笔宽度），text 为文本命令的内容
+CRect CalcDrawDataBounds(const DrawData& data, const CString& text);
+// 把绘图数据写入文档；nTextId 为文本在文件字符串表中的序号，nPenColor、nBrushColor 为颜色在文件颜色表中的序号
+void StoreDrawData(CArchive& ar, const DrawData& data, DWORD nTextId, DWORD nPenColor, DWORD nBrushColor);
+// 从文档读取绘图数据：textIds 把文件字符串表中的序号转换为字符串池中的序号，
+// colorIds 把文件颜色表中的序号转换为文档颜色表中的序号
+void LoadDrawData(CArchive& ar, DrawData& data, const std::vector<UINT>& textIds,
+	const std::vector<CColorPalette::ColorIndex>& colorIds);
+
 // 命令基类
 class CDrawCommand
 {
+protected:
+	DrawData m_data;
+	CRect m_bounds;  // 外接矩形，构造时计算一次
+
 public:
+	explicit CDrawCommand(const DrawData& data) : m_data(data), m_bounds(CalcDrawDataBounds(data, CString())) {}
+	// 接管 data 中的点，不再复制（鼠标抬起时由采集缓冲区生成的铅笔/橡皮擦数据）
+	explicit CDrawCommand(DrawData&& data) : m_data(std::move(data)), m_bounds(CalcDrawDataBounds(m_data, CString())) {}
+	CDrawCommand(const DrawData& data, const CString& text) : m_data(data), m_bounds(CalcDrawDataBounds(data, text)) {}
 	virtual ~CDrawCommand() {}
-	virtual void Execute(CDC* pDC) = 0;  // 执行命令
+	virtual void Execute(CDC* pDC, const CColorPalette& palette) = 0;  // 执行命令，palette 为命令所属文档的颜色表
 	virtual void Undo(CDC* pDC) = 0;     // 撤销命令
 	virtual CDrawCommand* Clone() const = 0;  // 克隆命令
+	// 低细节绘制（缩略图等缩小显示）：dTolerance 为可以忽略的偏差（逻辑单位），默认与 Execute 相同
+	virtual void ExecuteLowDetail(CDC* pDC, const CColorPalette& palette, double /*dTolerance*/) { Execute(pDC, palette); }
+
+	// 获取绘图数据
+	const DrawData& GetData() const { return m_data; }
+	// 获取外接矩形（逻辑坐标），用于裁剪和计算文档范围
+	const CRect& GetBounds() const { return m_bounds; }
+	// 点选：point 到图形（含画笔宽度）的距离不超过 dTolerance 时返回 TRUE；默认按外接矩形判断
+	virtual BOOL HitTest(CPoint point, double dTolerance) const;
+	// 框选：图形（含画笔宽度）与 rect 相交时返回 TRUE；默认按外接矩形判断
+	virtual BOOL IntersectsRect(const CRect& rect) const;
+	// 获取文本内容，没有文本的命令返回空字符串
+	virtual const CString& GetText() const;
+	// 创建按 transform 变换后的同类命令（调用方接管所有权）
+	CDrawCommand* CreateTransformed(const DrawTransform& transform) const;
+	// 估算命令占用的内存（字节），不含与字符串池共享的文本
+	virtual size_t GetMemorySize() const { return sizeof(CDrawCommand) + m_data.pencilPoints.capacity() * sizeof(CPoint); }
 };
 
 // 具体命令类：线段
 class CLineSegmentCommand : public CDrawCommand
 {
-private:
-	DrawData m_data;
-
 public:
-	CLineSegmentCommand(const DrawData& data) : m_data(data) {}
-	virtual void Execute(CDC* pDC) override;
+	CLineSegmentCommand(const DrawData& data) : CDrawCommand(data) {}
+	virtual void Execute(CDC* pDC, const CColorPalette& palette) override;
 	virtual void Undo(CDC* pDC) override;
 	virtual CDrawCommand* Clone() const override;
+	virtual BOOL HitTest(CPoint point, double dTolerance) const override;
+	virtual BOOL IntersectsRect(const CRect& rect) const override;
 };
 
 // 具体命令类：矩形
 class CRectangleCommand : public CDrawCommand
 {
-private:
-	DrawData m_data;
-
 public:
-	CRectangleCommand(const DrawData& data) : m_data(data) {}
-	virtual void Execute(CDC* pDC) override;
+	CRectangleCommand(const DrawData& data) : CDrawCommand(data) {}
+	virtual void Execute(CDC* pDC, const CColorPalette& palette) override;
 	virtual void Undo(CDC* pDC) override;
 	virtual CDrawCommand* Clone() const override;
+	virtual BOOL HitTest(CPoint point, double dTolerance) const override;
+	virtual BOOL IntersectsRect(const CRect& rect) const override;
 };
 
 // 具体命令类：圆形
 class CCircleCommand : public CDrawCommand
 {
-private:
-	DrawData m_data;
-
 public:
-	CCircleCommand(const DrawData& data) : m_data(data) {}
-	virtual void Execute(CDC* pDC) override;
+	CCircleCommand(const DrawData& data) : CDrawCommand(data) {}
+	virtual void Execute(CDC* pDC, const CColorPalette& palette) override;
 	virtual void Undo(CDC* pDC) override;
 	virtual CDrawCommand* Clone() const override;
+	virtual BOOL HitTest(CPoint point, double dTolerance) const override;
+	virtual BOOL IntersectsRect(const CRect& rect) const override;
 };
 
 // 具体命令类：椭圆
 class CEllipseCommand : public CDrawCommand
 {
-private:
-	DrawData m_data;
-
 public:
-	CEllipseCommand(const DrawData& data) : m_data(data) {}
-	virtual void Execute(CDC* pDC) override;
+	CEllipseCommand(const DrawData& data) : CDrawCommand(data) {}
+	virtual void Execute(CDC* pDC, const CColorPalette& palette) override;
 	virtual void Undo(CDC* pDC) override;
 	virtual CDrawCommand* Clone() const override;
+	virtual BOOL HitTest(CPoint point, double dTolerance) const override;
+	virtual BOOL IntersectsRect(const CRect& rect) const override;
 };
 
-// 具体命令类：铅笔
-class CPencilCommand : public CDrawCommand
+// 连续点命令（铅笔、橡皮擦）的基类：低细节绘制使用按需建立的多分辨率金字塔
+class CStrokeCommand : public CDrawCommand
 {
-private:
-	DrawData m_data;
+protected:
+	CStrokePyramidCache m_pyramid;
+
+	// 用 color 画出与 dTolerance 相符的金字塔级别（点数太少或容差小于 1 时画出原始点）
+	void DrawLowDetail(CDC* pDC, COLORREF color, double dTolerance) const;
 
 public:
-	CPencilCommand(const DrawData& data) : m_data(data) {}
-	virtual void Execute(CDC* pDC) override;
+	explicit CStrokeCommand(const DrawData& data) : CDrawCommand(data) {}
+	explicit CStrokeCommand(DrawData&& data) : CDrawCommand(std::move(data)) {}
+
+	// data 对应的命令是否为 CStrokeCommand（铅笔或橡皮擦）
+	static BOOL IsStroke(const DrawData& data)
+	{
+		return data.drawType == DrawData::DrawType::Pencil || data.drawType == DrawData::DrawType::Eraser;
+	}
+
+	// 获取金字塔，尚未建立时建立；点数太少时返回 nullptr
+	const CStrokePyramid* GetStrokePyramid() const { return m_pyramid.Get(m_data.pencilPoints); }
+	// 已经建立或读取的金字塔，没有时返回 nullptr（不会建立）
+	const CStrokePyramid* GetBuiltStrokePyramid() const { return m_pyramid.GetIfBuilt(); }
+	// 设置从文档读取的金字塔（接管所有权）
+	void SetStrokePyramid(CStrokePyramid* pPyramid) { m_pyramid.Set(pPyramid); }
+};
+
+// 具体命令类：铅笔
+class CPencilCommand : public CStrokeCommand
+{
+public:
+	CPencilCommand(const DrawData& data) : CStrokeCommand(data) {}
+	CPencilCommand(DrawData&& data) : CStrokeCommand(std::move(data)) {}
+	virtual void Execute(CDC* pDC, const CColorPalette& palette) override;
 	virtual void Undo(CDC* pDC) override;
 	virtual CDrawCommand* Clone() const override;
+	virtual void ExecuteLowDetail(CDC* pDC, const CColorPalette& palette, double dTolerance) override;
+	virtual BOOL HitTest(CPoint point, double dTolerance) const override;
+	virtual BOOL IntersectsRect(const CRect& rect) const override;
 };
 
 // 具体命令类：橡皮擦
-class CEraserCommand : public CDrawCommand
+class CEraserCommand : public CStrokeCommand
 {
-private:
-	DrawData m_data;
-
 public:
-	CEraserCommand(const DrawData& data) : m_data(data) {}
-	virtual void Execute(CDC* pDC) override;
+	CEraserCommand(const DrawData& data) : CStrokeCommand(data) {}
+	CEraserCommand(DrawData&& data) : CStrokeCommand(std::move(data)) {}
+	virtual void Execute(CDC* pDC, const CColorPalette& palette) override;
 	virtual void Undo(CDC* pDC) override;
 	virtual CDrawCommand* Clone() const override;
+	virtual void ExecuteLowDetail(CDC* pDC, const CColorPalette& palette, double dTolerance) override;
+	// 橡皮擦轨迹不能被选中
+	virtual BOOL HitTest(CPoint /*point*/, double /*dTolerance*/) const override { return FALSE; }
+	virtual BOOL IntersectsRect(const CRect& /*rect*/) const override { return FALSE; }
 };
 
 // 具体命令类：文本
 class CTextCommand : public CDrawCommand
 {
 private:
-	DrawData m_data;
+	CString m_strText;   // 与文档字符串池共享缓冲区
+	size_t m_nTextHash;  // 文本内容的散列值，用于查找缓存的绘制结果
 
 public:
-	CTextCommand(const DrawData& data) : m_data(data) {}
-	virtual void Execute(CDC* pDC) override;
+	CTextCommand(const DrawData& data, const CString& text);
+	virtual const CString& GetText() const override { return m_strText; }
+	virtual size_t GetMemorySize() const override { return sizeof(CTextCommand); }
+	virtual void Execute(CDC* pDC, const CColorPalette& palette) override;
 	virtual void Undo(CDC* pDC) override;
 	virtual CDrawCommand* Clone() const override;
 };
 
+// 按绘图类型创建对应的命令（读取文档时使用），文本从 pool 中取得
+CDrawCommand* CreateDrawCommand(const DrawData& data, const CStringPool& pool);
+// 同上，文本命令的内容为 text
+CDrawCommand* CreateDrawCommand(const DrawData& data, const CString& text);
+// 批量添加时使用：命令与共享指针的引用计数一次分配，绘图数据移入命令（铅笔和橡皮擦的点列表不复制）
+std::shared_ptr<CDrawCommand> MakeSharedDrawCommand(DrawData&& data, const CStringPool& pool);
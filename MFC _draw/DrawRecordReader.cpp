@@ -0,0 +1,298 @@
+﻿// DrawRecordReader.cpp: 绘图记录文件的流式读取的实现
+//
+
+#include "pch.h"
+#include "DrawRecordReader.h"
+
+#include <cstring>
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+static BOOL IsSpace(char ch)
+{
+	return ch == ' ' || ch == '\t' || ch == '\r';
+}
+
+static void SkipSpaces(const char*& p, const char* pEnd)
+{
+	while (p < pEnd && IsSpace(*p))
+		p++;
+}
+
+// 读取一个单词，返回其长度
+static size_t ReadWord(const char*& p, const char* pEnd)
+{
+	SkipSpaces(p, pEnd);
+	const char* pStart = p;
+	while (p < pEnd && !IsSpace(*p))
+		p++;
+	return static_cast<size_t>(p - pStart);
+}
+
+static BOOL IsWord(const char* pWord, size_t nLength, const char* psz)
+{
+	return nLength == strlen(psz) && memcmp(pWord, psz, nLength) == 0;
+}
+
+// 读取一个十进制整数，绝对值不超过 1e9（足够表示文档坐标，也不会在 LONG 中溢出）
+static BOOL ReadInt(const char*& p, const char* pEnd, LONG& nValue)
+{
+	SkipSpaces(p, pEnd);
+	BOOL bNegative = p < pEnd && *p == '-';
+	if (bNegative || (p < pEnd && *p == '+'))
+		p++;
+	if (p == pEnd || *p < '0' || *p > '9')
+		return FALSE;
+
+	long long n = 0;
+	while (p < pEnd && *p >= '0' && *p <= '9')
+	{
+		n = n * 10 + (*p++ - '0');
+		if (n > 1000000000)
+			return FALSE;
+	}
+	if (p < pEnd && !IsSpace(*p))
+		return FALSE;
+	nValue = static_cast<LONG>(bNegative ? -n : n);
+	return TRUE;
+}
+
+// 读取 RRGGBB 形式的颜色
+static BOOL ReadColor(const char*& p, const char* pEnd, COLORREF& color)
+{
+	SkipSpaces(p, pEnd);
+	if (pEnd - p < 6 || (pEnd - p > 6 && !IsSpace(p[6])))
+		return FALSE;
+	unsigned int rgb = 0;
+	for (int i = 0; i < 6; i++)
+	{
+		char ch = *p++;
+		unsigned int nDigit;
+		if (ch >= '0' && ch <= '9')
+			nDigit = ch - '0';
+		else if (ch >= 'a' && ch <= 'f')
+			nDigit = ch - 'a' + 10;
+		else if (ch >= 'A' && ch <= 'F')
+			nDigit = ch - 'A' + 10;
+		else
+			return FALSE;
+		rgb = (rgb << 4) | nDigit;
+	}
+	color = RGB((rgb >> 16) & 0xFF, (rgb >> 8) & 0xFF, rgb & 0xFF);
+	return TRUE;
+}
+
+// 行尾只能是空白
+static BOOL AtLineEnd(const char* p, const char* pEnd)
+{
+	SkipSpaces(p, pEnd);
+	return p == pEnd;
+}
+
+// UTF-8 -> UTF-16，无效的序列（多余的后续字节、F5 以上的首字节、过长编码、代理区和 U+10FFFF 以上的码点）替换为 U+FFFD
+static void DecodeUtf8(const char* p, const char* pEnd, CString& text)
+{
+	static const unsigned int MIN_CODE_POINT[] = { 0, 0x80, 0x800, 0x10000 };
+	text.Empty();
+	while (p < pEnd)
+	{
+		unsigned int ch = static_cast<unsigned char>(*p++);
+		int nTrail = ch >= 0xF0 ? 3 : ch >= 0xE0 ? 2 : ch >= 0xC0 ? 1 : 0;
+		if (ch >= 0x80 && (nTrail == 0 || ch >= 0xF5))
+		{
+			text += static_cast<TCHAR>(0xFFFD);
+			continue;
+		}
+		const int nLength = nTrail;
+		if (nTrail > 0)
+			ch &= 0x3F >> nTrail;
+		for (; nTrail > 0; nTrail--)
+		{
+			if (p == pEnd || (static_cast<unsigned char>(*p) & 0xC0) != 0x80)
+				break;
+			ch = (ch << 6) | (static_cast<unsigned char>(*p++) & 0x3F);
+		}
+		if (nTrail > 0 || ch < MIN_CODE_POINT[nLength] || (ch >= 0xD800 && ch <= 0xDFFF) || ch > 0x10FFFF)
+			ch = 0xFFFD;
+
+		if (ch >= 0x10000)
+		{
+			ch -= 0x10000;
+			text += static_cast<TCHAR>(0xD800 + (ch >> 10));
+			text += static_cast<TCHAR>(0xDC00 + (ch & 0x3FF));
+		}
+		else
+		{
+			text += static_cast<TCHAR>(ch);
+		}
+	}
+}
+
+CDrawRecordReader::CDrawRecordReader(std::istream& in, CColorPalette& palette)
+	: m_in(in), m_palette(palette), m_buffer(BUFFER_SIZE), m_nBegin(0), m_nEnd(0), m_nLine(0), m_bError(FALSE),
+	m_nPenSize(1), m_penColorIndex(CColorPalette::BLACK_INDEX), m_brushColorIndex(CColorPalette::BLACK_INDEX)
+{
+}
+
+BOOL CDrawRecordReader::NextLine(const char*& pLine, const char*& pLineEnd)
+{
+	size_t nSearched = m_nBegin;  // 已确认没有换行符的位置
+	for (;;)
+	{
+		const char* pNewline = static_cast<const char*>(memchr(m_buffer.data() + nSearched, '\n', m_nEnd - nSearched));
+		if (pNewline != nullptr || (m_in.eof() && m_nBegin < m_nEnd))
+		{
+			// 最后一行可以没有换行符
+			pLine = m_buffer.data() + m_nBegin;
+			pLineEnd = pNewline != nullptr ? pNewline : m_buffer.data() + m_nEnd;
+			m_nBegin = static_cast<size_t>(pLineEnd - m_buffer.data()) + (pNewline != nullptr ? 1 : 0);
+			m_nLine++;
+			return TRUE;
+		}
+		if (m_in.eof() || !m_in)
+		{
+			m_bError = m_in.bad();  // 读取失败与格式错误同样报告
+			return FALSE;
+		}
+
+		// 未处理的内容移到缓冲区开头再继续读取；一行占满缓冲区时加倍
+		nSearched = m_nEnd - m_nBegin;
+		if (m_nBegin > 0)
+		{
+			memmove(m_buffer.data(), m_buffer.data() + m_nBegin, nSearched);
+			m_nBegin = 0;
+			m_nEnd = nSearched;
+		}
+		else if (m_nEnd == m_buffer.size())
+		{
+			m_buffer.resize(m_buffer.size() * 2);
+		}
+		m_in.read(m_buffer.data() + m_nEnd, static_cast<std::streamsize>(m_buffer.size() - m_nEnd));
+		m_nEnd += static_cast<size_t>(m_in.gcount());
+	}
+}
+
+BOOL CDrawRecordReader::ParseLine(const char* p, const char* pEnd, DrawData& data, CString& text)
+{
+	size_t nLength = ReadWord(p, pEnd);
+	const char* pWord = p - nLength;
+	if (nLength == 0 || *pWord == '#')
+		return FALSE;
+
+	if (IsWord(pWord, nLength, "pen"))
+	{
+		LONG nSize;
+		COLORREF color;
+		if (!ReadInt(p, pEnd, nSize) || nSize < 1 || !ReadColor(p, pEnd, color) || !AtLineEnd(p, pEnd))
+			m_bError = TRUE;
+		else
+		{
+			m_nPenSize = static_cast<int>(nSize);
+			m_penColorIndex = m_palette.Intern(color);
+		}
+		return FALSE;
+	}
+	if (IsWord(pWord, nLength, "brush"))
+	{
+		COLORREF color;
+		if (!ReadColor(p, pEnd, color) || !AtLineEnd(p, pEnd))
+			m_bError = TRUE;
+		else
+			m_brushColorIndex = m_palette.Intern(color);
+		return FALSE;
+	}
+
+	DrawData::DrawType drawType;
+	if (IsWord(pWord, nLength, "line"))
+		drawType = DrawData::DrawType::LineSegment;
+	else if (IsWord(pWord, nLength, "rect"))
+		drawType = DrawData::DrawType::Rectangle;
+	else if (IsWord(pWord, nLength, "circle"))
+		drawType = DrawData::DrawType::Circle;
+	else if (IsWord(pWord, nLength, "ellipse"))
+		drawType = DrawData::DrawType::Ellipse;
+	else if (IsWord(pWord, nLength, "pencil"))
+		drawType = DrawData::DrawType::Pencil;
+	else if (IsWord(pWord, nLength, "eraser"))
+		drawType = DrawData::DrawType::Eraser;
+	else if (IsWord(pWord, nLength, "text"))
+		drawType = DrawData::DrawType::Text;
+	else
+	{
+		m_bError = TRUE;
+		return FALSE;
+	}
+
+	data.drawType = drawType;
+	data.penSize = m_nPenSize;
+	data.SetPenColorIndex(m_penColorIndex);
+	data.SetBrushColorIndex(m_brushColorIndex);
+	data.nTextId = CStringPool::EMPTY_ID;
+	data.pencilPoints.clear();
+	text.Empty();
+
+	CPoint point;
+	if (!ReadInt(p, pEnd, point.x) || !ReadInt(p, pEnd, point.y))
+	{
+		m_bError = TRUE;
+		return FALSE;
+	}
+	data.pointBegin = data.pointEnd = point;
+
+	switch (drawType)
+	{
+	case DrawData::DrawType::Text:
+		// 内容为坐标之后的第一个空格到行尾（去掉 Windows 换行符的 \r）
+		if (p < pEnd)
+			p++;
+		if (pEnd > p && pEnd[-1] == '\r')
+			pEnd--;
+		DecodeUtf8(p, pEnd, text);
+		return TRUE;
+
+	case DrawData::DrawType::Pencil:
+	case DrawData::DrawType::Eraser:
+		data.pencilPoints.push_back(point);
+		while (!AtLineEnd(p, pEnd))
+		{
+			if (!ReadInt(p, pEnd, point.x) || !ReadInt(p, pEnd, point.y))
+			{
+				m_bError = TRUE;
+				return FALSE;
+			}
+			data.pencilPoints.push_back(point);
+		}
+		if (data.pencilPoints.size() < 2)
+		{
+			m_bError = TRUE;
+			return FALSE;
+		}
+		data.pointEnd = data.pencilPoints.back();
+		return TRUE;
+
+	default:
+		if (!ReadInt(p, pEnd, data.pointEnd.x) || !ReadInt(p, pEnd, data.pointEnd.y) || !AtLineEnd(p, pEnd))
+		{
+			m_bError = TRUE;
+			return FALSE;
+		}
+		return TRUE;
+	}
+}
+
+BOOL CDrawRecordReader::Read(DrawData& data, CString& text)
+{
+	m_bError = FALSE;
+	const char* pLine;
+	const char* pLineEnd;
+	while (NextLine(pLine, pLineEnd))
+	{
+		if (ParseLine(pLine, pLineEnd, data, text))
+			return TRUE;
+		if (m_bError)
+			return FALSE;
+	}
+	return FALSE;
+}
@@ -0,0 +1,57 @@
+// DrawRecordReader.h: 绘图记录文件的流式读取
+// 程序生成的图形（图表、标注等）不需要模拟鼠标输入，写成记录文件后批量导入。
+// 文本格式，UTF-8 编码，每行一条记录，空行和以 # 开头的行忽略，坐标为文档坐标：
+//   pen 粗细 RRGGBB         之后的图形使用的画笔粗细和颜色（默认 1 000000）
+//   brush RRGGBB            之后的图形使用的画刷颜色（默认 000000）
+//   line x1 y1 x2 y2        线段；rect、circle、ellipse 同样由拖动的起点和终点确定
+//   pencil x1 y1 x2 y2 ...  铅笔轨迹，至少两个点；eraser 同样
+//   text x y 内容           文本，内容为坐标之后的第一个空格到行尾
+// 输入经过固定大小的缓冲区按行切分，数字直接解析，不构造临时字符串；读取任意大小的文件只占用常量内存。
+//
+
+#pragma once
+
+#include <istream>
+#include <vector>
+#include "DrawCommand.h"
+
+class CDrawRecordReader
+{
+private:
+	static const size_t BUFFER_SIZE = 64 * 1024;
+
+	std::istream& m_in;
+	CColorPalette& m_palette;  // 记录中的颜色加入的文档颜色表
+	std::vector<char> m_buffer;  // 只有一行超过缓冲区大小时才增大
+	size_t m_nBegin;  // 缓冲区中未处理内容的开始和结束
+	size_t m_nEnd;
+	size_t m_nLine;   // 当前行号（从 1 开始）
+	BOOL m_bError;
+
+	// 当前的画笔和画刷
+	int m_nPenSize;
+	CColorPalette::ColorIndex m_penColorIndex;
+	CColorPalette::ColorIndex m_brushColorIndex;
+
+	// 禁止拷贝构造和赋值
+	CDrawRecordReader(const CDrawRecordReader&) = delete;
+	CDrawRecordReader& operator=(const CDrawRecordReader&) = delete;
+
+	// 取得下一行（不含换行符），没有更多行时返回 FALSE
+	BOOL NextLine(const char*& pLine, const char*& pLineEnd);
+	// 解析一行，是图形记录时填入 data 并返回 TRUE；设置行返回 FALSE；格式错误时设置 m_bError
+	BOOL ParseLine(const char* p, const char* pEnd, DrawData& data, CString& text);
+
+public:
+	// 记录中的颜色加入 palette，读到的绘图数据中的颜色序号指向它
+	CDrawRecordReader(std::istream& in, CColorPalette& palette);
+
+	// 读取下一条图形记录：data 被整体覆盖（点列表的容量保留），文本命令的内容写入 text，
+	// 调用方负责把文本加入字符串池并设置 data.nTextId。没有更多记录或格式错误时返回 FALSE
+	BOOL Read(DrawData& data, CString& text);
+
+	// 上一次 Read 是否因格式错误而失败
+	BOOL HasError() const { return m_bError; }
+	// 最后读取的行号，格式错误时为出错的行
+	size_t GetLineNumber() const { return m_nLine; }
+};
@@ -5,7 +5,9 @@
 #pragma once
 
 #include <afxwin.h>
+#include <atomic>
 #include <stdexcept>
+#include "Metrics.h"
 
 // GDI 对象创建失败异常类
 class CGdiObjectException : public std::runtime_error
@@ -15,6 +17,100 @@ public:
 	CGdiObjectException(const CString& message) : std::runtime_error(CT2A(message)) {}
 };
 
+// 记录一个由包装类创建的 GDI 对象（状态栏显示每次绘制创建的数量）
+inline void CountGdiObjectCreated()
+{
+	static CMetricCounter& s_created = CMetricsRegistry::Instance().GetCounter(DrawMetrics::GDI_OBJECTS_CREATED);
+	s_created.Add();
+}
+
+#ifdef GDI_RESOURCE_ACCOUNTING
+// GDI 资源统计（定义 GDI_RESOURCE_ACCOUNTING 时编译，调试配置默认打开）
+// 按类型统计包装类当前持有（创建或接管所有权）的对象数、持有数的峰值和累计创建数，
+// 用于在接近进程 GDI 句柄上限（默认 10000）之前发现泄漏或缓存失控。
+enum class GdiResourceType
+{
+	Pen, Brush, Font, Bitmap, DC, Count
+};
+
+class CGdiResourceStats
+{
+private:
+	struct CCounters
+	{
+		std::atomic<long> nLive;
+		std::atomic<long> nPeak;
+		std::atomic<long long> nCreated;
+	};
+
+	static CCounters& GetCounters(GdiResourceType type)
+	{
+		static CCounters s_counters[static_cast<int>(GdiResourceType::Count)];
+		return s_counters[static_cast<int>(type)];
+	}
+
+public:
+	// 所有类型持有总数超过此值时输出一次警告
+	static const long WARNING_LIVE_OBJECTS = 5000;
+
+	static void OnAcquired(GdiResourceType type)
+	{
+		CCounters& counters = GetCounters(type);
+		long nLive = counters.nLive.fetch_add(1, std::memory_order_relaxed) + 1;
+		long nPeak = counters.nPeak.load(std::memory_order_relaxed);
+		while (nLive > nPeak && !counters.nPeak.compare_exchange_weak(nPeak, nLive, std::memory_order_relaxed))
+		{
+		}
+		counters.nCreated.fetch_add(1, std::memory_order_relaxed);
+
+		static std::atomic<bool> s_bWarned(false);
+		if (GetTotalLive() > WARNING_LIVE_OBJECTS && !s_bWarned.exchange(true))
+		{
+			TRACE(_T("Warning: more than %ld GDI objects are held by wrappers\n"), WARNING_LIVE_OBJECTS);
+		}
+	}
+
+	static void OnReleased(GdiResourceType type)
+	{
+		GetCounters(type).nLive.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	static long GetLive(GdiResourceType type) { return GetCounters(type).nLive.load(std::memory_order_relaxed); }
+	static long GetPeak(GdiResourceType type) { return GetCounters(type).nPeak.load(std::memory_order_relaxed); }
+	static long long GetCreated(GdiResourceType type) { return GetCounters(type).nCreated.load(std::memory_order_relaxed); }
+
+	static long GetTotalLive()
+	{
+		long nTotal = 0;
+		for (int i = 0; i < static_cast<int>(GdiResourceType::Count); i++)
+			nTotal += GetLive(static_cast<GdiResourceType>(i));
+		return nTotal;
+	}
+
+	// 把各类型的峰值重置为当前持有数，开始新的一段测量
+	static void ResetPeaks()
+	{
+		for (int i = 0; i < static_cast<int>(GdiResourceType::Count); i++)
+		{
+			CCounters& counters = GetCounters(static_cast<GdiResourceType>(i));
+			counters.nPeak.store(counters.nLive.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		}
+	}
+
+	static LPCTSTR GetTypeName(GdiResourceType type)
+	{
+		static const LPCTSTR s_names[] = { _T("Pen"), _T("Brush"), _T("Font"), _T("Bitmap"), _T("DC") };
+		return s_names[static_cast<int>(type)];
+	}
+};
+
+#define GDI_RESOURCE_ACQUIRED(type) CGdiResourceStats::OnAcquired(GdiResourceType::type)
+#define GDI_RESOURCE_RELEASED(type) CGdiResourceStats::OnReleased(GdiResourceType::type)
+#else
+#define GDI_RESOURCE_ACQUIRED(type) ((void)0)
+#define GDI_RESOURCE_RELEASED(type) ((void)0)
+#endif
+
 // CPen 的 RAII 包装类
 class CPenWrapper
 {
@@ -38,6 +134,8 @@ public:
 			throw CGdiObjectException(_T("Failed to create pen"));
 		}
 		m_bCreated = TRUE;
+		CountGdiObjectCreated();
+		GDI_RESOURCE_ACQUIRED(Pen);
 	}
 
 	// 构造函数：从现有画笔创建
@@ -59,6 +157,7 @@ public:
 		if (m_bCreated)
 		{
 			m_pen.DeleteObject();
+			GDI_RESOURCE_RELEASED(Pen);
 		}
 	}
 
@@ -133,6 +232,8 @@ public:
 			throw CGdiObjectException(_T("Failed to create solid brush"));
 		}
 		m_bCreated = TRUE;
+		CountGdiObjectCreated();
+		GDI_RESOURCE_ACQUIRED(Brush);
 	}
 
 	// 构造函数：创建图案画刷
@@ -148,6 +249,8 @@ public:
 			throw CGdiObjectException(_T("Failed to create pattern brush"));
 		}
 		m_bCreated = TRUE;
+		CountGdiObjectCreated();
+		GDI_RESOURCE_ACQUIRED(Brush);
 	}
 
 	// 析构函数：自动清理
@@ -157,6 +260,7 @@ public:
 		if (m_bCreated)
 		{
 			m_brush.DeleteObject();
+			GDI_RESOURCE_RELEASED(Brush);
 		}
 	}
 
@@ -235,6 +339,8 @@ public:
 			throw CGdiObjectException(_T("Failed to create font"));
 		}
 		m_bCreated = TRUE;
+		CountGdiObjectCreated();
+		GDI_RESOURCE_ACQUIRED(Font);
 	}
 
 	// 析构函数：自动清理
@@ -244,6 +350,7 @@ public:
 		if (m_bCreated)
 		{
 			m_font.DeleteObject();
+			GDI_RESOURCE_RELEASED(Font);
 		}
 	}
 
@@ -321,6 +428,8 @@ public:
 			throw CGdiObjectException(_T("Failed to create bitmap"));
 		}
 		m_bOwned = TRUE;
+		CountGdiObjectCreated();
+		GDI_RESOURCE_ACQUIRED(Bitmap);
 	}
 
 	// 构造函数：从现有句柄创建（不拥有所有权）
@@ -331,6 +440,8 @@ public:
 		{
 			throw CGdiObjectException(_T("Bitmap handle is null"));
 		}
+		if (m_bOwned)
+			GDI_RESOURCE_ACQUIRED(Bitmap);
 	}
 
 	// 析构函数：自动清理
@@ -340,6 +451,7 @@ public:
 		{
 			DeleteObject(m_hBitmap);
 			m_hBitmap = nullptr;
+			GDI_RESOURCE_RELEASED(Bitmap);
 		}
 	}
 
@@ -353,6 +465,8 @@ public:
 	HBITMAP Detach()
 	{
 		HBITMAP hBitmap = m_hBitmap;
+		if (m_bOwned && hBitmap != nullptr)
+			GDI_RESOURCE_RELEASED(Bitmap);
 		m_hBitmap = nullptr;
 		m_bOwned = FALSE;
 		return hBitmap;
@@ -386,6 +500,8 @@ public:
 			throw CGdiObjectException(_T("Failed to create compatible DC"));
 		}
 		m_bOwned = TRUE;
+		CountGdiObjectCreated();
+		GDI_RESOURCE_ACQUIRED(DC);
 	}
 
 	// 构造函数：从现有句柄创建（不拥有所有权）
@@ -396,6 +512,8 @@ public:
 		{
 			throw CGdiObjectException(_T("DC handle is null"));
 		}
+		if (m_bOwned)
+			GDI_RESOURCE_ACQUIRED(DC);
 	}
 
 	// 析构函数：自动清理
@@ -405,6 +523,7 @@ public:
 		{
 			DeleteDC(m_hDC);
 			m_hDC = nullptr;
+			GDI_RESOURCE_RELEASED(DC);
 		}
 	}
 
@@ -418,6 +537,8 @@ public:
 	HDC Detach()
 	{
 		HDC hDC = m_hDC;
+		if (m_bOwned && hDC != nullptr)
+			GDI_RESOURCE_RELEASED(DC);
 		m_hDC = nullptr;
 		m_bOwned = FALSE;
 		return hDC;
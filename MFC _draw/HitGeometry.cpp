@@ -0,0 +1,149 @@
+// HitGeometry.cpp: 点选和框选几何判断的实现
+//
+
+#include "pch.h"
+#include "HitGeometry.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+double PointSegmentDistanceSquared(double x, double y, CPoint a, CPoint b)
+{
+	double dx = static_cast<double>(b.x) - a.x;
+	double dy = static_cast<double>(b.y) - a.y;
+	double dLengthSquared = dx * dx + dy * dy;
+	double t = 0;
+	if (dLengthSquared > 0)
+		t = std::max(0.0, std::min(1.0, ((x - a.x) * dx + (y - a.y) * dy) / dLengthSquared));
+	double ex = a.x + t * dx - x;
+	double ey = a.y + t * dy - y;
+	return ex * ex + ey * ey;
+}
+
+// 以下 rect 均为闭区间 [left, right] × [top, bottom]，由 ClosedRect 从 CRect 转换而来
+static CRect ClosedRect(const CRect& rect)
+{
+	CRect rectClosed(rect);
+	rectClosed.NormalizeRect();
+	rectClosed.right--;
+	rectClosed.bottom--;
+	return rectClosed;
+}
+
+// (x, y) 到矩形 rect 的距离的平方，在矩形内为 0
+static double PointRectDistanceSquared(double x, double y, const CRect& rect)
+{
+	double dx = std::max(0.0, std::max(rect.left - x, x - rect.right));
+	double dy = std::max(0.0, std::max(rect.top - y, y - rect.bottom));
+	return dx * dx + dy * dy;
+}
+
+// 线段 ab 是否穿过矩形 rect（Liang-Barsky 裁剪）
+static BOOL SegmentCrossesRect(CPoint a, CPoint b, const CRect& rect)
+{
+	double dx = static_cast<double>(b.x) - a.x;
+	double dy = static_cast<double>(b.y) - a.y;
+	double p[4] = { -dx, dx, -dy, dy };
+	double q[4] = { static_cast<double>(a.x) - rect.left, static_cast<double>(rect.right) - a.x,
+		static_cast<double>(a.y) - rect.top, static_cast<double>(rect.bottom) - a.y };
+	double t0 = 0, t1 = 1;
+	for (int i = 0; i < 4; i++)
+	{
+		if (p[i] == 0)
+		{
+			if (q[i] < 0)
+				return FALSE;
+			continue;
+		}
+		double t = q[i] / p[i];
+		if (p[i] < 0)
+			t0 = std::max(t0, t);
+		else
+			t1 = std::min(t1, t);
+		if (t0 > t1)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+BOOL SegmentNearRect(CPoint a, CPoint b, const CRect& rectHalfOpen, double dRadius)
+{
+	CRect rect = ClosedRect(rectHalfOpen);
+	if (rect.right < rect.left || rect.bottom < rect.top)
+		return FALSE;
+	if (SegmentCrossesRect(a, b, rect))
+		return TRUE;
+
+	// 不相交时最近的点对一定包含矩形的一个角或线段的一个端点
+	double dRadiusSquared = dRadius * dRadius;
+	if (PointRectDistanceSquared(a.x, a.y, rect) <= dRadiusSquared || PointRectDistanceSquared(b.x, b.y, rect) <= dRadiusSquared)
+		return TRUE;
+	const CPoint corners[4] = { rect.TopLeft(), CPoint(rect.right, rect.top), rect.BottomRight(), CPoint(rect.left, rect.bottom) };
+	for (const CPoint& corner : corners)
+	{
+		if (PointSegmentDistanceSquared(corner.x, corner.y, a, b) <= dRadiusSquared)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+// 椭圆的中心和半轴；f(x, y) = (dx/a)² + (dy/b)²，在椭圆内不超过 1
+struct CEllipseShape
+{
+	double cx, cy, a, b;
+
+	CEllipseShape(const CRect& rectEllipse, double dInflate)
+	{
+		CRect rect(rectEllipse);
+		rect.NormalizeRect();
+		cx = (rect.left + rect.right) / 2.0;
+		cy = (rect.top + rect.bottom) / 2.0;
+		a = rect.Width() / 2.0 + dInflate;
+		b = rect.Height() / 2.0 + dInflate;
+	}
+
+	bool IsEmpty() const { return a <= 0 || b <= 0; }
+
+	double Eval(double x, double y) const
+	{
+		double dx = (x - cx) / a;
+		double dy = (y - cy) / b;
+		return dx * dx + dy * dy;
+	}
+};
+
+BOOL PointNearEllipseOutline(CPoint point, const CRect& rectEllipse, double dRadius)
+{
+	// 在外椭圆内、不在内椭圆内
+	CEllipseShape outer(rectEllipse, dRadius);
+	if (outer.IsEmpty() || outer.Eval(point.x, point.y) > 1)
+		return FALSE;
+	CEllipseShape inner(rectEllipse, -dRadius);
+	return inner.IsEmpty() || inner.Eval(point.x, point.y) >= 1;
+}
+
+BOOL EllipseOutlineIntersectsRect(const CRect& rectEllipse, double dRadius, const CRect& rectHalfOpen)
+{
+	CRect rect = ClosedRect(rectHalfOpen);
+	if (rect.right < rect.left || rect.bottom < rect.top)
+		return FALSE;
+	// 矩形与外椭圆相交：矩形中离中心最近的点在外椭圆内
+	CEllipseShape outer(rectEllipse, dRadius);
+	if (outer.IsEmpty())
+		return FALSE;
+	double x = std::max(static_cast<double>(rect.left), std::min(static_cast<double>(rect.right), outer.cx));
+	double y = std::max(static_cast<double>(rect.top), std::min(static_cast<double>(rect.bottom), outer.cy));
+	if (outer.Eval(x, y) > 1)
+		return FALSE;
+
+	// 并且矩形没有完全落在内椭圆里（内椭圆是凸的，四个角都在里面时整个矩形都在里面）
+	CEllipseShape inner(rectEllipse, -dRadius);
+	if (inner.IsEmpty())
+		return TRUE;
+	return inner.Eval(rect.left, rect.top) >= 1 || inner.Eval(rect.right, rect.top) >= 1
+		|| inner.Eval(rect.left, rect.bottom) >= 1 || inner.Eval(rect.right, rect.bottom) >= 1;
+}
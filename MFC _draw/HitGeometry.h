@@ -0,0 +1,18 @@
+// HitGeometry.h: 点选和框选的几何判断
+// 图形按 GDI 的画法看作有宽度的轮廓：线段是两端为半圆的粗线，矩形是四条这样的边，
+// 圆和椭圆是内外两个椭圆之间的环，铅笔轨迹是各段粗线的并集。dRadius 为画笔宽度的一半加上点选的容差。
+// 矩形参数与 CRect 相同，右边和下边不包含在内。
+//
+
+#pragma once
+
+#include <afxwin.h>
+
+// (x, y) 到线段 ab 的距离的平方
+double PointSegmentDistanceSquared(double x, double y, CPoint a, CPoint b);
+// 线段 ab 与矩形 rect 的距离是否不超过 dRadius（相交时距离为 0）
+BOOL SegmentNearRect(CPoint a, CPoint b, const CRect& rect, double dRadius);
+// point 是否落在外接矩形为 rectEllipse 的椭圆轮廓上，轮廓向内外各延伸 dRadius
+BOOL PointNearEllipseOutline(CPoint point, const CRect& rectEllipse, double dRadius);
+// 外接矩形为 rectEllipse、向内外各延伸 dRadius 的椭圆轮廓是否与 rect 相交
+BOOL EllipseOutlineIntersectsRect(const CRect& rectEllipse, double dRadius, const CRect& rect);
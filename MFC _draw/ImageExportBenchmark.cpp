@@ -0,0 +1,134 @@
+// ImageExportBenchmark.cpp: 图像导出性能测试
+// 比较 CImage::Save 与 CPngRowWriter（单线程 / 多线程）编码同一幅大图像的吞吐量，结果通过 TRACE 输出。
+// 用法：在需要时调用 RunImageExportBenchmark(pWnd)（建议在 Release 配置下运行）
+//
+
+#include "pch.h"
+#include "GdiObjectWrapper.h"
+#include "PngWriter.h"
+#include <afxwin.h>
+#include <atlimage.h>
+#include <fstream>
+#include <thread>
+
+static double BenchmarkElapsedMs(const LARGE_INTEGER& start)
+{
+	LARGE_INTEGER frequency, now;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&now);
+	return (now.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+}
+
+// 生成测试图像：白色背景上的随机线段、矩形和文本，与实际绘图内容相近
+static BOOL CreateBenchmarkImage(CImage& image, int nWidth, int nHeight)
+{
+	if (!image.Create(nWidth, -nHeight, 32))
+		return FALSE;
+
+	CDC* pDC = CDC::FromHandle(image.GetDC());
+	pDC->FillSolidRect(0, 0, nWidth, nHeight, RGB(255, 255, 255));
+	srand(1);
+	try
+	{
+		for (int i = 0; i < 20000; i++)
+		{
+			CPenWrapper pen(PS_SOLID, 1 + rand() % 5, RGB(rand() % 256, rand() % 256, rand() % 256));
+			CGdiObjectSelector<CPen, CPen> penSelector(pDC, pen.Get());
+			CPoint point(rand() % nWidth, rand() % nHeight);
+			if (i % 10 == 0)
+			{
+				pDC->SelectStockObject(NULL_BRUSH);
+				pDC->Rectangle(point.x, point.y, point.x + rand() % 400, point.y + rand() % 300);
+			}
+			else if (i % 10 == 1)
+			{
+				pDC->TextOutW(point.x, point.y, _T("性能测试 Benchmark"));
+			}
+			else
+			{
+				pDC->MoveTo(point);
+				pDC->LineTo(point.x + rand() % 600 - 300, point.y + rand() % 600 - 300);
+			}
+		}
+	}
+	catch (const CGdiObjectException&)
+	{
+		TRACE(_T("Failed to draw benchmark image\n"));
+	}
+	image.ReleaseDC();
+	return TRUE;
+}
+
+static void ReportResult(LPCTSTR pszName, double dMs, int nWidth, int nHeight, LPCTSTR pszPath)
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	ULONGLONG nFileSize = 0;
+	if (GetFileAttributesEx(pszPath, GetFileExInfoStandard, &attributes))
+	{
+		nFileSize = (static_cast<ULONGLONG>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+	}
+
+	double dMegaPixels = static_cast<double>(nWidth) * nHeight / 1e6;
+	TRACE(_T("%-28s %9.1f ms  %7.1f MP/s  %10I64u 字节\n"), pszName, dMs, dMegaPixels / (dMs / 1000.0), nFileSize);
+}
+
+static double SaveWithPngWriter(const CImage& image, LPCTSTR pszPath, unsigned nThreads)
+{
+	LARGE_INTEGER start;
+	QueryPerformanceCounter(&start);
+
+	std::ofstream file(pszPath, std::ios::binary | std::ios::trunc);
+	CPngRowWriter writer(file, nThreads);
+	// CImage 以自上而下创建，首行地址和行距可以直接交给写入器
+	if (!writer.Begin(image.GetWidth(), image.GetHeight())
+		|| !writer.WriteRows(static_cast<const uint8_t*>(image.GetBits()), image.GetHeight(), image.GetPitch())
+		|| !writer.End())
+	{
+		TRACE(_T("✗ CPngRowWriter 写入失败\n"));
+	}
+	file.close();
+	return BenchmarkElapsedMs(start);
+}
+
+// 主测试函数：在 nWidth x nHeight 的图像上比较各编码方式
+void RunImageExportBenchmark(int nWidth = 8000, int nHeight = 6000)
+{
+	TRACE(_T("\n"));
+	TRACE(_T("========================================\n"));
+	TRACE(_T("图像导出性能测试 (%d x %d)\n"), nWidth, nHeight);
+	TRACE(_T("========================================\n"));
+
+	CImage image;
+	if (!CreateBenchmarkImage(image, nWidth, nHeight))
+	{
+		TRACE(_T("✗ 创建测试图像失败\n"));
+		return;
+	}
+
+	TCHAR szTempDir[MAX_PATH];
+	TCHAR szPath[MAX_PATH];
+	GetTempPath(MAX_PATH, szTempDir);
+	GetTempFileName(szTempDir, _T("png"), 0, szPath);
+
+	LARGE_INTEGER start;
+	QueryPerformanceCounter(&start);
+	HRESULT hr = image.Save(szPath, Gdiplus::ImageFormatPNG);
+	double dMs = BenchmarkElapsedMs(start);
+	if (FAILED(hr))
+	{
+		TRACE(_T("✗ CImage::Save 失败: 0x%08X\n"), hr);
+	}
+	ReportResult(_T("CImage::Save"), dMs, nWidth, nHeight, szPath);
+
+	dMs = SaveWithPngWriter(image, szPath, 1);
+	ReportResult(_T("CPngRowWriter (1 线程)"), dMs, nWidth, nHeight, szPath);
+
+	unsigned nThreads = max(1u, std::thread::hardware_concurrency());
+	dMs = SaveWithPngWriter(image, szPath, nThreads);
+	CString strName;
+	strName.Format(_T("CPngRowWriter (%u 线程)"), nThreads);
+	ReportResult(strName, dMs, nWidth, nHeight, szPath);
+
+	DeleteFile(szPath);
+	TRACE(_T("========================================\n\n"));
+}
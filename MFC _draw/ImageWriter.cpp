@@ -0,0 +1,101 @@
+// ImageWriter.cpp: BMP 写入器的实现
+//
+
+#include "pch.h"
+#include "ImageWriter.h"
+
+static void PutU16(uint8_t* p, uint32_t value)
+{
+	p[0] = static_cast<uint8_t>(value);
+	p[1] = static_cast<uint8_t>(value >> 8);
+}
+
+static void PutU32(uint8_t* p, uint32_t value)
+{
+	p[0] = static_cast<uint8_t>(value);
+	p[1] = static_cast<uint8_t>(value >> 8);
+	p[2] = static_cast<uint8_t>(value >> 16);
+	p[3] = static_cast<uint8_t>(value >> 24);
+}
+
+CBmpRowWriter::CBmpRowWriter(std::ostream& out)
+	: m_out(out), m_nWidth(0), m_nHeight(0), m_nNextRow(0), m_nRowBytes(0)
+{
+}
+
+bool CBmpRowWriter::Begin(int nWidth, int nHeight)
+{
+	const uint32_t nFileHeaderSize = 14;
+	const uint32_t nInfoHeaderSize = 40;
+
+	if (nWidth <= 0 || nHeight <= 0)
+		return false;
+
+	m_nWidth = nWidth;
+	m_nHeight = nHeight;
+	m_nNextRow = 0;
+	m_nRowBytes = (static_cast<size_t>(nWidth) * 3 + 3) & ~static_cast<size_t>(3);
+	m_row.assign(m_nRowBytes, 0);
+
+	uint64_t nImageSize = static_cast<uint64_t>(m_nRowBytes) * nHeight;
+	uint64_t nFileSize = nFileHeaderSize + nInfoHeaderSize + nImageSize;
+	if (nFileSize > 0xFFFFFFFFu)
+		return false;  // BMP 文件大小字段只有 32 位
+
+	uint8_t header[nFileHeaderSize + nInfoHeaderSize] = {};
+	// BITMAPFILEHEADER
+	header[0] = 'B';
+	header[1] = 'M';
+	PutU32(header + 2, static_cast<uint32_t>(nFileSize));
+	PutU32(header + 10, nFileHeaderSize + nInfoHeaderSize);
+	// BITMAPINFOHEADER
+	uint8_t* pInfo = header + nFileHeaderSize;
+	PutU32(pInfo + 0, nInfoHeaderSize);
+	PutU32(pInfo + 4, static_cast<uint32_t>(nWidth));
+	PutU32(pInfo + 8, static_cast<uint32_t>(nHeight));  // 正数：从下到上
+	PutU16(pInfo + 12, 1);
+	PutU16(pInfo + 14, 24);
+	PutU32(pInfo + 20, static_cast<uint32_t>(nImageSize));
+	PutU32(pInfo + 24, 3780);  // 96 DPI，单位为像素/米
+	PutU32(pInfo + 28, 3780);
+
+	m_out.write(reinterpret_cast<const char*>(header), sizeof(header));
+	m_posBase = m_out.tellp();
+	return m_out.good();
+}
+
+bool CBmpRowWriter::WriteRows(const uint8_t* pPixels, int nRows, int nStride)
+{
+	if (m_nNextRow + nRows > m_nHeight)
+		return false;
+
+	for (int i = 0; i < nRows; i++)
+	{
+		const uint8_t* pSrc = pPixels + static_cast<ptrdiff_t>(i) * nStride;
+		uint8_t* pDst = m_row.data();
+		for (int x = 0; x < m_nWidth; x++)
+		{
+			pDst[0] = pSrc[0];
+			pDst[1] = pSrc[1];
+			pDst[2] = pSrc[2];
+			pSrc += 4;
+			pDst += 3;
+		}
+
+		int nFileRow = m_nHeight - 1 - m_nNextRow;
+		m_out.seekp(m_posBase + static_cast<std::streamoff>(m_nRowBytes) * nFileRow);
+		m_out.write(reinterpret_cast<const char*>(m_row.data()), m_nRowBytes);
+		m_nNextRow++;
+	}
+	return m_out.good();
+}
+
+bool CBmpRowWriter::End()
+{
+	if (m_nNextRow != m_nHeight)
+		return false;
+
+	m_out.seekp(m_posBase + static_cast<std::streamoff>(m_nRowBytes) * m_nHeight);
+	m_out.flush();
+	return m_out.good();
+}
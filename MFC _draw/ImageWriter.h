@@ -0,0 +1,50 @@
+// ImageWriter.h: 按行写入图像的接口及 BMP 写入器
+// 导出时逐条带渲染，每渲染完一条带就交给写入器，整幅图像不需要同时放在内存中。
+//
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// 按行接收图像数据
+// 像素格式：每像素 4 字节，依次为 B、G、R、保留字节（与 32 位 DIB 相同），行从上到下依次送入。
+class IImageRowSink
+{
+public:
+	virtual ~IImageRowSink() {}
+
+	// 开始写入一幅 nWidth x nHeight 的图像
+	virtual bool Begin(int nWidth, int nHeight) = 0;
+	// 写入接下来的 nRows 行，nStride 为相邻两行的字节距离
+	virtual bool WriteRows(const uint8_t* pPixels, int nRows, int nStride) = 0;
+	// 所有行写入完毕
+	virtual bool End() = 0;
+};
+
+// 把图像写成 24 位 BMP 文件
+// BMP 的行按从下到上的顺序存放，而文件大小在开始时就已确定，所以每一行直接定位到它在文件中的位置写入。
+// 输出流必须支持定位（文件流），内存占用只有一行。
+class CBmpRowWriter : public IImageRowSink
+{
+private:
+	std::ostream& m_out;
+	std::streampos m_posBase;   // 像素数据在流中的起始位置
+	int m_nWidth;
+	int m_nHeight;
+	int m_nNextRow;             // 下一行在图像中的行号（从上往下数）
+	size_t m_nRowBytes;         // 文件中每行的字节数（4 字节对齐）
+	std::vector<uint8_t> m_row;
+
+	// 禁止拷贝构造和赋值
+	CBmpRowWriter(const CBmpRowWriter&) = delete;
+	CBmpRowWriter& operator=(const CBmpRowWriter&) = delete;
+
+public:
+	explicit CBmpRowWriter(std::ostream& out);
+
+	bool Begin(int nWidth, int nHeight) override;
+	bool WriteRows(const uint8_t* pPixels, int nRows, int nStride) override;
+	bool End() override;
+};
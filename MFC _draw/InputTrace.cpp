@@ -0,0 +1,449 @@
+// InputTrace.cpp: 输入轨迹记录与回放的实现
+//
+
+#include "pch.h"
+#include "InputTrace.h"
+#include "ArchiveArray.h"
+#include <sstream>
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+// 变长整数：每字节 7 位，最高位表示后面还有字节
+static void WriteVarUInt(CArchive& ar, ULONGLONG nValue)
+{
+	while (nValue >= 0x80)
+	{
+		ar << static_cast<BYTE>(nValue | 0x80);
+		nValue >>= 7;
+	}
+	ar << static_cast<BYTE>(nValue);
+}
+
+static ULONGLONG ReadVarUInt(CArchive& ar)
+{
+	ULONGLONG nValue = 0;
+	for (int nShift = 0; nShift < 64; nShift += 7)
+	{
+		BYTE by;
+		ar >> by;
+		nValue |= static_cast<ULONGLONG>(by & 0x7F) << nShift;
+		if ((by & 0x80) == 0)
+			return nValue;
+	}
+	AfxThrowArchiveException(CArchiveException::badIndex, ar.m_strFileName);
+	return 0;
+}
+
+// 有符号数先做 ZigZag 变换，绝对值小的负数也只占一个字节
+static void WriteVarInt(CArchive& ar, LONGLONG nValue)
+{
+	WriteVarUInt(ar, (static_cast<ULONGLONG>(nValue) << 1) ^ static_cast<ULONGLONG>(nValue >> 63));
+}
+
+static LONGLONG ReadVarInt(CArchive& ar)
+{
+	ULONGLONG nValue = ReadVarUInt(ar);
+	return static_cast<LONGLONG>(nValue >> 1) ^ -static_cast<LONGLONG>(nValue & 1);
+}
+
+static BOOL HasPoint(InputTraceEventType type)
+{
+	return type == InputTraceEventType::MouseDown || type == InputTraceEventType::MouseMove
+		|| type == InputTraceEventType::MouseUp || type == InputTraceEventType::Text;
+}
+
+// 带有 nValue 的事件（撤销和重做的值为 0）
+static BOOL HasValue(InputTraceEventType type)
+{
+	return !HasPoint(type) && type < InputTraceEventType::Transform;
+}
+
+static BOOL HasIndices(InputTraceEventType type)
+{
+	return type == InputTraceEventType::Transform || type == InputTraceEventType::Copy;
+}
+
+static BOOL HasTransform(InputTraceEventType type)
+{
+	return type == InputTraceEventType::Transform || type == InputTraceEventType::Paste;
+}
+
+// 命令序号递增，写入数量和相邻序号之差
+static void WriteIndices(CArchive& ar, const std::vector<size_t>& indices)
+{
+	WriteVarUInt(ar, indices.size());
+	size_t nLast = 0;
+	for (size_t i : indices)
+	{
+		WriteVarUInt(ar, i - nLast);
+		nLast = i;
+	}
+}
+
+static void ReadIndices(CArchive& ar, std::vector<size_t>& indices)
+{
+	// 数量来自文件，不可信：预留的空间有上限，每个序号至少占一个字节，损坏的文件会读到文件结尾
+	ULONGLONG nCount = ReadVarUInt(ar);
+	indices.reserve(static_cast<size_t>(min(nCount, 1ULL << 16)));
+	ULONGLONG nIndex = 0;
+	for (ULONGLONG i = 0; i < nCount; i++)
+	{
+		nIndex += ReadVarUInt(ar);
+		indices.push_back(static_cast<size_t>(nIndex));
+	}
+}
+
+static void WriteTransform(CArchive& ar, const DrawTransform& transform)
+{
+	WriteVarInt(ar, transform.ptAnchor.x);
+	WriteVarInt(ar, transform.ptAnchor.y);
+	ar << transform.dScaleX << transform.dScaleY;
+	WriteVarInt(ar, transform.offset.cx);
+	WriteVarInt(ar, transform.offset.cy);
+}
+
+static void ReadTransform(CArchive& ar, DrawTransform& transform)
+{
+	transform.ptAnchor.x = static_cast<LONG>(ReadVarInt(ar));
+	transform.ptAnchor.y = static_cast<LONG>(ReadVarInt(ar));
+	ar >> transform.dScaleX >> transform.dScaleY;
+	transform.offset.cx = static_cast<LONG>(ReadVarInt(ar));
+	transform.offset.cy = static_cast<LONG>(ReadVarInt(ar));
+}
+
+// CInputTrace 实现
+void CInputTrace::Serialize(CArchive& ar)
+{
+	if (ar.IsStoring())
+	{
+		ar << FILE_MAGIC << FILE_VERSION << static_cast<DWORD>(m_events.size());
+
+		LONGLONG llLastTime = 0;
+		CPoint lastPoint(0, 0);
+		for (const CInputTraceEvent& event : m_events)
+		{
+			ar << static_cast<BYTE>(event.type);
+			WriteVarUInt(ar, static_cast<ULONGLONG>(max(0LL, event.llTime - llLastTime)));
+			llLastTime = max(llLastTime, event.llTime);
+			if (HasPoint(event.type))
+			{
+				WriteVarInt(ar, event.point.x - lastPoint.x);
+				WriteVarInt(ar, event.point.y - lastPoint.y);
+				lastPoint = event.point;
+			}
+			if (event.type == InputTraceEventType::Text)
+			{
+				WriteVarUInt(ar, static_cast<ULONGLONG>(event.text.GetLength()));
+				for (int i = 0; i < event.text.GetLength(); i++)
+					ar << static_cast<WORD>(event.text[i]);
+			}
+			else if (HasValue(event.type))
+			{
+				WriteVarUInt(ar, event.nValue);
+			}
+			if (HasIndices(event.type))
+				WriteIndices(ar, event.indices);
+			if (HasTransform(event.type))
+				WriteTransform(ar, event.transform);
+			if (event.type == InputTraceEventType::Import)
+			{
+				WriteVarUInt(ar, event.records.size());
+				ar.Write(event.records.data(), static_cast<UINT>(event.records.size()));
+			}
+		}
+	}
+	else
+	{
+		DWORD dwMagic, nCount;
+		WORD wVersion;
+		ar >> dwMagic >> wVersion;
+		if (dwMagic != FILE_MAGIC || wVersion == 0 || wVersion > FILE_VERSION)
+			AfxThrowArchiveException(CArchiveException::badSchema, ar.m_strFileName);
+		ar >> nCount;
+
+		m_events.clear();
+		m_events.reserve(min(nCount, static_cast<DWORD>(1 << 20)));
+		LONGLONG llTime = 0;
+		CPoint lastPoint(0, 0);
+		for (DWORD i = 0; i < nCount; i++)
+		{
+			CInputTraceEvent event;
+			BYTE nType;
+			ar >> nType;
+			if (nType >= static_cast<BYTE>(InputTraceEventType::Count))
+				AfxThrowArchiveException(CArchiveException::badIndex, ar.m_strFileName);
+			event.type = static_cast<InputTraceEventType>(nType);
+			llTime += static_cast<LONGLONG>(ReadVarUInt(ar));
+			event.llTime = llTime;
+			if (HasPoint(event.type))
+			{
+				lastPoint.x += static_cast<LONG>(ReadVarInt(ar));
+				lastPoint.y += static_cast<LONG>(ReadVarInt(ar));
+				event.point = lastPoint;
+			}
+			if (event.type == InputTraceEventType::Text)
+			{
+				ULONGLONG nLength = ReadVarUInt(ar);
+				if (nLength > 0x100000)
+					AfxThrowArchiveException(CArchiveException::badIndex, ar.m_strFileName);
+				for (ULONGLONG j = 0; j < nLength; j++)
+				{
+					WORD ch;
+					ar >> ch;
+					event.text += static_cast<wchar_t>(ch);
+				}
+			}
+			else if (HasValue(event.type))
+			{
+				event.nValue = static_cast<DWORD>(ReadVarUInt(ar));
+			}
+			if (HasIndices(event.type))
+				ReadIndices(ar, event.indices);
+			if (HasTransform(event.type))
+				ReadTransform(ar, event.transform);
+			if (event.type == InputTraceEventType::Import)
+			{
+				std::vector<char> records;
+				LoadArchiveArray(ar, records, ReadVarUInt(ar));
+				event.records.assign(records.begin(), records.end());
+			}
+			m_events.push_back(std::move(event));
+		}
+	}
+}
+
+BOOL CInputTrace::Save(LPCTSTR lpszPath)
+{
+	try
+	{
+		CFile file(lpszPath, CFile::modeCreate | CFile::modeWrite);
+		CArchive ar(&file, CArchive::store);
+		Serialize(ar);
+		ar.Close();
+		return TRUE;
+	}
+	catch (CException* e)
+	{
+		TRACE(_T("Failed to save input trace\n"));
+		e->Delete();
+		return FALSE;
+	}
+}
+
+BOOL CInputTrace::Load(LPCTSTR lpszPath)
+{
+	try
+	{
+		CFile file(lpszPath, CFile::modeRead);
+		CArchive ar(&file, CArchive::load);
+		Serialize(ar);
+		return TRUE;
+	}
+	catch (CException* e)
+	{
+		TRACE(_T("Failed to load input trace\n"));
+		e->Delete();
+		m_events.clear();
+		return FALSE;
+	}
+}
+
+// CInputTraceRecorder 实现
+void CInputTraceRecorder::Start()
+{
+	LARGE_INTEGER frequency, now;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&now);
+	m_llFrequency = frequency.QuadPart;
+	m_llStart = now.QuadPart;
+	m_trace.Clear();
+	m_bRecording = TRUE;
+}
+
+void CInputTraceRecorder::Record(CInputTraceEvent& event)
+{
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	event.llTime = (now.QuadPart - m_llStart) * 1000000 / m_llFrequency;
+	m_trace.Add(event);
+}
+
+// CInputTraceReplayer 实现
+CInputTraceReplayer::CInputTraceReplayer(CDocumentModel& model, CDC* pDC)
+	: m_model(model), m_pDC(pDC), m_drawType(DrawData::DrawType::LineSegment), m_nPenSize(1),
+	m_penColor(RGB(0, 0, 0)), m_brushColor(RGB(0, 0, 0))
+{
+}
+
+void CInputTraceReplayer::AddCommand(CDrawCommand* pCommand)
+{
+	m_model.AddCommand(pCommand);
+	if (m_pDC != nullptr)
+		pCommand->Execute(m_pDC, m_model.GetColorPalette());
+}
+
+BOOL CInputTraceReplayer::IsValidSelection(const std::vector<size_t>& indices) const
+{
+	for (size_t i : indices)
+	{
+		if (i >= m_model.GetCommandCount())
+			return FALSE;
+	}
+	return TRUE;
+}
+
+size_t CInputTraceReplayer::Apply(const CInputTraceEvent& event)
+{
+	switch (event.type)
+	{
+	case InputTraceEventType::MouseDown:
+		m_capture.Begin(m_drawType, m_nPenSize, m_penColor, m_brushColor, event.point);
+		break;
+
+	case InputTraceEventType::MouseMove:
+		// 与 CMFCdrawView::OnMouseMove 相同，m_pDC 不为空时画出拖动预览
+		m_capture.Move(event.point, m_pDC);
+		break;
+
+	case InputTraceEventType::MouseUp:
+	{
+		// 最终图形由 AddCommand 执行命令画出
+		CDrawCommand* pCommand = m_capture.End(event.point, nullptr, m_model.GetColorPalette());
+		if (pCommand == nullptr)
+			return 0;
+		AddCommand(pCommand);
+		return 1;
+	}
+
+	case InputTraceEventType::SetTool:
+		if (event.nValue <= static_cast<DWORD>(DrawData::DrawType::Eraser))
+			m_drawType = static_cast<DrawData::DrawType>(event.nValue);
+		break;
+
+	case InputTraceEventType::SetPenSize:
+		m_nPenSize = static_cast<int>(event.nValue);
+		break;
+
+	case InputTraceEventType::SetPenColor:
+		m_penColor = event.nValue;
+		break;
+
+	case InputTraceEventType::SetBrushColor:
+		m_brushColor = event.nValue;
+		break;
+
+	case InputTraceEventType::Text:
+	{
+		DrawData data;
+		data.drawType = DrawData::DrawType::Text;
+		data.pointBegin = event.point;
+		data.SetPenColor(m_model.GetColorPalette(), m_penColor);
+		data.penSize = m_nPenSize;
+		data.nTextId = m_model.InternText(event.text);
+		AddCommand(CreateDrawCommand(data, m_model.GetStringPool()));
+		return 1;
+	}
+
+	case InputTraceEventType::Undo:
+		if (m_model.Undo() && m_pDC != nullptr)
+			m_model.RedrawAll(m_pDC);
+		break;
+
+	case InputTraceEventType::Redo:
+		if (m_model.Redo() && m_pDC != nullptr)
+			m_model.GetCommand(m_model.GetCommandCount() - 1)->Execute(m_pDC, m_model.GetColorPalette());
+		break;
+
+	case InputTraceEventType::SwitchBranch:
+		if (m_model.SwitchBranch(event.nValue != 0) && m_pDC != nullptr)
+			m_model.RedrawAll(m_pDC);
+		break;
+
+	case InputTraceEventType::Transform:
+		if (IsValidSelection(event.indices) && m_model.TransformCommands(event.indices, event.transform) && m_pDC != nullptr)
+			m_model.RedrawAll(m_pDC);
+		break;
+
+	case InputTraceEventType::Copy:
+		if (IsValidSelection(event.indices) && !event.indices.empty())
+		{
+			m_clipboard.clear();
+			for (size_t i : event.indices)
+				m_clipboard.push_back(m_model.GetCommands()[i]);
+			m_pClipboardPalette = m_model.GetSnapshot().GetSharedColorPalette();
+		}
+		break;
+
+	case InputTraceEventType::Paste:
+	{
+		if (m_clipboard.empty())
+			break;
+		const size_t nBefore = m_model.GetCommandCount();
+		m_model.PasteCommands(m_clipboard, *m_pClipboardPalette, event.transform);
+		if (m_pDC != nullptr)
+			m_model.RedrawAll(m_pDC);
+		return m_model.GetCommandCount() - nBefore;
+	}
+
+	case InputTraceEventType::Import:
+	{
+		std::istringstream in(event.records);
+		size_t nImported = 0;
+		m_model.ImportDrawRecords(in, &nImported);
+		if (m_pDC != nullptr)
+			m_model.RedrawAll(m_pDC);
+		return nImported;
+	}
+
+	default:
+		break;
+	}
+	return 0;
+}
+
+void CInputTraceReplayer::Replay(const CInputTrace& trace, BOOL bRealTime, CInputTraceReplayResult& result)
+{
+	result = CInputTraceReplayResult();
+
+	LARGE_INTEGER frequency, start, before, after;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&start);
+	const double dNsPerTick = 1e9 / frequency.QuadPart;
+
+	for (const CInputTraceEvent& event : trace.GetEvents())
+	{
+		if (bRealTime)
+		{
+			// 等到事件的记录时间；剩余时间较长时先让出处理器，最后一毫秒内忙等以保证精度
+			const LONGLONG llDue = start.QuadPart + event.llTime * frequency.QuadPart / 1000000;
+			for (;;)
+			{
+				QueryPerformanceCounter(&before);
+				LONGLONG llRemainingMs = (llDue - before.QuadPart) * 1000 / frequency.QuadPart;
+				if (llRemainingMs <= 0)
+					break;
+				if (llRemainingMs > 1)
+					Sleep(static_cast<DWORD>(llRemainingMs - 1));
+			}
+			result.llMaxLagNs = max(result.llMaxLagNs, static_cast<LONGLONG>((before.QuadPart - llDue) * dNsPerTick));
+		}
+		else
+		{
+			QueryPerformanceCounter(&before);
+		}
+
+		result.nCommandsAdded += Apply(event);
+
+		QueryPerformanceCounter(&after);
+		LONGLONG llNs = static_cast<LONGLONG>((after.QuadPart - before.QuadPart) * dNsPerTick);
+		CInputTraceEventStats& stats = result.stats[static_cast<int>(event.type)];
+		stats.nCount++;
+		stats.llTotalNs += llNs;
+		stats.llMaxNs = max(stats.llMaxNs, llNs);
+	}
+
+	QueryPerformanceCounter(&after);
+	result.llTotalNs = static_cast<LONGLONG>((after.QuadPart - start.QuadPart) * dNsPerTick);
+}
@@ -0,0 +1,199 @@
+// InputTrace.h: 输入轨迹的记录与回放
+// 记录视图处理的鼠标和命令事件（按下、移动、松开、工具和画笔设置、文本、撤销/重做、移动缩放、复制粘贴、导入）及其时间，
+// 保存为紧凑的二进制文件。回放不需要窗口：CInputTraceReplayer 按与 CMFCdrawView 相同的规则
+// 把事件转换为绘图命令，直接驱动 CDocumentModel，可以按原始速度或最快速度重现一次用户会话，
+// 并统计各类事件的处理耗时。记录下来的轨迹可以作为回归基准（bench 目录下的 drawbench --trace）。
+//
+
+#pragma once
+
+#include <afxwin.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "DrawCommand.h"
+#include "DocumentModel.h"
+#include "StrokeCapture.h"
+
+enum class InputTraceEventType : BYTE
+{
+	MouseDown,      // 左键按下（point）
+	MouseMove,      // 按住左键移动（point）
+	MouseUp,        // 左键松开（point）
+	SetTool,        // 切换工具（nValue 为 DrawData::DrawType）
+	SetPenSize,     // 画笔粗细（nValue）
+	SetPenColor,    // 画笔颜色（nValue 为 COLORREF）
+	SetBrushColor,  // 画刷颜色（nValue 为 COLORREF）
+	Text,           // 提交文本（point 为文本位置，text 为内容）
+	Undo,
+	Redo,
+	SwitchBranch,   // 切换撤销分支（nValue 为 1 时下一个，0 时上一个）
+	Transform,      // 移动、缩放选中的图形（indices 为选中的命令序号，transform 为变换；只记录松开鼠标时提交的变换）
+	Copy,           // 复制选中的图形（indices）
+	Paste,          // 粘贴上一次复制的图形（transform 为相对原位置的变换）
+	Import,         // 导入绘图记录（records 为记录文件的内容）
+	Count
+};
+
+struct CInputTraceEvent
+{
+	InputTraceEventType type;
+	LONGLONG llTime;  // 距记录开始的时间（微秒）
+	CPoint point;
+	DWORD nValue;
+	CString text;
+	std::vector<size_t> indices;  // 递增
+	DrawTransform transform;
+	std::string records;
+
+	CInputTraceEvent() : type(InputTraceEventType::MouseMove), llTime(0), nValue(0) {}
+};
+
+// 一段输入轨迹
+// 文件格式：DWORD 标识、WORD 版本号、DWORD 事件数量，之后是各事件：
+//   BYTE 类型，变长整数的时间增量（微秒），然后按类型：
+//   鼠标事件为相对上一个鼠标位置的坐标增量（ZigZag 变长整数），设置事件为变长整数的值，
+//   文本事件为位置（同鼠标事件）、变长整数的长度和 UTF-16 字符；
+//   移动缩放和复制事件为变长整数的命令数量和相邻序号之差，移动缩放和粘贴事件为变换（锚点和偏移为 ZigZag 变长整数，
+//   缩放比例为 double）；导入事件为变长整数的长度和记录文件的内容。
+// 鼠标移动事件通常只需 3~4 个字节。
+class CInputTrace
+{
+private:
+	std::vector<CInputTraceEvent> m_events;
+
+public:
+	static const DWORD FILE_MAGIC = 0x5444464D;  // "MFDT"
+	static const WORD FILE_VERSION = 1;
+
+	void Add(const CInputTraceEvent& event) { m_events.push_back(event); }
+	void Clear() { m_events.clear(); }
+	const std::vector<CInputTraceEvent>& GetEvents() const { return m_events; }
+	size_t GetCount() const { return m_events.size(); }
+	// 轨迹时长（微秒）
+	LONGLONG GetDuration() const { return m_events.empty() ? 0 : m_events.back().llTime; }
+
+	// 读写轨迹，格式错误时抛出 CArchiveException
+	void Serialize(CArchive& ar);
+	// 保存到文件 / 从文件读取，失败时返回 FALSE
+	BOOL Save(LPCTSTR lpszPath);
+	BOOL Load(LPCTSTR lpszPath);
+};
+
+// 记录器：视图在处理输入时调用，未开始记录时每次调用只有一次判断
+class CInputTraceRecorder
+{
+private:
+	CInputTrace m_trace;
+	BOOL m_bRecording;
+	LONGLONG m_llStart;  // 开始记录时的 QueryPerformanceCounter 计数
+	LONGLONG m_llFrequency;
+
+	void Record(CInputTraceEvent& event);
+
+public:
+	CInputTraceRecorder() : m_bRecording(FALSE), m_llStart(0), m_llFrequency(1) {}
+
+	// 开始记录（清除之前的轨迹）
+	void Start();
+	void Stop() { m_bRecording = FALSE; }
+	BOOL IsRecording() const { return m_bRecording; }
+	const CInputTrace& GetTrace() const { return m_trace; }
+
+	void RecordMouse(InputTraceEventType type, CPoint point)
+	{
+		if (!m_bRecording)
+			return;
+		CInputTraceEvent event;
+		event.type = type;
+		event.point = point;
+		Record(event);
+	}
+
+	void RecordValue(InputTraceEventType type, DWORD nValue = 0)
+	{
+		if (!m_bRecording)
+			return;
+		CInputTraceEvent event;
+		event.type = type;
+		event.nValue = nValue;
+		Record(event);
+	}
+
+	void RecordText(CPoint point, const CString& text)
+	{
+		if (!m_bRecording)
+			return;
+		CInputTraceEvent event;
+		event.type = InputTraceEventType::Text;
+		event.point = point;
+		event.text = text;
+		Record(event);
+	}
+
+	void RecordTransform(InputTraceEventType type, const std::vector<size_t>& indices, const DrawTransform& transform)
+	{
+		if (!m_bRecording)
+			return;
+		CInputTraceEvent event;
+		event.type = type;
+		event.indices = indices;
+		event.transform = transform;
+		Record(event);
+	}
+
+	void RecordImport(std::string&& records)
+	{
+		if (!m_bRecording)
+			return;
+		CInputTraceEvent event;
+		event.type = InputTraceEventType::Import;
+		event.records = std::move(records);
+		Record(event);
+	}
+};
+
+// 每类事件的处理耗时
+struct CInputTraceEventStats
+{
+	size_t nCount = 0;
+	LONGLONG llTotalNs = 0;
+	LONGLONG llMaxNs = 0;
+};
+
+struct CInputTraceReplayResult
+{
+	CInputTraceEventStats stats[static_cast<int>(InputTraceEventType::Count)];
+	LONGLONG llTotalNs = 0;   // 回放总耗时
+	LONGLONG llMaxLagNs = 0;  // 按原始速度回放时，事件实际处理时间比记录时间晚的最大值
+	size_t nCommandsAdded = 0;
+};
+
+// 回放器：按 CMFCdrawView 的规则把事件转换为绘图命令并加入文档
+class CInputTraceReplayer
+{
+private:
+	CDocumentModel& m_model;
+	CDC* m_pDC;  // 不为空时像视图一样绘制拖动预览和新命令，撤销/重做后整体重绘
+
+	// 与视图对应的绘图状态
+	DrawData::DrawType m_drawType;
+	int m_nPenSize;
+	COLORREF m_penColor;
+	COLORREF m_brushColor;
+	CStrokeCapture m_capture;  // 与视图共用的拖动采集
+	std::vector<CDrawCommandPtr> m_clipboard;  // Copy 事件复制的命令
+	std::shared_ptr<const CColorPalette> m_pClipboardPalette;
+
+	// 处理一个事件，返回加入的新命令数量
+	size_t Apply(const CInputTraceEvent& event);
+	// indices 是否都是文档中的命令序号（轨迹文件可能与文档不符）
+	BOOL IsValidSelection(const std::vector<size_t>& indices) const;
+	void AddCommand(CDrawCommand* pCommand);
+
+public:
+	explicit CInputTraceReplayer(CDocumentModel& model, CDC* pDC = nullptr);
+
+	// 回放 trace；bRealTime 为 TRUE 时按记录的时间间隔等待，否则以最快速度回放
+	void Replay(const CInputTrace& trace, BOOL bRealTime, CInputTraceReplayResult& result);
+};
@@ -11,6 +11,7 @@
 
 #include "MFC _drawDoc.h"
 #include "MFC _drawView.h"
+#include "AllocationCounter.h"
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
@@ -72,6 +73,11 @@ BOOL CMFCdrawApp::InitInstance()
 
 	CWinApp::InitInstance();
 
+#ifdef _DEBUG
+	// 统计堆分配，检查鼠标移动等热路径不分配内存（见 DrawMetrics::MOUSE_MOVE_ALLOCATIONS）
+	CAllocationCounter::Install();
+#endif
+
 
 	// 初始化 OLE 库
 	if (!AfxOleInit())
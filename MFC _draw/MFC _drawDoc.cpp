@@ -11,15 +11,38 @@
 #endif
 
 #include "MFC _drawDoc.h"
+#include "ArchiveArray.h"
 #include "DrawCommand.h"
 #include "GdiObjectWrapper.h"
+#include "ThumbnailRenderer.h"
+#include "TraceProfiler.h"
 
+#include <fstream>
+#include <iterator>
+#include <sstream>
 #include <propkey.h>
+#ifdef SHARED_HANDLERS
+#include <atlimage.h>
+#include <shlwapi.h>
+#endif // SHARED_HANDLERS
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
 #endif
 
+// 文档文件格式：
+//   DWORD  文件标识 "MFDR"
+//   WORD   版本号
+//   DWORD  缩略图字节数，之后是缩略图 PNG 数据（空文档为 0）
+//   CString 搜索内容，所有文本命令的内容，以“;”分隔
+//   DWORD  字符串表大小，之后依次是每个字符串；命令中的文本序号从 1 开始指向此表，0 表示没有文本
+//   DWORD  颜色表大小，之后依次是每种颜色的 COLORREF；命令中的颜色序号指向此表
+//   DWORD  命令数量，之后依次是每条命令的绘图数据（见 StoreDrawData）
+//   DWORD  金字塔数量，之后依次是 DWORD 命令序号和该笔迹的多分辨率金字塔（见 CStrokePyramid::Store）
+// 缩略图和搜索内容放在命令之前，外壳预览和搜索筛选器只读取文件开头的一小段。
+static const DWORD DOCUMENT_FILE_MAGIC = 0x5244464D;  // "MFDR"
+static const WORD DOCUMENT_FILE_VERSION = CDocumentModel::FILE_VERSION;
+
 // CMFCdrawDoc
 
 IMPLEMENT_DYNCREATE(CMFCdrawDoc, CDocument)
@@ -38,89 +61,105 @@ void CMFCdrawDoc::AddCommand(CDrawCommand* pCommand)
 {
 	if (pCommand == nullptr) return;
 	
-	// 清除重做栈（新操作后不能再重做之前的操作）
-	while (!m_redoStack.empty())
-	{
-		delete m_redoStack.top();
-		m_redoStack.pop();
-	}
-	
-	// 添加到撤销栈和所有命令列表
-	m_undoStack.push(pCommand);
-	m_allCommands.push_back(pCommand);
+	// 添加到命令历史（之前撤销的操作保留在撤销树中）
+	m_model.AddCommand(pCommand);
 	
-	// 标记文档已修改
+	// 标记文档已修改（事务中由 EndTransaction 统一标记）
+	if (!m_model.IsInTransaction())
+		SetModifiedFlag(TRUE);
+}
+
+void CMFCdrawDoc::EndTransaction()
+{
+	CRect rectChanged;
+	if (!m_model.EndTransaction(&rectChanged))
+		return;
+
 	SetModifiedFlag(TRUE);
+	CRegionHint hint(rectChanged);
+	UpdateAllViews(nullptr, HINT_REGION_CHANGED, &hint);
 }
 
-BOOL CMFCdrawDoc::Undo()
+void CMFCdrawDoc::AddDrawData(const DrawData* pFirst, const DrawData* pLast)
 {
-	if (m_undoStack.empty())
-		return FALSE;
-	
-	CDrawCommand* pCommand = m_undoStack.top();
-	m_undoStack.pop();
-	
-	// 从所有命令列表中移除
-	auto it = std::find(m_allCommands.begin(), m_allCommands.end(), pCommand);
-	if (it != m_allCommands.end())
+	CTransactionScope<CMFCdrawDoc> transaction(*this);
+	m_model.AddDrawData(pFirst, pLast);
+}
+
+void CMFCdrawDoc::AddDrawData(std::vector<DrawData>&& data)
+{
+	CTransactionScope<CMFCdrawDoc> transaction(*this);
+	m_model.AddDrawData(std::move(data));
+}
+
+BOOL CMFCdrawDoc::ImportDrawRecords(LPCTSTR pszPath, size_t& nImported, size_t& nErrorLine, std::string* pRecords)
+{
+	nImported = 0;
+	nErrorLine = 0;
+	std::ifstream file(pszPath, std::ios::binary);
+	if (!file)
 	{
-		m_allCommands.erase(it);
+		TRACE(_T("无法打开绘图记录文件: %s\n"), pszPath);
+		return FALSE;
 	}
-	
-	// 移到重做栈
-	m_redoStack.push(pCommand);
+
+	CTransactionScope<CMFCdrawDoc> transaction(*this);
+	if (pRecords == nullptr)
+		return m_model.ImportDrawRecords(file, &nImported, &nErrorLine);
+
+	pRecords->assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	std::istringstream in(*pRecords);
+	return m_model.ImportDrawRecords(in, &nImported, &nErrorLine);
+}
+
+void CMFCdrawDoc::PasteCommands(const std::vector<CDrawCommandPtr>& commands, const CColorPalette& palette, const DrawTransform& transform)
+{
+	CTransactionScope<CMFCdrawDoc> transaction(*this);
+	m_model.PasteCommands(commands, palette, transform);
+}
+
+BOOL CMFCdrawDoc::TransformCommands(const std::vector<size_t>& indices, const DrawTransform& transform, CRect* pChanged)
+{
+	if (!m_model.TransformCommands(indices, transform, pChanged))
+		return FALSE;
+
+	if (!m_model.IsInTransaction())
+		SetModifiedFlag(TRUE);
+	return TRUE;
+}
+
+BOOL CMFCdrawDoc::Undo(CRect* pChanged)
+{
+	if (!m_model.Undo(pChanged))
+		return FALSE;
 	
 	SetModifiedFlag(TRUE);
 	return TRUE;
 }
 
-BOOL CMFCdrawDoc::Redo()
+BOOL CMFCdrawDoc::Redo(CRect* pChanged)
 {
-	if (m_redoStack.empty())
+	if (!m_model.Redo(pChanged))
 		return FALSE;
 	
-	CDrawCommand* pCommand = m_redoStack.top();
-	m_redoStack.pop();
-	
-	// 移回撤销栈和所有命令列表
-	m_undoStack.push(pCommand);
-	m_allCommands.push_back(pCommand);
-	
 	SetModifiedFlag(TRUE);
 	return TRUE;
 }
 
-void CMFCdrawDoc::ClearCommands()
+BOOL CMFCdrawDoc::SwitchBranch(BOOL bNext, CRect* pChanged)
 {
-	// 清除撤销栈
-	while (!m_undoStack.empty())
-	{
-		delete m_undoStack.top();
-		m_undoStack.pop();
-	}
-	
-	// 清除重做栈
-	while (!m_redoStack.empty())
-	{
-		delete m_redoStack.top();
-		m_redoStack.pop();
-	}
-	
-	// 清除所有命令
-	for (auto* cmd : m_allCommands)
-	{
-		delete cmd;
-	}
-	m_allCommands.clear();
+	if (!m_model.SwitchBranch(bNext, pChanged))
+		return FALSE;
+
+	SetModifiedFlag(TRUE);
+	return TRUE;
 }
 
-void CMFCdrawDoc::RedrawAll(CDC* pDC)
+void CMFCdrawDoc::ClearCommands()
 {
-	for (auto* cmd : m_allCommands)
-	{
-		cmd->Execute(pDC);
-	}
+	// 清除撤销树和所有命令
+	// 仍被快照引用的命令由快照负责在释放时删除
+	m_model.Clear();
 }
 
 CMFCdrawDoc::~CMFCdrawDoc()
@@ -130,6 +169,7 @@ CMFCdrawDoc::~CMFCdrawDoc()
 
 BOOL CMFCdrawDoc::OnNewDocument()
 {
+	PROFILE_FUNCTION();
 	if (!CDocument::OnNewDocument())
 		return FALSE;
 
@@ -147,63 +187,110 @@ BOOL CMFCdrawDoc::OnNewDocument()
 
 void CMFCdrawDoc::Serialize(CArchive& ar)
 {
+	PROFILE_FUNCTION();
 	if (ar.IsStoring())
 	{
-		// TODO: 在此添加存储代码
+		ar << DOCUMENT_FILE_MAGIC << DOCUMENT_FILE_VERSION;
+
+		CDocumentSnapshot snapshot = GetSnapshot();
+		std::vector<uint8_t> thumbnail;
+		CThumbnailRenderer::RenderPng(snapshot, CThumbnailRenderer::THUMBNAIL_SIZE, ::GetSysColor(COLOR_WINDOW), thumbnail);
+		ar << static_cast<DWORD>(thumbnail.size());
+		if (!thumbnail.empty())
+			ar.Write(thumbnail.data(), static_cast<UINT>(thumbnail.size()));
+
+		ar << m_model.GetSearchContent();
+
+		// 只写入缩小显示或渲染缩略图时已经建立的笔迹金字塔
+		m_model.StoreCommands(ar, snapshot, TRUE);
 	}
 	else
 	{
-		// TODO: 在此添加加载代码
+		DWORD dwMagic;
+		WORD wVersion;
+		ar >> dwMagic >> wVersion;
+		if (dwMagic != DOCUMENT_FILE_MAGIC || wVersion != DOCUMENT_FILE_VERSION)
+			AfxThrowArchiveException(CArchiveException::badSchema, ar.m_strFileName);
+
+		DWORD nThumbnailBytes;
+		ar >> nThumbnailBytes;
+#ifdef SHARED_HANDLERS
+		// 外壳预览只需要缩略图，不读取后面的命令
+		LoadArchiveArray(ar, m_thumbnailCache, nThumbnailBytes);
+
+		// 搜索筛选器只需要搜索内容
+		ar >> m_strSearchContentCache;
+#else
+		// 程序中不使用缓存的缩略图，跳过
+		BYTE buffer[4096];
+		while (nThumbnailBytes > 0)
+		{
+			UINT nRead = ar.Read(buffer, min(nThumbnailBytes, static_cast<DWORD>(sizeof(buffer))));
+			if (nRead == 0)
+				AfxThrowArchiveException(CArchiveException::endOfFile, ar.m_strFileName);
+			nThumbnailBytes -= nRead;
+		}
+
+		// 搜索内容在加载命令时重新建立
+		CString strSearchContent;
+		ar >> strSearchContent;
+
+		m_model.LoadCommands(ar);
+#endif // SHARED_HANDLERS
 	}
 }
 
+void CMFCdrawDoc::DeleteContents()
+{
+	PROFILE_FUNCTION();
+	// 打开文档前和打开失败后都会调用，清除旧的命令
+	ClearCommands();
+	CDocument::DeleteContents();
+}
+
 #ifdef SHARED_HANDLERS
 
 // 缩略图的支持
 void CMFCdrawDoc::OnDrawThumbnail(CDC& dc, LPRECT lprcBounds)
 {
-	// 修改此代码以绘制文档数据
+	PROFILE_FUNCTION();
 	dc.FillSolidRect(lprcBounds, RGB(255, 255, 255));
 
-	try
-	{
-		CString strText = _T("TODO: implement thumbnail drawing here");
-		LOGFONT lf;
+	// 只加载了文件头部的缩略图；空文档没有缩略图
+	if (m_thumbnailCache.empty())
+		return;
 
-		CFont* pDefaultGUIFont = CFont::FromHandle((HFONT) GetStockObject(DEFAULT_GUI_FONT));
-		if (pDefaultGUIFont != nullptr)
-		{
-			pDefaultGUIFont->GetLogFont(&lf);
-		}
-		else
-		{
-			// 如果无法获取默认字体，使用系统默认值
-			ZeroMemory(&lf, sizeof(LOGFONT));
-			lf.lfHeight = 36;
-		}
-		lf.lfHeight = 36;
+	IStream* pStream = SHCreateMemStream(m_thumbnailCache.data(), static_cast<UINT>(m_thumbnailCache.size()));
+	if (pStream == nullptr)
+		return;
 
-		CFontWrapper fontDraw(&lf);
-		CGdiObjectSelector<CFont, CFont> fontSelector(&dc, fontDraw.Get());
-		
-		dc.DrawText(strText, lprcBounds, DT_CENTER | DT_WORDBREAK);
-	}
-	catch (const CGdiObjectException&)
+	CImage image;
+	HRESULT hr = image.Load(pStream);
+	pStream->Release();
+	if (FAILED(hr) || image.GetWidth() <= 0 || image.GetHeight() <= 0)
 	{
-		// 错误处理：记录日志或显示错误消息
-		TRACE(_T("Failed to draw thumbnail\n"));
+		TRACE(_T("Failed to decode cached thumbnail\n"));
+		return;
 	}
+
+	// 保持宽高比，居中绘制
+	CRect rectBounds(lprcBounds);
+	double dScale = min(static_cast<double>(rectBounds.Width()) / image.GetWidth(),
+		static_cast<double>(rectBounds.Height()) / image.GetHeight());
+	int nWidth = max(1, static_cast<int>(image.GetWidth() * dScale));
+	int nHeight = max(1, static_cast<int>(image.GetHeight() * dScale));
+	CRect rectDest(CPoint(rectBounds.left + (rectBounds.Width() - nWidth) / 2,
+		rectBounds.top + (rectBounds.Height() - nHeight) / 2), CSize(nWidth, nHeight));
+
+	dc.SetStretchBltMode(HALFTONE);
+	image.Draw(dc.GetSafeHdc(), rectDest);
 }
 
 // 搜索处理程序的支持
 void CMFCdrawDoc::InitializeSearchContent()
 {
-	CString strSearchContent;
-	// 从文档数据设置搜索内容。
-	// 内容部分应由“;”分隔
-
-	// 例如:     strSearchContent = _T("point;rectangle;circle;ole object;")；
-	SetSearchContent(strSearchContent);
+	// 搜索内容在保存时写入文件头部，内容部分由“;”分隔
+	SetSearchContent(m_strSearchContentCache);
 }
 
 void CMFCdrawDoc::SetSearchContent(const CString& value)
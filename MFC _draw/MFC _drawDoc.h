@@ -5,8 +5,20 @@
 
 #pragma once
 
-#include <stack>
+#include <cstdint>
+#include <string>
+#include <vector>
 #include "DrawCommand.h"
+#include "DocumentModel.h"
+
+// UpdateAllViews 的提示（lHint 为 CMFCdrawDoc::HINT_REGION_CHANGED）：只有文档区域 m_rect 中的内容发生了变化
+class CRegionHint : public CObject
+{
+public:
+	CRect m_rect;
+
+	explicit CRegionHint(const CRect& rect) : m_rect(rect) {}
+};
 
 class CMFCdrawDoc : public CDocument
 {
@@ -19,30 +31,79 @@ public:
 
 // 操作
 public:
+	static const LPARAM HINT_REGION_CHANGED = 1;  // UpdateAllViews 的提示，pHint 为 CRegionHint
+
 	// 添加命令到撤销栈
 	void AddCommand(CDrawCommand* pCommand);
-	// 撤销操作
-	BOOL Undo();
-	// 重做操作
-	BOOL Redo();
+	// 事务：之间添加、变换的命令合并为一个撤销单元（可以嵌套，通常通过 CTransactionScope 使用）；
+	// 最外层结束时只设置一次修改标志，并以 HINT_REGION_CHANGED 通知视图重绘一次所有操作影响的区域
+	void BeginTransaction() { m_model.BeginTransaction(); }
+	void EndTransaction();
+	// 批量添加程序生成的图形（文本已通过 InternText 加入字符串池），作为一步可撤销的操作，视图只重绘一次
+	void AddDrawData(const DrawData* pFirst, const DrawData* pLast);
+	void AddDrawData(std::vector<DrawData>&& data);
+	// 从绘图记录文件（格式见 DrawRecordReader.h）流式导入图形，作为一步可撤销的操作；
+	// nImported 返回导入的数量。文件无法打开或格式错误时返回 FALSE，nErrorLine 返回出错的行号（无法打开时为 0），已导入的图形保留。
+	// pRecords 不为空时先把整个文件读入 *pRecords 再导入（记录输入轨迹时使用）
+	BOOL ImportDrawRecords(LPCTSTR pszPath, size_t& nImported, size_t& nErrorLine, std::string* pRecords = nullptr);
+	// 移动、缩放 indices 中的命令，作为一步可撤销的操作；pChanged 不为空时返回需要重绘的区域（文档坐标）
+	BOOL TransformCommands(const std::vector<size_t>& indices, const DrawTransform& transform, CRect* pChanged = nullptr);
+	// 粘贴命令（见 CDocumentModel::PasteCommands），作为一步可撤销的操作，视图只重绘一次
+	void PasteCommands(const std::vector<CDrawCommandPtr>& commands, const CColorPalette& palette, const DrawTransform& transform);
+	// 撤销操作；pChanged 不为空时返回受影响的区域（文档坐标）
+	BOOL Undo(CRect* pChanged = nullptr);
+	// 重做操作；pChanged 同上
+	BOOL Redo(CRect* pChanged = nullptr);
+	// 切换到撤销树中最近的分叉点的下一个或上一个分支；pChanged 同上，只包含两个分支不同的部分
+	BOOL SwitchBranch(BOOL bNext, CRect* pChanged = nullptr);
 	// 检查是否可以撤销
-	BOOL CanUndo() const { return !m_undoStack.empty(); }
+	BOOL CanUndo() const { return m_model.CanUndo(); }
 	// 检查是否可以重做
-	BOOL CanRedo() const { return !m_redoStack.empty(); }
+	BOOL CanRedo() const { return m_model.CanRedo(); }
+	// 检查撤销树中是否有其他分支
+	BOOL CanSwitchBranch() const { return m_model.CanSwitchBranch(); }
+	BOOL GetBranchPosition(size_t& nBranch, size_t& nBranches) const { return m_model.GetBranchPosition(nBranch, nBranches); }
 	// 清除所有命令（新建文档时）
 	void ClearCommands();
-	// 重绘所有命令
-	void RedrawAll(CDC* pDC);
+	// 重绘所有命令；dScale 为显示比例，缩小显示时按低细节规则重放
+	void RedrawAll(CDC* pDC, double dScale = 1.0) { m_model.RedrawAll(pDC, dScale); }
+	// 获取当前命令数量
+	size_t GetCommandCount() const { return m_model.GetCommandCount(); }
+	// 估算文档占用的内存（字节）
+	size_t GetMemoryUsage() const { return m_model.GetMemoryUsage(); }
+	// 分片重绘：从 nStart 开始重放命令，直到全部完成或超过截止时间（QueryPerformanceCounter 计数）
+	// 返回下一次应继续重放的位置
+	size_t RedrawSlice(CDC* pDC, size_t nStart, LONGLONG llDeadline, double dScale = 1.0) { return m_model.RedrawSlice(pDC, nStart, llDeadline, dScale); }
+	// 获取当前文档状态的不可变快照（O(1)），可交给其他线程读取
+	CDocumentSnapshot GetSnapshot() const { return m_model.GetSnapshot(); }
+	// 查找内容包含 strQuery（不区分大小写）的文本命令，结果为命令序号（递增）
+	void FindText(const CString& strQuery, std::vector<size_t>& results) const { m_model.FindText(strQuery, results); }
+	// 点选最上层的命令，没有时返回 CDocumentModel::NO_COMMAND
+	size_t HitTest(CPoint point, double dTolerance) const { return m_model.HitTest(point, dTolerance); }
+	// 框选，结果为命令序号（递增）
+	void SelectInRect(const CRect& rect, BOOL bContainedOnly, std::vector<size_t>& results) const { m_model.SelectInRect(rect, bContainedOnly, results); }
+	// 获取第 i 条命令
+	CDrawCommand* GetCommand(size_t i) const { return m_model.GetCommand(i); }
+	// 把文本加入文档字符串池，返回其序号（相同的文本只保存一份）
+	UINT InternText(const CString& text) { return m_model.InternText(text); }
+	const CStringPool& GetStringPool() const { return m_model.GetStringPool(); }
+	// 文档颜色表：新命令的颜色通过 DrawData::SetPenColor 加入
+	CColorPalette& GetColorPalette() { return m_model.GetColorPalette(); }
+	// 只读访问文档模型（分块缓冲区按块重放时使用）
+	const CDocumentModel& GetModel() const { return m_model; }
 
 private:
-	std::stack<CDrawCommand*> m_undoStack;  // 撤销栈
-	std::stack<CDrawCommand*> m_redoStack;  // 重做栈
-	std::vector<CDrawCommand*> m_allCommands;  // 存储所有命令用于重绘
+	CDocumentModel m_model;  // 命令历史、搜索索引和字符串池
+#ifdef SHARED_HANDLERS
+	std::vector<uint8_t> m_thumbnailCache;  // 从文件头部读取的缩略图（PNG）
+	CString m_strSearchContentCache;        // 从文件头部读取的搜索内容
+#endif // SHARED_HANDLERS
 
 // 重写
 public:
 	virtual BOOL OnNewDocument();
 	virtual void Serialize(CArchive& ar);
+	virtual void DeleteContents();
 #ifdef SHARED_HANDLERS
 	virtual void InitializeSearchContent();
 	virtual void OnDrawThumbnail(CDC& dc, LPRECT lprcBounds);
@@ -12,8 +12,18 @@
 
 #include "MFC _drawDoc.h"
 #include "MFC _drawView.h"
+#include "MainFrm.h"
 #include "resource.h"
 #include "CSetPenSizeDialog.h"
+#include "CExportImageDialog.h"
+#include "CFindTextDialog.h"
+#include "OffscreenExporter.h"
+#include "Metrics.h"
+#include "TraceProfiler.h"
+#include "AllocationCounter.h"
+
+#include <algorithm>
+#include <cmath>
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
@@ -44,11 +54,36 @@ BEGIN_MESSAGE_MAP(CMFCdrawView, CView)
 	ON_COMMAND(ID_32779, &CMFCdrawView::OnSetEraser)
 	ON_COMMAND(ID_FILE_OPEN, &CMFCdrawView::OnFileOpen)
 	ON_COMMAND(ID_FILE_SAVE, &CMFCdrawView::OnFileSave)
+	ON_COMMAND(ID_FILE_EXPORT_IMAGE, &CMFCdrawView::OnFileExportImage)
+	ON_COMMAND(ID_FILE_IMPORT_RECORDS, &CMFCdrawView::OnFileImportRecords)
 	ON_COMMAND(ID_32780, &CMFCdrawView::OnPen)
 	ON_COMMAND(ID_EDIT_UNDO, &CMFCdrawView::OnEditUndo)
 	ON_COMMAND(ID_EDIT_REDO, &CMFCdrawView::OnEditRedo)
 	ON_UPDATE_COMMAND_UI(ID_EDIT_UNDO, &CMFCdrawView::OnUpdateEditUndo)
 	ON_UPDATE_COMMAND_UI(ID_EDIT_REDO, &CMFCdrawView::OnUpdateEditRedo)
+	ON_COMMAND(ID_EDIT_PREV_BRANCH, &CMFCdrawView::OnEditPrevBranch)
+	ON_COMMAND(ID_EDIT_NEXT_BRANCH, &CMFCdrawView::OnEditNextBranch)
+	ON_UPDATE_COMMAND_UI(ID_EDIT_PREV_BRANCH, &CMFCdrawView::OnUpdateEditSwitchBranch)
+	ON_UPDATE_COMMAND_UI(ID_EDIT_NEXT_BRANCH, &CMFCdrawView::OnUpdateEditSwitchBranch)
+	ON_COMMAND(ID_EDIT_FIND, &CMFCdrawView::OnEditFind)
+	ON_COMMAND(ID_EDIT_FIND_NEXT, &CMFCdrawView::OnEditFindNext)
+	ON_COMMAND(ID_FILE_RECORD_TRACE, &CMFCdrawView::OnFileRecordTrace)
+	ON_UPDATE_COMMAND_UI(ID_FILE_RECORD_TRACE, &CMFCdrawView::OnUpdateFileRecordTrace)
+	ON_WM_TIMER()
+	ON_WM_ERASEBKGND()
+	ON_WM_MOUSEWHEEL()
+	ON_WM_MBUTTONDOWN()
+	ON_WM_MBUTTONUP()
+	ON_COMMAND(ID_VIEW_ZOOM_IN, &CMFCdrawView::OnViewZoomIn)
+	ON_COMMAND(ID_VIEW_ZOOM_OUT, &CMFCdrawView::OnViewZoomOut)
+	ON_COMMAND(ID_VIEW_ZOOM_ACTUAL, &CMFCdrawView::OnViewZoomActual)
+	ON_COMMAND(ID_VIEW_ZOOM_FIT, &CMFCdrawView::OnViewZoomFit)
+	ON_COMMAND(ID_EDIT_SELECT_TOOL, &CMFCdrawView::OnEditSelectTool)
+	ON_UPDATE_COMMAND_UI(ID_EDIT_SELECT_TOOL, &CMFCdrawView::OnUpdateEditSelectTool)
+	ON_COMMAND(ID_EDIT_COPY, &CMFCdrawView::OnEditCopy)
+	ON_COMMAND(ID_EDIT_PASTE, &CMFCdrawView::OnEditPaste)
+	ON_UPDATE_COMMAND_UI(ID_EDIT_COPY, &CMFCdrawView::OnUpdateEditCopy)
+	ON_UPDATE_COMMAND_UI(ID_EDIT_PASTE, &CMFCdrawView::OnUpdateEditPaste)
 END_MESSAGE_MAP()
 
 // CMFCdrawView 构造/析构
@@ -64,6 +99,16 @@ CMFCdrawView::CMFCdrawView() noexcept
 	  m_DrawType = m_DrawType::LineSegment;//初始值为线段
 	  m_TextId = 10086;//文本输入id
 	  m_bDrawing = FALSE;
+	  m_bRedrawPending = FALSE;
+	  m_nFoundCommand = NO_FOUND_COMMAND;
+	  m_rectFound.SetRectEmpty();
+	  m_bPanning = FALSE;
+	  m_bSelectTool = FALSE;
+	  m_rectSelection.SetRectEmpty();
+	  m_selectDrag = SelectDrag::None;
+	  m_rectMarquee.SetRectEmpty();
+	  m_nPasteCount = 0;
+	  m_bClipboardInTrace = FALSE;
 }
 
 CMFCdrawView::~CMFCdrawView()
@@ -80,15 +125,282 @@ BOOL CMFCdrawView::PreCreateWindow(CREATESTRUCT& cs)
 
 // CMFCdrawView 绘图
 
+void CMFCdrawView::OnPrepareDC(CDC* pDC, CPrintInfo* pInfo)
+{
+	CView::OnPrepareDC(pDC, pInfo);
+
+	// 屏幕上按当前的缩放和平移以文档坐标绘制；打印保持 1:1
+	if (!pDC->IsPrinting())
+		m_viewport.Prepare(pDC);
+}
+
 void CMFCdrawView::OnDraw(CDC* pDC)
+{
+	PROFILE_FUNCTION();
+	if (pDC->IsPrinting())
+	{
+		DrawDocument(pDC);
+		return;
+	}
+
+	// 记录屏幕绘制的耗时、重放和跳过的命令数以及创建的 GDI 对象数，由状态栏显示
+	CMetricsRegistry& registry = CMetricsRegistry::Instance();
+	static CMetricHistogram& s_drawTime = registry.GetHistogram(DrawMetrics::DRAW_TIME_US);
+	static CMetricCounter& s_replayed = registry.GetCounter(DrawMetrics::COMMANDS_REPLAYED);
+	static CMetricCounter& s_culled = registry.GetCounter(DrawMetrics::COMMANDS_CULLED);
+	static CMetricCounter& s_gdiCreated = registry.GetCounter(DrawMetrics::GDI_OBJECTS_CREATED);
+	static CMetricCounter& s_lastReplayed = registry.GetCounter(DrawMetrics::LAST_DRAW_REPLAYED);
+	static CMetricCounter& s_lastCulled = registry.GetCounter(DrawMetrics::LAST_DRAW_CULLED);
+	static CMetricCounter& s_lastGdiCreated = registry.GetCounter(DrawMetrics::LAST_DRAW_GDI_OBJECTS);
+
+	long long nReplayed = s_replayed.Get();
+	long long nCulled = s_culled.Get();
+	long long nGdiCreated = s_gdiCreated.Get();
+	LARGE_INTEGER frequency, start, end;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&start);
+
+	DrawDocument(pDC);
+
+	QueryPerformanceCounter(&end);
+	s_drawTime.Record((end.QuadPart - start.QuadPart) * 1000000 / frequency.QuadPart);
+	s_lastReplayed.Set(s_replayed.Get() - nReplayed);
+	s_lastCulled.Set(s_culled.Get() - nCulled);
+	s_lastGdiCreated.Set(s_gdiCreated.Get() - nGdiCreated);
+}
+
+void CMFCdrawView::DrawDocument(CDC* pDC)
 {
 	CMFCdrawDoc* pDoc = GetDocument();
 	ASSERT_VALID(pDoc);
 	if (!pDoc)
 		return;
 
-	// 重绘所有命令
-	pDoc->RedrawAll(pDC);
+	// 命令较少或打印时直接重绘所有命令
+	if (pDC->IsPrinting() || pDoc->GetCommandCount() < PROGRESSIVE_REDRAW_THRESHOLD)
+	{
+		pDoc->RedrawAll(pDC, pDC->IsPrinting() ? 1.0 : m_viewport.GetZoom());
+		if (!pDC->IsPrinting() && !m_rectFound.IsRectEmpty())
+			pDC->DrawFocusRect(&m_rectFound);
+		if (!pDC->IsPrinting())
+			DrawSelection(pDC);
+		return;
+	}
+
+	LARGE_INTEGER frequency, now;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&now);
+	LONGLONG llDeadline = now.QuadPart + frequency.QuadPart * REDRAW_SLICE_MS / 1000;
+
+	// 可见的块各自重放一个时间片，再复制到屏幕；块按画布像素保存，复制时临时换回设备坐标
+	BOOL bComplete = TRUE;
+	BOOL bDrawDirectly = FALSE;
+	int nSavedDC = pDC->SaveDC();
+	pDC->SetMapMode(MM_TEXT);
+	pDC->SetWindowOrg(0, 0);
+	pDC->SetViewportOrg(0, 0);
+	CRect rectClip;
+	pDC->GetClipBox(&rectClip);
+	try
+	{
+		bComplete = m_canvas.Draw(pDC, rectClip, pDoc->GetModel(), m_viewport, ::GetSysColor(COLOR_WINDOW), llDeadline);
+	}
+	catch (const CGdiObjectException&)
+	{
+		// 无法分配块位图时丢弃缓冲区，直接重绘
+		TRACE(_T("Failed to draw tile canvas\n"));
+		m_canvas.Clear();
+		pDC->FillSolidRect(&rectClip, ::GetSysColor(COLOR_WINDOW));
+		bDrawDirectly = TRUE;
+	}
+	pDC->RestoreDC(nSavedDC);
+	if (bDrawDirectly)
+		pDoc->RedrawAll(pDC, m_viewport.GetZoom());
+
+	if (!m_rectFound.IsRectEmpty())
+		pDC->DrawFocusRect(&m_rectFound);
+	DrawSelection(pDC);
+
+	// 尚未重放完毕时由定时器驱动下一个时间片，期间输入消息可以优先处理
+	if (!bComplete)
+	{
+		SetTimer(REDRAW_TIMER_ID, USER_TIMER_MINIMUM, nullptr);
+	}
+}
+
+void CMFCdrawView::OnUpdate(CView* /*pSender*/, LPARAM lHint, CObject* pHint)
+{
+	PROFILE_FUNCTION();
+	if (lHint == CMFCdrawDoc::HINT_REGION_CHANGED && pHint != nullptr)
+	{
+		// 事务等局部修改：保留缩放、平移和其余已完成的块，只重绘变化的区域
+		ClearFoundHighlight();
+		ClearSelection();
+		InvalidateDocRect(static_cast<CRegionHint*>(pHint)->m_rect);
+		return;
+	}
+
+	// 文档内容整体变化（新建、打开等）时丢弃旧的重绘进度、查找结果、选择和上一个文档的绘制耗时统计
+	ClearFoundHighlight();
+	ClearSelection();
+	CMetricsRegistry::Instance().GetHistogram(DrawMetrics::DRAW_TIME_US).Reset();
+	m_viewport.Reset();
+	InvalidateDrawing();
+}
+
+void CMFCdrawView::InvalidateDrawing()
+{
+	// 新的失效请求会取消尚未完成的重放：所有块从头开始
+	m_canvas.Clear();
+	Invalidate();
+}
+
+void CMFCdrawView::InvalidateDocRect(const CRect& rectDoc)
+{
+	if (rectDoc.IsRectEmpty())
+		return;
+	// 分块缓冲区中只有与该区域相交的块从头重放，其余的块继续使用
+	m_canvas.Invalidate(rectDoc, m_viewport);
+	CRect rectClient = m_viewport.DocToClient(rectDoc);
+	rectClient.InflateRect(1, 1);
+	InvalidateRect(&rectClient);
+}
+
+void CMFCdrawView::OnTimer(UINT_PTR nIDEvent)
+{
+	PROFILE_FUNCTION();
+	if (nIDEvent != REDRAW_TIMER_ID)
+	{
+		CView::OnTimer(nIDEvent);
+		return;
+	}
+
+	KillTimer(REDRAW_TIMER_ID);
+	// 鼠标拖动绘制或拖动选中的图形期间暂停，避免缓冲区覆盖屏幕上的预览；由 EndDrawing 继续
+	if (m_bDrawing)
+	{
+		m_bRedrawPending = TRUE;
+		return;
+	}
+
+	// 由 OnDraw 重放下一个时间片；WM_PAINT 的优先级低于输入消息
+	Invalidate(FALSE);
+}
+
+void CMFCdrawView::EndDrawing()
+{
+	m_bDrawing = FALSE;
+	if (m_bRedrawPending)
+	{
+		m_bRedrawPending = FALSE;
+		SetTimer(REDRAW_TIMER_ID, USER_TIMER_MINIMUM, nullptr);
+	}
+}
+
+BOOL CMFCdrawView::OnEraseBkgnd(CDC* pDC)
+{
+	// 渐进式重绘时由缓冲区覆盖整个客户区，跳过背景擦除以免闪烁
+	CMFCdrawDoc* pDoc = GetDocument();
+	if (pDoc != nullptr && pDoc->GetCommandCount() >= PROGRESSIVE_REDRAW_THRESHOLD)
+		return TRUE;
+
+	return CView::OnEraseBkgnd(pDC);
+}
+
+
+// CMFCdrawView 缩放和平移
+
+CSize CMFCdrawView::GetClientSize() const
+{
+	CRect rectClient;
+	GetClientRect(&rectClient);
+	return rectClient.Size();
+}
+
+void CMFCdrawView::OnZoomChanged()
+{
+	InvalidateDrawing();
+
+	CMainFrame* pFrame = DYNAMIC_DOWNCAST(CMainFrame, AfxGetMainWnd());
+	if (pFrame != nullptr)
+	{
+		CString strMessage;
+		strMessage.Format(_T("缩放 %.4g%%"), m_viewport.GetZoom() * 100);
+		pFrame->SetMessageText(strMessage);
+	}
+}
+
+BOOL CMFCdrawView::OnMouseWheel(UINT nFlags, short zDelta, CPoint pt)
+{
+	PROFILE_FUNCTION();
+	// 拖动绘制期间不改变视图，避免橡皮筋预览错位
+	if (m_bDrawing)
+		return TRUE;
+
+	// Ctrl+滚轮以鼠标位置为中心缩放，Shift+滚轮水平平移，滚轮垂直平移（每格 WHEEL_DELTA 像素）
+	ScreenToClient(&pt);
+	if (nFlags & MK_CONTROL)
+	{
+		if (m_viewport.ZoomBy(zDelta > 0 ? 1 : -1, pt))
+			OnZoomChanged();
+	}
+	else
+	{
+		m_viewport.Pan((nFlags & MK_SHIFT) ? CSize(zDelta, 0) : CSize(0, zDelta));
+		Invalidate();  // 分块缓冲区中已完成的块平移后仍然有效
+	}
+	return TRUE;
+}
+
+void CMFCdrawView::OnMButtonDown(UINT nFlags, CPoint point)
+{
+	// 按住中键拖动平移
+	if (!m_bDrawing)
+	{
+		m_bPanning = TRUE;
+		m_ptPanLast = point;
+		SetCapture();
+	}
+	CView::OnMButtonDown(nFlags, point);
+}
+
+void CMFCdrawView::OnMButtonUp(UINT nFlags, CPoint point)
+{
+	if (m_bPanning)
+	{
+		m_bPanning = FALSE;
+		ReleaseCapture();
+	}
+	CView::OnMButtonUp(nFlags, point);
+}
+
+void CMFCdrawView::OnViewZoomIn()
+{
+	CSize sizeClient = GetClientSize();
+	if (m_viewport.ZoomBy(1, CPoint(sizeClient.cx / 2, sizeClient.cy / 2)))
+		OnZoomChanged();
+}
+
+void CMFCdrawView::OnViewZoomOut()
+{
+	CSize sizeClient = GetClientSize();
+	if (m_viewport.ZoomBy(-1, CPoint(sizeClient.cx / 2, sizeClient.cy / 2)))
+		OnZoomChanged();
+}
+
+void CMFCdrawView::OnViewZoomActual()
+{
+	m_viewport.Reset();
+	OnZoomChanged();
+}
+
+void CMFCdrawView::OnViewZoomFit()
+{
+	CMFCdrawDoc* pDoc = GetDocument();
+	if (pDoc == nullptr)
+		return;
+	m_viewport.FitRect(pDoc->GetSnapshot().GetExtent(), GetClientSize());
+	OnZoomChanged();
 }
 
 
@@ -137,16 +449,29 @@ CMFCdrawDoc* CMFCdrawView::GetDocument() const // 非调试版本是内联的
 
 void CMFCdrawView::OnLButtonDown(UINT nFlags, CPoint point)//鼠标消息 按动
 {
+	PROFILE_FUNCTION();
 	// TODO: 在此添加消息处理程序代码和/或调用默认值
+	if (m_bSelectTool)
+	{
+		// 选择本身不改变文档，不记录鼠标事件；拖动提交的移动、缩放在 OnSelectButtonUp 中记录
+		OnSelectButtonDown(point);
+		CView::OnLButtonDown(nFlags, point);
+		return;
+	}
+	point = m_viewport.ClientToDoc(point);//命令和轨迹中使用文档坐标
+	m_traceRecorder.RecordMouse(InputTraceEventType::MouseDown, point);
 	m_PointBegin = m_PointEnd = point;//初始化
 	m_bDrawing = TRUE;
-	
-	// 对于铅笔和橡皮擦，记录起始点
-	if (m_DrawType == m_DrawType::Pencil || m_DrawType == m_DrawType::Eraser)
+	ClearFoundHighlight();
+
+	// 新的文本框在拖动时创建，丢弃上一次未提交的文本框
+	if (m_DrawType == m_DrawType::Text && m_Edit != nullptr)
 	{
-		m_currentPencilPoints.clear();
-		m_currentPencilPoints.push_back(point);
+		delete m_Edit;
+		m_Edit = nullptr;
 	}
+
+	m_capture.Begin(static_cast<DrawData::DrawType>(m_DrawType), m_PenSize, m_PenColor, m_BrushColor, point);
 	
 	CView::OnLButtonDown(nFlags, point);
 }
@@ -154,136 +479,45 @@ void CMFCdrawView::OnLButtonDown(UINT nFlags, CPoint point)//鼠标消息 按动
 
 void CMFCdrawView::OnMouseMove(UINT nFlags, CPoint point)//鼠标移动
 {
+	PROFILE_FUNCTION();
 	// TODO: 在此添加消息处理程序代码和/或调用默认值
-	if (nFlags & MK_LBUTTON) {
-		CClientDC dc(this);//获取当前数据,鼠标左键是否被按下
-		CPen newPen, * oldPen;
-	
-		newPen.CreatePen(PS_SOLID,m_PenSize,m_PenColor);//创建个新笔，设置画笔尺寸，颜色等
-		oldPen = dc.SelectObject(&newPen);
-
-
-		switch (m_DrawType){
-		case m_DrawType::LineSegment://画直线
-		{
-			dc.SetROP2(R2_NOTXORPEN);//设置DC的绘图模式，如果已经画了一条线，再画一条线，覆盖掉上一条线，以达到线段移动的效果
-			dc.MoveTo(m_PointBegin);
-			dc.LineTo(m_PointEnd);
-
-			dc.MoveTo(m_PointBegin);
-			dc.LineTo(point);
+	if (m_bPanning) {
+		// 按住中键拖动：内容跟随鼠标移动
+		m_viewport.Pan(point - m_ptPanLast);
+		m_ptPanLast = point;
+		Invalidate();
+	}
+	else if ((nFlags & MK_LBUTTON) && m_selectDrag != SelectDrag::None) {
+		OnSelectMouseMove(point);
+	}
+	else if ((nFlags & MK_LBUTTON) && m_capture.IsCapturing()) {
+		CPoint ptDoc = m_viewport.ClientToDoc(point);
+		m_traceRecorder.RecordMouse(InputTraceEventType::MouseMove, ptDoc);
 
-			m_PointEnd = point;
-			break;
-		}
-		case m_DrawType::Rectangle://画矩形
+		// 热路径：预览画笔和点缓冲区由 m_capture 重复使用，稳定状态下不分配内存
+		static CMetricCounter& allocations = CMetricsRegistry::Instance().GetCounter(DrawMetrics::MOUSE_MOVE_ALLOCATIONS);
+		CAllocationScope allocationScope;
 		{
-			dc.SetROP2(R2_NOTXORPEN);
-			dc.SelectStockObject(5);
-			CRect rectP1(m_PointBegin, m_PointEnd);
-
-			dc.Rectangle(rectP1);
-
-			CRect rectP2(m_PointBegin, point);
-			dc.Rectangle(rectP2);
-			m_PointEnd = point;
-			break;
+			CClientDC dc(this);//获取当前数据,鼠标左键是否被按下
+			OnPrepareDC(&dc);
+			m_capture.Move(ptDoc, &dc);
 		}
-		case m_DrawType::Ellipse://画椭圆
-		{
-			dc.SetROP2(R2_NOTXORPEN);
-			dc.SelectStockObject(5);
-			CRect rectP1(m_PointBegin, m_PointEnd);
+		allocations.Add(static_cast<long long>(allocationScope.GetCount()));
+		m_PointBegin = m_capture.GetBegin();
+		m_PointEnd = m_capture.GetEnd();
 
-			dc.Ellipse(rectP1);
-
-			CRect rectP2(m_PointBegin, point);
-			dc.Ellipse(rectP2);
-			m_PointEnd = point;
-			break;
-		}
-		case m_DrawType::Circle://画圆形
-		{
-			dc.SetROP2(R2_NOTXORPEN);
-			dc.SelectStockObject(5);
-
-			int length_1 = m_PointEnd.y - m_PointBegin.y;//确定正方形的边长
-			if (m_PointEnd.x < m_PointBegin.x) {
-				m_PointEnd.x = m_PointBegin.x - abs(length_1);//对length1_1取绝对值
-
-			}
-			else {
-				m_PointEnd.x = m_PointBegin.x + abs(length_1);
-			}
-
-			CRect rectP1(m_PointBegin, m_PointEnd);//确定正方形
-
-			dc.Ellipse(rectP1);//用正方形绘制椭圆
-			int length_2 = point.y - m_PointBegin.y;//point为当前点
-			if (point.x < m_PointBegin.x) {
-				m_PointEnd.x = m_PointBegin.x - abs(length_2);//对length1_1取绝对值
-
-			}//用现在当前点和现在的起点的横坐标来确定终点的横坐标
-			else {
-				m_PointEnd.x = m_PointBegin.x + abs(length_2);
-			}
-			m_PointEnd.y = point.y;//用纵坐标的差来绘制圆，所以纵坐标不用变
-
-			CRect rectP2(m_PointBegin, m_PointEnd);
-			dc.Ellipse(rectP2);
-			m_PointEnd = point;
-			break;
-		}
-		case m_DrawType::Text://文本输入
+		if (m_DrawType == m_DrawType::Text)//文本输入：文本框跟随鼠标调整大小（文本框使用客户区坐标）
 		{
+			CRect rect(m_viewport.DocToClient(m_PointBegin), point);
 			if (m_Edit != nullptr) {
-				delete m_Edit;
+				m_Edit->MoveWindow(rect);
 			}
-			CEdit* myEdit = new CEdit();//新建一个Edit对象
-			myEdit->Create(WS_CHILD | WS_VISIBLE | WS_BORDER, CRect(m_PointBegin, point), this, m_TextId);
-
-			m_Edit = myEdit;
-			myEdit->ShowWindow(SW_SHOW);
-			break;
-		}
-		case m_DrawType::Pencil: //创建铅笔
-		{
-			m_PointBegin = m_PointEnd;
-			m_PointEnd = point;
-			dc.MoveTo(m_PointBegin);
-			dc.LineTo(m_PointEnd);
-			
-			// 记录点
-			if (m_currentPencilPoints.empty() || m_currentPencilPoints.back() != point)
-			{
-				m_currentPencilPoints.push_back(point);
-			}
-
-			break;
-		}
-		case m_DrawType::Eraser://创建橡皮
-		{
-			COLORREF pColor = dc.GetBkColor();//颜色设置成背景颜色
-			CPen newPen(PS_SOLID,m_PenSize,pColor);// 创建一个与背景颜色相同的画笔
-			dc.SelectObject(&newPen);//选择这个画笔到设备上下文中
-			m_PointBegin = m_PointEnd;
-			m_PointEnd = point;//更新起点和终点
-			dc.MoveTo(m_PointBegin);
-			dc.LineTo(m_PointEnd);//移动到起点，然后画到终点
-			
-			// 记录点
-			if (m_currentPencilPoints.empty() || m_currentPencilPoints.back() != point)
-			{
-				m_currentPencilPoints.push_back(point);
+			else {
+				m_Edit = new CEdit();//新建一个Edit对象
+				m_Edit->Create(WS_CHILD | WS_VISIBLE | WS_BORDER, rect, this, m_TextId);
+				m_Edit->ShowWindow(SW_SHOW);
 			}
-
-			break;
 		}
-		default:
-
-			break;
-		}
-		dc.SelectObject(&oldPen);                                                         
 	}
 	CView::OnMouseMove(nFlags, point);
 }
@@ -291,130 +525,58 @@ void CMFCdrawView::OnMouseMove(UINT nFlags, CPoint point)//鼠标移动
 
 void CMFCdrawView::OnLButtonUp(UINT nFlags, CPoint point)//使相交的点不再是白色
 {
+	PROFILE_FUNCTION();
 	// TODO: 在此添加消息处理程序代码和/或调用默认值
+	if (m_selectDrag != SelectDrag::None)
+	{
+		OnSelectButtonUp(point);
+		CView::OnLButtonUp(nFlags, point);
+		return;
+	}
+	CPoint ptDoc = m_viewport.ClientToDoc(point);
+	m_traceRecorder.RecordMouse(InputTraceEventType::MouseUp, ptDoc);
 	if (!m_bDrawing)
 	{
 		CView::OnLButtonUp(nFlags, point);
 		return;
 	}
 	
-	CClientDC dc(this);
-	CPen newPen, * oldPen;
 	CMFCdrawDoc* pDoc = GetDocument();
-	CDrawCommand* pCommand = nullptr;
-
-	newPen.CreatePen(PS_SOLID, m_PenSize, m_PenColor);//创建个新笔，设置画笔尺寸，颜色等
-	oldPen = dc.SelectObject(&newPen);
-	
-	DrawData data;
-	data.penSize = m_PenSize;
-	data.penColor = m_PenColor;
-	data.brushColor = m_BrushColor;
-	data.pointBegin = m_PointBegin;
-	
-	switch (m_DrawType) {
-	case m_DrawType::LineSegment://画直线
-	{
-		dc.MoveTo(m_PointBegin);
-		dc.LineTo(point);
-		m_PointEnd = point;
-		data.pointEnd = point;
-		data.drawType = DrawData::DrawType::LineSegment;
-		pCommand = new CLineSegmentCommand(data);
-		break;
-	}
-	case m_DrawType::Rectangle://画矩形
-	{
-		dc.SelectStockObject(5);
-		CRect rectP2(m_PointBegin, point);
-		dc.Rectangle(rectP2);
-		data.pointEnd = point;
-		data.drawType = DrawData::DrawType::Rectangle;
-		pCommand = new CRectangleCommand(data);
-		break;
-	}
-	case m_DrawType::Ellipse://画椭圆
-	{
-		dc.SelectStockObject(5);
-		CRect rectP2(m_PointBegin, point);
-		dc.Ellipse(rectP2);
-		data.pointEnd = point;
-		data.drawType = DrawData::DrawType::Ellipse;
-		pCommand = new CEllipseCommand(data);
-		break;
-	}
-	case m_DrawType::Circle://画圆形
-	{
-		dc.SelectStockObject(5);
-
-		int length_2 = point.y - m_PointBegin.y;//point为当前点
-		if (point.x < m_PointBegin.x) {
-			m_PointEnd.x = m_PointBegin.x - abs(length_2);//对length1_1取绝对值
-
-		}//用现在当前点和现在的起点的横坐标来确定终点的横坐标
-		else {
-			m_PointEnd.x = m_PointBegin.x + abs(length_2);
-		}
-		m_PointEnd.y = point.y;//用纵坐标的差来绘制圆，所以纵坐标不用变
-
-		CRect rectP2(m_PointBegin, m_PointEnd);
-		dc.Ellipse(rectP2);
-		m_PointEnd = point;
-		data.pointEnd = m_PointEnd;
-		data.drawType = DrawData::DrawType::Circle;
-		pCommand = new CCircleCommand(data);
-		break;
-	}
-	case m_DrawType::Text:
+	if (pDoc == nullptr)
 	{
-		CEdit* myEdit = new CEdit();//新建一个Edit对象
-		myEdit->Create(WS_CHILD | WS_VISIBLE | WS_BORDER, CRect(m_PointBegin, point), this, m_TextId);
-		myEdit->ShowWindow(SW_SHOW);
-
-		if (nullptr != m_Edit) {
-			delete m_Edit;
-		}
-		m_Edit = myEdit;
-		m_TextPos = m_PointBegin;
-		// 文本命令将在PreTranslateMessage中创建
-		break;
-
+		m_capture.Cancel();
+		EndDrawing();
+		CView::OnLButtonUp(nFlags, point);
+		return;
 	}
-	case m_DrawType::Pencil: //创建铅笔
+	CDrawCommand* pCommand = nullptr;
 	{
-		if (m_currentPencilPoints.size() > 1)
-		{
-			data.pencilPoints = m_currentPencilPoints;
-			data.drawType = DrawData::DrawType::Pencil;
-			pCommand = new CPencilCommand(data);
-		}
-		break;
+		CClientDC dc(this);
+		OnPrepareDC(&dc);
+		pCommand = m_capture.End(ptDoc, &dc, pDoc->GetColorPalette());//画出最终的图形并生成命令
 	}
-	case m_DrawType::Eraser://创建橡皮
+	m_PointEnd = ptDoc;
+
+	if (m_DrawType == m_DrawType::Text)
 	{
-		if (m_currentPencilPoints.size() > 1)
-		{
-			data.pencilPoints = m_currentPencilPoints;
-			data.drawType = DrawData::DrawType::Eraser;
-			pCommand = new CEraserCommand(data);
+		CRect rect(m_viewport.DocToClient(m_PointBegin), point);
+		if (m_Edit != nullptr) {
+			m_Edit->MoveWindow(rect);
 		}
-		break;
-	}
-	   default:
-
-		break;
+		else {
+			m_Edit = new CEdit();//新建一个Edit对象
+			m_Edit->Create(WS_CHILD | WS_VISIBLE | WS_BORDER, rect, this, m_TextId);
+			m_Edit->ShowWindow(SW_SHOW);
+		}
+		m_TextPos = m_PointBegin;
+		// 文本命令将在PreTranslateMessage中创建
 	}
 	
-	dc.SelectObject(oldPen);
-	
 	// 添加命令到文档
-	if (pCommand != nullptr && pDoc != nullptr)
-	{
+	if (pCommand != nullptr)
 		pDoc->AddCommand(pCommand);
-	}
 	
-	m_bDrawing = FALSE;
-	m_currentPencilPoints.clear();
+	EndDrawing();
 	
 	CView::OnLButtonUp(nFlags, point);
 }
@@ -423,6 +585,9 @@ void CMFCdrawView::OnLButtonUp(UINT nFlags, CPoint point)//使相交的点不再
 void CMFCdrawView::OnDrawLineSegment()
 {
 	m_DrawType = m_DrawType::LineSegment;
+	m_bSelectTool = FALSE;
+	ClearSelection();
+	m_traceRecorder.RecordValue(InputTraceEventType::SetTool, static_cast<DWORD>(m_DrawType));
 	// TODO: 在此添加命令处理程序代码
 }
 
@@ -430,6 +595,9 @@ void CMFCdrawView::OnDrawLineSegment()
 void CMFCdrawView::OnDrawRectangle()
 {
 	m_DrawType = m_DrawType::Rectangle;
+	m_bSelectTool = FALSE;
+	ClearSelection();
+	m_traceRecorder.RecordValue(InputTraceEventType::SetTool, static_cast<DWORD>(m_DrawType));
 	// TODO: 在此添加命令处理程序代码
 }
 
@@ -437,6 +605,9 @@ void CMFCdrawView::OnDrawRectangle()
 void CMFCdrawView::OnDrawCircle()
 {
 	m_DrawType = m_DrawType::Circle;
+	m_bSelectTool = FALSE;
+	ClearSelection();
+	m_traceRecorder.RecordValue(InputTraceEventType::SetTool, static_cast<DWORD>(m_DrawType));
 	// TODO: 在此添加命令处理程序代码
 }
 
@@ -444,6 +615,9 @@ void CMFCdrawView::OnDrawCircle()
 void CMFCdrawView::On32774()
 {
 	m_DrawType = m_DrawType::Ellipse;
+	m_bSelectTool = FALSE;
+	ClearSelection();
+	m_traceRecorder.RecordValue(InputTraceEventType::SetTool, static_cast<DWORD>(m_DrawType));
 	// TODO: 在此添加命令处理程序代码
 }
 
@@ -455,6 +629,7 @@ void CMFCdrawView::OnSetColor()
 	if (IDOK == dlg.DoModal())//显示颜色对话框
 	{
 		m_PenColor = dlg.GetColor();//将颜色存到pencolor中
+		m_traceRecorder.RecordValue(InputTraceEventType::SetPenColor, m_PenColor);
 	
 	
 	}
@@ -467,6 +642,7 @@ void CMFCdrawView::OnSetPenSize()
 	CSetPenSizeDialog dlg;
 	if (IDOK == dlg.DoModal()) {
 		this->m_PenSize = dlg.m_PenSize;
+		m_traceRecorder.RecordValue(InputTraceEventType::SetPenSize, static_cast<DWORD>(m_PenSize));
 	
 	}
 }
@@ -475,6 +651,9 @@ void CMFCdrawView::OnSetPenSize()
 void CMFCdrawView::OnText()
 {
 	m_DrawType = m_DrawType::Text;
+	m_bSelectTool = FALSE;
+	ClearSelection();
+	m_traceRecorder.RecordValue(InputTraceEventType::SetTool, static_cast<DWORD>(m_DrawType));
 	// TODO: 在此添加命令处理程序代码
 }
 
@@ -491,21 +670,24 @@ BOOL CMFCdrawView::PreTranslateMessage(MSG* pMsg)
 			m_Edit->GetWindowTextW(pStr);
 			assert(m_Edit != nullptr);
 			
+			m_traceRecorder.RecordText(m_TextPos, pStr);
 			CClientDC dc(this);
+			OnPrepareDC(&dc);
 			dc.TextOutW(m_TextPos.x, m_TextPos.y, pStr);
 			
 			// 创建文本命令
 			DrawData data;
 			data.drawType = DrawData::DrawType::Text;
 			data.pointBegin = m_TextPos;
-			data.textContent = pStr;
-			data.penColor = m_PenColor;
 			data.penSize = m_PenSize;
 			
 			CMFCdrawDoc* pDoc = GetDocument();
 			if (pDoc != nullptr)
 			{
-				CDrawCommand* pCommand = new CTextCommand(data);
+				// 文本存入文档的字符串池，命令与池共享同一份字符串
+				data.SetPenColor(pDoc->GetColorPalette(), m_PenColor);
+				data.nTextId = pDoc->InternText(pStr);
+				CDrawCommand* pCommand = CreateDrawCommand(data, pDoc->GetStringPool());
 				pDoc->AddCommand(pCommand);
 			}
 			
@@ -530,6 +712,9 @@ void CMFCdrawView::OnSetPencil()
 {
 	// TODO: 在此添加命令处理程序代码
 	m_DrawType = m_DrawType::Pencil;
+	m_bSelectTool = FALSE;
+	ClearSelection();
+	m_traceRecorder.RecordValue(InputTraceEventType::SetTool, static_cast<DWORD>(m_DrawType));
 }
 
 
@@ -537,15 +722,19 @@ void CMFCdrawView::OnSetEraser()
 {
 	// TODO: 在此添加命令处理程序代码
 	m_DrawType = m_DrawType::Eraser;
+	m_bSelectTool = FALSE;
+	ClearSelection();
+	m_traceRecorder.RecordValue(InputTraceEventType::SetTool, static_cast<DWORD>(m_DrawType));
 }
 
 
 void CMFCdrawView::OnFileOpen()
 {
+	PROFILE_FUNCTION();
 	// TODO: 在此添加命令处理程序代码
 	CString filter, strPath;
 
-	filter = "bmp图片(*.bmp)|*.bmp||";
+	filter = "MFC _draw 文件(*.mfd)|*.mfd|bmp图片(*.bmp)|*.bmp||";
 	CFileDialog dlg(TRUE, NULL, NULL, OFN_HIDEREADONLY, filter);
 	//打开文件对应的名
 	if (dlg.DoModal() == IDOK)
@@ -554,6 +743,15 @@ void CMFCdrawView::OnFileOpen()
 		strPath = dlg.GetPathName();//检查是否获取文件路径
 
 	}
+	if (strPath.IsEmpty())
+		return;
+
+	// 文档文件交给文档模板打开，位图文件仍然直接画到窗口上
+	if (dlg.GetFileExt().CompareNoCase(_T("mfd")) == 0)
+	{
+		AfxGetApp()->OpenDocumentFile(strPath);
+		return;
+	}
 
 	HBITMAP hBitmap = (HBITMAP)::LoadImage(
 		NULL,
@@ -591,43 +789,14 @@ void CMFCdrawView::OnFileOpen()
 }
 
 
-void CMFCdrawView::OnFileSave()
+BOOL CMFCdrawView::PromptImageFilePath(CString& strPath)
 {
-	// TODO: 在此添加命令处理程序代码
-	CClientDC dc(this);
-	CRect rect;
-
-
-	BOOL  showMsgTag;
-	//是否要弹出”图像保存成功对话框" 
-
-	GetClientRect(&rect);                  //获取窗口区域大小    
-	HBITMAP hbitmap = CreateCompatibleBitmap(dc, rect.right - rect.left, rect.bottom - rect.top);
-	//创建与设备环境兼容位图  
-
-	HDC hdc = CreateCompatibleDC(dc);      //创建兼容DC，以便将图像保存为不同的格式   
-
-	HBITMAP hOldMap = (HBITMAP)SelectObject(hdc, hbitmap);  //将位图选入DC，并保存返回值   
-
-	BitBlt(hdc, 0, 0, rect.right - rect.left, rect.bottom - rect.top, dc, 0, 0, SRCCOPY);
-	//将屏幕DC的图像复制到内存DC中   
-
-	CImage image;
-	image.Attach(hbitmap);
-
-
-	//将位图转化为一般图像     
-
-
-
-
-	showMsgTag = TRUE;
-	CString  strFilter = _T("位图文件(*.bmp)|*.bmp|JPEG 图像文件|*.jpg|GIF图像文件 | *.gif | PNG图像文件 | *.png | 其他格式 * .*) | *.* || ");
+	CString  strFilter = _T("位图文件(*.bmp)|*.bmp|JPEG 图像文件|*.jpg|GIF图像文件 | *.gif | PNG图像文件 | *.png |SVG 矢量图形(*.svg)|*.svg| 其他格式 * .*) | *.* || ");
 
 	CFileDialog dlg(FALSE, _T("bmp"), _T("iPaint1.bmp"), NULL, strFilter);//创建文件对话框
 
 	if (dlg.DoModal() != IDOK)//如果用户没有选择，则返回
-		return;
+		return FALSE;
 	CString strFileName;          //如果用户没有指定文件扩展名，则为其添加一个  
 
 	CString strExtension;
@@ -636,8 +805,7 @@ void CMFCdrawView::OnFileSave()
 
 
 	strFileName = dlg.m_ofn.lpstrFile;
-
-	if (dlg.m_ofn.nFileExtension = 0)               //扩展名项目为0    
+	if (dlg.m_ofn.nFileExtension == 0)               //扩展名项目为0    
 	{
 		switch (dlg.m_ofn.nFilterIndex)// 根据过滤器索引确定文件类型
 		{
@@ -649,29 +817,130 @@ void CMFCdrawView::OnFileSave()
 			strExtension = "gif"; break;
 		case 4:
 			strExtension = "png"; break;
+		case 5:
+			strExtension = "svg"; break;
 		default:
 			break;
 		}
 		strFileName = strFileName + "." + strExtension;// 添加正确的文件扩展名
 	}
-	CString saveFilePath = strFileName;     // 保存文件路径
+	strPath = strFileName;     // 保存文件路径
+	return TRUE;
+}
 
+void CMFCdrawView::OnFileSave()
+{
+	PROFILE_FUNCTION();
+	// TODO: 在此添加命令处理程序代码
+	CMainFrame* pFrame = DYNAMIC_DOWNCAST(CMainFrame, AfxGetMainWnd());
+	CMFCdrawDoc* pDoc = GetDocument();
+	if (pFrame == nullptr || pDoc == nullptr)
+		return;
+
+	CBackgroundSaver& saver = pFrame->GetBackgroundSaver();
+	if (saver.IsBusy())
+	{
+		MessageBox(_T("上一次保存尚未完成，请稍后再试。"));
+		return;
+	}
 
+	CRect rect;
+	GetClientRect(&rect);                  //获取窗口区域大小    
 
-	HRESULT hResult = image.Save(saveFilePath);     //保存图像    
-	if (FAILED(hResult))
+	CString saveFilePath;
+	if (!PromptImageFilePath(saveFilePath))
+		return;
+
+	// 界面线程只获取文档快照（O(1)）并启动工作线程，
+	// 渲染和编码在后台进行，进度和结果显示在状态栏中，期间可以继续编辑
+	LARGE_INTEGER requestTime;
+	QueryPerformanceCounter(&requestTime);
+
+	// 保存屏幕上看到的内容：缩放和平移后可见的文档区域，按窗口大小输出
+	if (!saver.Start(pDoc->GetSnapshot(), m_viewport.GetVisibleDocRect(rect.Size()), rect.Size(), ::GetSysColor(COLOR_WINDOW),
+		saveFilePath, pFrame->GetSafeHwnd(), requestTime.QuadPart))
 	{
 		MessageBox(_T("保存图像文件失败！"));
 	}
-	else
+}
+
+void CMFCdrawView::OnFileExportImage()
+{
+	PROFILE_FUNCTION();
+	CMainFrame* pFrame = DYNAMIC_DOWNCAST(CMainFrame, AfxGetMainWnd());
+	CMFCdrawDoc* pDoc = GetDocument();
+	if (pFrame == nullptr || pDoc == nullptr)
+		return;
+
+	CBackgroundSaver& saver = pFrame->GetBackgroundSaver();
+	if (saver.IsBusy())
 	{
-		if (showMsgTag)
-			MessageBox(_T("文件保存成功！"));
+		MessageBox(_T("上一次保存尚未完成，请稍后再试。"));
+		return;
+	}
+
+	// 导出整个文档，与窗口大小无关；快照在选择参数之前获取，导出内容与显示的默认尺寸一致
+	CDocumentSnapshot snapshot = pDoc->GetSnapshot();
+	CRect rectExtent = snapshot.GetExtent();
+	if (rectExtent.IsRectEmpty())
+	{
+		MessageBox(_T("文档为空，没有可导出的内容。"));
+		return;
 	}
-	image.Detach();//从Cimage对象分离位图
-	SelectObject(hdc, hOldMap);//恢复原来的位图对象
 
+	CExportImageDialog dlgExport(rectExtent.Size());
+	if (dlgExport.DoModal() != IDOK)
+		return;
+
+	CString exportFilePath;
+	if (!PromptImageFilePath(exportFilePath))
+		return;
+
+	LARGE_INTEGER requestTime;
+	QueryPerformanceCounter(&requestTime);
 
+	if (!saver.Start(snapshot, rectExtent, CSize(dlgExport.m_nWidth, dlgExport.m_nHeight), ::GetSysColor(COLOR_WINDOW),
+		exportFilePath, pFrame->GetSafeHwnd(), requestTime.QuadPart))
+	{
+		MessageBox(_T("导出图像失败！"));
+	}
+}
+
+void CMFCdrawView::OnFileImportRecords()
+{
+	PROFILE_FUNCTION();
+	CMFCdrawDoc* pDoc = GetDocument();
+	if (pDoc == nullptr)
+		return;
+
+	CFileDialog dlg(TRUE, _T("txt"), NULL, OFN_HIDEREADONLY | OFN_FILEMUSTEXIST, _T("绘图记录(*.txt)|*.txt|所有文件(*.*)|*.*||"));
+	if (dlg.DoModal() != IDOK)
+		return;
+
+	// 导入的图形作为一个事务添加，文档结束时以 HINT_REGION_CHANGED 通知视图重绘一次
+	// 记录输入轨迹时文件内容写入轨迹，回放时导入相同的图形
+	CWaitCursor wait;
+	size_t nImported = 0;
+	size_t nErrorLine = 0;
+	std::string records;
+	BOOL bSucceeded = pDoc->ImportDrawRecords(dlg.GetPathName(), nImported, nErrorLine,
+		m_traceRecorder.IsRecording() ? &records : nullptr);
+	if (nImported > 0)
+		m_traceRecorder.RecordImport(std::move(records));
+
+	CString strMessage;
+	if (bSucceeded)
+		strMessage.Format(_T("已导入 %d 个图形"), static_cast<int>(nImported));
+	else if (nErrorLine == 0)
+		strMessage = _T("无法打开绘图记录文件！");
+	else
+		strMessage.Format(_T("第 %d 行格式错误，已导入之前的 %d 个图形"), static_cast<int>(nErrorLine), static_cast<int>(nImported));
+
+	CMainFrame* pFrame = DYNAMIC_DOWNCAST(CMainFrame, AfxGetMainWnd());
+	if (bSucceeded && pFrame != nullptr)
+		pFrame->SetMessageText(strMessage);
+	else if (!bSucceeded)
+		MessageBox(strMessage);
 }
 
 
@@ -682,26 +951,79 @@ void CMFCdrawView::OnPen()
 
 void CMFCdrawView::OnEditUndo()
 {
+	PROFILE_FUNCTION();
 	CMFCdrawDoc* pDoc = GetDocument();
 	if (pDoc == nullptr) return;
 	
-	if (pDoc->Undo())
+	m_traceRecorder.RecordValue(InputTraceEventType::Undo);
+	CRect rectChanged;
+	if (pDoc->Undo(&rectChanged))
 	{
-		Invalidate();  // 重绘视图
+		// 找到的和选中的命令可能已被撤销
+		ClearFoundHighlight();
+		ClearSelection();
+		InvalidateDocRect(rectChanged);  // 只有撤销的命令覆盖的块需要从头重放
 	}
 }
 
 void CMFCdrawView::OnEditRedo()
 {
+	PROFILE_FUNCTION();
 	CMFCdrawDoc* pDoc = GetDocument();
 	if (pDoc == nullptr) return;
 	
-	if (pDoc->Redo())
+	m_traceRecorder.RecordValue(InputTraceEventType::Redo);
+	CRect rectChanged;
+	if (pDoc->Redo(&rectChanged))
+	{
+		// 重做的移动或缩放会改变已绘内容，同样只重绘变化的区域
+		ClearSelection();
+		InvalidateDocRect(rectChanged);
+	}
+}
+
+void CMFCdrawView::SwitchBranch(BOOL bNext)
+{
+	PROFILE_FUNCTION();
+	CMFCdrawDoc* pDoc = GetDocument();
+	if (pDoc == nullptr) return;
+
+	m_traceRecorder.RecordValue(InputTraceEventType::SwitchBranch, bNext ? 1 : 0);
+	CRect rectChanged;
+	if (!pDoc->SwitchBranch(bNext, &rectChanged))
+		return;
+
+	// 两个分支共同的部分不变，只重绘不同的步骤覆盖的区域
+	ClearFoundHighlight();
+	ClearSelection();
+	InvalidateDocRect(rectChanged);
+
+	size_t nBranch, nBranches;
+	CMainFrame* pFrame = DYNAMIC_DOWNCAST(CMainFrame, AfxGetMainWnd());
+	if (pFrame != nullptr && pDoc->GetBranchPosition(nBranch, nBranches))
 	{
-		Invalidate();  // 重绘视图
+		CString strMessage;
+		strMessage.Format(_T("撤消分支 %d / %d"), static_cast<int>(nBranch), static_cast<int>(nBranches));
+		pFrame->SetMessageText(strMessage);
 	}
 }
 
+void CMFCdrawView::OnEditPrevBranch()
+{
+	SwitchBranch(FALSE);
+}
+
+void CMFCdrawView::OnEditNextBranch()
+{
+	SwitchBranch(TRUE);
+}
+
+void CMFCdrawView::OnUpdateEditSwitchBranch(CCmdUI* pCmdUI)
+{
+	CMFCdrawDoc* pDoc = GetDocument();
+	pCmdUI->Enable(pDoc != nullptr && pDoc->CanSwitchBranch());
+}
+
 void CMFCdrawView::OnUpdateEditUndo(CCmdUI* pCmdUI)
 {
 	CMFCdrawDoc* pDoc = GetDocument();
@@ -727,3 +1049,425 @@ void CMFCdrawView::OnUpdateEditRedo(CCmdUI* pCmdUI)
 		pCmdUI->Enable(FALSE);
 	}
 }
+
+void CMFCdrawView::OnEditFind()
+{
+	PROFILE_FUNCTION();
+	CFindTextDialog dlgFind(m_strFindText);
+	if (dlgFind.DoModal() != IDOK || dlgFind.m_strText.IsEmpty())
+		return;
+
+	// 新的查找从第一个匹配开始
+	m_strFindText = dlgFind.m_strText;
+	m_nFoundCommand = NO_FOUND_COMMAND;
+	FindNextText();
+}
+
+void CMFCdrawView::OnEditFindNext()
+{
+	PROFILE_FUNCTION();
+	if (m_strFindText.IsEmpty())
+	{
+		OnEditFind();
+		return;
+	}
+	FindNextText();
+}
+
+void CMFCdrawView::OnFileRecordTrace()
+{
+	CMainFrame* pFrame = DYNAMIC_DOWNCAST(CMainFrame, AfxGetMainWnd());
+
+	if (!m_traceRecorder.IsRecording())
+	{
+		// 先记录当前的工具和画笔设置，回放时从相同的状态开始
+		m_traceRecorder.Start();
+		m_bClipboardInTrace = FALSE;
+		m_traceRecorder.RecordValue(InputTraceEventType::SetTool, static_cast<DWORD>(m_DrawType));
+		m_traceRecorder.RecordValue(InputTraceEventType::SetPenSize, static_cast<DWORD>(m_PenSize));
+		m_traceRecorder.RecordValue(InputTraceEventType::SetPenColor, m_PenColor);
+		m_traceRecorder.RecordValue(InputTraceEventType::SetBrushColor, m_BrushColor);
+		if (pFrame != nullptr)
+			pFrame->SetMessageText(_T("正在记录输入轨迹，再次选择“记录输入轨迹”停止并保存"));
+		return;
+	}
+	StopTraceRecording();
+}
+
+void CMFCdrawView::StopTraceRecording()
+{
+	CMainFrame* pFrame = DYNAMIC_DOWNCAST(CMainFrame, AfxGetMainWnd());
+	m_traceRecorder.Stop();
+	CFileDialog dlg(FALSE, _T("mftrace"), _T("session.mftrace"), OFN_OVERWRITEPROMPT, _T("输入轨迹(*.mftrace)|*.mftrace||"));
+	if (dlg.DoModal() != IDOK)
+		return;
+
+	const CInputTrace& trace = m_traceRecorder.GetTrace();
+	if (!trace.Save(dlg.GetPathName()))
+	{
+		MessageBox(_T("保存输入轨迹失败！"));
+		return;
+	}
+
+	CString strMessage;
+	strMessage.Format(_T("已保存输入轨迹：%d 个事件，%.1f 秒"), static_cast<int>(trace.GetCount()), trace.GetDuration() / 1e6);
+	if (pFrame != nullptr)
+		pFrame->SetMessageText(strMessage);
+}
+
+void CMFCdrawView::OnUpdateFileRecordTrace(CCmdUI* pCmdUI)
+{
+	pCmdUI->SetCheck(m_traceRecorder.IsRecording());
+}
+
+void CMFCdrawView::FindNextText()
+{
+	CMFCdrawDoc* pDoc = GetDocument();
+	CMainFrame* pFrame = DYNAMIC_DOWNCAST(CMainFrame, AfxGetMainWnd());
+	if (pDoc == nullptr)
+		return;
+
+	// 每次都从索引查询，编辑后结果仍然有效；查询代价只与候选命令数量有关
+	std::vector<size_t> results;
+	pDoc->FindText(m_strFindText, results);
+
+	CString strMessage;
+	if (results.empty())
+	{
+		ClearFoundHighlight();
+		strMessage.Format(_T("找不到“%s”"), (LPCTSTR)m_strFindText);
+	}
+	else
+	{
+		std::vector<size_t>::const_iterator it = results.begin();
+		if (m_nFoundCommand != NO_FOUND_COMMAND)
+		{
+			it = std::upper_bound(results.begin(), results.end(), m_nFoundCommand);
+			if (it == results.end())
+				it = results.begin();
+		}
+
+		// 高亮框画在文本外接矩形外侧，擦除旧框和绘制新框都只需要使这两个区域失效
+		ClearFoundHighlight();
+		m_nFoundCommand = *it;
+		m_rectFound = pDoc->GetCommand(m_nFoundCommand)->GetBounds();
+		m_rectFound.InflateRect(2, 2);
+		if (m_viewport.EnsureVisible(m_rectFound, GetClientSize()))
+		{
+			Invalidate();  // 找到的文本不在窗口中时平移过去
+		}
+		else
+		{
+			CRect rectClient = m_viewport.DocToClient(m_rectFound);
+			rectClient.InflateRect(1, 1);
+			InvalidateRect(&rectClient, FALSE);
+		}
+
+		strMessage.Format(_T("“%s”：第 %d 处，共 %d 处"), (LPCTSTR)m_strFindText,
+			static_cast<int>(it - results.begin()) + 1, static_cast<int>(results.size()));
+	}
+
+	if (pFrame != nullptr)
+		pFrame->SetMessageText(strMessage);
+	else if (results.empty())
+		MessageBox(strMessage);
+}
+
+void CMFCdrawView::ClearFoundHighlight()
+{
+	if (!m_rectFound.IsRectEmpty() && GetSafeHwnd() != nullptr)
+	{
+		CRect rectClient = m_viewport.DocToClient(m_rectFound);
+		rectClient.InflateRect(1, 1);
+		InvalidateRect(&rectClient, FALSE);
+	}
+	m_rectFound.SetRectEmpty();
+	m_nFoundCommand = NO_FOUND_COMMAND;
+}
+
+
+// CMFCdrawView 选择、移动和缩放
+
+void CMFCdrawView::OnEditSelectTool()
+{
+	m_bSelectTool = TRUE;
+}
+
+void CMFCdrawView::OnUpdateEditSelectTool(CCmdUI* pCmdUI)
+{
+	pCmdUI->SetCheck(m_bSelectTool);
+}
+
+void CMFCdrawView::SetSelection(std::vector<size_t>&& selection)
+{
+	CMFCdrawDoc* pDoc = GetDocument();
+	ClearSelection();
+	if (pDoc == nullptr || selection.empty())
+		return;
+
+	m_selection = std::move(selection);
+	for (size_t i : m_selection)
+		m_rectSelection.UnionRect(&m_rectSelection, &pDoc->GetCommand(i)->GetBounds());
+	CRect rectClient = GetSelectionClientRect();
+	InvalidateRect(&rectClient, FALSE);
+}
+
+void CMFCdrawView::ClearSelection()
+{
+	if (!m_rectSelection.IsRectEmpty() && GetSafeHwnd() != nullptr)
+	{
+		// 选择框直接画在屏幕上，不在分块缓冲区中，重绘该处即可擦除
+		CRect rectClient = GetSelectionClientRect();
+		InvalidateRect(&rectClient);
+	}
+	m_selection.clear();
+	m_rectSelection.SetRectEmpty();
+}
+
+CRect CMFCdrawView::GetSelectionClientRect() const
+{
+	CRect rect = m_viewport.DocToClient(m_rectSelection);
+	rect.InflateRect(HANDLE_SIZE, HANDLE_SIZE);
+	return rect;
+}
+
+CRect CMFCdrawView::GetHandleClientRect() const
+{
+	CPoint point = m_viewport.DocToClient(m_rectSelection.BottomRight());
+	return CRect(point.x - HANDLE_SIZE / 2, point.y - HANDLE_SIZE / 2, point.x + HANDLE_SIZE / 2 + 1, point.y + HANDLE_SIZE / 2 + 1);
+}
+
+void CMFCdrawView::DrawSelection(CDC* pDC)
+{
+	if (m_rectSelection.IsRectEmpty() || m_selectDrag == SelectDrag::Move || m_selectDrag == SelectDrag::Scale)
+		return;
+
+	// 选择框和控制点的大小不随缩放变化，在客户区坐标下绘制
+	int nSavedDC = pDC->SaveDC();
+	pDC->SetMapMode(MM_TEXT);
+	pDC->SetWindowOrg(0, 0);
+	pDC->SetViewportOrg(0, 0);
+	CRect rect = m_viewport.DocToClient(m_rectSelection);
+	pDC->DrawFocusRect(&rect);
+	CRect rectHandle = GetHandleClientRect();
+	pDC->FillSolidRect(&rectHandle, RGB(0, 0, 0));
+	pDC->RestoreDC(nSavedDC);
+}
+
+DrawTransform CMFCdrawView::CalcDragTransform(CPoint ptDoc) const
+{
+	DrawTransform transform;
+	if (m_selectDrag == SelectDrag::Move)
+	{
+		transform.offset = ptDoc - m_ptDragStart;
+	}
+	else if (m_selectDrag == SelectDrag::Scale)
+	{
+		// 以选中区域的左上角为不动点，右下角跟随鼠标；不允许缩到零或翻转
+		transform.ptAnchor = m_rectSelection.TopLeft();
+		int nWidth = m_rectSelection.Width();
+		int nHeight = m_rectSelection.Height();
+		if (nWidth > 0)
+			transform.dScaleX = std::max(1, nWidth + ptDoc.x - m_ptDragStart.x) / static_cast<double>(nWidth);
+		if (nHeight > 0)
+			transform.dScaleY = std::max(1, nHeight + ptDoc.y - m_ptDragStart.y) / static_cast<double>(nHeight);
+	}
+	return transform;
+}
+
+void CMFCdrawView::OnSelectButtonDown(CPoint point)
+{
+	CMFCdrawDoc* pDoc = GetDocument();
+	if (pDoc == nullptr || m_bDrawing)
+		return;
+	ClearFoundHighlight();
+
+	CPoint ptDoc = m_viewport.ClientToDoc(point);
+	m_ptDragStart = ptDoc;
+	m_dragTransform = DrawTransform();
+	if (!m_selection.empty() && GetHandleClientRect().PtInRect(point))
+	{
+		m_selectDrag = SelectDrag::Scale;
+	}
+	else if (!m_selection.empty() && m_rectSelection.PtInRect(ptDoc))
+	{
+		m_selectDrag = SelectDrag::Move;
+	}
+	else
+	{
+		// 点中图形时选中它并开始移动，否则开始框选
+		size_t nHit = pDoc->HitTest(ptDoc, SELECT_TOLERANCE / m_viewport.GetZoom());
+		if (nHit != CDocumentModel::NO_COMMAND)
+		{
+			SetSelection(std::vector<size_t>(1, nHit));
+			m_selectDrag = SelectDrag::Move;
+		}
+		else
+		{
+			ClearSelection();
+			m_selectDrag = SelectDrag::Marquee;
+			m_rectMarquee.SetRectEmpty();
+		}
+	}
+
+	if (m_selectDrag != SelectDrag::Marquee)
+	{
+		// 冻结背景并缓存选中的图形；先把选择框擦掉并补画尚未完成的块，背景中才不会留下它们
+		CRect rectSelectionClient = GetSelectionClientRect();
+		InvalidateRect(&rectSelectionClient);
+		UpdateWindow();
+		CRect rectClient;
+		GetClientRect(&rectClient);
+		CClientDC dc(this);
+		try
+		{
+			m_preview.Begin(&dc, rectClient, pDoc->GetModel(), m_selection, m_rectSelection, m_viewport, ::GetSysColor(COLOR_WINDOW));
+		}
+		catch (const CGdiObjectException&)
+		{
+			// 无法分配预览位图时拖动过程中不显示预览，松开后照常提交
+			TRACE(_T("Failed to begin transform preview\n"));
+			m_preview.End();
+		}
+	}
+	m_bDrawing = TRUE;  // 暂停渐进式重绘和视图变化
+	SetCapture();
+}
+
+void CMFCdrawView::OnSelectMouseMove(CPoint point)
+{
+	CClientDC dc(this);
+	if (m_selectDrag == SelectDrag::Marquee)
+	{
+		// 以异或方式画出框选框，再画一次即擦除
+		if (!m_rectMarquee.IsRectEmpty())
+			dc.DrawFocusRect(&m_rectMarquee);
+		m_rectMarquee.SetRect(m_viewport.DocToClient(m_ptDragStart), point);
+		m_rectMarquee.NormalizeRect();
+		if (!m_rectMarquee.IsRectEmpty())
+			dc.DrawFocusRect(&m_rectMarquee);
+		return;
+	}
+
+	m_dragTransform = CalcDragTransform(m_viewport.ClientToDoc(point));
+	if (!m_preview.IsActive())
+		return;
+
+	// 文档坐标中的变换换算到客户区：不动点按视口转换，平移量乘以缩放比例
+	DrawTransform transformClient;
+	transformClient.ptAnchor = m_viewport.DocToClient(m_dragTransform.ptAnchor);
+	transformClient.dScaleX = m_dragTransform.dScaleX;
+	transformClient.dScaleY = m_dragTransform.dScaleY;
+	double dZoom = m_viewport.GetZoom();
+	transformClient.offset = CSize(static_cast<int>(std::lround(m_dragTransform.offset.cx * dZoom)),
+		static_cast<int>(std::lround(m_dragTransform.offset.cy * dZoom)));
+	m_preview.Draw(&dc, transformClient);
+}
+
+void CMFCdrawView::OnSelectButtonUp(CPoint point)
+{
+	CMFCdrawDoc* pDoc = GetDocument();
+	ReleaseCapture();
+	EndDrawing();
+	SelectDrag drag = m_selectDrag;
+	m_selectDrag = SelectDrag::None;
+	if (pDoc == nullptr)
+		return;
+
+	if (drag == SelectDrag::Marquee)
+	{
+		if (!m_rectMarquee.IsRectEmpty())
+		{
+			CClientDC dc(this);
+			dc.DrawFocusRect(&m_rectMarquee);
+		}
+		m_rectMarquee.SetRectEmpty();
+
+		// 从左向右拖动只选中完全框住的图形，从右向左拖动选中与框相交的图形
+		CPoint ptDoc = m_viewport.ClientToDoc(point);
+		CRect rect(m_ptDragStart, ptDoc);
+		rect.NormalizeRect();
+		std::vector<size_t> selection;
+		if (!rect.IsRectEmpty())
+			pDoc->SelectInRect(rect, ptDoc.x >= m_ptDragStart.x, selection);
+		SetSelection(std::move(selection));
+		return;
+	}
+
+	m_dragTransform = CalcDragTransform(m_viewport.ClientToDoc(point));
+	m_preview.End();
+	// 预览只画在变换前后的区域中（背景在其余位置与原内容相同），重绘这两处即可；
+	// 没有变换时预览中的遮挡关系仍可能不同，重绘原来的区域
+	CRect rectChanged;
+	m_traceRecorder.RecordTransform(InputTraceEventType::Transform, m_selection, m_dragTransform);
+	if (!pDoc->TransformCommands(m_selection, m_dragTransform, &rectChanged))
+	{
+		InvalidateDocRect(m_rectSelection);
+	}
+	else
+	{
+		std::vector<size_t> selection(std::move(m_selection));
+		m_rectSelection.SetRectEmpty();
+		SetSelection(std::move(selection));
+	}
+	InvalidateDocRect(rectChanged);
+	CRect rectSelectionClient = GetSelectionClientRect();
+	InvalidateRect(&rectSelectionClient);
+}
+
+void CMFCdrawView::OnEditCopy()
+{
+	CMFCdrawDoc* pDoc = GetDocument();
+	if (pDoc == nullptr || m_selection.empty())
+		return;
+
+	m_clipboard.clear();
+	const CCommandVector& commands = pDoc->GetModel().GetCommands();
+	for (size_t i : m_selection)
+		m_clipboard.push_back(commands[i]);
+	m_pClipboardPalette = pDoc->GetSnapshot().GetSharedColorPalette();
+	m_nPasteCount = 0;
+	m_bClipboardInTrace = m_traceRecorder.IsRecording();
+	m_traceRecorder.RecordTransform(InputTraceEventType::Copy, m_selection, DrawTransform());
+}
+
+void CMFCdrawView::OnEditPaste()
+{
+	PROFILE_FUNCTION();
+	CMFCdrawDoc* pDoc = GetDocument();
+	if (pDoc == nullptr || m_clipboard.empty())
+		return;
+
+	if (m_traceRecorder.IsRecording() && !m_bClipboardInTrace)
+	{
+		MessageBox(_T("剪贴板中的图形在开始记录输入轨迹之前复制，回放时无法重现这次粘贴，输入轨迹到此结束。"));
+		StopTraceRecording();
+	}
+
+	// 所有图形作为一个撤销单元加入，结束事务时统一重绘一次；
+	// 剪贴板中的命令可能来自上一个文档，文本和颜色重新加入当前文档的字符串池和颜色表
+	m_nPasteCount++;
+	DrawTransform transform;
+	transform.offset = CSize(PASTE_OFFSET * m_nPasteCount, PASTE_OFFSET * m_nPasteCount);
+	m_traceRecorder.RecordTransform(InputTraceEventType::Paste, std::vector<size_t>(), transform);
+	const size_t nBefore = pDoc->GetCommandCount();
+	pDoc->PasteCommands(m_clipboard, *m_pClipboardPalette, transform);
+	std::vector<size_t> pasted;
+	pasted.reserve(pDoc->GetCommandCount() - nBefore);
+	for (size_t i = nBefore; i < pDoc->GetCommandCount(); i++)
+		pasted.push_back(i);
+
+	// 粘贴的图形成为新的选择，可以直接拖动
+	m_bSelectTool = TRUE;
+	SetSelection(std::move(pasted));
+}
+
+void CMFCdrawView::OnUpdateEditCopy(CCmdUI* pCmdUI)
+{
+	pCmdUI->Enable(!m_selection.empty());
+}
+
+void CMFCdrawView::OnUpdateEditPaste(CCmdUI* pCmdUI)
+{
+	pCmdUI->Enable(!m_clipboard.empty());
+}
@@ -4,7 +4,13 @@
 
 #pragma once
 
+#include <memory>
 #include <vector>
+#include "InputTrace.h"
+#include "StrokeCapture.h"
+#include "TileCanvas.h"
+#include "TransformPreview.h"
+#include "Viewport.h"
 
 
 class CMFCdrawView : public CView//构造函数实例化时首先调用这个函数
@@ -32,16 +38,104 @@ public:
 	CPoint m_TextPos = CPoint(0, 0);
 	
 	// 用于记录当前操作的临时数据
-	std::vector<CPoint> m_currentPencilPoints;  // 铅笔/橡皮擦的连续点
+	CStrokeCapture m_capture;  // 拖动绘制的采集：点缓冲区和预览画笔在笔画之间重复使用
 	BOOL m_bDrawing;  // 是否正在绘制
+
+	// 使重绘缓冲区失效并重绘（缩放、打开文档等改变全部已绘内容的操作使用）
+	void InvalidateDrawing();
+	// 只重绘文档区域 rectDoc（撤销、移动图形等只改变局部内容的操作使用）
+	void InvalidateDocRect(const CRect& rectDoc);
+
+protected:
+	// 渐进式重绘：命令数量较多时，在分块缓冲区中按时间片重放可见的块，
+	// 每个时间片结束后把控制权交还给消息循环，下一片从各块保存的位置继续
+	static const size_t PROGRESSIVE_REDRAW_THRESHOLD = 5000;  // 启用渐进式重绘的命令数量
+	static const UINT REDRAW_SLICE_MS = 8;  // 每个时间片的时长（毫秒）
+	static const UINT_PTR REDRAW_TIMER_ID = 1;
+
+	CTileCanvas m_canvas;  // 只为有内容的区域分配位图，平移后已完成的块继续使用
+	BOOL m_bRedrawPending;  // 拖动期间暂停了渐进式重绘，拖动结束后继续
+
+	// 结束鼠标拖动（绘制或拖动选中的图形），继续拖动期间暂停的渐进式重绘
+	void EndDrawing();
+
+	// OnDraw 的实际绘制部分；OnDraw 负责记录耗时等指标
+	void DrawDocument(CDC* pDC);
+
+	// 切换到撤销树中的下一个或上一个分支，只重绘两个分支不同的区域
+	void SwitchBranch(BOOL bNext);
+
+	// 弹出保存图像对话框，未指定扩展名时按所选类型补上
+	BOOL PromptImageFilePath(CString& strPath);
+
+	// 查找文本
+	static const size_t NO_FOUND_COMMAND = static_cast<size_t>(-1);
+	CString m_strFindText;  // 上一次查找的内容
+	size_t m_nFoundCommand;  // 当前找到的文本命令序号，没有时为 NO_FOUND_COMMAND
+	CRect m_rectFound;  // 找到的文本命令周围的高亮框，没有时为空
+
+	// 查找序号大于 m_nFoundCommand 的下一个匹配（到末尾后从头开始）并高亮显示
+	void FindNextText();
+	void ClearFoundHighlight();
+
+	// 输入轨迹：记录鼠标和命令事件，保存后可以用 drawbench --trace 无界面回放
+	CInputTraceRecorder m_traceRecorder;
+	BOOL m_bClipboardInTrace;  // 剪贴板中的图形是否在本次记录中复制（否则回放时无法重现粘贴）
+	// 停止记录并保存轨迹
+	void StopTraceRecording();
+
+	// 缩放和平移：屏幕绘制和鼠标坐标都经过 m_viewport 换算，命令中保存的是文档坐标
+	CViewport m_viewport;
+	BOOL m_bPanning;  // 是否正在按住中键平移
+	CPoint m_ptPanLast;  // 平移时上一次的鼠标位置（客户区坐标）
+
+	CSize GetClientSize() const;
+	// 缩放级别变化后重绘，并在状态栏显示缩放比例
+	void OnZoomChanged();
+
+	// 选择工具：点选或框选图形，拖动选中的图形移动，拖动右下角的控制点缩放
+	// 拖动期间由 m_preview 合成画面，松开后作为一步可撤销的操作提交，只重绘变换前后的区域
+	enum class SelectDrag { None, Marquee, Move, Scale };
+	static const int SELECT_TOLERANCE = 3;  // 点选的容差（像素）
+	static const int HANDLE_SIZE = 7;  // 缩放控制点的边长（像素）
+
+	BOOL m_bSelectTool;  // 当前工具是否为选择
+	std::vector<size_t> m_selection;  // 选中的命令序号（递增）
+	CRect m_rectSelection;  // 选中命令外接矩形的并集（文档坐标），没有选中时为空
+	SelectDrag m_selectDrag;
+	CPoint m_ptDragStart;  // 拖动开始时的鼠标位置（文档坐标）
+	CRect m_rectMarquee;  // 屏幕上的框选框（客户区坐标），没有时为空
+	DrawTransform m_dragTransform;  // 拖动中的变换（文档坐标）
+	CTransformPreview m_preview;
+
+	void SetSelection(std::vector<size_t>&& selection);
+	void ClearSelection();
+	// 选择框和缩放控制点（客户区坐标）
+	CRect GetSelectionClientRect() const;
+	CRect GetHandleClientRect() const;
+	// 在客户区坐标下画出选择框和控制点
+	void DrawSelection(CDC* pDC);
+	// 按鼠标位置（文档坐标）计算移动或缩放的变换
+	DrawTransform CalcDragTransform(CPoint ptDoc) const;
+	void OnSelectButtonDown(CPoint point);
+	void OnSelectMouseMove(CPoint point);
+	void OnSelectButtonUp(CPoint point);
+
+	// 复制和粘贴选中的图形：剪贴板与文档共享命令对象（命令不可变），粘贴时生成平移后的新命令
+	static const int PASTE_OFFSET = 10;  // 每次粘贴相对原位置的偏移（文档单位）
+	std::vector<CDrawCommandPtr> m_clipboard;
+	std::shared_ptr<const CColorPalette> m_pClipboardPalette;  // 剪贴板中命令的颜色序号所指的颜色表
+	int m_nPasteCount;  // 本次复制后已粘贴的次数
 // 重写
 public:
 	virtual void OnDraw(CDC* pDC);  // 重写以绘制该视图
 	virtual BOOL PreCreateWindow(CREATESTRUCT& cs);
+	virtual void OnPrepareDC(CDC* pDC, CPrintInfo* pInfo = nullptr);
 protected:
 	virtual BOOL OnPreparePrinting(CPrintInfo* pInfo);
 	virtual void OnBeginPrinting(CDC* pDC, CPrintInfo* pInfo);
 	virtual void OnEndPrinting(CDC* pDC, CPrintInfo* pInfo);
+	virtual void OnUpdate(CView* pSender, LPARAM lHint, CObject* pHint);
 
 // 实现
 public:
@@ -73,11 +167,35 @@ public:
 	afx_msg void OnSetEraser();
 	afx_msg void OnFileOpen();
 	afx_msg void OnFileSave();
+	afx_msg void OnFileExportImage();
+	afx_msg void OnFileImportRecords();
 	afx_msg void OnPen();
 	afx_msg void OnEditUndo();
 	afx_msg void OnEditRedo();
 	afx_msg void OnUpdateEditUndo(CCmdUI* pCmdUI);
 	afx_msg void OnUpdateEditRedo(CCmdUI* pCmdUI);
+	afx_msg void OnEditPrevBranch();
+	afx_msg void OnEditNextBranch();
+	afx_msg void OnUpdateEditSwitchBranch(CCmdUI* pCmdUI);
+	afx_msg void OnEditFind();
+	afx_msg void OnEditFindNext();
+	afx_msg void OnFileRecordTrace();
+	afx_msg void OnUpdateFileRecordTrace(CCmdUI* pCmdUI);
+	afx_msg void OnTimer(UINT_PTR nIDEvent);
+	afx_msg BOOL OnEraseBkgnd(CDC* pDC);
+	afx_msg BOOL OnMouseWheel(UINT nFlags, short zDelta, CPoint pt);
+	afx_msg void OnMButtonDown(UINT nFlags, CPoint point);
+	afx_msg void OnMButtonUp(UINT nFlags, CPoint point);
+	afx_msg void OnViewZoomIn();
+	afx_msg void OnViewZoomOut();
+	afx_msg void OnViewZoomActual();
+	afx_msg void OnViewZoomFit();
+	afx_msg void OnEditSelectTool();
+	afx_msg void OnUpdateEditSelectTool(CCmdUI* pCmdUI);
+	afx_msg void OnEditCopy();
+	afx_msg void OnEditPaste();
+	afx_msg void OnUpdateEditCopy(CCmdUI* pCmdUI);
+	afx_msg void OnUpdateEditPaste(CCmdUI* pCmdUI);
 #ifdef _DEBUG
 	afx_msg LRESULT OnTestGdiWrapper(WPARAM wParam, LPARAM lParam);
 #endif
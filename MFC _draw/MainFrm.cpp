@@ -7,6 +7,11 @@
 #include "MFC _draw.h"
 
 #include "MainFrm.h"
+#include "MFC _drawDoc.h"
+#include "Metrics.h"
+#include "TraceProfiler.h"
+
+#include <fstream>
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
@@ -18,11 +23,25 @@ IMPLEMENT_DYNCREATE(CMainFrame, CFrameWnd)
 
 BEGIN_MESSAGE_MAP(CMainFrame, CFrameWnd)
 	ON_WM_CREATE()
+	ON_MESSAGE(WM_BACKGROUND_SAVE_PROGRESS, &CMainFrame::OnBackgroundSaveProgress)
+	ON_MESSAGE(WM_BACKGROUND_SAVE_DONE, &CMainFrame::OnBackgroundSaveDone)
+	ON_UPDATE_COMMAND_UI(ID_INDICATOR_DRAW_TIME, &CMainFrame::OnUpdateIndicatorDrawTime)
+	ON_UPDATE_COMMAND_UI(ID_INDICATOR_REDRAW, &CMainFrame::OnUpdateIndicatorRedraw)
+	ON_UPDATE_COMMAND_UI(ID_INDICATOR_GDI, &CMainFrame::OnUpdateIndicatorGdi)
+	ON_UPDATE_COMMAND_UI(ID_INDICATOR_MEMORY, &CMainFrame::OnUpdateIndicatorMemory)
+	ON_COMMAND(ID_FILE_PROFILE_TRACE, &CMainFrame::OnFileProfileTrace)
+	ON_UPDATE_COMMAND_UI(ID_FILE_PROFILE_TRACE, &CMainFrame::OnUpdateFileProfileTrace)
+	ON_COMMAND(ID_FILE_SAVE_PROFILE_TRACE, &CMainFrame::OnFileSaveProfileTrace)
+	ON_UPDATE_COMMAND_UI(ID_FILE_SAVE_PROFILE_TRACE, &CMainFrame::OnUpdateFileSaveProfileTrace)
 END_MESSAGE_MAP()
 
 static UINT indicators[] =
 {
 	ID_SEPARATOR,           // 状态行指示器
+	ID_INDICATOR_DRAW_TIME, // 最近一次和 p99 绘制耗时
+	ID_INDICATOR_REDRAW,    // 最近一次绘制重放 / 跳过的命令数
+	ID_INDICATOR_GDI,       // 最近一次绘制创建的 GDI 对象数和进程的 GDI 句柄数
+	ID_INDICATOR_MEMORY,    // 文档占用的内存
 	ID_INDICATOR_CAPS,
 	ID_INDICATOR_NUM,
 	ID_INDICATOR_SCRL,
@@ -94,3 +113,126 @@ void CMainFrame::Dump(CDumpContext& dc) const
 
 // CMainFrame 消息处理程序
 
+LRESULT CMainFrame::OnBackgroundSaveProgress(WPARAM wParam, LPARAM /*lParam*/)
+{
+	CString strText;
+	strText.Format(_T("正在后台保存图像... %d%%"), static_cast<int>(wParam));
+	SetMessageText(strText);
+	return 0;
+}
+
+LRESULT CMainFrame::OnBackgroundSaveDone(WPARAM /*wParam*/, LPARAM lParam)
+{
+	CBackgroundSaveResult* pResult = reinterpret_cast<CBackgroundSaveResult*>(lParam);
+	if (pResult == nullptr)
+		return 0;
+
+	CString strText;
+	if (SUCCEEDED(pResult->hr))
+	{
+		strText.Format(_T("文件保存成功：%s（界面线程停顿 %.2f ms，后台耗时 %.0f ms）"),
+			(LPCTSTR)pResult->strPath, pResult->dStallMs, pResult->dWorkMs);
+	}
+	else
+	{
+		strText.Format(_T("保存图像文件失败：%s"), (LPCTSTR)pResult->strPath);
+	}
+	SetMessageText(strText);
+
+	delete pResult;
+	return 0;
+}
+
+// 性能指标窗格：在空闲时由状态栏更新，读取视图 OnDraw 记录的指标
+
+void CMainFrame::OnUpdateIndicatorDrawTime(CCmdUI* pCmdUI)
+{
+	static CMetricHistogram& s_drawTime = CMetricsRegistry::Instance().GetHistogram(DrawMetrics::DRAW_TIME_US);
+
+	CString strText;
+	if (s_drawTime.GetCount() > 0)
+	{
+		strText.Format(_T("绘制 %.1f ms  p99 %.1f ms"),
+			s_drawTime.GetLast() / 1000.0, s_drawTime.GetPercentile(99) / 1000.0);
+	}
+	pCmdUI->Enable();
+	pCmdUI->SetText(strText);
+}
+
+void CMainFrame::OnUpdateIndicatorRedraw(CCmdUI* pCmdUI)
+{
+	static CMetricCounter& s_replayed = CMetricsRegistry::Instance().GetCounter(DrawMetrics::LAST_DRAW_REPLAYED);
+	static CMetricCounter& s_culled = CMetricsRegistry::Instance().GetCounter(DrawMetrics::LAST_DRAW_CULLED);
+
+	CString strText;
+	strText.Format(_T("重放 %lld  跳过 %lld"), s_replayed.Get(), s_culled.Get());
+	pCmdUI->Enable();
+	pCmdUI->SetText(strText);
+}
+
+void CMainFrame::OnUpdateIndicatorGdi(CCmdUI* pCmdUI)
+{
+	static CMetricCounter& s_created = CMetricsRegistry::Instance().GetCounter(DrawMetrics::LAST_DRAW_GDI_OBJECTS);
+
+	CString strText;
+	strText.Format(_T("GDI 新建 %lld  句柄 %u"), s_created.Get(),
+		static_cast<UINT>(GetGuiResources(GetCurrentProcess(), GR_GDIOBJECTS)));
+	pCmdUI->Enable();
+	pCmdUI->SetText(strText);
+}
+
+void CMainFrame::OnUpdateIndicatorMemory(CCmdUI* pCmdUI)
+{
+	CMFCdrawDoc* pDoc = DYNAMIC_DOWNCAST(CMFCdrawDoc, GetActiveDocument());
+
+	CString strText;
+	if (pDoc != nullptr)
+		strText.Format(_T("文档 %.1f MB"), pDoc->GetMemoryUsage() / (1024.0 * 1024.0));
+	pCmdUI->Enable();
+	pCmdUI->SetText(strText);
+}
+
+// 性能跟踪：记录视图消息处理、文档操作、逐条命令的重放和保存/读取，保存后附在问题报告中
+
+void CMainFrame::OnFileProfileTrace()
+{
+	if (CTraceProfiler::IsEnabled())
+	{
+		CTraceProfiler::Stop();
+		SetMessageText(_T("已停止性能跟踪，选择“保存性能跟踪”保存记录的事件"));
+	}
+	else
+	{
+		CTraceProfiler::Start();
+		SetMessageText(_T("正在记录性能跟踪"));
+	}
+}
+
+void CMainFrame::OnUpdateFileProfileTrace(CCmdUI* pCmdUI)
+{
+	pCmdUI->SetCheck(CTraceProfiler::IsEnabled());
+}
+
+void CMainFrame::OnFileSaveProfileTrace()
+{
+	CFileDialog dlg(FALSE, _T("json"), _T("profile.json"), OFN_OVERWRITEPROMPT, _T("Chrome 跟踪(*.json)|*.json||"));
+	if (dlg.DoModal() != IDOK)
+		return;
+
+	// 可以在记录时保存，转储跳过正在写入的事件
+	std::ofstream file(dlg.GetPathName().GetString(), std::ios::binary | std::ios::trunc);
+	if (!file || !CTraceProfiler::WriteJson(file))
+	{
+		MessageBox(_T("保存性能跟踪失败！"));
+		return;
+	}
+
+	CString strText;
+	strText.Format(_T("已保存性能跟踪：%d 个事件"), static_cast<int>(CTraceProfiler::GetEventCount()));
+	SetMessageText(strText);
+}
+
+void CMainFrame::OnUpdateFileSaveProfileTrace(CCmdUI* pCmdUI)
+{
+	pCmdUI->Enable(CTraceProfiler::GetEventCount() > 0);
+}
@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include "BackgroundSaver.h"
+
 class CMainFrame : public CFrameWnd
 {
 	
@@ -16,6 +18,8 @@ public:
 
 // 操作
 public:
+	// 获取后台保存器
+	CBackgroundSaver& GetBackgroundSaver() { return m_backgroundSaver; }
 
 // 重写
 public:
@@ -33,9 +37,21 @@ protected:  // 控件条嵌入成员
 	CToolBar          m_wndToolBar;
 	CStatusBar        m_wndStatusBar;
 
+	CBackgroundSaver  m_backgroundSaver;  // 后台保存图像
+
 // 生成的消息映射函数
 protected:
 	afx_msg int OnCreate(LPCREATESTRUCT lpCreateStruct);
+	afx_msg LRESULT OnBackgroundSaveProgress(WPARAM wParam, LPARAM lParam);
+	afx_msg LRESULT OnBackgroundSaveDone(WPARAM wParam, LPARAM lParam);
+	afx_msg void OnUpdateIndicatorDrawTime(CCmdUI* pCmdUI);
+	afx_msg void OnUpdateIndicatorRedraw(CCmdUI* pCmdUI);
+	afx_msg void OnUpdateIndicatorGdi(CCmdUI* pCmdUI);
+	afx_msg void OnUpdateIndicatorMemory(CCmdUI* pCmdUI);
+	afx_msg void OnFileProfileTrace();
+	afx_msg void OnUpdateFileProfileTrace(CCmdUI* pCmdUI);
+	afx_msg void OnFileSaveProfileTrace();
+	afx_msg void OnUpdateFileSaveProfileTrace(CCmdUI* pCmdUI);
 	DECLARE_MESSAGE_MAP()
 
 };
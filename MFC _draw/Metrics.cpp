@@ -0,0 +1,109 @@
+// Metrics.cpp: 进程内性能指标的实现
+//
+
+#include "pch.h"
+#include "Metrics.h"
+#include <climits>
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+// CMetricHistogram 实现
+int CMetricHistogram::GetBucketIndex(unsigned long long nValue)
+{
+	if (nValue < SUB_BUCKETS)
+		return static_cast<int>(nValue);
+
+	// 最高有效位的位置（二分查找）
+	int nExponent = 0;
+	for (int nShift = 32; nShift > 0; nShift >>= 1)
+	{
+		if ((nValue >> (nExponent + nShift)) != 0)
+			nExponent += nShift;
+	}
+	int nSubBucket = static_cast<int>(nValue >> (nExponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+	return (nExponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + nSubBucket;
+}
+
+long long CMetricHistogram::GetBucketUpperBound(int nIndex)
+{
+	if (nIndex < SUB_BUCKETS)
+		return nIndex;
+
+	int nShift = nIndex / SUB_BUCKETS - 1;
+	unsigned long long nLower = static_cast<unsigned long long>(SUB_BUCKETS + nIndex % SUB_BUCKETS) << nShift;
+	unsigned long long nUpper = nLower + (1ULL << nShift) - 1;
+	return nUpper > static_cast<unsigned long long>(LLONG_MAX) ? LLONG_MAX : static_cast<long long>(nUpper);
+}
+
+void CMetricHistogram::Record(long long nValue)
+{
+	if (nValue < 0)
+		nValue = 0;
+
+	m_buckets[GetBucketIndex(static_cast<unsigned long long>(nValue))].fetch_add(1, std::memory_order_relaxed);
+	m_nCount.fetch_add(1, std::memory_order_relaxed);
+	m_nSum.fetch_add(nValue, std::memory_order_relaxed);
+	m_nLast.store(nValue, std::memory_order_relaxed);
+
+	long long nMax = m_nMax.load(std::memory_order_relaxed);
+	while (nValue > nMax && !m_nMax.compare_exchange_weak(nMax, nValue, std::memory_order_relaxed))
+	{
+	}
+}
+
+void CMetricHistogram::Reset()
+{
+	for (std::atomic<long long>& bucket : m_buckets)
+		bucket.store(0, std::memory_order_relaxed);
+	m_nCount.store(0, std::memory_order_relaxed);
+	m_nSum.store(0, std::memory_order_relaxed);
+	m_nMax.store(0, std::memory_order_relaxed);
+	m_nLast.store(0, std::memory_order_relaxed);
+}
+
+long long CMetricHistogram::GetPercentile(double dPercentile) const
+{
+	long long nCount = GetCount();
+	if (nCount <= 0)
+		return 0;
+
+	// 第 nRank 个样本（从 1 开始）所在的桶
+	long long nRank = static_cast<long long>(dPercentile / 100.0 * nCount + 0.5);
+	nRank = max(1LL, min(nRank, nCount));
+
+	long long nSeen = 0;
+	for (int i = 0; i < BUCKET_COUNT; i++)
+	{
+		nSeen += m_buckets[i].load(std::memory_order_relaxed);
+		if (nSeen >= nRank)
+			return min(GetBucketUpperBound(i), GetMax());
+	}
+	return GetMax();
+}
+
+// CMetricsRegistry 实现
+CMetricsRegistry& CMetricsRegistry::Instance()
+{
+	static CMetricsRegistry s_registry;
+	return s_registry;
+}
+
+CMetricCounter& CMetricsRegistry::GetCounter(const char* pszName)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::unique_ptr<CMetricCounter>& pCounter = m_counters[pszName];
+	if (!pCounter)
+		pCounter.reset(new CMetricCounter);
+	return *pCounter;
+}
+
+CMetricHistogram& CMetricsRegistry::GetHistogram(const char* pszName)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::unique_ptr<CMetricHistogram>& pHistogram = m_histograms[pszName];
+	if (!pHistogram)
+		pHistogram.reset(new CMetricHistogram);
+	return *pHistogram;
+}
@@ -0,0 +1,104 @@
+// Metrics.h: 进程内的性能指标
+// 计数器和直方图在首次使用时按名称注册，之后由调用方保存引用直接更新：
+// 更新只是几次原子操作，不加锁、不分配内存，可以放在绘制等频繁执行的路径上。
+// 状态栏和基准测试按名称读取。
+//
+
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// 计数器：累加值，也可以直接设置（用作最近一次的取值）
+class CMetricCounter
+{
+private:
+	std::atomic<long long> m_nValue;
+
+	// 禁止拷贝构造和赋值
+	CMetricCounter(const CMetricCounter&) = delete;
+	CMetricCounter& operator=(const CMetricCounter&) = delete;
+
+public:
+	CMetricCounter() : m_nValue(0) {}
+
+	void Add(long long nDelta = 1) { m_nValue.fetch_add(nDelta, std::memory_order_relaxed); }
+	void Set(long long nValue) { m_nValue.store(nValue, std::memory_order_relaxed); }
+	long long Get() const { return m_nValue.load(std::memory_order_relaxed); }
+};
+
+// 直方图：非负整数样本（如微秒）按对数分桶，每个 2 的幂区间再等分为 SUB_BUCKETS 个桶，
+// 百分位数的相对误差不超过 1/SUB_BUCKETS
+class CMetricHistogram
+{
+private:
+	static const int SUB_BUCKET_BITS = 3;
+	static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+	static const int BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+	std::atomic<long long> m_buckets[BUCKET_COUNT];
+	std::atomic<long long> m_nCount;
+	std::atomic<long long> m_nSum;
+	std::atomic<long long> m_nMax;
+	std::atomic<long long> m_nLast;
+
+	// 禁止拷贝构造和赋值
+	CMetricHistogram(const CMetricHistogram&) = delete;
+	CMetricHistogram& operator=(const CMetricHistogram&) = delete;
+
+	static int GetBucketIndex(unsigned long long nValue);
+	// 桶中样本的上限（包含）
+	static long long GetBucketUpperBound(int nIndex);
+
+public:
+	CMetricHistogram() { Reset(); }
+
+	// 记录一个样本，负数按 0 记录
+	void Record(long long nValue);
+	// 清除所有样本（与 Record 同时调用时结果可能不完整）
+	void Reset();
+
+	long long GetCount() const { return m_nCount.load(std::memory_order_relaxed); }
+	long long GetSum() const { return m_nSum.load(std::memory_order_relaxed); }
+	long long GetMax() const { return m_nMax.load(std::memory_order_relaxed); }
+	// 最近一次记录的样本
+	long long GetLast() const { return m_nLast.load(std::memory_order_relaxed); }
+	// 百分位数（dPercentile 为 0~100），返回所在桶的上限，不超过最大值；没有样本时返回 0
+	long long GetPercentile(double dPercentile) const;
+};
+
+// 指标注册表：按名称保存进程中的所有指标，注册后的对象在进程结束前不会移动或删除
+class CMetricsRegistry
+{
+private:
+	std::mutex m_mutex;
+	std::map<std::string, std::unique_ptr<CMetricCounter>> m_counters;
+	std::map<std::string, std::unique_ptr<CMetricHistogram>> m_histograms;
+
+	CMetricsRegistry() {}
+	CMetricsRegistry(const CMetricsRegistry&) = delete;
+	CMetricsRegistry& operator=(const CMetricsRegistry&) = delete;
+
+public:
+	static CMetricsRegistry& Instance();
+
+	// 获取名称为 pszName 的指标，不存在时创建；频繁调用的地方应保存返回的引用
+	CMetricCounter& GetCounter(const char* pszName);
+	CMetricHistogram& GetHistogram(const char* pszName);
+};
+
+// 绘图程序使用的指标名称
+namespace DrawMetrics
+{
+	const char* const DRAW_TIME_US = "view.draw_time_us";               // 直方图：OnDraw 耗时（微秒）
+	const char* const COMMANDS_REPLAYED = "redraw.commands_replayed";   // 累计重放的命令数
+	const char* const COMMANDS_CULLED = "redraw.commands_culled";       // 累计因不在裁剪区域内而跳过的命令数
+	const char* const GDI_OBJECTS_CREATED = "gdi.objects_created";      // 累计由 RAII 包装类创建的 GDI 对象数
+	const char* const LAST_DRAW_REPLAYED = "view.last_draw_replayed";   // 最近一次 OnDraw 重放的命令数
+	const char* const LAST_DRAW_CULLED = "view.last_draw_culled";       // 最近一次 OnDraw 跳过的命令数
+	const char* const LAST_DRAW_GDI_OBJECTS = "view.last_draw_gdi_objects";  // 最近一次 OnDraw 创建的 GDI 对象数
+	const char* const MOUSE_MOVE_ALLOCATIONS = "input.mouse_move_allocations";  // 累计拖动时鼠标移动处理中的堆分配次数（安装了分配钩子时）
+}
@@ -0,0 +1,143 @@
+// OffscreenExporter.cpp: 离屏分带导出的实现
+//
+
+#include "pch.h"
+#include "OffscreenExporter.h"
+#include "GdiObjectWrapper.h"
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+static bool RectsOverlap(const CRect& a, const CRect& b)
+{
+	return a.left < b.right && b.left < a.right && a.top < b.bottom && b.top < a.bottom;
+}
+
+// COffscreenExporter 实现
+COffscreenExporter::COffscreenExporter(const CDocumentSnapshot& snapshot, const CRect& rectSource, CSize sizeOutput, COLORREF bkColor)
+	: m_snapshot(snapshot), m_rectSource(rectSource), m_sizeOutput(sizeOutput), m_bkColor(bkColor)
+{
+}
+
+BOOL COffscreenExporter::Export(IImageRowSink& sink, const std::function<void(int)>& onProgress) const
+{
+	const int nWidth = m_sizeOutput.cx;
+	const int nHeight = m_sizeOutput.cy;
+	if (nWidth <= 0 || nHeight <= 0 || m_rectSource.IsRectEmpty())
+		return FALSE;
+
+	const int nBandHeight = static_cast<int>(min(static_cast<LONGLONG>(nHeight), max(1LL, BAND_BYTES / (4LL * nWidth))));
+	const int nStride = nWidth * 4;
+	const BOOL bScaled = m_rectSource.Size() != m_sizeOutput;
+
+	try
+	{
+		BITMAPINFO bmi;
+		ZeroMemory(&bmi, sizeof(bmi));
+		bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+		bmi.bmiHeader.biWidth = nWidth;
+		bmi.bmiHeader.biHeight = -nBandHeight;  // 自上而下，行顺序与 IImageRowSink 一致
+		bmi.bmiHeader.biPlanes = 1;
+		bmi.bmiHeader.biBitCount = 32;
+		bmi.bmiHeader.biCompression = BI_RGB;
+
+		void* pBits = nullptr;
+		HBITMAP hBitmap = CreateDIBSection(nullptr, &bmi, DIB_RGB_COLORS, &pBits, nullptr, 0);
+		if (hBitmap == nullptr)
+		{
+			throw CGdiObjectException(_T("Failed to create band DIB section"));
+		}
+		CBitmapWrapper bitmap(hBitmap, TRUE);
+
+		HDC hMemDC = CreateCompatibleDC(nullptr);
+		if (hMemDC == nullptr)
+		{
+			throw CGdiObjectException(_T("Failed to create memory DC"));
+		}
+		CDCWrapper memDC(hMemDC, TRUE);
+
+		if (!sink.Begin(nWidth, nHeight))
+			return FALSE;
+
+		HGDIOBJ hOldBitmap = SelectObject(memDC, bitmap.Get());
+		CDC* pDC = CDC::FromHandle(memDC);
+		BOOL bResult = TRUE;
+
+		for (int nTop = 0; nTop < nHeight && bResult; nTop += nBandHeight)
+		{
+			int nRows = min(nBandHeight, nHeight - nTop);
+
+			// 清空条带（同时把背景色设为 m_bkColor，橡皮擦使用背景色绘制）
+			pDC->SetMapMode(MM_TEXT);
+			pDC->SetWindowOrg(0, 0);
+			pDC->SetViewportOrg(0, 0);
+			pDC->FillSolidRect(0, 0, nWidth, nBandHeight, m_bkColor);
+
+			// 把文档区域映射到整幅输出图像，再把视口上移到当前条带
+			if (bScaled)
+			{
+				pDC->SetMapMode(MM_ANISOTROPIC);
+				pDC->SetWindowOrg(m_rectSource.left, m_rectSource.top);
+				pDC->SetWindowExt(m_rectSource.Width(), m_rectSource.Height());
+				pDC->SetViewportExt(nWidth, nHeight);
+				pDC->SetViewportOrg(0, -nTop);
+			}
+			else
+			{
+				pDC->SetViewportOrg(-m_rectSource.left, -m_rectSource.top - nTop);
+			}
+
+			// 条带对应的文档区域，只重放与之相交的命令
+			CRect rectBand(m_rectSource.left,
+				m_rectSource.top + MulDiv(nTop, m_rectSource.Height(), nHeight) - 1,
+				m_rectSource.right,
+				m_rectSource.top + MulDiv(nTop + nRows, m_rectSource.Height(), nHeight) + 1);
+			for (const CDrawCommandPtr& cmd : m_snapshot.GetCommands())
+			{
+				if (RectsOverlap(cmd->GetBounds(), rectBand))
+					cmd->Execute(pDC, m_snapshot.GetColorPalette());
+			}
+
+			GdiFlush();
+			bResult = sink.WriteRows(static_cast<const uint8_t*>(pBits), nRows, nStride);
+
+			if (onProgress)
+				onProgress(static_cast<int>((nTop + nRows) * 100LL / nHeight));
+		}
+
+		SelectObject(memDC, hOldBitmap);
+		return bResult && sink.End();
+	}
+	catch (const CGdiObjectException&)
+	{
+		TRACE(_T("Failed to render export band\n"));
+		return FALSE;
+	}
+}
+
+// CImageRowSink 实现
+bool CImageRowSink::Begin(int nWidth, int nHeight)
+{
+	m_image.Destroy();
+	m_nNextRow = 0;
+	return m_image.Create(nWidth, -nHeight, 32) != FALSE;
+}
+
+bool CImageRowSink::WriteRows(const uint8_t* pPixels, int nRows, int nStride)
+{
+	if (m_nNextRow + nRows > m_image.GetHeight())
+		return false;
+
+	size_t nRowBytes = static_cast<size_t>(m_image.GetWidth()) * 4;
+	for (int i = 0; i < nRows; i++)
+	{
+		memcpy(m_image.GetPixelAddress(0, m_nNextRow++), pPixels + static_cast<ptrdiff_t>(i) * nStride, nRowBytes);
+	}
+	return true;
+}
+
+bool CImageRowSink::End()
+{
+	return m_nNextRow == m_image.GetHeight();
+}
@@ -0,0 +1,48 @@
+// OffscreenExporter.h: 离屏分带导出
+// 按任意输出尺寸渲染文档快照，不依赖窗口大小。输出图像被分成若干水平条带，
+// 每次只渲染一条带到固定大小的 DIB 中，再交给 IImageRowSink，峰值内存与输出高度无关。
+//
+
+#pragma once
+
+#include <afxwin.h>
+#include <atlimage.h>
+#include <functional>
+#include "CommandHistory.h"
+#include "ImageWriter.h"
+
+class COffscreenExporter
+{
+private:
+	static const LONGLONG BAND_BYTES = 16 * 1024 * 1024;  // 每条带 DIB 的最大字节数
+
+	CDocumentSnapshot m_snapshot;
+	CRect m_rectSource;   // 要导出的文档区域（逻辑坐标）
+	CSize m_sizeOutput;   // 输出图像大小（像素）
+	COLORREF m_bkColor;
+
+public:
+	COffscreenExporter(const CDocumentSnapshot& snapshot, const CRect& rectSource, CSize sizeOutput, COLORREF bkColor);
+
+	// 逐条带渲染并写入 sink；onProgress 接收 0~100 的渲染进度（可以为空）
+	BOOL Export(IImageRowSink& sink, const std::function<void(int)>& onProgress = nullptr) const;
+};
+
+// 把行数据收集到 CImage 中，用于没有流式写入器的格式（JPEG、GIF 等）
+// 整幅图像都在内存中，大尺寸导出应优先使用流式写入器。
+class CImageRowSink : public IImageRowSink
+{
+private:
+	CImage m_image;
+	int m_nNextRow;
+
+public:
+	CImageRowSink() : m_nNextRow(0) {}
+
+	bool Begin(int nWidth, int nHeight) override;
+	bool WriteRows(const uint8_t* pPixels, int nRows, int nStride) override;
+	bool End() override;
+
+	// 按扩展名决定的格式保存
+	HRESULT Save(const CString& strPath) { return m_image.Save(strPath); }
+};
@@ -0,0 +1,321 @@
+// PersistentVector.h: 结构共享的持久化向量
+// 设计：32 叉前缀树 + 尾块（与 Clojure 的 PersistentVector 相同的布局）
+//
+// 复制一个向量只复制根节点和尾块的引用计数指针，是 O(1) 且不分配内存的操作。
+// 修改时只复制被共享的路径上的节点（写时复制）；没有被其他副本引用的节点直接原地修改，
+// 所以在没有快照存在时，追加/弹出与普通数组一样不会产生额外的分配。
+//
+// 线程安全：同一个向量对象只能由一个线程修改；不同的副本可以在不同线程中并发读取和修改。
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+
+template<typename T>
+class CPersistentVector
+{
+private:
+	static const unsigned BITS = 5;
+	static const size_t WIDTH = size_t(1) << BITS;
+	static const size_t MASK = WIDTH - 1;
+
+	struct CNode
+	{
+	};
+
+	// 叶节点：保存 WIDTH 个元素
+	struct CLeaf : public CNode
+	{
+		T items[WIDTH];
+	};
+
+	// 内部节点：保存 WIDTH 个子节点（叶节点或内部节点）
+	struct CBranch : public CNode
+	{
+		std::shared_ptr<CNode> children[WIDTH];
+	};
+
+	std::shared_ptr<CBranch> m_root;  // 树部分的根（元素不超过 WIDTH 个时为空）
+	std::shared_ptr<CLeaf> m_tail;    // 尾块：最后 1~WIDTH 个元素
+	unsigned m_shift;                 // 根节点所在层的位移量
+	size_t m_size;
+
+public:
+	CPersistentVector() : m_shift(BITS), m_size(0) {}
+
+	size_t size() const { return m_size; }
+	bool empty() const { return m_size == 0; }
+
+	const T& operator[](size_t i) const { return LeafFor(i)[i & MASK]; }
+	const T& back() const { return (*this)[m_size - 1]; }
+
+	// 追加元素
+	void push_back(const T& value)
+	{
+		size_t nTailCount = m_size - TailOffset();
+		if (nTailCount < WIDTH)
+		{
+			MakeUnique(m_tail);
+			m_tail->items[nTailCount] = value;
+			m_size++;
+			return;
+		}
+
+		// 尾块已满：把尾块挂到树上，再开始新的尾块
+		std::shared_ptr<CNode> fullTail = std::move(m_tail);
+		if (!m_root)
+		{
+			m_root = std::make_shared<CBranch>();
+			m_root->children[0] = std::move(fullTail);
+		}
+		else if ((m_size >> BITS) > (size_t(1) << m_shift))
+		{
+			// 根节点已满，树增加一层
+			std::shared_ptr<CBranch> newRoot = std::make_shared<CBranch>();
+			newRoot->children[0] = std::move(m_root);
+			newRoot->children[1] = NewPath(m_shift, std::move(fullTail));
+			m_root = std::move(newRoot);
+			m_shift += BITS;
+		}
+		else
+		{
+			PushTail(m_root, m_shift, std::move(fullTail));
+		}
+
+		m_tail = std::make_shared<CLeaf>();
+		m_tail->items[0] = value;
+		m_size++;
+	}
+
+	// 删除最后一个元素
+	void pop_back()
+	{
+		if (m_size == 0)
+			return;
+		if (m_size == 1)
+		{
+			clear();
+			return;
+		}
+
+		size_t nTailCount = m_size - TailOffset();
+		if (nTailCount > 1)
+		{
+			MakeUnique(m_tail);
+			m_tail->items[nTailCount - 1] = T();
+			m_size--;
+			return;
+		}
+
+		// 尾块只剩一个元素：树中最后一个叶节点成为新的尾块
+		std::shared_ptr<CLeaf> newTail = LeafNodeFor(m_size - 2);
+		PopTail(m_root, m_shift);
+		m_size--;
+
+		if (m_size <= WIDTH)
+		{
+			m_root.reset();
+			m_shift = BITS;
+		}
+		else if (m_shift > BITS && !m_root->children[1])
+		{
+			// 根节点只剩一个子节点，树减少一层
+			m_root = std::static_pointer_cast<CBranch>(m_root->children[0]);
+			m_shift -= BITS;
+		}
+		m_tail = std::move(newTail);
+	}
+
+	// 替换第 i 个元素
+	void set(size_t i, const T& value)
+	{
+		if (i >= TailOffset())
+		{
+			MakeUnique(m_tail);
+			m_tail->items[i & MASK] = value;
+			return;
+		}
+		SetInTree(m_root, m_shift, i, value);
+	}
+
+	void clear()
+	{
+		m_root.reset();
+		m_tail.reset();
+		m_shift = BITS;
+		m_size = 0;
+	}
+
+	// 只读前向迭代器：每 WIDTH 个元素才查找一次叶节点
+	class const_iterator
+	{
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef T value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const T* pointer;
+		typedef const T& reference;
+
+		const_iterator() : m_pVector(nullptr), m_nIndex(0), m_pItems(nullptr) {}
+		const_iterator(const CPersistentVector* pVector, size_t nIndex)
+			: m_pVector(pVector), m_nIndex(nIndex), m_pItems(nullptr)
+		{
+			if (m_nIndex < m_pVector->m_size)
+				m_pItems = m_pVector->LeafFor(m_nIndex);
+		}
+
+		reference operator*() const { return m_pItems[m_nIndex & MASK]; }
+		pointer operator->() const { return &m_pItems[m_nIndex & MASK]; }
+
+		const_iterator& operator++()
+		{
+			m_nIndex++;
+			if ((m_nIndex & MASK) == 0 && m_nIndex < m_pVector->m_size)
+				m_pItems = m_pVector->LeafFor(m_nIndex);
+			return *this;
+		}
+		const_iterator operator++(int)
+		{
+			const_iterator old = *this;
+			++*this;
+			return old;
+		}
+
+		bool operator==(const const_iterator& other) const { return m_nIndex == other.m_nIndex; }
+		bool operator!=(const const_iterator& other) const { return m_nIndex != other.m_nIndex; }
+
+		size_t index() const { return m_nIndex; }
+
+	private:
+		const CPersistentVector* m_pVector;
+		size_t m_nIndex;
+		const T* m_pItems;
+	};
+
+	const_iterator begin() const { return const_iterator(this, 0); }
+	const_iterator end() const { return const_iterator(this, m_size); }
+	const_iterator iterator_at(size_t i) const { return const_iterator(this, i < m_size ? i : m_size); }
+
+private:
+	size_t TailOffset() const
+	{
+		return m_size < WIDTH ? 0 : ((m_size - 1) >> BITS) << BITS;
+	}
+
+	// 确保节点只被当前向量引用，否则复制一份（写时复制）
+	template<typename TNode>
+	static void MakeUnique(std::shared_ptr<TNode>& node)
+	{
+		if (!node)
+		{
+			node = std::make_shared<TNode>();
+		}
+		else if (node.use_count() != 1)
+		{
+			node = std::make_shared<TNode>(*node);
+		}
+		else
+		{
+			// 与其他线程释放引用时的写操作同步，之后才能原地修改
+			std::atomic_thread_fence(std::memory_order_acquire);
+		}
+	}
+
+	const T* LeafFor(size_t i) const
+	{
+		if (i >= TailOffset())
+			return m_tail->items;
+
+		const CBranch* pNode = m_root.get();
+		for (unsigned level = m_shift; level > BITS; level -= BITS)
+		{
+			pNode = static_cast<const CBranch*>(pNode->children[(i >> level) & MASK].get());
+		}
+		return static_cast<const CLeaf*>(pNode->children[(i >> BITS) & MASK].get())->items;
+	}
+
+	std::shared_ptr<CLeaf> LeafNodeFor(size_t i) const
+	{
+		const CBranch* pNode = m_root.get();
+		for (unsigned level = m_shift; level > BITS; level -= BITS)
+		{
+			pNode = static_cast<const CBranch*>(pNode->children[(i >> level) & MASK].get());
+		}
+		return std::static_pointer_cast<CLeaf>(pNode->children[(i >> BITS) & MASK]);
+	}
+
+	static std::shared_ptr<CNode> NewPath(unsigned level, std::shared_ptr<CNode> node)
+	{
+		if (level == 0)
+			return node;
+
+		std::shared_ptr<CBranch> branch = std::make_shared<CBranch>();
+		branch->children[0] = NewPath(level - BITS, std::move(node));
+		return branch;
+	}
+
+	void PushTail(std::shared_ptr<CBranch>& node, unsigned level, std::shared_ptr<CNode> tail)
+	{
+		MakeUnique(node);
+		size_t nSub = ((m_size - 1) >> level) & MASK;
+		std::shared_ptr<CNode>& slot = node->children[nSub];
+		if (level == BITS)
+		{
+			slot = std::move(tail);
+		}
+		else if (!slot)
+		{
+			slot = NewPath(level - BITS, std::move(tail));
+		}
+		else
+		{
+			// 先把子节点移出槽位，保持引用计数不变，子节点未被共享时可以原地修改
+			std::shared_ptr<CBranch> child = std::static_pointer_cast<CBranch>(std::move(slot));
+			PushTail(child, level - BITS, std::move(tail));
+			slot = std::move(child);
+		}
+	}
+
+	// 删除树中最后一个叶节点；返回该节点是否因此变为空
+	bool PopTail(std::shared_ptr<CBranch>& node, unsigned level)
+	{
+		MakeUnique(node);
+		size_t nSub = ((m_size - 2) >> level) & MASK;
+		std::shared_ptr<CNode>& slot = node->children[nSub];
+		if (level > BITS)
+		{
+			std::shared_ptr<CBranch> child = std::static_pointer_cast<CBranch>(std::move(slot));
+			if (!PopTail(child, level - BITS))
+			{
+				slot = std::move(child);
+				return false;
+			}
+			return nSub == 0;
+		}
+		slot.reset();
+		return nSub == 0;
+	}
+
+	void SetInTree(std::shared_ptr<CBranch>& node, unsigned level, size_t i, const T& value)
+	{
+		MakeUnique(node);
+		std::shared_ptr<CNode>& slot = node->children[(i >> level) & MASK];
+		if (level == BITS)
+		{
+			std::shared_ptr<CLeaf> leaf = std::static_pointer_cast<CLeaf>(std::move(slot));
+			MakeUnique(leaf);
+			leaf->items[i & MASK] = value;
+			slot = std::move(leaf);
+		}
+		else
+		{
+			std::shared_ptr<CBranch> child = std::static_pointer_cast<CBranch>(std::move(slot));
+			SetInTree(child, level - BITS, i, value);
+			slot = std::move(child);
+		}
+	}
+};
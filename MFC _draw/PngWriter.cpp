@@ -0,0 +1,513 @@
+// PngWriter.cpp: 并行 PNG 写入器的实现
+//
+
+#include "pch.h"
+#include "PngWriter.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+// CRC-32（PNG 块校验）
+static const uint32_t* CrcTable()
+{
+	static uint32_t table[256];
+	static bool bInit = [] {
+		for (uint32_t n = 0; n < 256; n++)
+		{
+			uint32_t c = n;
+			for (int k = 0; k < 8; k++)
+				c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			table[n] = c;
+		}
+		return true;
+	}();
+	(void)bInit;
+	return table;
+}
+
+static uint32_t UpdateCrc(uint32_t nCrc, const uint8_t* pData, size_t nSize)
+{
+	const uint32_t* pTable = CrcTable();
+	nCrc = ~nCrc;
+	for (size_t i = 0; i < nSize; i++)
+		nCrc = pTable[(nCrc ^ pData[i]) & 0xFF] ^ (nCrc >> 8);
+	return ~nCrc;
+}
+
+// Adler-32（zlib 流校验）
+static const uint32_t ADLER_BASE = 65521;
+
+static uint32_t UpdateAdler(uint32_t nAdler, const uint8_t* pData, size_t nSize)
+{
+	uint32_t a = nAdler & 0xFFFF;
+	uint32_t b = nAdler >> 16;
+	while (nSize > 0)
+	{
+		// 5552 是保证 b 不溢出的最大字节数
+		size_t n = std::min<size_t>(nSize, 5552);
+		nSize -= n;
+		while (n-- > 0)
+		{
+			a += *pData++;
+			b += a;
+		}
+		a %= ADLER_BASE;
+		b %= ADLER_BASE;
+	}
+	return (b << 16) | a;
+}
+
+// 由两段数据各自的 Adler-32 计算拼接后的 Adler-32
+static uint32_t CombineAdler(uint32_t nAdler1, uint32_t nAdler2, size_t nSize2)
+{
+	uint32_t nRem = static_cast<uint32_t>(nSize2 % ADLER_BASE);
+	uint32_t a = nAdler1 & 0xFFFF;
+	uint32_t b = static_cast<uint32_t>((static_cast<uint64_t>(nRem) * a) % ADLER_BASE);
+	a += (nAdler2 & 0xFFFF) + ADLER_BASE - 1;
+	b += (nAdler1 >> 16) + (nAdler2 >> 16) + ADLER_BASE - nRem;
+	if (a >= ADLER_BASE) a -= ADLER_BASE;
+	if (a >= ADLER_BASE) a -= ADLER_BASE;
+	if (b >= ADLER_BASE * 2) b -= ADLER_BASE * 2;
+	if (b >= ADLER_BASE) b -= ADLER_BASE;
+	return (b << 16) | a;
+}
+
+static void PutU32BE(uint8_t* p, uint32_t value)
+{
+	p[0] = static_cast<uint8_t>(value >> 24);
+	p[1] = static_cast<uint8_t>(value >> 16);
+	p[2] = static_cast<uint8_t>(value >> 8);
+	p[3] = static_cast<uint8_t>(value);
+}
+
+// 使用固定 Huffman 编码的 deflate 压缩器
+// 绘图内容以大片背景和重复像素为主，LZ77 的长匹配占压缩收益的绝大部分，固定编码表省去了统计和建表的开销。
+class CDeflateEncoder
+{
+private:
+	static const int MIN_MATCH = 3;
+	static const int MAX_MATCH = 258;
+	static const int WINDOW_SIZE = 32768;
+	static const int HASH_BITS = 15;
+	static const int MAX_CHAIN = 32;    // 每个位置最多比较的候选数
+	static const int NICE_MATCH = 128;  // 找到这么长的匹配就不再继续查找
+	static const int MAX_INSERT = 32;   // 超过这个长度的匹配不把中间位置加入哈希表
+
+	// 固定 Huffman 编码表（已按位反转，可以直接按低位在前写入）
+	struct CTables
+	{
+		uint16_t litCode[288];
+		uint8_t litBits[288];
+		uint8_t distCode[30];
+		uint8_t lengthSymbol[MAX_MATCH + 1];  // 匹配长度 -> 长度码序号（0~28）
+		uint8_t distSymbol[512];              // 距离 -> 距离码，见 DistSymbol
+	};
+
+	static const uint16_t s_lengthBase[29];
+	static const uint8_t s_lengthExtra[29];
+	static const uint16_t s_distBase[30];
+	static const uint8_t s_distExtra[30];
+
+	std::vector<uint8_t>& m_out;
+	uint64_t m_nBitBuffer;
+	int m_nBitCount;
+
+	static uint32_t ReverseBits(uint32_t nCode, int nBits)
+	{
+		uint32_t nResult = 0;
+		for (int i = 0; i < nBits; i++)
+		{
+			nResult = (nResult << 1) | (nCode & 1);
+			nCode >>= 1;
+		}
+		return nResult;
+	}
+
+	static const CTables& Tables()
+	{
+		static CTables tables;
+		static bool bInit = [] {
+			for (int s = 0; s < 288; s++)
+			{
+				uint32_t nCode;
+				int nBits;
+				if (s < 144) { nCode = 0x30 + s; nBits = 8; }
+				else if (s < 256) { nCode = 0x190 + (s - 144); nBits = 9; }
+				else if (s < 280) { nCode = s - 256; nBits = 7; }
+				else { nCode = 0xC0 + (s - 280); nBits = 8; }
+				tables.litCode[s] = static_cast<uint16_t>(ReverseBits(nCode, nBits));
+				tables.litBits[s] = static_cast<uint8_t>(nBits);
+			}
+			for (int d = 0; d < 30; d++)
+				tables.distCode[d] = static_cast<uint8_t>(ReverseBits(d, 5));
+
+			for (int nCode = 0; nCode < 29; nCode++)
+			{
+				int nEnd = nCode == 28 ? MAX_MATCH + 1 : s_lengthBase[nCode + 1];
+				for (int nLength = s_lengthBase[nCode]; nLength < nEnd && nLength <= MAX_MATCH; nLength++)
+					tables.lengthSymbol[nLength] = static_cast<uint8_t>(nCode);
+			}
+			tables.lengthSymbol[MAX_MATCH] = 28;
+
+			// 距离 1~256 直接查表，更大的距离按 (距离-1)>>7 查表
+			int nCode = 0;
+			for (int nDist = 1; nDist <= 256; nDist++)
+			{
+				while (nCode < 29 && s_distBase[nCode + 1] <= nDist)
+					nCode++;
+				tables.distSymbol[nDist - 1] = static_cast<uint8_t>(nCode);
+			}
+			for (int nIndex = 2; nIndex < 256; nIndex++)
+			{
+				int nDist = (nIndex << 7) + 1;
+				while (nCode < 29 && s_distBase[nCode + 1] <= nDist)
+					nCode++;
+				tables.distSymbol[256 + nIndex] = static_cast<uint8_t>(nCode);
+			}
+			return true;
+		}();
+		(void)bInit;
+		return tables;
+	}
+
+	static int DistSymbol(const CTables& tables, int nDist)
+	{
+		return nDist <= 256 ? tables.distSymbol[nDist - 1] : tables.distSymbol[256 + ((nDist - 1) >> 7)];
+	}
+
+	void PutBits(uint32_t nValue, int nBits)
+	{
+		m_nBitBuffer |= static_cast<uint64_t>(nValue) << m_nBitCount;
+		m_nBitCount += nBits;
+		while (m_nBitCount >= 8)
+		{
+			m_out.push_back(static_cast<uint8_t>(m_nBitBuffer));
+			m_nBitBuffer >>= 8;
+			m_nBitCount -= 8;
+		}
+	}
+
+	void PutLiteral(const CTables& tables, int nSymbol)
+	{
+		PutBits(tables.litCode[nSymbol], tables.litBits[nSymbol]);
+	}
+
+	void PutMatch(const CTables& tables, int nLength, int nDist)
+	{
+		int nLengthCode = tables.lengthSymbol[nLength];
+		PutLiteral(tables, 257 + nLengthCode);
+		if (s_lengthExtra[nLengthCode] > 0)
+			PutBits(nLength - s_lengthBase[nLengthCode], s_lengthExtra[nLengthCode]);
+
+		int nDistCode = DistSymbol(tables, nDist);
+		PutBits(tables.distCode[nDistCode], 5);
+		if (s_distExtra[nDistCode] > 0)
+			PutBits(nDist - s_distBase[nDistCode], s_distExtra[nDistCode]);
+	}
+
+public:
+	explicit CDeflateEncoder(std::vector<uint8_t>& out) : m_out(out), m_nBitBuffer(0), m_nBitCount(0) {}
+
+	// 把 pData 压缩成一个不是最后块的固定编码块，并用空存储块对齐到字节边界
+	void CompressAligned(const uint8_t* pData, size_t nSize)
+	{
+		const CTables& tables = Tables();
+		const int nHashSize = 1 << HASH_BITS;
+		std::vector<int32_t> head(nHashSize, -1);
+		std::vector<int32_t> prev(nSize);
+
+		auto Hash = [pData](size_t i) {
+			return ((pData[i] << 10) ^ (pData[i + 1] << 5) ^ pData[i + 2]) & ((1 << HASH_BITS) - 1);
+		};
+		auto Insert = [&](size_t i) {
+			int h = Hash(i);
+			prev[i] = head[h];
+			head[h] = static_cast<int32_t>(i);
+		};
+
+		PutBits(2, 3);  // BFINAL=0, BTYPE=01（固定 Huffman）
+
+		size_t i = 0;
+		while (i < nSize)
+		{
+			int nBestLength = 0;
+			int nBestDist = 0;
+			if (i + MIN_MATCH <= nSize)
+			{
+				int nMaxLength = static_cast<int>(std::min<size_t>(MAX_MATCH, nSize - i));
+				int nCandidate = head[Hash(i)];
+				for (int nChain = MAX_CHAIN; nCandidate >= 0 && nChain > 0; nChain--)
+				{
+					int nDist = static_cast<int>(i - nCandidate);
+					if (nDist > WINDOW_SIZE)
+						break;
+
+					const uint8_t* pCur = pData + i;
+					const uint8_t* pCand = pData + nCandidate;
+					if (pCand[nBestLength] == pCur[nBestLength] && pCand[0] == pCur[0])
+					{
+						int nLength = 0;
+						while (nLength < nMaxLength && pCand[nLength] == pCur[nLength])
+							nLength++;
+						if (nLength > nBestLength)
+						{
+							nBestLength = nLength;
+							nBestDist = nDist;
+							if (nLength >= NICE_MATCH || nLength == nMaxLength)
+								break;
+						}
+					}
+					nCandidate = prev[nCandidate];
+				}
+				Insert(i);
+			}
+
+			if (nBestLength >= MIN_MATCH)
+			{
+				PutMatch(tables, nBestLength, nBestDist);
+				if (nBestLength <= MAX_INSERT)
+				{
+					for (size_t k = i + 1; k < i + nBestLength && k + MIN_MATCH <= nSize; k++)
+						Insert(k);
+				}
+				i += nBestLength;
+			}
+			else
+			{
+				PutLiteral(tables, pData[i]);
+				i++;
+			}
+		}
+
+		PutLiteral(tables, 256);  // 块结束
+		// 空存储块：3 位块头，补齐到字节边界，然后是 LEN=0、NLEN=0xFFFF
+		PutBits(0, 3);
+		if (m_nBitCount > 0)
+			PutBits(0, 8 - m_nBitCount);
+		PutBits(0x0000, 16);
+		PutBits(0xFFFF, 16);
+	}
+};
+
+const uint16_t CDeflateEncoder::s_lengthBase[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+const uint8_t CDeflateEncoder::s_lengthExtra[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+const uint16_t CDeflateEncoder::s_distBase[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+const uint8_t CDeflateEncoder::s_distExtra[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+// PNG 行过滤：对每一行尝试 5 种过滤方式，选择差值绝对值之和最小的一种
+static void FilterRow(const uint8_t* pRow, const uint8_t* pPrev, size_t nRowBytes, uint8_t* pOut, std::vector<uint8_t>& scratch)
+{
+	const size_t bpp = 3;
+	scratch.resize(nRowBytes * 5);
+	uint8_t* pCandidates[5];
+	for (int f = 0; f < 5; f++)
+		pCandidates[f] = scratch.data() + nRowBytes * f;
+
+	for (size_t x = 0; x < nRowBytes; x++)
+	{
+		int a = x >= bpp ? pRow[x - bpp] : 0;
+		int b = pPrev[x];
+		int c = x >= bpp ? pPrev[x - bpp] : 0;
+
+		int p = a + b - c;
+		int pa = abs(p - a);
+		int pb = abs(p - b);
+		int pc = abs(p - c);
+		int nPaeth = (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+
+		pCandidates[0][x] = pRow[x];
+		pCandidates[1][x] = static_cast<uint8_t>(pRow[x] - a);
+		pCandidates[2][x] = static_cast<uint8_t>(pRow[x] - b);
+		pCandidates[3][x] = static_cast<uint8_t>(pRow[x] - ((a + b) >> 1));
+		pCandidates[4][x] = static_cast<uint8_t>(pRow[x] - nPaeth);
+	}
+
+	int nBest = 0;
+	uint64_t nBestSum = UINT64_MAX;
+	for (int f = 0; f < 5; f++)
+	{
+		uint64_t nSum = 0;
+		for (size_t x = 0; x < nRowBytes; x++)
+			nSum += abs(static_cast<int8_t>(pCandidates[f][x]));
+		if (nSum < nBestSum)
+		{
+			nBestSum = nSum;
+			nBest = f;
+		}
+	}
+
+	pOut[0] = static_cast<uint8_t>(nBest);
+	memcpy(pOut + 1, pCandidates[nBest], nRowBytes);
+}
+
+// CPngRowWriter 实现
+CPngRowWriter::CPngRowWriter(std::ostream& out, unsigned nThreads)
+	: m_out(out), m_nThreads(nThreads), m_nWidth(0), m_nHeight(0), m_nRowsWritten(0),
+	m_nRowBytes(0), m_nBlockRows(1), m_nBatchRows(0), m_nAdler(1)
+{
+	if (m_nThreads == 0)
+		m_nThreads = std::max(1u, std::thread::hardware_concurrency());
+}
+
+bool CPngRowWriter::Begin(int nWidth, int nHeight)
+{
+	static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+	if (nWidth <= 0 || nHeight <= 0)
+		return false;
+
+	m_nWidth = nWidth;
+	m_nHeight = nHeight;
+	m_nRowsWritten = 0;
+	m_nRowBytes = static_cast<size_t>(nWidth) * 3;
+	m_nBlockRows = static_cast<int>(std::max<size_t>(1, BLOCK_BYTES / m_nRowBytes));
+	m_nBatchRows = 0;
+	m_nAdler = 1;
+	m_batch.assign(m_nRowBytes * (1 + static_cast<size_t>(m_nBlockRows) * m_nThreads), 0);
+	m_results.resize(m_nThreads);
+
+	m_out.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+	uint8_t header[13];
+	PutU32BE(header, static_cast<uint32_t>(nWidth));
+	PutU32BE(header + 4, static_cast<uint32_t>(nHeight));
+	header[8] = 8;   // 每通道 8 位
+	header[9] = 2;   // 真彩色
+	header[10] = 0;  // deflate
+	header[11] = 0;  // 自适应过滤
+	header[12] = 0;  // 不隔行
+	WriteChunk("IHDR", header, sizeof(header));
+
+	// zlib 流头：deflate，32K 窗口，最快压缩级别
+	static const uint8_t zlibHeader[2] = { 0x78, 0x01 };
+	WriteChunk("IDAT", zlibHeader, sizeof(zlibHeader));
+	return m_out.good();
+}
+
+bool CPngRowWriter::WriteRows(const uint8_t* pPixels, int nRows, int nStride)
+{
+	if (m_nRowsWritten + m_nBatchRows + nRows > m_nHeight)
+		return false;
+
+	const int nBatchCapacity = m_nBlockRows * static_cast<int>(m_nThreads);
+	for (int i = 0; i < nRows; i++)
+	{
+		// BGRX -> RGB
+		const uint8_t* pSrc = pPixels + static_cast<ptrdiff_t>(i) * nStride;
+		uint8_t* pDst = m_batch.data() + m_nRowBytes * (1 + m_nBatchRows);
+		for (int x = 0; x < m_nWidth; x++)
+		{
+			pDst[0] = pSrc[2];
+			pDst[1] = pSrc[1];
+			pDst[2] = pSrc[0];
+			pSrc += 4;
+			pDst += 3;
+		}
+
+		if (++m_nBatchRows == nBatchCapacity && !FlushBatch())
+			return false;
+	}
+	return true;
+}
+
+bool CPngRowWriter::End()
+{
+	if (m_nBatchRows > 0 && !FlushBatch())
+		return false;
+	if (m_nRowsWritten != m_nHeight)
+		return false;
+
+	// 最后一个块：空的固定编码块（BFINAL=1），然后是 Adler-32
+	uint8_t trailer[6] = { 0x03, 0x00 };
+	PutU32BE(trailer + 2, m_nAdler);
+	WriteChunk("IDAT", trailer, sizeof(trailer));
+	WriteChunk("IEND", nullptr, 0);
+	m_out.flush();
+	return m_out.good();
+}
+
+void CPngRowWriter::CompressBlock(const uint8_t* pRows, int nRows, size_t nRowBytes, CBlockResult& result)
+{
+	// 过滤
+	std::vector<uint8_t> filtered((nRowBytes + 1) * nRows);
+	std::vector<uint8_t> scratch;
+	for (int y = 0; y < nRows; y++)
+	{
+		const uint8_t* pRow = pRows + nRowBytes * y;
+		FilterRow(pRow, pRow - nRowBytes, nRowBytes, filtered.data() + (nRowBytes + 1) * y, scratch);
+	}
+
+	// 压缩
+	result.data.clear();
+	result.data.reserve(filtered.size() / 4 + 64);
+	CDeflateEncoder encoder(result.data);
+	encoder.CompressAligned(filtered.data(), filtered.size());
+
+	result.nAdler = UpdateAdler(1, filtered.data(), filtered.size());
+	result.nRawBytes = filtered.size();
+	result.nCrc = UpdateCrc(UpdateCrc(0, reinterpret_cast<const uint8_t*>("IDAT"), 4), result.data.data(), result.data.size());
+}
+
+bool CPngRowWriter::FlushBatch()
+{
+	const int nBlocks = (m_nBatchRows + m_nBlockRows - 1) / m_nBlockRows;
+	const uint8_t* pFirstRow = m_batch.data() + m_nRowBytes;
+
+	auto Compress = [this, pFirstRow](int nBlock) {
+		int nStartRow = nBlock * m_nBlockRows;
+		int nRows = std::min(m_nBlockRows, m_nBatchRows - nStartRow);
+		CompressBlock(pFirstRow + m_nRowBytes * nStartRow, nRows, m_nRowBytes, m_results[nBlock]);
+	};
+
+	// 第一个块在当前线程中压缩，其余块各用一个线程
+	std::vector<std::thread> threads;
+	threads.reserve(nBlocks > 1 ? nBlocks - 1 : 0);
+	for (int nBlock = 1; nBlock < nBlocks; nBlock++)
+		threads.emplace_back(Compress, nBlock);
+	Compress(0);
+	for (std::thread& thread : threads)
+		thread.join();
+
+	for (int nBlock = 0; nBlock < nBlocks; nBlock++)
+	{
+		const CBlockResult& result = m_results[nBlock];
+		m_nAdler = CombineAdler(m_nAdler, result.nAdler, result.nRawBytes);
+		WriteChunk("IDAT", result.data.data(), result.data.size(), result.nCrc);
+	}
+
+	// 保留最后一行，作为下一批第一行的前一行
+	memcpy(m_batch.data(), m_batch.data() + m_nRowBytes * m_nBatchRows, m_nRowBytes);
+	m_nRowsWritten += m_nBatchRows;
+	m_nBatchRows = 0;
+	return m_out.good();
+}
+
+void CPngRowWriter::WriteChunk(const char* pType, const uint8_t* pData, size_t nSize)
+{
+	uint32_t nCrc = UpdateCrc(0, reinterpret_cast<const uint8_t*>(pType), 4);
+	if (nSize > 0)
+		nCrc = UpdateCrc(nCrc, pData, nSize);
+	WriteChunk(pType, pData, nSize, nCrc);
+}
+
+void CPngRowWriter::WriteChunk(const char* pType, const uint8_t* pData, size_t nSize, uint32_t nCrc)
+{
+	uint8_t buffer[4];
+	PutU32BE(buffer, static_cast<uint32_t>(nSize));
+	m_out.write(reinterpret_cast<const char*>(buffer), 4);
+	m_out.write(pType, 4);
+	if (nSize > 0)
+		m_out.write(reinterpret_cast<const char*>(pData), nSize);
+	PutU32BE(buffer, nCrc);
+	m_out.write(reinterpret_cast<const char*>(buffer), 4);
+}
@@ -0,0 +1,58 @@
+// PngWriter.h: 并行 PNG 写入器
+// 行数据按块（约 256KB 原始数据）分组，多个块在工作线程中同时完成过滤和压缩，再按顺序拼接成一个 zlib 流：
+// 每个块独立压缩，结尾用一个空的存储块对齐到字节边界；各块的 Adler-32 校验和在主线程中合并。
+//
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "ImageWriter.h"
+
+// 把图像写成 24 位真彩色 PNG（不含透明通道）
+class CPngRowWriter : public IImageRowSink
+{
+private:
+	static const size_t BLOCK_BYTES = 256 * 1024;  // 每个压缩块的目标原始数据量
+
+	// 一个块的压缩结果
+	struct CBlockResult
+	{
+		std::vector<uint8_t> data;  // 压缩后的数据（字节对齐，不含结束块）
+		uint32_t nAdler;            // 过滤后原始数据的 Adler-32
+		size_t nRawBytes;           // 过滤后原始数据的字节数
+		uint32_t nCrc;              // IDAT 块的 CRC（含块类型）
+	};
+
+	std::ostream& m_out;
+	unsigned m_nThreads;
+	int m_nWidth;
+	int m_nHeight;
+	int m_nRowsWritten;         // 已写入文件的行数
+	size_t m_nRowBytes;         // 每行 RGB 数据的字节数（不含过滤类型字节）
+	int m_nBlockRows;           // 每个块的行数
+	std::vector<uint8_t> m_batch;  // 第 0 行是上一批的最后一行（过滤时用作前一行），之后是待压缩的行
+	int m_nBatchRows;           // m_batch 中待压缩的行数
+	uint32_t m_nAdler;          // 整个 zlib 流的 Adler-32
+	std::vector<CBlockResult> m_results;
+
+	// 禁止拷贝构造和赋值
+	CPngRowWriter(const CPngRowWriter&) = delete;
+	CPngRowWriter& operator=(const CPngRowWriter&) = delete;
+
+	// 过滤并压缩一个块；pRows 前面紧挨着它的前一行（第一行之前为全零行）
+	static void CompressBlock(const uint8_t* pRows, int nRows, size_t nRowBytes, CBlockResult& result);
+	// 并行压缩缓存中的行并按顺序写出
+	bool FlushBatch();
+	void WriteChunk(const char* pType, const uint8_t* pData, size_t nSize);
+	void WriteChunk(const char* pType, const uint8_t* pData, size_t nSize, uint32_t nCrc);
+
+public:
+	// nThreads 为 0 时使用硬件线程数
+	explicit CPngRowWriter(std::ostream& out, unsigned nThreads = 0);
+
+	bool Begin(int nWidth, int nHeight) override;
+	bool WriteRows(const uint8_t* pPixels, int nRows, int nStride) override;
+	bool End() override;
+};
@@ -0,0 +1,103 @@
+// PolylineSimplifier.cpp: 折线简化的实现
+//
+
+#include "pch.h"
+#include "PolylineSimplifier.h"
+
+#include <utility>
+
+// 点 p 到线段 ab 的距离的平方
+static double SegmentDistanceSquared(const CPoint& p, const CPoint& a, const CPoint& b)
+{
+	double dx = static_cast<double>(b.x) - a.x;
+	double dy = static_cast<double>(b.y) - a.y;
+	double px = static_cast<double>(p.x) - a.x;
+	double py = static_cast<double>(p.y) - a.y;
+
+	double dLengthSquared = dx * dx + dy * dy;
+	if (dLengthSquared > 0.0)
+	{
+		double t = (px * dx + py * dy) / dLengthSquared;
+		if (t > 1.0)
+		{
+			px = static_cast<double>(p.x) - b.x;
+			py = static_cast<double>(p.y) - b.y;
+		}
+		else if (t > 0.0)
+		{
+			px -= dx * t;
+			py -= dy * t;
+		}
+	}
+	return px * px + py * py;
+}
+
+void SimplifyPolyline(const std::vector<CPoint>& points, double dTolerance, std::vector<CPoint>& result)
+{
+	result.clear();
+	if (points.size() < 3 || dTolerance <= 0.0)
+	{
+		result = points;
+		return;
+	}
+
+	const double dToleranceSquared = dTolerance * dTolerance;
+
+	// 第一步：半径距离，O(n) 去掉与上一个保留点距离小于容差的点
+	std::vector<CPoint> reduced;
+	reduced.reserve(points.size());
+	reduced.push_back(points.front());
+	for (size_t i = 1; i + 1 < points.size(); i++)
+	{
+		double dx = static_cast<double>(points[i].x) - reduced.back().x;
+		double dy = static_cast<double>(points[i].y) - reduced.back().y;
+		if (dx * dx + dy * dy > dToleranceSquared)
+			reduced.push_back(points[i]);
+	}
+	reduced.push_back(points.back());
+
+	if (reduced.size() < 3)
+	{
+		result.swap(reduced);
+		return;
+	}
+
+	// 第二步：Douglas-Peucker，用显式栈代替递归，避免长笔画导致栈溢出
+	std::vector<char> keep(reduced.size(), 0);
+	keep.front() = 1;
+	keep.back() = 1;
+
+	std::vector<std::pair<size_t, size_t>> stack;
+	stack.push_back(std::make_pair(static_cast<size_t>(0), reduced.size() - 1));
+	while (!stack.empty())
+	{
+		size_t nFirst = stack.back().first;
+		size_t nLast = stack.back().second;
+		stack.pop_back();
+
+		double dMaxDistance = 0.0;
+		size_t nFarthest = nFirst;
+		for (size_t i = nFirst + 1; i < nLast; i++)
+		{
+			double dDistance = SegmentDistanceSquared(reduced[i], reduced[nFirst], reduced[nLast]);
+			if (dDistance > dMaxDistance)
+			{
+				dMaxDistance = dDistance;
+				nFarthest = i;
+			}
+		}
+
+		if (dMaxDistance > dToleranceSquared)
+		{
+			keep[nFarthest] = 1;
+			stack.push_back(std::make_pair(nFirst, nFarthest));
+			stack.push_back(std::make_pair(nFarthest, nLast));
+		}
+	}
+
+	for (size_t i = 0; i < reduced.size(); i++)
+	{
+		if (keep[i])
+			result.push_back(reduced[i]);
+	}
+}
@@ -0,0 +1,12 @@
+// PolylineSimplifier.h: 折线简化
+// 用于低细节绘制（缩略图、缩小显示）：去掉与折线偏差不超过容差的点，形状在目标分辨率下基本不变。
+//
+
+#pragma once
+
+#include <afxwin.h>
+#include <vector>
+
+// 简化折线：先按半径距离去掉过密的点，再用 Douglas-Peucker 算法去掉偏差不超过 dTolerance 的点
+// 结果保留首尾两点；点数少于 3 或容差不为正时原样复制
+void SimplifyPolyline(const std::vector<CPoint>& points, double dTolerance, std::vector<CPoint>& result);
@@ -0,0 +1,36 @@
+// StringPool.cpp: 驻留字符串池的实现
+//
+
+#include "pch.h"
+#include "StringPool.h"
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+const UINT CStringPool::EMPTY_ID;  // 按引用传递时需要定义
+
+UINT CStringPool::Intern(const CString& text)
+{
+	if (text.IsEmpty())
+		return EMPTY_ID;
+
+	auto it = m_lookup.find(std::wstring_view(text.GetString(), text.GetLength()));
+	if (it != m_lookup.end())
+		return it->second;
+
+	UINT nId = static_cast<UINT>(m_strings.size());
+	m_strings.push_back(text);
+	m_nTextBytes += (text.GetLength() + 1) * sizeof(TCHAR);
+	const CString& stored = m_strings.back();
+	m_lookup.emplace(std::wstring_view(stored.GetString(), stored.GetLength()), nId);
+	return nId;
+}
+
+void CStringPool::Clear()
+{
+	m_lookup.clear();
+	m_strings.clear();
+	m_nTextBytes = 0;
+	m_strings.push_back(CString());
+}
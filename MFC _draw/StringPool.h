@@ -0,0 +1,41 @@
+// StringPool.h: 文档级的驻留字符串池
+// 文档中的文本统一保存在字符串池中，绘图数据只记录序号；相同的文本（如重复的标注）只保存一份，
+// 文本命令持有的 CString 与池中的字符串共享同一块缓冲区。字符串只追加、不修改，
+// 序号在文档的生命周期内保持有效（撤销的命令重做时仍然可用）。
+// 只在拥有者（界面）线程中使用。
+//
+
+#pragma once
+
+#include <afxwin.h>
+#include <deque>
+#include <string_view>
+#include <unordered_map>
+
+class CStringPool
+{
+private:
+	std::deque<CString> m_strings;  // 序号即下标；deque 追加时不移动已有元素，查找表中的视图保持有效
+	std::unordered_map<std::wstring_view, UINT> m_lookup;  // 字符串内容 -> 序号
+	size_t m_nTextBytes;  // 所有字符串内容占用的字节数
+
+	// 禁止拷贝构造和赋值（查找表引用自身的字符串缓冲区）
+	CStringPool(const CStringPool&) = delete;
+	CStringPool& operator=(const CStringPool&) = delete;
+
+public:
+	static const UINT EMPTY_ID = 0;  // 空字符串（没有文本的命令）
+
+	CStringPool() : m_nTextBytes(0) { Clear(); }
+
+	// 返回 text 的序号，池中没有时追加
+	UINT Intern(const CString& text);
+	// 获取序号对应的字符串；序号无效时返回空字符串
+	const CString& Get(UINT nId) const { return nId < m_strings.size() ? m_strings[nId] : m_strings[EMPTY_ID]; }
+	// 字符串数量（包含空字符串）
+	UINT GetCount() const { return static_cast<UINT>(m_strings.size()); }
+	// 估算占用的内存（字节）：字符串内容和每个元素的开销，不含查找表
+	size_t GetMemorySize() const { return m_nTextBytes + m_strings.size() * sizeof(CString); }
+	// 清空，只保留空字符串
+	void Clear();
+};
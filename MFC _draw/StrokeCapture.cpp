@@ -0,0 +1,196 @@
+// StrokeCapture.cpp: 鼠标拖动绘制采集的实现
+//
+
+#include "pch.h"
+#include "StrokeCapture.h"
+
+#include <utility>
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+// CCachedPen 实现
+HPEN CStrokeCapture::CCachedPen::Get(int nWidth, COLORREF color)
+{
+	if (m_pen == nullptr || m_nWidth != nWidth || m_color != color)
+	{
+		m_pen.reset();
+		m_pen.reset(new CPenWrapper(PS_SOLID, nWidth, color));
+		m_nWidth = nWidth;
+		m_color = color;
+	}
+	return static_cast<HPEN>(m_pen->Get()->GetSafeHandle());
+}
+
+// CStrokeCapture 实现
+CStrokeCapture::CStrokeCapture()
+	: m_drawType(DrawData::DrawType::LineSegment), m_nPenSize(1), m_penColor(RGB(0, 0, 0)), m_brushColor(RGB(0, 0, 0)),
+	m_pointBegin(0, 0), m_pointEnd(0, 0), m_bCapturing(FALSE)
+{
+	m_points.reserve(RESERVED_POINTS);
+}
+
+void CStrokeCapture::Begin(DrawData::DrawType drawType, int nPenSize, COLORREF penColor, COLORREF brushColor, CPoint point)
+{
+	m_drawType = drawType;
+	m_nPenSize = nPenSize;
+	m_penColor = penColor;
+	m_brushColor = brushColor;
+	m_pointBegin = m_pointEnd = point;
+	m_bCapturing = TRUE;
+
+	// clear 保留容量，上一笔画增长出的容量也会继续使用
+	m_points.clear();
+	if (drawType == DrawData::DrawType::Pencil || drawType == DrawData::DrawType::Eraser)
+		m_points.push_back(point);
+}
+
+CRect CStrokeCapture::GetCircleRect(CPoint point) const
+{
+	int nLength = abs(point.y - m_pointBegin.y);
+	int x = point.x < m_pointBegin.x ? m_pointBegin.x - nLength : m_pointBegin.x + nLength;
+	return CRect(m_pointBegin.x, m_pointBegin.y, x, point.y);
+}
+
+void CStrokeCapture::DrawOutline(HDC hDC, CPoint point) const
+{
+	switch (m_drawType)
+	{
+	case DrawData::DrawType::LineSegment:
+		::MoveToEx(hDC, m_pointBegin.x, m_pointBegin.y, nullptr);
+		::LineTo(hDC, point.x, point.y);
+		break;
+
+	case DrawData::DrawType::Rectangle:
+		::Rectangle(hDC, m_pointBegin.x, m_pointBegin.y, point.x, point.y);
+		break;
+
+	case DrawData::DrawType::Ellipse:
+		::Ellipse(hDC, m_pointBegin.x, m_pointBegin.y, point.x, point.y);
+		break;
+
+	case DrawData::DrawType::Circle:
+	{
+		CRect rect = GetCircleRect(point);
+		::Ellipse(hDC, rect.left, rect.top, rect.right, rect.bottom);
+		break;
+	}
+
+	default:
+		break;
+	}
+}
+
+void CStrokeCapture::Move(CPoint point, CDC* pDC)
+{
+	if (!m_bCapturing)
+		return;
+
+	if (m_drawType == DrawData::DrawType::Pencil || m_drawType == DrawData::DrawType::Eraser)
+	{
+		// 起点跟随上一个点，每次只画新增的一段
+		m_pointBegin = m_pointEnd;
+		m_pointEnd = point;
+		if (m_points.back() != point)
+			m_points.push_back(point);
+
+		if (pDC != nullptr)
+		{
+			HDC hDC = pDC->GetSafeHdc();
+			HPEN hPen = m_drawType == DrawData::DrawType::Eraser
+				? m_eraserPen.Get(m_nPenSize, ::GetBkColor(hDC))
+				: m_previewPen.Get(m_nPenSize, m_penColor);
+			HGDIOBJ hOldPen = ::SelectObject(hDC, hPen);
+			::MoveToEx(hDC, m_pointBegin.x, m_pointBegin.y, nullptr);
+			::LineTo(hDC, m_pointEnd.x, m_pointEnd.y);
+			::SelectObject(hDC, hOldPen);
+		}
+		return;
+	}
+
+	if (pDC != nullptr && m_drawType != DrawData::DrawType::Text)
+	{
+		// 橡皮筋：异或模式下先画一遍上一次的轮廓把它擦掉，再画新的轮廓
+		HDC hDC = pDC->GetSafeHdc();
+		HGDIOBJ hOldPen = ::SelectObject(hDC, m_previewPen.Get(m_nPenSize, m_penColor));
+		HGDIOBJ hOldBrush = ::SelectObject(hDC, ::GetStockObject(NULL_BRUSH));
+		int nOldRop = ::SetROP2(hDC, R2_NOTXORPEN);
+		DrawOutline(hDC, m_pointEnd);
+		DrawOutline(hDC, point);
+		::SetROP2(hDC, nOldRop);
+		::SelectObject(hDC, hOldBrush);
+		::SelectObject(hDC, hOldPen);
+	}
+	m_pointEnd = point;
+}
+
+CDrawCommand* CStrokeCapture::End(CPoint point, CDC* pDC, CColorPalette& palette)
+{
+	if (!m_bCapturing)
+		return nullptr;
+	m_bCapturing = FALSE;
+
+	DrawData data;
+	data.drawType = m_drawType;
+	data.penSize = m_nPenSize;
+	data.SetPenColor(palette, m_penColor);
+	data.SetBrushColor(palette, m_brushColor);
+	data.pointBegin = m_pointBegin;
+	data.pointEnd = point;
+
+	CDrawCommand* pCommand = nullptr;
+	switch (m_drawType)
+	{
+	case DrawData::DrawType::LineSegment:
+	case DrawData::DrawType::Rectangle:
+	case DrawData::DrawType::Ellipse:
+	case DrawData::DrawType::Circle:
+		if (pDC != nullptr)
+		{
+			// 以正常模式画出最终的图形
+			HDC hDC = pDC->GetSafeHdc();
+			HGDIOBJ hOldPen = ::SelectObject(hDC, m_previewPen.Get(m_nPenSize, m_penColor));
+			HGDIOBJ hOldBrush = ::SelectObject(hDC, ::GetStockObject(NULL_BRUSH));
+			DrawOutline(hDC, point);
+			::SelectObject(hDC, hOldBrush);
+			::SelectObject(hDC, hOldPen);
+		}
+		if (m_drawType == DrawData::DrawType::LineSegment)
+			pCommand = new CLineSegmentCommand(data);
+		else if (m_drawType == DrawData::DrawType::Rectangle)
+			pCommand = new CRectangleCommand(data);
+		else if (m_drawType == DrawData::DrawType::Ellipse)
+			pCommand = new CEllipseCommand(data);
+		else
+			pCommand = new CCircleCommand(data);
+		break;
+
+	case DrawData::DrawType::Pencil:
+	case DrawData::DrawType::Eraser:
+		if (m_points.size() > 1)
+		{
+			// 命令中的点按实际数量分配，缓冲区保留给下一笔画
+			data.pencilPoints.assign(m_points.begin(), m_points.end());
+			if (m_drawType == DrawData::DrawType::Pencil)
+				pCommand = new CPencilCommand(std::move(data));
+			else
+				pCommand = new CEraserCommand(std::move(data));
+		}
+		break;
+
+	default:
+		// 文本命令在提交文本时创建
+		break;
+	}
+
+	m_pointEnd = point;
+	m_points.clear();
+	return pCommand;
+}
+
+void CStrokeCapture::Cancel()
+{
+	m_bCapturing = FALSE;
+	m_points.clear();
+}
@@ -0,0 +1,126 @@
+// StrokePyramid.cpp: 笔迹多分辨率金字塔的实现
+//
+
+#include "pch.h"
+#include "StrokePyramid.h"
+#include "ArchiveArray.h"
+#include "PolylineSimplifier.h"
+
+#include <cmath>
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+void CStrokePyramid::AddLevel(const CPoint* pPoints, size_t nCount)
+{
+	if (!m_levelCount.empty() && m_levelCount.back() <= nCount)
+	{
+		// 容差更大时简化结果偶尔反而多出几个点；上一级的偏差更小，同样满足本级的容差，直接共用
+		m_levelBegin.push_back(m_levelBegin.back());
+		m_levelCount.push_back(m_levelCount.back());
+	}
+	else
+	{
+		m_levelBegin.push_back(static_cast<uint32_t>(m_points.size()));
+		m_levelCount.push_back(static_cast<uint32_t>(nCount));
+		m_points.insert(m_points.end(), pPoints, pPoints + nCount);
+	}
+}
+
+void CStrokePyramid::Build(const std::vector<CPoint>& points)
+{
+	m_points.clear();
+	m_levelBegin.clear();
+	m_levelCount.clear();
+	if (points.size() < 2)
+		return;
+
+	// 每一级都从原始轨迹简化，偏差不会逐级累积
+	std::vector<CPoint> simplified;
+	for (int nLevel = 0; nLevel < MAX_LEVELS; nLevel++)
+	{
+		SimplifyPolyline(points, GetLevelTolerance(nLevel), simplified);
+		AddLevel(simplified.data(), simplified.size());
+		if (simplified.size() <= 2)
+			break;
+	}
+	m_points.shrink_to_fit();
+}
+
+const CPoint* CStrokePyramid::GetLevel(double dTolerance, int& nCount) const
+{
+	if (m_levelCount.empty() || !(dTolerance >= 1.0))
+		return nullptr;
+
+	// 容差在 [2^k, 2^(k+1)) 中时取第 k 级；更粗的级别没有建立时取最后一级（已经只剩首尾两点）
+	int nExponent;
+	std::frexp(dTolerance, &nExponent);
+	int nLevel = min(nExponent - 1, GetLevelCount() - 1);
+	nCount = static_cast<int>(m_levelCount[nLevel]);
+	return m_points.data() + m_levelBegin[nLevel];
+}
+
+void CStrokePyramid::Store(CArchive& ar) const
+{
+	ar << static_cast<BYTE>(m_levelCount.size());
+	for (uint32_t nCount : m_levelCount)
+		ar << static_cast<DWORD>(nCount);
+	if (!m_points.empty())
+		ar.Write(m_points.data(), static_cast<UINT>(m_points.size() * sizeof(CPoint)));
+}
+
+BOOL CStrokePyramid::Load(CArchive& ar, size_t nSourcePoints)
+{
+	m_points.clear();
+	m_levelBegin.clear();
+	m_levelCount.clear();
+
+	BYTE nLevels;
+	ar >> nLevels;
+	if (nLevels == 0 || nLevels > MAX_LEVELS)
+		return FALSE;
+
+	// 点数逐级不增，且不超过原始轨迹
+	size_t nStored = 0;
+	DWORD nPrevious = 0;
+	for (BYTE i = 0; i < nLevels; i++)
+	{
+		DWORD nCount;
+		ar >> nCount;
+		if (nCount < 2 || nCount > nSourcePoints || (i > 0 && nCount > nPrevious))
+			return FALSE;
+		m_levelBegin.push_back(static_cast<uint32_t>(i > 0 && nCount == nPrevious ? m_levelBegin.back() : nStored));
+		m_levelCount.push_back(nCount);
+		if (i == 0 || nCount != nPrevious)
+			nStored += nCount;
+		nPrevious = nCount;
+	}
+
+	LoadArchiveArray(ar, m_points, nStored);
+	return TRUE;
+}
+
+// CStrokePyramidCache 实现
+const CStrokePyramid* CStrokePyramidCache::Get(const std::vector<CPoint>& points) const
+{
+	CStrokePyramid* pPyramid = m_pPyramid.load(std::memory_order_acquire);
+	if (pPyramid != nullptr || points.size() < CStrokePyramid::MIN_SOURCE_POINTS)
+		return pPyramid;
+
+	// 多个线程同时建立时只保留第一个完成的结果
+	CStrokePyramid* pBuilt = new CStrokePyramid;
+	pBuilt->Build(points);
+	CStrokePyramid* pExpected = nullptr;
+	if (m_pPyramid.compare_exchange_strong(pExpected, pBuilt, std::memory_order_acq_rel, std::memory_order_acquire))
+		return pBuilt;
+	delete pBuilt;
+	return pExpected;
+}
+
+void CStrokePyramidCache::Set(CStrokePyramid* pPyramid)
+{
+	CStrokePyramid* pExpected = nullptr;
+	if (!m_pPyramid.compare_exchange_strong(pExpected, pPyramid, std::memory_order_acq_rel))
+		delete pPyramid;
+}
@@ -0,0 +1,71 @@
+// StrokePyramid.h: 笔迹的多分辨率金字塔
+// 铅笔和橡皮擦的轨迹缩小显示时，大部分点落在同一个像素里。金字塔按 1、2、4……个文档单位的容差
+// 预先保存轨迹的简化版本，低细节绘制时直接取与当前比例相符的一级，不必每次重新简化。
+// 各级的点依次存放在同一个数组中，与上一级共用的级别不重复保存。
+// 金字塔在第一次低细节绘制时创建（CStrokePyramidCache），也可以随文档保存和读取。
+//
+
+#pragma once
+
+#include <afxwin.h>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+class CStrokePyramid
+{
+private:
+	std::vector<CPoint> m_points;  // 各级的点
+	std::vector<uint32_t> m_levelBegin;  // 第 k 级在 m_points 中的起始位置
+	std::vector<uint32_t> m_levelCount;  // 第 k 级的点数
+
+	// 追加一级；点数不少于上一级时共用上一级的点，保证各级点数逐级不增
+	void AddLevel(const CPoint* pPoints, size_t nCount);
+
+public:
+	static const int MAX_LEVELS = 10;  // 最粗一级的容差为 2^(MAX_LEVELS-1) = 512 个文档单位
+	static const size_t MIN_SOURCE_POINTS = 8;  // 点数少于此值的轨迹不建立金字塔
+
+	// 第 nLevel 级的容差（文档单位）
+	static double GetLevelTolerance(int nLevel) { return static_cast<double>(1 << nLevel); }
+
+	// 由原始轨迹建立各级；某一级只剩首尾两点后不再继续
+	void Build(const std::vector<CPoint>& points);
+
+	int GetLevelCount() const { return static_cast<int>(m_levelCount.size()); }
+	// 偏差不超过 dTolerance 的最粗一级的点，nCount 为点数；dTolerance 小于 1 时没有合适的级别，返回 nullptr
+	const CPoint* GetLevel(double dTolerance, int& nCount) const;
+
+	// 占用的内存（字节）
+	size_t GetMemorySize() const
+	{
+		return sizeof(CStrokePyramid) + m_points.capacity() * sizeof(CPoint) + (m_levelBegin.capacity() + m_levelCount.capacity()) * sizeof(uint32_t);
+	}
+
+	// 写入文档：BYTE 级数，每级的 DWORD 点数，之后是实际保存的点（点数与上一级相同的级别不重复写入）
+	void Store(CArchive& ar) const;
+	// 读取 Store 写入的数据；nSourcePoints 为原始轨迹的点数，数据与之不符时返回 FALSE
+	BOOL Load(CArchive& ar, size_t nSourcePoints);
+};
+
+// 命令中延迟创建的金字塔：第一次需要时建立，之后只读，可以在多个线程中同时使用（如后台渲染缩略图）
+class CStrokePyramidCache
+{
+private:
+	mutable std::atomic<CStrokePyramid*> m_pPyramid;
+
+	// 禁止拷贝构造和赋值
+	CStrokePyramidCache(const CStrokePyramidCache&) = delete;
+	CStrokePyramidCache& operator=(const CStrokePyramidCache&) = delete;
+
+public:
+	CStrokePyramidCache() : m_pPyramid(nullptr) {}
+	~CStrokePyramidCache() { delete m_pPyramid.load(std::memory_order_relaxed); }
+
+	// 获取 points 的金字塔，尚未建立时建立；点数太少不需要金字塔时返回 nullptr
+	const CStrokePyramid* Get(const std::vector<CPoint>& points) const;
+	// 已经建立或读取的金字塔，没有时返回 nullptr
+	const CStrokePyramid* GetIfBuilt() const { return m_pPyramid.load(std::memory_order_acquire); }
+	// 设置从文档读取的金字塔（接管所有权）；已经有金字塔时丢弃 pPyramid
+	void Set(CStrokePyramid* pPyramid);
+};
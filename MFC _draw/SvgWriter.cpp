@@ -0,0 +1,280 @@
+// SvgWriter.cpp: 流式 SVG 导出的实现
+//
+
+#include "pch.h"
+#include "SvgWriter.h"
+
+CSvgWriter::CSvgWriter(std::ostream& out)
+	: m_writer(out), m_bkColor(RGB(255, 255, 255))
+{
+}
+
+bool CSvgWriter::Begin(const CRect& rectView, CSize sizeOutput, COLORREF bkColor)
+{
+	m_bkColor = bkColor;
+
+	m_writer.Write("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+	m_writer.Write("<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"");
+	m_writer.WriteInt(sizeOutput.cx);
+	m_writer.Write("\" height=\"");
+	m_writer.WriteInt(sizeOutput.cy);
+	m_writer.Write("\" viewBox=\"");
+	m_writer.WriteInt(rectView.left);
+	m_writer.Write(' ');
+	m_writer.WriteInt(rectView.top);
+	m_writer.Write(' ');
+	m_writer.WriteInt(rectView.Width());
+	m_writer.Write(' ');
+	m_writer.WriteInt(rectView.Height());
+	m_writer.Write("\">\n");
+
+	// 文本命令使用 DC 的默认字体，坐标是文本左上角
+	m_writer.Write("<style>text{font-family:sans-serif;font-size:16px;dominant-baseline:text-before-edge;white-space:pre}</style>\n");
+
+	m_writer.Write("<rect x=\"");
+	m_writer.WriteInt(rectView.left);
+	m_writer.Write("\" y=\"");
+	m_writer.WriteInt(rectView.top);
+	m_writer.Write("\" width=\"");
+	m_writer.WriteInt(rectView.Width());
+	m_writer.Write("\" height=\"");
+	m_writer.WriteInt(rectView.Height());
+	m_writer.Write("\" fill=\"");
+	WriteColor(bkColor);
+	m_writer.Write("\"/>\n");
+
+	// GDI 的几何画笔默认使用圆形端点和连接
+	m_writer.Write("<g fill=\"none\" stroke-linecap=\"round\" stroke-linejoin=\"round\">\n");
+	return m_writer.Flush();
+}
+
+void CSvgWriter::WriteCommand(const DrawData& data, const CString& text, const CColorPalette& palette)
+{
+	const COLORREF penColor = data.GetPenColor(palette);
+	switch (data.drawType)
+	{
+	case DrawData::DrawType::LineSegment:
+		m_writer.Write("<line x1=\"");
+		m_writer.WriteInt(data.pointBegin.x);
+		m_writer.Write("\" y1=\"");
+		m_writer.WriteInt(data.pointBegin.y);
+		m_writer.Write("\" x2=\"");
+		m_writer.WriteInt(data.pointEnd.x);
+		m_writer.Write("\" y2=\"");
+		m_writer.WriteInt(data.pointEnd.y);
+		m_writer.Write('"');
+		WriteStroke(penColor, data.penSize);
+		m_writer.Write("/>\n");
+		break;
+
+	case DrawData::DrawType::Rectangle:
+	{
+		// Rectangle 的右下边界不包含在内，边框经过 (right - 1, bottom - 1)
+		CRect rect(data.pointBegin, data.pointEnd);
+		rect.NormalizeRect();
+		m_writer.Write("<rect x=\"");
+		m_writer.WriteInt(rect.left);
+		m_writer.Write("\" y=\"");
+		m_writer.WriteInt(rect.top);
+		m_writer.Write("\" width=\"");
+		m_writer.WriteInt(max(rect.Width() - 1, 0));
+		m_writer.Write("\" height=\"");
+		m_writer.WriteInt(max(rect.Height() - 1, 0));
+		m_writer.Write('"');
+		WriteStroke(penColor, data.penSize);
+		m_writer.Write("/>\n");
+		break;
+	}
+
+	case DrawData::DrawType::Circle:
+	case DrawData::DrawType::Ellipse:
+	{
+		// 圆和椭圆都按外接矩形绘制
+		CRect rect(data.pointBegin, data.pointEnd);
+		rect.NormalizeRect();
+		m_writer.Write("<ellipse cx=\"");
+		WriteHalf(static_cast<long long>(rect.left) + rect.right - 1);
+		m_writer.Write("\" cy=\"");
+		WriteHalf(static_cast<long long>(rect.top) + rect.bottom - 1);
+		m_writer.Write("\" rx=\"");
+		WriteHalf(max(rect.Width() - 1, 0));
+		m_writer.Write("\" ry=\"");
+		WriteHalf(max(rect.Height() - 1, 0));
+		m_writer.Write('"');
+		WriteStroke(penColor, data.penSize);
+		m_writer.Write("/>\n");
+		break;
+	}
+
+	case DrawData::DrawType::Pencil:
+		WritePath(data.pencilPoints, penColor, data.penSize);
+		break;
+
+	case DrawData::DrawType::Eraser:
+		// 橡皮擦用背景色绘制
+		WritePath(data.pencilPoints, m_bkColor, data.penSize);
+		break;
+
+	case DrawData::DrawType::Text:
+		if (text.IsEmpty())
+			break;
+		m_writer.Write("<text x=\"");
+		m_writer.WriteInt(data.pointBegin.x);
+		m_writer.Write("\" y=\"");
+		m_writer.WriteInt(data.pointBegin.y);
+		m_writer.Write("\" fill=\"");
+		WriteColor(penColor);
+		m_writer.Write("\">");
+		WriteEscapedText(text);
+		m_writer.Write("</text>\n");
+		break;
+	}
+}
+
+bool CSvgWriter::End()
+{
+	m_writer.Write("</g>\n</svg>\n");
+	return m_writer.Flush();
+}
+
+void CSvgWriter::WriteColor(COLORREF color)
+{
+	static const char hex[] = "0123456789abcdef";
+	char text[7] = { '#' };
+	BYTE components[3] = { GetRValue(color), GetGValue(color), GetBValue(color) };
+	for (int i = 0; i < 3; i++)
+	{
+		text[1 + i * 2] = hex[components[i] >> 4];
+		text[2 + i * 2] = hex[components[i] & 0xF];
+	}
+	m_writer.Write(text, sizeof(text));
+}
+
+void CSvgWriter::WriteHalf(long long nTwice)
+{
+	if (nTwice < 0 && nTwice % 2 != 0)
+	{
+		// 例如 -1 / 2 = -0.5：整数部分为 -0
+		m_writer.Write('-');
+		m_writer.WriteInt(-nTwice / 2);
+	}
+	else
+	{
+		m_writer.WriteInt(nTwice / 2);
+	}
+	if (nTwice % 2 != 0)
+		m_writer.Write(".5", 2);
+}
+
+void CSvgWriter::WriteStroke(COLORREF color, int penSize)
+{
+	m_writer.Write(" stroke=\"");
+	WriteColor(color);
+	m_writer.Write('"');
+	if (penSize > 1)
+	{
+		m_writer.Write(" stroke-width=\"");
+		m_writer.WriteInt(penSize);
+		m_writer.Write('"');
+	}
+}
+
+void CSvgWriter::WriteEscapedText(const CString& text)
+{
+	// UTF-16 -> UTF-8，同时转义 XML 特殊字符
+	int nLength = text.GetLength();
+	for (int i = 0; i < nLength; i++)
+	{
+		unsigned int ch = static_cast<unsigned int>(text[i]);
+		if (ch >= 0xD800 && ch <= 0xDBFF && i + 1 < nLength)
+		{
+			unsigned int low = static_cast<unsigned int>(text[i + 1]);
+			if (low >= 0xDC00 && low <= 0xDFFF)
+			{
+				ch = 0x10000 + ((ch - 0xD800) << 10) + (low - 0xDC00);
+				i++;
+			}
+		}
+
+		switch (ch)
+		{
+		case '&': m_writer.Write("&amp;", 5); continue;
+		case '<': m_writer.Write("&lt;", 4); continue;
+		case '>': m_writer.Write("&gt;", 4); continue;
+		case '"': m_writer.Write("&quot;", 6); continue;
+		default: break;
+		}
+
+		if (ch < 0x20 && ch != '\t' && ch != '\n' && ch != '\r')
+			continue;  // XML 不允许的控制字符
+		if (ch >= 0xD800 && ch <= 0xDFFF)
+			ch = 0xFFFD;  // 不成对的代理项
+
+		if (ch < 0x80)
+		{
+			m_writer.Write(static_cast<char>(ch));
+		}
+		else if (ch < 0x800)
+		{
+			m_writer.Write(static_cast<char>(0xC0 | (ch >> 6)));
+			m_writer.Write(static_cast<char>(0x80 | (ch & 0x3F)));
+		}
+		else if (ch < 0x10000)
+		{
+			m_writer.Write(static_cast<char>(0xE0 | (ch >> 12)));
+			m_writer.Write(static_cast<char>(0x80 | ((ch >> 6) & 0x3F)));
+			m_writer.Write(static_cast<char>(0x80 | (ch & 0x3F)));
+		}
+		else
+		{
+			m_writer.Write(static_cast<char>(0xF0 | (ch >> 18)));
+			m_writer.Write(static_cast<char>(0x80 | ((ch >> 12) & 0x3F)));
+			m_writer.Write(static_cast<char>(0x80 | ((ch >> 6) & 0x3F)));
+			m_writer.Write(static_cast<char>(0x80 | (ch & 0x3F)));
+		}
+	}
+}
+
+void CSvgWriter::WritePath(const std::vector<CPoint>& points, COLORREF color, int penSize)
+{
+	// 与 CPencilCommand 一致：少于两个点时不绘制；所有点都重合时 LineTo 也不会画出任何像素
+	if (points.size() < 2)
+		return;
+
+	size_t nFirstMove = 1;
+	while (nFirstMove < points.size() && points[nFirstMove] == points[0])
+		nFirstMove++;
+	if (nFirstMove == points.size())
+		return;
+
+	m_writer.Write("<path d=\"M");
+	m_writer.WriteInt(points[0].x);
+	m_writer.Write(' ');
+	m_writer.WriteInt(points[0].y);
+	m_writer.Write('l');
+
+	// 负号本身可以作为分隔符，只在非负数前写空格
+	bool bFirst = true;
+	CPoint last = points[0];
+	for (size_t i = nFirstMove; i < points.size(); i++)
+	{
+		if (points[i] == last)
+			continue;
+
+		long long dx = static_cast<long long>(points[i].x) - last.x;
+		long long dy = static_cast<long long>(points[i].y) - last.y;
+		if (!bFirst && dx >= 0)
+			m_writer.Write(' ');
+		m_writer.WriteInt(dx);
+		if (dy >= 0)
+			m_writer.Write(' ');
+		m_writer.WriteInt(dy);
+
+		bFirst = false;
+		last = points[i];
+	}
+
+	m_writer.Write('"');
+	WriteStroke(color, penSize);
+	m_writer.Write("/>\n");
+}
@@ -0,0 +1,39 @@
+// SvgWriter.h: 流式 SVG 导出
+// 按顺序把绘图命令直接写成 SVG 元素，不构建文档树；输出经过固定大小的缓冲区，
+// 导出任意数量的命令只占用常量内存。
+//
+
+#pragma once
+
+#include <ostream>
+#include "BufferedWriter.h"
+#include "DrawCommand.h"
+
+class CSvgWriter
+{
+private:
+	CBufferedWriter m_writer;
+	COLORREF m_bkColor;
+
+	// 禁止拷贝构造和赋值
+	CSvgWriter(const CSvgWriter&) = delete;
+	CSvgWriter& operator=(const CSvgWriter&) = delete;
+
+	void WriteColor(COLORREF color);
+	// 写入 nTwice / 2，可能带 .5
+	void WriteHalf(long long nTwice);
+	void WriteStroke(COLORREF color, int penSize);
+	void WriteEscapedText(const CString& text);
+	// 铅笔和橡皮擦轨迹：起点用绝对坐标，之后用相对坐标，省略重复点和多余的分隔符
+	void WritePath(const std::vector<CPoint>& points, COLORREF color, int penSize);
+
+public:
+	explicit CSvgWriter(std::ostream& out);
+
+	// 写入文件头：rectView 为要导出的文档区域，sizeOutput 为图像的显示尺寸
+	bool Begin(const CRect& rectView, CSize sizeOutput, COLORREF bkColor);
+	// 写入一条命令对应的元素，text 为文本命令的内容，palette 为命令所在文档（快照）的颜色表
+	void WriteCommand(const DrawData& data, const CString& text, const CColorPalette& palette);
+	// 写入文件尾并刷新缓冲区
+	bool End();
+};
@@ -0,0 +1,162 @@
+// TextRunCache.cpp: 文本绘制结果缓存的实现
+//
+
+#include "pch.h"
+#include "TextRunCache.h"
+
+#include <string_view>
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+size_t CTextRunCache::CRunKeyHash::operator()(const CRunKey& key) const
+{
+	size_t nHash = key.nTextHash;
+	nHash = nHash * 31 + key.textColor;
+	nHash = nHash * 31 + key.bkColor;
+	nHash = nHash * 31 + static_cast<size_t>(key.logFont.lfHeight);
+	nHash = nHash * 31 + static_cast<size_t>(key.logFont.lfWeight);
+	return nHash;
+}
+
+bool CTextRunCache::IsSameFont(const LOGFONT& font1, const LOGFONT& font2)
+{
+	return font1.lfHeight == font2.lfHeight && font1.lfWidth == font2.lfWidth
+		&& font1.lfEscapement == font2.lfEscapement && font1.lfOrientation == font2.lfOrientation
+		&& font1.lfWeight == font2.lfWeight && font1.lfItalic == font2.lfItalic
+		&& font1.lfUnderline == font2.lfUnderline && font1.lfStrikeOut == font2.lfStrikeOut
+		&& font1.lfCharSet == font2.lfCharSet && font1.lfOutPrecision == font2.lfOutPrecision
+		&& font1.lfClipPrecision == font2.lfClipPrecision && font1.lfQuality == font2.lfQuality
+		&& font1.lfPitchAndFamily == font2.lfPitchAndFamily
+		&& wcsncmp(font1.lfFaceName, font2.lfFaceName, LF_FACESIZE) == 0;
+}
+
+CTextRunCache::~CTextRunCache()
+{
+	// 先删除位图，再删除内存 DC（位图此时未被选入任何 DC）
+	Clear();
+}
+
+CTextRunCache& CTextRunCache::ForCurrentThread()
+{
+	thread_local CTextRunCache cache;
+	return cache;
+}
+
+size_t CTextRunCache::HashText(const CString& text)
+{
+	return std::hash<std::wstring_view>()(std::wstring_view(text.GetString(), text.GetLength()));
+}
+
+BOOL CTextRunCache::Draw(CDC* pDC, CPoint point, const CString& text, size_t nTextHash)
+{
+	if (pDC == nullptr || text.IsEmpty() || pDC->IsPrinting())
+		return FALSE;
+
+	// 位图按设备像素保存，只能在没有缩放和变换、左上角对齐、不透明背景时代替 TextOut
+	const UINT nAlignMask = TA_UPDATECP | TA_RIGHT | TA_CENTER | TA_BOTTOM | TA_BASELINE;
+	if (pDC->GetMapMode() != MM_TEXT || pDC->GetBkMode() != OPAQUE
+		|| (pDC->GetTextAlign() & nAlignMask) != 0 || ::GetGraphicsMode(pDC->GetSafeHdc()) != GM_COMPATIBLE)
+		return FALSE;
+
+	HFONT hFont = static_cast<HFONT>(::GetCurrentObject(pDC->GetSafeHdc(), OBJ_FONT));
+	CRunKey key;
+	if (hFont == nullptr || ::GetObject(hFont, sizeof(LOGFONT), &key.logFont) != sizeof(LOGFONT))
+		return FALSE;
+	key.nTextHash = nTextHash;
+	key.textColor = pDC->GetTextColor();
+	key.bkColor = pDC->GetBkColor();
+
+	try
+	{
+		// CString 复制只增加引用计数
+		CRunEntry* pEntry = nullptr;
+		key.text = text;
+		auto it = m_index.find(key);
+		if (it != m_index.end())
+		{
+			m_entries.splice(m_entries.begin(), m_entries, it->second);
+			pEntry = &*it->second;
+		}
+		else
+		{
+			pEntry = Render(pDC, std::move(key), hFont);
+			if (pEntry == nullptr)
+				return FALSE;
+		}
+
+		HGDIOBJ hOldBitmap = ::SelectObject(*m_memDC, pEntry->bitmap->Get());
+		BOOL bResult = ::BitBlt(pDC->GetSafeHdc(), point.x, point.y, pEntry->size.cx, pEntry->size.cy,
+			*m_memDC, 0, 0, SRCCOPY);
+		::SelectObject(*m_memDC, hOldBitmap);
+		return bResult;
+	}
+	catch (const CGdiObjectException&)
+	{
+		TRACE(_T("Failed to use cached text run\n"));
+		return FALSE;
+	}
+}
+
+CTextRunCache::CRunEntry* CTextRunCache::Render(CDC* pDC, CRunKey&& key, HFONT hFont)
+{
+	CSize size = pDC->GetTextExtent(key.text);
+	LONGLONG nPixels = static_cast<LONGLONG>(size.cx) * size.cy;
+	if (size.cx <= 0 || size.cy <= 0 || nPixels > MAX_RUN_PIXELS)
+		return nullptr;
+
+	if (!m_memDC)
+	{
+		HDC hMemDC = ::CreateCompatibleDC(nullptr);
+		if (hMemDC == nullptr)
+		{
+			throw CGdiObjectException(_T("Failed to create memory DC"));
+		}
+		m_memDC.reset(new CDCWrapper(hMemDC, TRUE));
+	}
+
+	// 位图与目标 DC 兼容，复制时不需要转换像素格式
+	std::unique_ptr<CBitmapWrapper> bitmap(new CBitmapWrapper(pDC->GetSafeHdc(), size.cx, size.cy));
+
+	HDC hMemDC = *m_memDC;
+	HGDIOBJ hOldBitmap = ::SelectObject(hMemDC, bitmap->Get());
+	HGDIOBJ hOldFont = ::SelectObject(hMemDC, hFont);
+	::SetTextColor(hMemDC, key.textColor);
+	::SetBkColor(hMemDC, key.bkColor);
+	::SetBkMode(hMemDC, OPAQUE);
+	::TextOutW(hMemDC, 0, 0, key.text, key.text.GetLength());
+	// 不让内存 DC 继续持有调用方的字体
+	::SelectObject(hMemDC, hOldFont);
+	::SelectObject(hMemDC, hOldBitmap);
+
+	m_entries.push_front(CRunEntry());
+	CRunEntry& entry = m_entries.front();
+	entry.key = std::move(key);
+	entry.size = size;
+	entry.bitmap = std::move(bitmap);
+	m_index[entry.key] = m_entries.begin();
+	m_nPixels += nPixels;
+
+	Trim();
+	return &m_entries.front();
+}
+
+void CTextRunCache::Trim()
+{
+	// 刚加入的条目在表头，至少保留它
+	while (m_entries.size() > 1 && (m_entries.size() > MAX_ENTRIES || m_nPixels > MAX_PIXELS))
+	{
+		CRunEntry& entry = m_entries.back();
+		m_nPixels -= static_cast<LONGLONG>(entry.size.cx) * entry.size.cy;
+		m_index.erase(entry.key);
+		m_entries.pop_back();
+	}
+}
+
+void CTextRunCache::Clear()
+{
+	m_index.clear();
+	m_entries.clear();
+	m_nPixels = 0;
+}
@@ -0,0 +1,87 @@
+// TextRunCache.h: 文本绘制结果的缓存
+// 文本命令重绘时不再每次重新排版字形：第一次绘制时把文本连同背景画到一个兼容位图中，
+// 之后相同的文本、字体、文字颜色和背景色直接 BitBlt 这块位图。任何一项变化都会得到新的键，
+// 旧的位图按最近最少使用的顺序淘汰。
+// 缓存只在逐像素的 MM_TEXT 设备上使用（屏幕、重绘缓冲区、等大导出），缩放、打印和透明背景时
+// 由调用方直接 TextOut。每个线程各有一份缓存，后台导出线程不需要加锁。
+//
+
+#pragma once
+
+#include <afxwin.h>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include "GdiObjectWrapper.h"
+
+class CTextRunCache
+{
+public:
+	// 每个线程的位图数量上限（每个位图占一个 GDI 句柄）；界面、导出、缩略图和保存线程各有一份缓存，
+	// 合计仍远低于进程的 GDI 句柄上限
+	static const size_t MAX_ENTRIES = 64;
+
+private:
+	static const LONGLONG MAX_PIXELS = 8 * 1024 * 1024;  // 所有位图的总像素上限
+	static const LONGLONG MAX_RUN_PIXELS = 1024 * 1024;  // 超过此大小的文本不缓存
+
+	// 缓存键：文本内容、字体、文字颜色、背景色
+	struct CRunKey
+	{
+		CString text;
+		size_t nTextHash;
+		LOGFONT logFont;
+		COLORREF textColor;
+		COLORREF bkColor;
+
+		bool operator==(const CRunKey& other) const
+		{
+			return nTextHash == other.nTextHash && textColor == other.textColor && bkColor == other.bkColor
+				&& IsSameFont(logFont, other.logFont) && text == other.text;
+		}
+	};
+
+	// 逐个字段比较字体；字体名只比较到结尾的 0，之后的字节不一定相同
+	static bool IsSameFont(const LOGFONT& font1, const LOGFONT& font2);
+
+	struct CRunKeyHash
+	{
+		size_t operator()(const CRunKey& key) const;
+	};
+
+	struct CRunEntry
+	{
+		CRunKey key;
+		CSize size;
+		std::unique_ptr<CBitmapWrapper> bitmap;
+	};
+
+	typedef std::list<CRunEntry> CEntryList;
+
+	CEntryList m_entries;  // 最近使用的在前
+	std::unordered_map<CRunKey, CEntryList::iterator, CRunKeyHash> m_index;
+	LONGLONG m_nPixels;
+	std::unique_ptr<CDCWrapper> m_memDC;  // 用于绘制和复制缓存位图的内存 DC
+
+	// 禁止拷贝构造和赋值
+	CTextRunCache(const CTextRunCache&) = delete;
+	CTextRunCache& operator=(const CTextRunCache&) = delete;
+
+	CRunEntry* Render(CDC* pDC, CRunKey&& key, HFONT hFont);
+	void Trim();
+
+public:
+	CTextRunCache() : m_nPixels(0) {}
+	~CTextRunCache();
+
+	// 当前线程的缓存
+	static CTextRunCache& ForCurrentThread();
+
+	// 计算文本的散列值（命令构造时计算一次）
+	static size_t HashText(const CString& text);
+
+	// 在 point 处以 pDC 当前的字体和颜色绘制文本；pDC 的状态不适合使用缓存时返回 FALSE
+	BOOL Draw(CDC* pDC, CPoint point, const CString& text, size_t nTextHash);
+
+	void Clear();
+};
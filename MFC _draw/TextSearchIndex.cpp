@@ -0,0 +1,83 @@
+// TextSearchIndex.cpp: 文本搜索索引的实现
+//
+
+#include "pch.h"
+#include "TextSearchIndex.h"
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+static const wchar_t SEARCH_CONTENT_SEPARATOR = L';';
+
+void CTextSearchIndex::AddText(size_t nCommand, const CString& text)
+{
+	m_strSearchContent += text;
+	m_strSearchContent += SEARCH_CONTENT_SEPARATOR;
+	m_segmentLengths.push_back(text.GetLength() + 1);
+
+	CString strLower(text);
+	strLower.MakeLower();
+	ForEachKey(strLower, [this, nCommand](uint64_t key) {
+		std::vector<size_t>& posting = m_postings[key];
+		// 同一文本中重复出现的键只记录一次
+		if (posting.empty() || posting.back() != nCommand)
+			posting.push_back(nCommand);
+	});
+}
+
+void CTextSearchIndex::RemoveText(size_t nCommand, const CString& text)
+{
+	if (!m_segmentLengths.empty())
+	{
+		m_strSearchContent.Truncate(m_strSearchContent.GetLength() - m_segmentLengths.back());
+		m_segmentLengths.pop_back();
+	}
+
+	CString strLower(text);
+	strLower.MakeLower();
+	ForEachKey(strLower, [this, nCommand](uint64_t key) {
+		auto it = m_postings.find(key);
+		if (it == m_postings.end() || it->second.empty() || it->second.back() != nCommand)
+			return;
+		it->second.pop_back();
+		if (it->second.empty())
+			m_postings.erase(it);
+	});
+}
+
+void CTextSearchIndex::Clear()
+{
+	m_postings.clear();
+	m_strSearchContent.Empty();
+	m_segmentLengths.clear();
+}
+
+void CTextSearchIndex::FindCandidates(const CString& strQuery, std::vector<size_t>& candidates) const
+{
+	candidates.clear();
+	if (strQuery.IsEmpty())
+		return;
+
+	CString strLower(strQuery);
+	strLower.MakeLower();
+
+	// 取查询中最稀有的键对应的倒排表；没有任何命令包含某个键时直接返回空结果
+	const std::vector<size_t>* pShortest = nullptr;
+	bool bMissing = false;
+	ForEachKey(strLower, [this, &pShortest, &bMissing](uint64_t key) {
+		if (bMissing)
+			return;
+		auto it = m_postings.find(key);
+		if (it == m_postings.end())
+		{
+			bMissing = true;
+			return;
+		}
+		if (pShortest == nullptr || it->second.size() < pShortest->size())
+			pShortest = &it->second;
+	});
+
+	if (!bMissing && pShortest != nullptr)
+		candidates = *pShortest;
+}
@@ -0,0 +1,52 @@
+// TextSearchIndex.h: 文本命令的搜索内容和倒排索引
+// 文本命令只会在命令列表末尾追加（添加、重做）或从末尾删除（撤销），
+// 所以搜索内容按段追加/截断，倒排表中的命令序号总是递增，删除时只需弹出表尾；
+// 每次更新的代价与文本长度成正比，不需要重新扫描文档。
+//
+
+#pragma once
+
+#include <afxwin.h>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class CTextSearchIndex
+{
+private:
+	// 倒排表：小写后的单字和相邻两字 -> 包含它的文本命令序号（递增）
+	std::unordered_map<uint64_t, std::vector<size_t>> m_postings;
+	CString m_strSearchContent;        // 所有文本，以“;”分隔
+	std::vector<int> m_segmentLengths;  // 每段（文本加分隔符）在搜索内容中的长度，栈顶为最后一段
+
+	static uint64_t MakeKey(wchar_t first, wchar_t second)
+	{
+		return (static_cast<uint64_t>(static_cast<uint32_t>(first)) << 32) | static_cast<uint32_t>(second);
+	}
+
+	// 枚举文本中的所有键（单字的第二个字符为 0）
+	template<typename TFunc>
+	static void ForEachKey(const CString& strLower, TFunc func)
+	{
+		int nLength = strLower.GetLength();
+		for (int i = 0; i < nLength; i++)
+		{
+			func(MakeKey(strLower[i], 0));
+			if (i + 1 < nLength)
+				func(MakeKey(strLower[i], strLower[i + 1]));
+		}
+	}
+
+public:
+	// 第 nCommand 条命令（文本命令）追加到命令列表末尾
+	void AddText(size_t nCommand, const CString& text);
+	// 最后一条文本命令（第 nCommand 条）从命令列表末尾删除
+	void RemoveText(size_t nCommand, const CString& text);
+	void Clear();
+
+	// 搜索处理程序使用的内容
+	const CString& GetSearchContent() const { return m_strSearchContent; }
+
+	// 查找可能包含 strQuery 的文本命令序号（递增）；结果需要由调用方按实际文本确认
+	void FindCandidates(const CString& strQuery, std::vector<size_t>& candidates) const;
+};
@@ -0,0 +1,121 @@
+// ThumbnailRenderer.cpp: 文档缩略图的实现
+//
+
+#include "pch.h"
+#include "ThumbnailRenderer.h"
+#include "GdiObjectWrapper.h"
+#include "PngWriter.h"
+
+#include <sstream>
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+// 缩放比例：文档范围适应目标区域，不放大
+static double ThumbnailScale(const CRect& extent, CSize sizeTarget)
+{
+	double dScaleX = static_cast<double>(sizeTarget.cx) / extent.Width();
+	double dScaleY = static_cast<double>(sizeTarget.cy) / extent.Height();
+	return min(1.0, min(dScaleX, dScaleY));
+}
+
+void CThumbnailRenderer::Draw(const CDocumentSnapshot& snapshot, CDC* pDC, const CRect& rectTarget, COLORREF bkColor)
+{
+	pDC->FillSolidRect(rectTarget, bkColor);
+
+	CRect extent = snapshot.GetExtent();
+	if (extent.IsRectEmpty() || rectTarget.IsRectEmpty())
+		return;
+
+	const double dScale = ThumbnailScale(extent, rectTarget.Size());
+	CSize sizeScaled(max(1, static_cast<int>(extent.Width() * dScale + 0.5)),
+		max(1, static_cast<int>(extent.Height() * dScale + 0.5)));
+
+	// 缩略图中一个像素对应的文档长度：小于它的命令看不见，偏差小于半个像素的点可以去掉
+	const double dPixel = 1.0 / dScale;
+	const double dTolerance = dPixel / 2;
+
+	int nSavedDC = pDC->SaveDC();
+	pDC->IntersectClipRect(rectTarget);
+	pDC->SetMapMode(MM_ANISOTROPIC);
+	pDC->SetWindowOrg(extent.left, extent.top);
+	pDC->SetWindowExt(extent.Width(), extent.Height());
+	pDC->SetViewportOrg(rectTarget.left + (rectTarget.Width() - sizeScaled.cx) / 2,
+		rectTarget.top + (rectTarget.Height() - sizeScaled.cy) / 2);
+	pDC->SetViewportExt(sizeScaled.cx, sizeScaled.cy);
+
+	for (const CDrawCommandPtr& cmd : snapshot.GetCommands())
+	{
+		const CRect& bounds = cmd->GetBounds();
+		if (bounds.Width() < dPixel && bounds.Height() < dPixel)
+			continue;
+		cmd->ExecuteLowDetail(pDC, snapshot.GetColorPalette(), dTolerance);
+	}
+
+	pDC->RestoreDC(nSavedDC);
+}
+
+BOOL CThumbnailRenderer::RenderPng(const CDocumentSnapshot& snapshot, int nMaxSize, COLORREF bkColor, std::vector<uint8_t>& png)
+{
+	png.clear();
+
+	CRect extent = snapshot.GetExtent();
+	if (extent.IsRectEmpty() || nMaxSize <= 0)
+		return FALSE;
+
+	const double dScale = ThumbnailScale(extent, CSize(nMaxSize, nMaxSize));
+	const int nWidth = max(1, static_cast<int>(extent.Width() * dScale + 0.5));
+	const int nHeight = max(1, static_cast<int>(extent.Height() * dScale + 0.5));
+
+	try
+	{
+		BITMAPINFO bmi;
+		ZeroMemory(&bmi, sizeof(bmi));
+		bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+		bmi.bmiHeader.biWidth = nWidth;
+		bmi.bmiHeader.biHeight = -nHeight;  // 自上而下
+		bmi.bmiHeader.biPlanes = 1;
+		bmi.bmiHeader.biBitCount = 32;
+		bmi.bmiHeader.biCompression = BI_RGB;
+
+		void* pBits = nullptr;
+		HBITMAP hBitmap = CreateDIBSection(nullptr, &bmi, DIB_RGB_COLORS, &pBits, nullptr, 0);
+		if (hBitmap == nullptr)
+		{
+			throw CGdiObjectException(_T("Failed to create thumbnail DIB section"));
+		}
+		CBitmapWrapper bitmap(hBitmap, TRUE);
+
+		HDC hMemDC = CreateCompatibleDC(nullptr);
+		if (hMemDC == nullptr)
+		{
+			throw CGdiObjectException(_T("Failed to create memory DC"));
+		}
+		CDCWrapper memDC(hMemDC, TRUE);
+
+		HGDIOBJ hOldBitmap = SelectObject(memDC, bitmap.Get());
+		Draw(snapshot, CDC::FromHandle(memDC), CRect(0, 0, nWidth, nHeight), bkColor);
+		GdiFlush();
+		SelectObject(memDC, hOldBitmap);
+
+		// 缩略图很小，单线程编码即可
+		std::ostringstream stream(std::ios::binary);
+		CPngRowWriter writer(stream, 1);
+		if (!writer.Begin(nWidth, nHeight)
+			|| !writer.WriteRows(static_cast<const uint8_t*>(pBits), nHeight, nWidth * 4)
+			|| !writer.End())
+		{
+			return FALSE;
+		}
+
+		const std::string& data = stream.str();
+		png.assign(data.begin(), data.end());
+		return TRUE;
+	}
+	catch (const CGdiObjectException&)
+	{
+		TRACE(_T("Failed to render thumbnail\n"));
+		return FALSE;
+	}
+}
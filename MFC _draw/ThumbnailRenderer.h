@@ -0,0 +1,23 @@
+// ThumbnailRenderer.h: 文档缩略图
+// 使用低细节路径绘制：跳过在缩略图中小于一个像素的命令，铅笔和橡皮擦轨迹按缩放后的像素容差简化。
+// 保存文档时把缩略图编码为 PNG 存放在文件头部，外壳预览只需读取文件开头的一小段数据。
+//
+
+#pragma once
+
+#include <afxwin.h>
+#include <cstdint>
+#include <vector>
+#include "CommandHistory.h"
+
+class CThumbnailRenderer
+{
+public:
+	static const int THUMBNAIL_SIZE = 256;  // 缓存缩略图的最大边长（像素）
+
+	// 把文档缩放到 rectTarget 中居中绘制（不放大），背景填充 bkColor
+	static void Draw(const CDocumentSnapshot& snapshot, CDC* pDC, const CRect& rectTarget, COLORREF bkColor);
+
+	// 渲染最大边长为 nMaxSize 的缩略图并编码为 PNG；文档为空或渲染失败时返回 FALSE
+	static BOOL RenderPng(const CDocumentSnapshot& snapshot, int nMaxSize, COLORREF bkColor, std::vector<uint8_t>& png);
+};
@@ -0,0 +1,214 @@
+// TileCanvas.cpp: 稀疏分块缓冲区的实现
+//
+
+#include "pch.h"
+#include "TileCanvas.h"
+#include "TraceProfiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+// 向负无穷取整的除法：像素坐标所在的块号
+static int FloorDiv(int n, int nDivisor)
+{
+	int nQuotient = n / nDivisor;
+	return (n % nDivisor != 0 && n < 0) ? nQuotient - 1 : nQuotient;
+}
+
+static LONGLONG Now()
+{
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	return now.QuadPart;
+}
+
+CRect CTileCanvas::GetTileDocRect(int nTileX, int nTileY, double dZoom)
+{
+	// 多留一个文档单位，避免取整后漏掉恰好压在边界上的命令
+	return CRect(static_cast<int>(std::floor(static_cast<double>(nTileX) * TILE_SIZE / dZoom)) - 1,
+		static_cast<int>(std::floor(static_cast<double>(nTileY) * TILE_SIZE / dZoom)) - 1,
+		static_cast<int>(std::ceil(static_cast<double>(nTileX + 1) * TILE_SIZE / dZoom)) + 1,
+		static_cast<int>(std::ceil(static_cast<double>(nTileY + 1) * TILE_SIZE / dZoom)) + 1);
+}
+
+void CTileCanvas::Clear()
+{
+	m_tiles.clear();
+	m_nBitmaps = 0;
+}
+
+void CTileCanvas::UpdateTile(CTile& tile, int nTileX, int nTileY, CDC* pDC, const CDocumentModel& model, const CViewport& viewport, LONGLONG llDeadline)
+{
+	HDC hMemDC = *m_memDC;
+	CDC* pMemDC = CDC::FromHandle(hMemDC);
+	size_t nCount = model.GetCommandCount();
+
+	// 命令被删除后，包含它的块已由调用方 Invalidate，其余的块只需退回已重放的位置
+	if (tile.nRedrawPos > nCount)
+		tile.nRedrawPos = nCount;
+	if (tile.nRedrawPos >= nCount || Now() >= llDeadline)
+		return;
+
+	if (!tile.bitmap)
+	{
+		// 空白块只向后检查新增的命令，直到出现第一条相交的命令才分配位图
+		tile.nRedrawPos = model.FindIntersecting(GetTileDocRect(nTileX, nTileY, viewport.GetZoom()), tile.nRedrawPos);
+		if (tile.nRedrawPos >= nCount)
+			return;
+
+		// 位图与目标 DC 兼容，复制时不需要转换像素格式
+		tile.bitmap.reset(new CBitmapWrapper(pDC->GetSafeHdc(), TILE_SIZE, TILE_SIZE));
+		m_nBitmaps++;
+		HGDIOBJ hOldBitmap = ::SelectObject(hMemDC, tile.bitmap->Get());
+		pMemDC->FillSolidRect(0, 0, TILE_SIZE, TILE_SIZE, m_bkColor);
+		::SelectObject(hMemDC, hOldBitmap);
+	}
+
+	HGDIOBJ hOldBitmap = ::SelectObject(hMemDC, tile.bitmap->Get());
+	int nSavedDC = pMemDC->SaveDC();
+	viewport.PrepareAtPixel(pMemDC, CPoint(nTileX * TILE_SIZE, nTileY * TILE_SIZE));
+	tile.nRedrawPos = model.RedrawSlice(pMemDC, tile.nRedrawPos, llDeadline, viewport.GetZoom());
+	pMemDC->RestoreDC(nSavedDC);
+	::SelectObject(hMemDC, hOldBitmap);
+}
+
+void CTileCanvas::Invalidate(const CRect& rectDoc, const CViewport& viewport)
+{
+	if (rectDoc.IsRectEmpty() || m_tiles.empty())
+		return;
+
+	// 块的文档区域向外多留一个单位（见 GetTileDocRect），块号范围相应放宽
+	double dZoom = viewport.GetZoom();
+	int nFirstX = FloorDiv(static_cast<int>(std::floor((rectDoc.left - 1) * dZoom)), TILE_SIZE);
+	int nLastX = FloorDiv(static_cast<int>(std::ceil((rectDoc.right + 1) * dZoom)), TILE_SIZE);
+	int nFirstY = FloorDiv(static_cast<int>(std::floor((rectDoc.top - 1) * dZoom)), TILE_SIZE);
+	int nLastY = FloorDiv(static_cast<int>(std::ceil((rectDoc.bottom + 1) * dZoom)), TILE_SIZE);
+
+	auto invalidate = [this](CTile& tile)
+	{
+		// 释放位图，重放时重新查找第一条相交的命令（区域中可能已经没有内容）
+		if (tile.bitmap)
+		{
+			tile.bitmap.reset();
+			m_nBitmaps--;
+		}
+		tile.nRedrawPos = 0;
+	};
+	if ((static_cast<double>(nLastX) - nFirstX + 1) * (static_cast<double>(nLastY) - nFirstY + 1) > static_cast<double>(m_tiles.size()))
+	{
+		for (auto& entry : m_tiles)
+		{
+			int x = static_cast<int>(static_cast<uint32_t>(entry.first >> 32));
+			int y = static_cast<int>(static_cast<uint32_t>(entry.first));
+			if (x >= nFirstX && x <= nLastX && y >= nFirstY && y <= nLastY)
+				invalidate(entry.second);
+		}
+		return;
+	}
+	for (int y = nFirstY; y <= nLastY; y++)
+	{
+		for (int x = nFirstX; x <= nLastX; x++)
+		{
+			auto it = m_tiles.find(MakeKey(x, y));
+			if (it != m_tiles.end())
+				invalidate(it->second);
+		}
+	}
+}
+
+BOOL CTileCanvas::Draw(CDC* pDC, const CRect& rectClip, const CDocumentModel& model, const CViewport& viewport, COLORREF bkColor, LONGLONG llDeadline)
+{
+	PROFILE_FUNCTION();
+	if (bkColor != m_bkColor)
+	{
+		Clear();
+		m_bkColor = bkColor;
+	}
+	if (rectClip.IsRectEmpty())
+		return TRUE;
+
+	if (!m_memDC)
+	{
+		HDC hMemDC = ::CreateCompatibleDC(nullptr);
+		if (hMemDC == nullptr)
+		{
+			throw CGdiObjectException(_T("Failed to create memory DC"));
+		}
+		m_memDC.reset(new CDCWrapper(hMemDC, TRUE));
+	}
+	m_nFrame++;
+
+	// 客户区坐标加上 ptOrigin 为画布像素坐标
+	CPoint ptOrigin = viewport.GetPixelOrigin();
+	int nFirstX = FloorDiv(ptOrigin.x + rectClip.left, TILE_SIZE);
+	int nLastX = FloorDiv(ptOrigin.x + rectClip.right - 1, TILE_SIZE);
+	int nFirstY = FloorDiv(ptOrigin.y + rectClip.top, TILE_SIZE);
+	int nLastY = FloorDiv(ptOrigin.y + rectClip.bottom - 1, TILE_SIZE);
+
+	HDC hMemDC = *m_memDC;
+	size_t nCount = model.GetCommandCount();
+	BOOL bComplete = TRUE;
+	for (int y = nFirstY; y <= nLastY; y++)
+	{
+		for (int x = nFirstX; x <= nLastX; x++)
+		{
+			// 散列表重新分配桶时元素的引用仍然有效
+			CTile& tile = m_tiles[MakeKey(x, y)];
+			tile.nLastFrame = m_nFrame;
+			UpdateTile(tile, x, y, pDC, model, viewport, llDeadline);
+			if (tile.nRedrawPos < nCount)
+				bComplete = FALSE;
+
+			int nLeft = x * TILE_SIZE - ptOrigin.x;
+			int nTop = y * TILE_SIZE - ptOrigin.y;
+			if (tile.bitmap)
+			{
+				HGDIOBJ hOldBitmap = ::SelectObject(hMemDC, tile.bitmap->Get());
+				::BitBlt(pDC->GetSafeHdc(), nLeft, nTop, TILE_SIZE, TILE_SIZE, hMemDC, 0, 0, SRCCOPY);
+				::SelectObject(hMemDC, hOldBitmap);
+			}
+			else
+			{
+				pDC->FillSolidRect(nLeft, nTop, TILE_SIZE, TILE_SIZE, m_bkColor);
+			}
+		}
+	}
+
+	Trim();
+	return bComplete;
+}
+
+void CTileCanvas::Trim()
+{
+	if (m_nBitmaps <= MAX_BITMAPS && m_tiles.size() <= MAX_TILES)
+		return;
+
+	// 本帧可见的块不删除
+	std::vector<std::pair<UINT, uint64_t>> candidates;
+	for (const auto& entry : m_tiles)
+	{
+		if (entry.second.nLastFrame != m_nFrame)
+			candidates.emplace_back(entry.second.nLastFrame, entry.first);
+	}
+	std::sort(candidates.begin(), candidates.end());
+
+	for (const auto& candidate : candidates)
+	{
+		BOOL bTooManyTiles = m_tiles.size() > MAX_TILES;
+		if (!bTooManyTiles && m_nBitmaps <= MAX_BITMAPS)
+			break;
+
+		auto it = m_tiles.find(candidate.second);
+		if (it->second.bitmap)
+			m_nBitmaps--;
+		else if (!bTooManyTiles)
+			continue;  // 只是位图超过上限时保留空白块，它们几乎不占内存
+		m_tiles.erase(it);
+	}
+}
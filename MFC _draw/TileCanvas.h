@@ -0,0 +1,78 @@
+// TileCanvas.h: 视图的稀疏分块缓冲区
+// 画布没有边界：按当前缩放比例把画布像素平面（文档坐标乘以缩放比例）划分为 TILE_SIZE 见方的块，块号可以是任意整数。
+// 块在第一次可见时登记到以块号为键的散列表中，只有与某条命令相交的块才分配位图；空白的块只记录已经检查过的命令数量，
+// 因此位图占用的内存与有内容的面积成正比，与文档的外接矩形和平移过的范围无关。
+// 每块记录已重放到其中的命令数量，绘制时只处理可见的块并按时间片增量重放；平移不会使已完成的块失效。
+// 缩放级别变化等改变全部已绘内容的操作由调用方 Clear；撤销、移动图形等只改变局部内容的操作由调用方 Invalidate 受影响的区域，
+// 只有与该区域相交的块从头重放，其余的块不受影响（撤销删除的命令不在其中，只需把已重放位置退回到命令数量）。
+//
+
+#pragma once
+
+#include <afxwin.h>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include "DocumentModel.h"
+#include "GdiObjectWrapper.h"
+#include "Viewport.h"
+
+class CTileCanvas
+{
+public:
+	static const int TILE_SIZE = 256;  // 块的边长（像素）
+	static const size_t MAX_BITMAPS = 192;  // 位图数量上限（32 位色时约 48 MB），超过时淘汰最久未显示的块
+	static const size_t MAX_TILES = 16384;  // 登记的块（含空白块）数量上限
+
+private:
+	struct CTile
+	{
+		std::unique_ptr<CBitmapWrapper> bitmap;  // 还没有相交的命令时为空
+		size_t nRedrawPos;  // 已重放（空白块为已确认不相交）的命令数量
+		UINT nLastFrame;  // 最近一次可见时的帧号
+
+		CTile() : nRedrawPos(0), nLastFrame(0) {}
+	};
+
+	std::unordered_map<uint64_t, CTile> m_tiles;
+	std::unique_ptr<CDCWrapper> m_memDC;  // 用于重放和复制块位图的内存 DC
+	size_t m_nBitmaps;
+	UINT m_nFrame;
+	COLORREF m_bkColor;
+
+	// 禁止拷贝构造和赋值
+	CTileCanvas(const CTileCanvas&) = delete;
+	CTileCanvas& operator=(const CTileCanvas&) = delete;
+
+	static uint64_t MakeKey(int nTileX, int nTileY)
+	{
+		return (static_cast<uint64_t>(static_cast<uint32_t>(nTileX)) << 32) | static_cast<uint32_t>(nTileY);
+	}
+
+	// 块在文档坐标中覆盖的区域（向外取整）
+	static CRect GetTileDocRect(int nTileX, int nTileY, double dZoom);
+	// 把块重放到 llDeadline 为止；需要时先查找第一条相交的命令并分配位图
+	void UpdateTile(CTile& tile, int nTileX, int nTileY, CDC* pDC, const CDocumentModel& model, const CViewport& viewport, LONGLONG llDeadline);
+	// 数量超过上限时删除本帧不可见的块，最久未显示的先删除
+	void Trim();
+
+public:
+	CTileCanvas() : m_nBitmaps(0), m_nFrame(0), m_bkColor(RGB(255, 255, 255)) {}
+
+	// 丢弃所有块
+	void Clear();
+	// 使与 rectDoc（文档坐标）相交的块失效，下次绘制时从头重放；viewport 为这些块绘制时使用的视口
+	void Invalidate(const CRect& rectDoc, const CViewport& viewport);
+
+	// 按 viewport 把 model 画到 pDC 的 rectClip 区域（客户区坐标，pDC 为 MM_TEXT），空白处以 bkColor 填充；
+	// 可见的块依次重放到 llDeadline（QueryPerformanceCounter 计数）为止，所有可见的块都已完成时返回 TRUE
+	BOOL Draw(CDC* pDC, const CRect& rectClip, const CDocumentModel& model, const CViewport& viewport, COLORREF bkColor, LONGLONG llDeadline);
+
+	size_t GetTileCount() const { return m_tiles.size(); }
+	size_t GetBitmapCount() const { return m_nBitmaps; }
+	// 占用的内存（字节，按 32 位色估算位图）
+	size_t GetMemorySize() const
+	{
+		return m_nBitmaps * TILE_SIZE * TILE_SIZE * 4 + m_tiles.size() * (sizeof(uint64_t) + sizeof(CTile));
+	}
+};
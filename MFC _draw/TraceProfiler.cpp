@@ -0,0 +1,142 @@
+// TraceProfiler.cpp: Chrome 跟踪格式性能分析的实现
+//
+
+#include "pch.h"
+#include "TraceProfiler.h"
+#include "BufferedWriter.h"
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+std::atomic<bool> CTraceProfiler::s_bEnabled(false);
+std::atomic<uint64_t> CTraceProfiler::s_nNextEvent(0);
+std::unique_ptr<CTraceProfiler::CEvent[]> CTraceProfiler::s_pEvents;
+size_t CTraceProfiler::s_nCapacity = 0;
+uint64_t CTraceProfiler::s_nFirstEvent = 0;
+LONGLONG CTraceProfiler::s_llOrigin = 0;
+
+void CTraceProfiler::Start(size_t nCapacity)
+{
+	if (s_pEvents == nullptr)
+	{
+		s_nCapacity = max(nCapacity, static_cast<size_t>(1));
+		s_pEvents.reset(new CEvent[s_nCapacity]);
+		for (size_t i = 0; i < s_nCapacity; i++)
+			s_pEvents[i].nSequence.store(0, std::memory_order_relaxed);
+	}
+
+	// 不重置写入序号：上一次记录中尚未结束的作用域仍可能写入，它们的序号小于 s_nFirstEvent，转储时被跳过
+	s_nFirstEvent = s_nNextEvent.load(std::memory_order_relaxed);
+	s_llOrigin = Now();
+	s_bEnabled.store(true, std::memory_order_release);
+}
+
+void CTraceProfiler::Stop()
+{
+	s_bEnabled.store(false, std::memory_order_release);
+}
+
+void CTraceProfiler::Record(const char* pszName, LONGLONG llStart, LONGLONG llEnd, const char* pszArgName, long long nArg)
+{
+	uint64_t nIndex = s_nNextEvent.fetch_add(1, std::memory_order_relaxed);
+	CEvent& event = s_pEvents[nIndex % s_nCapacity];
+
+	event.nSequence.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	event.pszName = pszName;
+	event.pszArgName = pszArgName;
+	event.nArg = nArg;
+	event.llStart = llStart;
+	event.llDuration = llEnd - llStart;
+	event.nThreadId = GetCurrentThreadId();
+	event.nSequence.store(nIndex + 1, std::memory_order_release);
+}
+
+size_t CTraceProfiler::GetEventCount()
+{
+	uint64_t nRecorded = s_nNextEvent.load(std::memory_order_relaxed) - s_nFirstEvent;
+	return static_cast<size_t>(min(nRecorded, static_cast<uint64_t>(s_nCapacity)));
+}
+
+// 写入 JSON 字符串（含引号）
+static void WriteJsonString(CBufferedWriter& writer, const char* psz)
+{
+	writer.Write('"');
+	for (; *psz != '\0'; psz++)
+	{
+		if (*psz == '"' || *psz == '\\')
+			writer.Write('\\');
+		writer.Write(*psz);
+	}
+	writer.Write('"');
+}
+
+// 把纳秒写成保留三位小数的微秒数（跟踪格式的时间单位）
+static void WriteMicroseconds(CBufferedWriter& writer, long long nNanoseconds)
+{
+	if (nNanoseconds < 0)
+		nNanoseconds = 0;
+	writer.WriteInt(nNanoseconds / 1000);
+	int nFraction = static_cast<int>(nNanoseconds % 1000);
+	char digits[4] = { '.', static_cast<char>('0' + nFraction / 100), static_cast<char>('0' + nFraction / 10 % 10), static_cast<char>('0' + nFraction % 10) };
+	writer.Write(digits, sizeof(digits));
+}
+
+bool CTraceProfiler::WriteJson(std::ostream& out)
+{
+	CBufferedWriter writer(out);
+	writer.Write("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+	if (s_pEvents != nullptr)
+	{
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		auto toNanoseconds = [&](LONGLONG llTicks)
+		{
+			return static_cast<long long>(static_cast<double>(llTicks) * 1e9 / frequency.QuadPart);
+		};
+
+		uint64_t nEnd = s_nNextEvent.load(std::memory_order_acquire);
+		uint64_t nBegin = max(s_nFirstEvent, nEnd > s_nCapacity ? nEnd - s_nCapacity : 0);
+		bool bFirst = true;
+		for (uint64_t i = nBegin; i < nEnd; i++)
+		{
+			// 复制后再检查一次序号，跳过正在写入或已被覆盖的事件
+			const CEvent& slot = s_pEvents[i % s_nCapacity];
+			if (slot.nSequence.load(std::memory_order_acquire) != i + 1)
+				continue;
+			const char* pszName = slot.pszName;
+			const char* pszArgName = slot.pszArgName;
+			long long nArg = slot.nArg;
+			LONGLONG llStart = slot.llStart;
+			LONGLONG llDuration = slot.llDuration;
+			DWORD nThreadId = slot.nThreadId;
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slot.nSequence.load(std::memory_order_relaxed) != i + 1)
+				continue;
+
+			writer.Write(bFirst ? "\n{\"name\":" : ",\n{\"name\":");
+			bFirst = false;
+			WriteJsonString(writer, pszName);
+			writer.Write(",\"cat\":\"draw\",\"ph\":\"X\",\"pid\":1,\"tid\":");
+			writer.WriteInt(nThreadId);
+			writer.Write(",\"ts\":");
+			WriteMicroseconds(writer, toNanoseconds(llStart - s_llOrigin));
+			writer.Write(",\"dur\":");
+			WriteMicroseconds(writer, toNanoseconds(llDuration));
+			if (pszArgName != nullptr)
+			{
+				writer.Write(",\"args\":{");
+				WriteJsonString(writer, pszArgName);
+				writer.Write(':');
+				writer.WriteInt(nArg);
+				writer.Write('}');
+			}
+			writer.Write('}');
+		}
+	}
+
+	writer.Write("\n]}\n");
+	return writer.Flush();
+}
@@ -0,0 +1,110 @@
+// TraceProfiler.h: Chrome 跟踪格式的性能分析
+// 打开后，PROFILE_SCOPE 标记的作用域在退出时把名称、开始时间、耗时和线程号写入固定大小的环形缓冲区，
+// 缓冲区满后覆盖最旧的事件；需要时转储为 Chrome Trace Event JSON（可以在 chrome://tracing 或 Perfetto 中打开）。
+// 关闭时每个作用域只读取一次全局开关并跳过，不计时、不写缓冲区。
+// 事件名称和参数名必须是静态字符串（字面量或 __FUNCTION__），缓冲区只保存指针。
+//
+
+#pragma once
+
+#include <afxwin.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+
+class CTraceProfiler
+{
+private:
+	// 环形缓冲区中的一个事件；nSequence 为写入序号加 1，写入期间为 0，转储时用来跳过未写完或已被覆盖的事件
+	struct CEvent
+	{
+		std::atomic<uint64_t> nSequence;
+		const char* pszName;
+		const char* pszArgName;  // 没有参数时为 nullptr
+		long long nArg;
+		LONGLONG llStart;     // QueryPerformanceCounter 计数
+		LONGLONG llDuration;
+		DWORD nThreadId;
+	};
+
+	static std::atomic<bool> s_bEnabled;
+	static std::atomic<uint64_t> s_nNextEvent;  // 下一个事件的写入序号
+	static std::unique_ptr<CEvent[]> s_pEvents;  // 第一次开始时分配，之后不再释放（其他线程可能仍在写入）
+	static size_t s_nCapacity;
+	static uint64_t s_nFirstEvent;  // 本次开始时的写入序号，之前的事件不再转储
+	static LONGLONG s_llOrigin;  // 本次开始时的计数，转储的时间戳相对于它
+
+public:
+	static const size_t DEFAULT_CAPACITY = 256 * 1024;  // 默认保存最近的事件数
+
+	// 与 Start 中的 release 配对，保证看到开关打开时缓冲区已经分配
+	static bool IsEnabled() { return s_bEnabled.load(std::memory_order_acquire); }
+
+	// 清空缓冲区并开始记录；只在拥有者（界面）线程中调用，第一次调用时按 nCapacity 分配缓冲区
+	static void Start(size_t nCapacity = DEFAULT_CAPACITY);
+	// 停止记录，已记录的事件保留到下一次开始
+	static void Stop();
+
+	// 当前时间（QueryPerformanceCounter 计数）
+	static LONGLONG Now()
+	{
+		LARGE_INTEGER now;
+		QueryPerformanceCounter(&now);
+		return now.QuadPart;
+	}
+
+	// 写入一个完整事件（可以在任何线程中调用）
+	static void Record(const char* pszName, LONGLONG llStart, LONGLONG llEnd, const char* pszArgName, long long nArg);
+
+	// 缓冲区中的事件数（不超过容量）
+	static size_t GetEventCount();
+	// 把缓冲区中的事件按 Chrome Trace Event JSON 格式写入 out，返回输出流是否正常
+	static bool WriteJson(std::ostream& out);
+};
+
+// 作用域事件：构造时开始计时，析构时写入
+class CTraceScope
+{
+private:
+	const char* m_pszName;  // 未记录时为 nullptr
+	const char* m_pszArgName;
+	long long m_nArg;
+	LONGLONG m_llStart;
+
+	// 禁止拷贝构造和赋值
+	CTraceScope(const CTraceScope&) = delete;
+	CTraceScope& operator=(const CTraceScope&) = delete;
+
+public:
+	explicit CTraceScope(const char* pszName, const char* pszArgName = nullptr, long long nArg = 0)
+	{
+		if (CTraceProfiler::IsEnabled())
+		{
+			m_pszName = pszName;
+			m_pszArgName = pszArgName;
+			m_nArg = nArg;
+			m_llStart = CTraceProfiler::Now();
+		}
+		else
+		{
+			m_pszName = nullptr;
+		}
+	}
+
+	~CTraceScope()
+	{
+		if (m_pszName != nullptr)
+			CTraceProfiler::Record(m_pszName, m_llStart, CTraceProfiler::Now(), m_pszArgName, m_nArg);
+	}
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+// 记录当前作用域，name 为静态字符串
+#define PROFILE_SCOPE(name) CTraceScope PROFILE_CONCAT(_profileScope, __LINE__)(name)
+// 记录当前作用域并附带一个整数参数（如命令序号）
+#define PROFILE_SCOPE_ARG(name, argName, arg) CTraceScope PROFILE_CONCAT(_profileScope, __LINE__)(name, argName, static_cast<long long>(arg))
+// 以函数名记录当前函数
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
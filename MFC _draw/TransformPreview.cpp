@@ -0,0 +1,118 @@
+// TransformPreview.cpp: 拖动选中图形时的预览的实现
+//
+
+#include "pch.h"
+#include "TransformPreview.h"
+#include "TraceProfiler.h"
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+CTransformPreview::CLayer::CLayer(HDC hCompatibleDC, int nWidth, int nHeight)
+	: m_hOldBitmap(nullptr)
+{
+	m_dc.reset(new CDCWrapper(hCompatibleDC));
+	m_bitmap.reset(new CBitmapWrapper(hCompatibleDC, nWidth, nHeight));
+	m_hOldBitmap = ::SelectObject(m_dc->Get(), m_bitmap->Get());
+}
+
+CTransformPreview::CLayer::~CLayer()
+{
+	// 先换回原来的位图，位图才能被删除
+	::SelectObject(m_dc->Get(), m_hOldBitmap);
+}
+
+COLORREF CTransformPreview::ChooseTransparentColor(const CDocumentModel& model, const std::vector<size_t>& selection)
+{
+	static const COLORREF candidates[] = { RGB(255, 0, 255), RGB(0, 255, 1), RGB(1, 2, 3), RGB(254, 1, 253) };
+	for (COLORREF color : candidates)
+	{
+		BOOL bUsed = FALSE;
+		for (size_t i : selection)
+		{
+			if (model.GetCommand(i)->GetData().GetPenColor(model.GetColorPalette()) == color)
+			{
+				bUsed = TRUE;
+				break;
+			}
+		}
+		if (!bUsed)
+			return color;
+	}
+	return candidates[0];
+}
+
+void CTransformPreview::Begin(CDC* pDC, const CRect& rectClient, const CDocumentModel& model, const std::vector<size_t>& selection,
+	const CRect& rectSelection, const CViewport& viewport, COLORREF bkColor)
+{
+	PROFILE_FUNCTION();
+	End();
+	m_rectClient = rectClient;
+	HDC hDC = pDC->GetSafeHdc();
+	int nWidth = max(rectClient.Width(), 1);
+	int nHeight = max(rectClient.Height(), 1);
+
+	// 背景：除选中的命令以外的所有命令，只画一次
+	m_background.reset(new CLayer(hDC, nWidth, nHeight));
+	CDC* pBackgroundDC = m_background->GetDC();
+	pBackgroundDC->FillSolidRect(0, 0, nWidth, nHeight, bkColor);
+	pBackgroundDC->SetBkColor(bkColor);
+	int nSavedDC = pBackgroundDC->SaveDC();
+	viewport.Prepare(pBackgroundDC);
+	model.RedrawSelection(pBackgroundDC, selection, FALSE, viewport.GetZoom());
+	pBackgroundDC->RestoreDC(nSavedDC);
+
+	// 精灵：选中区域超出客户区很多时只保留客户区周围一屏的范围，拖进窗口的部分仍然可以显示
+	CRect rectLimit(rectClient);
+	rectLimit.InflateRect(nWidth, nHeight);
+	m_rectSprite = viewport.DocToClient(rectSelection);
+	m_rectSprite.IntersectRect(m_rectSprite, rectLimit);
+	if (!m_rectSprite.IsRectEmpty())
+	{
+		m_transparentColor = ChooseTransparentColor(model, selection);
+		m_sprite.reset(new CLayer(hDC, m_rectSprite.Width(), m_rectSprite.Height()));
+		CDC* pSpriteDC = m_sprite->GetDC();
+		pSpriteDC->FillSolidRect(0, 0, m_rectSprite.Width(), m_rectSprite.Height(), m_transparentColor);
+		pSpriteDC->SetBkColor(m_transparentColor);  // 文本的背景也是透明色
+		nSavedDC = pSpriteDC->SaveDC();
+		viewport.Prepare(pSpriteDC);
+		CPoint ptOrigin = pSpriteDC->GetViewportOrg();
+		pSpriteDC->SetViewportOrg(ptOrigin.x - m_rectSprite.left, ptOrigin.y - m_rectSprite.top);
+		model.RedrawSelection(pSpriteDC, selection, TRUE, viewport.GetZoom());
+		pSpriteDC->RestoreDC(nSavedDC);
+	}
+
+	m_backBuffer.reset(new CLayer(hDC, nWidth, nHeight));
+}
+
+void CTransformPreview::Draw(CDC* pDC, const DrawTransform& transform)
+{
+	PROFILE_FUNCTION();
+	if (!IsActive())
+		return;
+
+	HDC hBackBuffer = m_backBuffer->GetSafeHdc();
+	int nWidth = m_rectClient.Width();
+	int nHeight = m_rectClient.Height();
+	::BitBlt(hBackBuffer, 0, 0, nWidth, nHeight, m_background->GetSafeHdc(), 0, 0, SRCCOPY);
+	if (m_sprite)
+	{
+		// 缩放时直接拉伸精灵，画笔宽度随之变化；提交后按实际命令重绘
+		CRect rectTarget = transform.Apply(m_rectSprite);
+		if (rectTarget.Width() > 0 && rectTarget.Height() > 0)
+		{
+			::TransparentBlt(hBackBuffer, rectTarget.left - m_rectClient.left, rectTarget.top - m_rectClient.top,
+				rectTarget.Width(), rectTarget.Height(), m_sprite->GetSafeHdc(), 0, 0, m_rectSprite.Width(), m_rectSprite.Height(),
+				m_transparentColor);
+		}
+	}
+	::BitBlt(pDC->GetSafeHdc(), m_rectClient.left, m_rectClient.top, nWidth, nHeight, hBackBuffer, 0, 0, SRCCOPY);
+}
+
+void CTransformPreview::End()
+{
+	m_backBuffer.reset();
+	m_sprite.reset();
+	m_background.reset();
+}
@@ -0,0 +1,64 @@
+// TransformPreview.h: 拖动选中图形时的预览
+// 开始拖动时把其余的命令画成冻结的背景位图（客户区大小），把选中的命令画成精灵位图（选中区域大小，以透明色为底）；
+// 拖动过程中每一帧只需把背景和按变换拉伸的精灵依次复制到后台位图，再一次复制到屏幕，代价与命令数量无关。
+// 松开鼠标后由调用方提交变换，并只重绘变换前后的区域。
+// 精灵中的命令按原来的先后顺序绘制；原来盖在选中图形上的其他命令在预览中被精灵遮住，提交后恢复正确的遮挡关系。
+//
+
+#pragma once
+
+#include <afxwin.h>
+#include <memory>
+#include <vector>
+#include "DocumentModel.h"
+#include "GdiObjectWrapper.h"
+#include "Viewport.h"
+
+class CTransformPreview
+{
+private:
+	// 选入了一张位图的内存 DC
+	class CLayer
+	{
+	private:
+		std::unique_ptr<CDCWrapper> m_dc;
+		std::unique_ptr<CBitmapWrapper> m_bitmap;
+		HGDIOBJ m_hOldBitmap;
+
+		CLayer(const CLayer&) = delete;
+		CLayer& operator=(const CLayer&) = delete;
+
+	public:
+		CLayer(HDC hCompatibleDC, int nWidth, int nHeight);
+		~CLayer();
+		CDC* GetDC() const { return CDC::FromHandle(m_dc->Get()); }
+		HDC GetSafeHdc() const { return m_dc->Get(); }
+	};
+
+	std::unique_ptr<CLayer> m_background;  // 未选中的命令
+	std::unique_ptr<CLayer> m_sprite;      // 选中的命令，底色为 m_transparentColor
+	std::unique_ptr<CLayer> m_backBuffer;  // 合成一帧
+	CRect m_rectClient;
+	CRect m_rectSprite;  // 精灵对应的客户区区域（选中区域与客户区附近的交集）
+	COLORREF m_transparentColor;
+
+	CTransformPreview(const CTransformPreview&) = delete;
+	CTransformPreview& operator=(const CTransformPreview&) = delete;
+
+	// 选择与 selection 中所有命令的画笔颜色都不同的透明色
+	static COLORREF ChooseTransparentColor(const CDocumentModel& model, const std::vector<size_t>& selection);
+
+public:
+	CTransformPreview() : m_transparentColor(0) {}
+
+	// 开始拖动：pDC 为客户区 DC（MM_TEXT），rectSelection 为选中命令外接矩形的并集（文档坐标）；
+	// 无法创建位图时抛出 CGdiObjectException
+	void Begin(CDC* pDC, const CRect& rectClient, const CDocumentModel& model, const std::vector<size_t>& selection,
+		const CRect& rectSelection, const CViewport& viewport, COLORREF bkColor);
+	// 画出一帧：transform 为客户区坐标中的变换（由文档坐标中的变换按视口换算）
+	void Draw(CDC* pDC, const DrawTransform& transform);
+	// 结束拖动，释放位图
+	void End();
+
+	BOOL IsActive() const { return m_background != nullptr; }
+};
@@ -0,0 +1,189 @@
+// Viewport.cpp: 视图缩放和平移的实现
+//
+
+#include "pch.h"
+#include "Viewport.h"
+
+#include <cmath>
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+int CViewport::GetViewportExtent(int nZoomLevel)
+{
+	return static_cast<int>(std::lround(ZOOM_EXTENT * std::pow(2.0, nZoomLevel / 2.0)));
+}
+
+BOOL CViewport::SetZoomLevel(int nZoomLevel, CPoint ptAnchor)
+{
+	nZoomLevel = max(static_cast<int>(MIN_ZOOM_LEVEL), min(static_cast<int>(MAX_ZOOM_LEVEL), nZoomLevel));
+	if (nZoomLevel == m_nZoomLevel)
+		return FALSE;
+
+	// 缩放前后 ptAnchor 对应同一个文档坐标
+	double dOldZoom = GetZoom();
+	double dAnchorX = m_dOriginX + ptAnchor.x / dOldZoom;
+	double dAnchorY = m_dOriginY + ptAnchor.y / dOldZoom;
+	m_nZoomLevel = nZoomLevel;
+	double dZoom = GetZoom();
+	m_dOriginX = dAnchorX - ptAnchor.x / dZoom;
+	m_dOriginY = dAnchorY - ptAnchor.y / dZoom;
+
+	// 100% 时使用整数原点，绘制与缩放前的 1:1 映射完全一致
+	if (m_nZoomLevel == 0)
+	{
+		m_dOriginX = std::floor(m_dOriginX + 0.5);
+		m_dOriginY = std::floor(m_dOriginY + 0.5);
+	}
+	return TRUE;
+}
+
+void CViewport::Pan(CSize sizeClient)
+{
+	double dZoom = GetZoom();
+	m_dOriginX -= sizeClient.cx / dZoom;
+	m_dOriginY -= sizeClient.cy / dZoom;
+}
+
+void CViewport::Reset()
+{
+	m_dOriginX = m_dOriginY = 0;
+	m_nZoomLevel = 0;
+}
+
+void CViewport::FitRect(const CRect& rect, CSize sizeClient)
+{
+	if (rect.IsRectEmpty() || sizeClient.cx <= 0 || sizeClient.cy <= 0)
+	{
+		Reset();
+		return;
+	}
+
+	m_nZoomLevel = 0;
+	while (m_nZoomLevel > MIN_ZOOM_LEVEL
+		&& (rect.Width() * GetZoom() > sizeClient.cx || rect.Height() * GetZoom() > sizeClient.cy))
+	{
+		m_nZoomLevel--;
+	}
+
+	double dZoom = GetZoom();
+	m_dOriginX = rect.left - (sizeClient.cx / dZoom - rect.Width()) / 2;
+	m_dOriginY = rect.top - (sizeClient.cy / dZoom - rect.Height()) / 2;
+	if (m_nZoomLevel == 0)
+	{
+		m_dOriginX = std::floor(m_dOriginX + 0.5);
+		m_dOriginY = std::floor(m_dOriginY + 0.5);
+	}
+}
+
+BOOL CViewport::EnsureVisible(const CRect& rect, CSize sizeClient)
+{
+	CRect rectVisible = GetVisibleDocRect(sizeClient);
+	CRect rectIntersect;
+	if (rectIntersect.IntersectRect(&rectVisible, &rect) && rectIntersect == rect)
+		return FALSE;
+
+	double dZoom = GetZoom();
+	m_dOriginX = std::floor((rect.left + rect.right) / 2.0 - sizeClient.cx / dZoom / 2);
+	m_dOriginY = std::floor((rect.top + rect.bottom) / 2.0 - sizeClient.cy / dZoom / 2);
+	return TRUE;
+}
+
+CPoint CViewport::GetPixelOrigin() const
+{
+	double dZoom = GetZoom();
+	return CPoint(static_cast<int>(std::floor(m_dOriginX * dZoom + 0.5)), static_cast<int>(std::floor(m_dOriginY * dZoom + 0.5)));
+}
+
+CPoint CViewport::ClientToDoc(CPoint point) const
+{
+	double dZoom = GetZoom();
+	return CPoint(static_cast<int>(std::floor(m_dOriginX + point.x / dZoom + 0.5)),
+		static_cast<int>(std::floor(m_dOriginY + point.y / dZoom + 0.5)));
+}
+
+CPoint CViewport::DocToClient(CPoint point) const
+{
+	double dZoom = GetZoom();
+	return CPoint(static_cast<int>(std::floor((point.x - m_dOriginX) * dZoom + 0.5)),
+		static_cast<int>(std::floor((point.y - m_dOriginY) * dZoom + 0.5)));
+}
+
+CRect CViewport::DocToClient(const CRect& rect) const
+{
+	double dZoom = GetZoom();
+	return CRect(static_cast<int>(std::floor((rect.left - m_dOriginX) * dZoom)),
+		static_cast<int>(std::floor((rect.top - m_dOriginY) * dZoom)),
+		static_cast<int>(std::ceil((rect.right - m_dOriginX) * dZoom)),
+		static_cast<int>(std::ceil((rect.bottom - m_dOriginY) * dZoom)));
+}
+
+CRect CViewport::GetVisibleDocRect(CSize sizeClient) const
+{
+	double dZoom = GetZoom();
+	return CRect(static_cast<int>(std::floor(m_dOriginX)), static_cast<int>(std::floor(m_dOriginY)),
+		static_cast<int>(std::ceil(m_dOriginX + sizeClient.cx / dZoom)),
+		static_cast<int>(std::ceil(m_dOriginY + sizeClient.cy / dZoom)));
+}
+
+void CViewport::Prepare(CDC* pDC) const
+{
+	// 原点的整数部分作为窗口原点，小数部分换算成像素作为视口原点
+	double dZoom = GetZoom();
+	double dWindowX = std::floor(m_dOriginX);
+	double dWindowY = std::floor(m_dOriginY);
+	if (m_nZoomLevel == 0)
+	{
+		pDC->SetMapMode(MM_TEXT);
+	}
+	else
+	{
+		pDC->SetMapMode(MM_ANISOTROPIC);
+		pDC->SetWindowExt(ZOOM_EXTENT, ZOOM_EXTENT);
+		pDC->SetViewportExt(GetViewportExtent(m_nZoomLevel), GetViewportExtent(m_nZoomLevel));
+	}
+	pDC->SetWindowOrg(static_cast<int>(dWindowX), static_cast<int>(dWindowY));
+	pDC->SetViewportOrg(-static_cast<int>(std::lround((m_dOriginX - dWindowX) * dZoom)),
+		-static_cast<int>(std::lround((m_dOriginY - dWindowY) * dZoom)));
+}
+
+// 小于等于 n 的最大的 nPeriod 的倍数
+static int FloorToMultiple(int n, int nPeriod)
+{
+	int nRemainder = n % nPeriod;
+	return nRemainder < 0 ? n - nRemainder - nPeriod : n - nRemainder;
+}
+
+void CViewport::PrepareAtPixel(CDC* pDC, CPoint ptPixel) const
+{
+	if (m_nZoomLevel == 0)
+	{
+		pDC->SetMapMode(MM_TEXT);
+		pDC->SetWindowOrg(ptPixel.x, ptPixel.y);
+		pDC->SetViewportOrg(0, 0);
+		return;
+	}
+
+	// 窗口原点取 nPeriod 的倍数，它换算成像素恰好是整数，映射的取整与窗口原点为 0 时完全相同；
+	// 同时窗口原点靠近 ptPixel，设备坐标保持在 GDI 的范围内
+	int nViewportExtent = GetViewportExtent(m_nZoomLevel);
+	int a = ZOOM_EXTENT, b = nViewportExtent;
+	while (b != 0)
+	{
+		int t = a % b;
+		a = b;
+		b = t;
+	}
+	int nPeriod = ZOOM_EXTENT / a;
+	double dZoom = GetZoom();
+	int nWindowX = FloorToMultiple(static_cast<int>(std::floor(ptPixel.x / dZoom)), nPeriod);
+	int nWindowY = FloorToMultiple(static_cast<int>(std::floor(ptPixel.y / dZoom)), nPeriod);
+
+	pDC->SetMapMode(MM_ANISOTROPIC);
+	pDC->SetWindowExt(ZOOM_EXTENT, ZOOM_EXTENT);
+	pDC->SetViewportExt(nViewportExtent, nViewportExtent);
+	pDC->SetWindowOrg(nWindowX, nWindowY);
+	pDC->SetViewportOrg(static_cast<int>(static_cast<long long>(nWindowX) * nViewportExtent / ZOOM_EXTENT) - ptPixel.x,
+		static_cast<int>(static_cast<long long>(nWindowY) * nViewportExtent / ZOOM_EXTENT) - ptPixel.y);
+}
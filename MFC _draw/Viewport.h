@@ -0,0 +1,58 @@
+// Viewport.h: 视图的缩放和平移
+// 文档坐标到客户区坐标的变换：客户区左上角对应文档坐标 (m_dOriginX, m_dOriginY)，一个文档单位显示为 GetZoom() 个像素。
+// 缩放按 √2 倍分级，从 1/64 到 32 倍；绘制时由 Prepare 以映射模式应用到 DC，命令和文档数据不受影响。
+// 原点保存为小数，放大后平移一个像素（不到一个文档单位）也不会丢失。
+//
+
+#pragma once
+
+#include <afxwin.h>
+
+class CViewport
+{
+private:
+	double m_dOriginX;  // 客户区左上角的文档坐标
+	double m_dOriginY;
+	int m_nZoomLevel;   // 缩放级别：0 为 100%，每级 √2 倍
+
+	// 映射模式的窗口范围；视口范围为 ZOOM_EXTENT 乘以缩放比例，缩放比例由两者之比决定
+	static const int ZOOM_EXTENT = 4096;
+	static int GetViewportExtent(int nZoomLevel);
+
+public:
+	static const int MIN_ZOOM_LEVEL = -12;  // 1/64
+	static const int MAX_ZOOM_LEVEL = 10;   // 32 倍
+
+	CViewport() : m_dOriginX(0), m_dOriginY(0), m_nZoomLevel(0) {}
+
+	// 一个文档单位对应的像素数
+	double GetZoom() const { return static_cast<double>(GetViewportExtent(m_nZoomLevel)) / ZOOM_EXTENT; }
+	int GetZoomLevel() const { return m_nZoomLevel; }
+	// 客户区左上角在画布像素坐标中的位置；画布像素坐标为文档坐标乘以缩放比例，与平移无关
+	CPoint GetPixelOrigin() const;
+
+	// 设置缩放级别（超出范围时取边界值），客户区中 ptAnchor 处的文档内容保持不动；级别没有变化时返回 FALSE
+	BOOL SetZoomLevel(int nZoomLevel, CPoint ptAnchor);
+	BOOL ZoomBy(int nSteps, CPoint ptAnchor) { return SetZoomLevel(m_nZoomLevel + nSteps, ptAnchor); }
+	// 内容随鼠标移动 sizeClient 像素
+	void Pan(CSize sizeClient);
+	// 恢复 100%，客户区左上角为文档原点
+	void Reset();
+	// 选择能完整显示文档区域 rect 的最大缩放级别（不超过 100%），并把它居中到 sizeClient 大小的客户区中
+	void FitRect(const CRect& rect, CSize sizeClient);
+	// 文档区域 rect 不在 sizeClient 大小的客户区中时平移，使它位于客户区中央；需要平移时返回 TRUE
+	BOOL EnsureVisible(const CRect& rect, CSize sizeClient);
+
+	// 客户区坐标与文档坐标的转换（与映射模式相同的取整）
+	CPoint ClientToDoc(CPoint point) const;
+	CPoint DocToClient(CPoint point) const;
+	CRect DocToClient(const CRect& rect) const;
+	// 客户区中可见的文档区域
+	CRect GetVisibleDocRect(CSize sizeClient) const;
+
+	// 设置 pDC 的映射模式和原点，之后在 pDC 上按文档坐标绘制；100% 时保持 MM_TEXT
+	void Prepare(CDC* pDC) const;
+	// 与 Prepare 相同，但 pDC 的 (0, 0) 对应画布像素 ptPixel（不受平移影响，供分块缓冲区使用）；
+	// 同一缩放级别下，任意两个 ptPixel 得到的绘制结果只相差整数像素的平移，相邻的块可以无缝拼接
+	void PrepareAtPixel(CDC* pDC, CPoint ptPixel) const;
+};
@@ -8,6 +8,11 @@
 #define PCH_H
 
 // 添加要在此处预编译的标头
+#ifdef DRAW_HEADLESS
+// 无界面构建（bench 目录下的基准测试）：afxwin.h 由 bench/compat 提供，只包含绘图核心用到的部分
+#include <afxwin.h>
+#else
 #include "framework.h"
+#endif
 
 #endif //PCH_H
@@ -7,10 +7,16 @@
 #define IDR_MAINFRAME                   128
 #define IDR_MFCdrawTYPE                 130
 #define IDD_DIALOG1                     310
+#define IDD_EXPORT_IMAGE                311
+#define IDD_FIND_TEXT                   313
 #define IDC_EDIT1                       1000
 #define IDC_EDIT2                       1001
 #define IDC_EDIT3                       1002
 #define IDC_EDIT4                       1003
+#define IDC_EXPORT_DPI                  1004
+#define IDC_EXPORT_WIDTH                1005
+#define IDC_EXPORT_HEIGHT               1006
+#define IDC_FIND_TEXT                   1007
 #define ID_32771                        32771
 #define ID_32772                        32772
 #define ID_32773                        32773
@@ -28,14 +34,31 @@
 #define ID_LANGUAGE_JAPANESE            32783
 #define ID_32783                        32783
 #define ID_32784                        32784
+#define ID_FILE_EXPORT_IMAGE            32785
+#define ID_EDIT_FIND_NEXT               32786
+#define ID_FILE_RECORD_TRACE            32787
+#define ID_INDICATOR_DRAW_TIME          32788
+#define ID_INDICATOR_REDRAW             32789
+#define ID_INDICATOR_GDI                32790
+#define ID_INDICATOR_MEMORY             32791
+#define ID_FILE_PROFILE_TRACE           32792
+#define ID_FILE_SAVE_PROFILE_TRACE      32793
+#define ID_VIEW_ZOOM_IN                 32794
+#define ID_VIEW_ZOOM_OUT                32795
+#define ID_VIEW_ZOOM_ACTUAL             32796
+#define ID_VIEW_ZOOM_FIT                32797
+#define ID_EDIT_SELECT_TOOL             32798
+#define ID_FILE_IMPORT_RECORDS          32799
+#define ID_EDIT_PREV_BRANCH             32800
+#define ID_EDIT_NEXT_BRANCH             32801
 
 // Next default values for new objects
 // 
 #ifdef APSTUDIO_INVOKED
 #ifndef APSTUDIO_READONLY_SYMBOLS
-#define _APS_NEXT_RESOURCE_VALUE        312
-#define _APS_NEXT_COMMAND_VALUE         32785
-#define _APS_NEXT_CONTROL_VALUE         1004
+#define _APS_NEXT_RESOURCE_VALUE        314
+#define _APS_NEXT_COMMAND_VALUE         32802
+#define _APS_NEXT_CONTROL_VALUE         1008
 #define _APS_NEXT_SYMED_VALUE           310
 #endif
 #endif
@@ -0,0 +1,82 @@
+// AllocationHook.cpp: drawbench 的分配钩子
+// bench 环境没有 CRT 调试堆，这里替换全局 operator new，把每次分配报告给 CAllocationCounter，
+// 基准测试据此检查鼠标移动等热路径在稳定状态下不分配内存。
+// 只链接到 drawbench：计数本身只是两次线程局部变量的累加，不影响计时。
+//
+
+#include "pch.h"
+#include "AllocationCounter.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+	// 静态初始化时标记计数有效
+	struct CAllocationHookInstaller
+	{
+		CAllocationHookInstaller() { CAllocationCounter::MarkActive(); }
+	} g_installer;
+
+	void* CountedAlloc(size_t nSize)
+	{
+		CAllocationCounter::OnAllocation(nSize);
+		return malloc(nSize == 0 ? 1 : nSize);
+	}
+
+	void* CountedAlignedAlloc(size_t nSize, std::align_val_t alignment)
+	{
+		CAllocationCounter::OnAllocation(nSize);
+		size_t nAlignment = static_cast<size_t>(alignment);
+		// aligned_alloc 要求大小是对齐值的倍数
+		size_t nRounded = (max(nSize, static_cast<size_t>(1)) + nAlignment - 1) / nAlignment * nAlignment;
+		return aligned_alloc(nAlignment, nRounded);
+	}
+}
+
+void* operator new(size_t nSize)
+{
+	void* p = CountedAlloc(nSize);
+	if (p == nullptr)
+		throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t nSize)
+{
+	return operator new(nSize);
+}
+
+void* operator new(size_t nSize, const std::nothrow_t&) noexcept
+{
+	return CountedAlloc(nSize);
+}
+
+void* operator new[](size_t nSize, const std::nothrow_t&) noexcept
+{
+	return CountedAlloc(nSize);
+}
+
+void* operator new(size_t nSize, std::align_val_t alignment)
+{
+	void* p = CountedAlignedAlloc(nSize, alignment);
+	if (p == nullptr)
+		throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t nSize, std::align_val_t alignment)
+{
+	return operator new(nSize, alignment);
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { free(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { free(p); }
@@ -0,0 +1,1502 @@
+﻿// BenchMain.cpp: 绘图核心的无界面基准测试
+// 用合成文档测量添加命令、撤销/重做、重放、范围查询、文本查找、序列化、SVG/PNG 导出和缩略图的耗时，
+// 以及鼠标拖动绘制的处理耗时（并检查稳定状态下的鼠标移动不分配内存），
+// 结果以 JSON 输出，可以与保存的基线比较：任一项的中位数比基线慢超过允许的比例时返回非零退出码，
+// 供发布前的性能回归检查使用。
+//
+// 用法：drawbench [--quick] [--commands N] [--seed N] [--filter 文本] [--output 文件]
+//                 [--baseline 文件] [--max-regression 百分比] [--trace 文件 ...] [--trace-realtime]
+//                 [--profile 文件]
+//
+
+#include "pch.h"
+#include "SyntheticDocument.h"
+#include "AllocationCounter.h"
+#include "DocumentModel.h"
+#include "DrawRecordReader.h"
+#include "GdiObjectWrapper.h"
+#include "InputTrace.h"
+#include "TraceProfiler.h"
+#include "PngWriter.h"
+#include "StrokeCapture.h"
+#include "SvgWriter.h"
+#include "ThumbnailRenderer.h"
+#include "TileCanvas.h"
+#include "TransformPreview.h"
+#include "Viewport.h"
+
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+
+namespace
+{
+	const COLORREF BENCH_BK_COLOR = RGB(255, 255, 255);
+	const int BENCH_VIEW_WIDTH = 1920;
+	const int BENCH_VIEW_HEIGHT = 1080;
+
+	struct CBenchOptions
+	{
+		bool bQuick = false;
+		size_t nCommands = 0;  // 0 表示按模式选择默认值
+		unsigned nSeed = 1;
+		std::string strFilter;
+		std::string strOutput;
+		std::string strBaseline;
+		double dMaxRegression = 10.0;  // 百分比
+		std::vector<std::string> traces;  // 要回放的输入轨迹文件
+		bool bTraceRealTime = false;      // 另外按原始速度回放一次并报告处理延迟
+		std::string strProfile;  // 运行期间打开性能跟踪，结束后写入的 Chrome 跟踪文件
+	};
+
+	struct CBenchResult
+	{
+		std::string strName;
+		size_t nItems;  // 每次迭代处理的项数（命令数、字节数等），用于计算吞吐量
+		std::vector<double> samples;  // 每次迭代的耗时（纳秒）
+		double dMean = 0, dMedian = 0, dMin = 0, dStdDev = 0;
+	};
+
+	LONGLONG BenchNow()
+	{
+		LARGE_INTEGER now;
+		QueryPerformanceCounter(&now);
+		return now.QuadPart;
+	}
+
+	double BenchElapsedNs(LONGLONG llStart, LONGLONG llEnd)
+	{
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		return (llEnd - llStart) * 1e9 / frequency.QuadPart;
+	}
+
+	// 丢弃写入内容、只统计字节数的输出流缓冲区，导出测试不受内存增长影响
+	class CCountingStreamBuf : public std::streambuf
+	{
+	private:
+		size_t m_nBytes = 0;
+
+	protected:
+		int_type overflow(int_type ch) override { if (ch != traits_type::eof()) m_nBytes++; return traits_type::not_eof(ch); }
+		std::streamsize xsputn(const char*, std::streamsize n) override { m_nBytes += static_cast<size_t>(n); return n; }
+
+	public:
+		size_t GetBytes() const { return m_nBytes; }
+	};
+
+	// 一块 32 位 DIB 及选入它的内存 DC，重放和导出测试在其上绘制
+	class CBenchSurface
+	{
+	private:
+		std::unique_ptr<CBitmapWrapper> m_bitmap;
+		std::unique_ptr<CDCWrapper> m_dc;
+		void* m_pBits = nullptr;
+		int m_nWidth;
+		int m_nHeight;
+
+	public:
+		CBenchSurface(int nWidth, int nHeight) : m_nWidth(nWidth), m_nHeight(nHeight)
+		{
+			BITMAPINFO bmi;
+			ZeroMemory(&bmi, sizeof(bmi));
+			bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+			bmi.bmiHeader.biWidth = nWidth;
+			bmi.bmiHeader.biHeight = -nHeight;
+			bmi.bmiHeader.biPlanes = 1;
+			bmi.bmiHeader.biBitCount = 32;
+			bmi.bmiHeader.biCompression = BI_RGB;
+
+			HBITMAP hBitmap = CreateDIBSection(nullptr, &bmi, DIB_RGB_COLORS, &m_pBits, nullptr, 0);
+			if (hBitmap == nullptr)
+				throw CGdiObjectException(_T("Failed to create benchmark DIB section"));
+			m_bitmap.reset(new CBitmapWrapper(hBitmap, TRUE));
+
+			HDC hMemDC = CreateCompatibleDC(nullptr);
+			if (hMemDC == nullptr)
+				throw CGdiObjectException(_T("Failed to create memory DC"));
+			m_dc.reset(new CDCWrapper(hMemDC, TRUE));
+			SelectObject(*m_dc, m_bitmap->Get());
+		}
+
+		CDC* GetDC() const { return CDC::FromHandle(*m_dc); }
+		const uint8_t* GetBits() const { return static_cast<const uint8_t*>(m_pBits); }
+		int GetWidth() const { return m_nWidth; }
+		int GetHeight() const { return m_nHeight; }
+
+		void Clear() { GetDC()->FillSolidRect(0, 0, m_nWidth, m_nHeight, BENCH_BK_COLOR); }
+	};
+
+	class CBenchRunner
+	{
+	private:
+		const CBenchOptions& m_options;
+		size_t m_nMinIterations;
+		size_t m_nMaxIterations;
+		double m_dMinTimeNs;
+		std::vector<CBenchResult> m_results;
+
+		static void Summarize(CBenchResult& result)
+		{
+			std::vector<double> sorted(result.samples);
+			std::sort(sorted.begin(), sorted.end());
+			size_t n = sorted.size();
+			double dSum = 0;
+			for (double d : sorted)
+				dSum += d;
+			result.dMean = dSum / n;
+			result.dMedian = n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+			result.dMin = sorted.front();
+			double dVariance = 0;
+			for (double d : sorted)
+				dVariance += (d - result.dMean) * (d - result.dMean);
+			result.dStdDev = std::sqrt(dVariance / n);
+		}
+
+	public:
+		explicit CBenchRunner(const CBenchOptions& options) : m_options(options)
+		{
+			m_nMinIterations = options.bQuick ? 2 : 5;
+			m_nMaxIterations = options.bQuick ? 5 : 1000;
+			m_dMinTimeNs = options.bQuick ? 0 : 5e8;
+		}
+
+		// 运行一项测试：setup 在每次迭代前执行，不计时；先运行一次预热，不计入结果
+		void Run(const char* pszName, size_t nItems, const std::function<void()>& setup, const std::function<void()>& body)
+		{
+			if (!m_options.strFilter.empty() && std::string(pszName).find(m_options.strFilter) == std::string::npos)
+				return;
+
+			CBenchResult result;
+			result.strName = pszName;
+			result.nItems = nItems;
+
+			if (setup)
+				setup();
+			body();
+
+			double dTotalNs = 0;
+			while (result.samples.size() < m_nMinIterations || (dTotalNs < m_dMinTimeNs && result.samples.size() < m_nMaxIterations))
+			{
+				if (setup)
+					setup();
+				LONGLONG llStart = BenchNow();
+				body();
+				double dNs = BenchElapsedNs(llStart, BenchNow());
+				result.samples.push_back(dNs);
+				dTotalNs += dNs;
+			}
+			Summarize(result);
+
+			fprintf(stderr, "%-24s %6zu 次  中位数 %12.3f ms  最小 %12.3f ms  %14.0f 项/秒\n", pszName, result.samples.size(),
+				result.dMedian / 1e6, result.dMin / 1e6, result.nItems / (result.dMedian / 1e9));
+			m_results.push_back(std::move(result));
+		}
+
+		void Run(const char* pszName, size_t nItems, const std::function<void()>& body)
+		{
+			Run(pszName, nItems, nullptr, body);
+		}
+
+		const std::vector<CBenchResult>& GetResults() const { return m_results; }
+	};
+
+	void WriteJson(std::ostream& out, const CBenchOptions& options, const std::vector<CBenchResult>& results)
+	{
+		out << "{\n";
+		out << "  \"suite\": \"drawbench\",\n";
+		out << "  \"commands\": " << options.nCommands << ",\n";
+		out << "  \"seed\": " << options.nSeed << ",\n";
+		out << "  \"quick\": " << (options.bQuick ? "true" : "false") << ",\n";
+		out << "  \"results\": [\n";
+		char line[512];
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			const CBenchResult& r = results[i];
+			snprintf(line, sizeof(line),
+				"    {\"name\": \"%s\", \"iterations\": %zu, \"items\": %zu, \"mean_ns\": %.0f, \"median_ns\": %.0f, "
+				"\"min_ns\": %.0f, \"stddev_ns\": %.0f, \"items_per_second\": %.1f}%s\n",
+				r.strName.c_str(), r.samples.size(), r.nItems, r.dMean, r.dMedian, r.dMin, r.dStdDev,
+				r.nItems / (r.dMedian / 1e9), i + 1 < results.size() ? "," : "");
+			out << line;
+		}
+		out << "  ]\n";
+		out << "}\n";
+	}
+
+	// 从基线 JSON（本程序的输出）中读取各项的中位数
+	bool ReadBaseline(const std::string& strPath, std::map<std::string, double>& medians)
+	{
+		std::ifstream file(strPath);
+		if (!file)
+			return false;
+		std::stringstream buffer;
+		buffer << file.rdbuf();
+		const std::string text = buffer.str();
+
+		const std::string nameKey = "\"name\": \"";
+		const std::string medianKey = "\"median_ns\": ";
+		size_t nPos = 0;
+		while ((nPos = text.find(nameKey, nPos)) != std::string::npos)
+		{
+			nPos += nameKey.size();
+			size_t nEnd = text.find('"', nPos);
+			size_t nMedian = text.find(medianKey, nEnd);
+			if (nEnd == std::string::npos || nMedian == std::string::npos)
+				break;
+			medians[text.substr(nPos, nEnd - nPos)] = atof(text.c_str() + nMedian + medianKey.size());
+			nPos = nMedian;
+		}
+		return true;
+	}
+
+	// 与基线比较，返回变慢超过阈值的项数
+	int CompareWithBaseline(const std::vector<CBenchResult>& results, const std::map<std::string, double>& baseline, double dMaxRegression)
+	{
+		int nRegressions = 0;
+		for (const CBenchResult& r : results)
+		{
+			auto it = baseline.find(r.strName);
+			if (it == baseline.end() || it->second <= 0)
+				continue;
+			double dChange = (r.dMedian / it->second - 1.0) * 100.0;
+			bool bRegressed = dChange > dMaxRegression;
+			fprintf(stderr, "%-24s %+8.1f%%%s\n", r.strName.c_str(), dChange, bRegressed ? "  ✗ 超过阈值" : "");
+			if (bRegressed)
+				nRegressions++;
+		}
+		return nRegressions;
+	}
+
+	void PrintUsage()
+	{
+		fprintf(stderr,
+			"用法：drawbench [选项]\n"
+			"  --quick                快速模式（命令少、迭代少，用于冒烟测试）\n"
+			"  --commands N           合成文档的命令数量（默认 20000，快速模式 2000）\n"
+			"  --seed N               随机种子（默认 1）\n"
+			"  --filter 文本          只运行名称包含该文本的测试\n"
+			"  --output 文件          把 JSON 结果写入文件（默认写到标准输出）\n"
+			"  --baseline 文件        与基线 JSON 比较\n"
+			"  --max-regression 百分比 允许的最大变慢比例（默认 10）\n"
+			"  --trace 文件           以最快速度回放输入轨迹（可以指定多次）\n"
+			"  --trace-realtime       另外按原始速度回放各轨迹，报告各类事件的耗时和最大延迟\n"
+			"  --profile 文件         运行期间记录性能跟踪并保存为 Chrome 跟踪 JSON（结果包含跟踪开销）\n");
+	}
+
+	bool ParseOptions(int argc, char* argv[], CBenchOptions& options)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			bool bHasValue = i + 1 < argc;
+			if (arg == "--quick")
+				options.bQuick = true;
+			else if (arg == "--commands" && bHasValue)
+				options.nCommands = static_cast<size_t>(strtoull(argv[++i], nullptr, 10));
+			else if (arg == "--seed" && bHasValue)
+				options.nSeed = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+			else if (arg == "--filter" && bHasValue)
+				options.strFilter = argv[++i];
+			else if (arg == "--output" && bHasValue)
+				options.strOutput = argv[++i];
+			else if (arg == "--baseline" && bHasValue)
+				options.strBaseline = argv[++i];
+			else if (arg == "--max-regression" && bHasValue)
+				options.dMaxRegression = atof(argv[++i]);
+			else if (arg == "--trace" && bHasValue)
+				options.traces.push_back(argv[++i]);
+			else if (arg == "--trace-realtime")
+				options.bTraceRealTime = true;
+			else if (arg == "--profile" && bHasValue)
+				options.strProfile = argv[++i];
+			else
+				return false;
+		}
+		if (options.nCommands == 0)
+			options.nCommands = options.bQuick ? 2000 : 20000;
+		return true;
+	}
+
+	const char* const TRACE_EVENT_NAMES[] =
+	{
+		"MouseDown", "MouseMove", "MouseUp", "SetTool", "SetPenSize", "SetPenColor", "SetBrushColor", "Text", "Undo", "Redo", "SwitchBranch",
+		"Transform", "Copy", "Paste", "Import",
+	};
+
+	void PrintReplayResult(const char* pszName, const CInputTraceReplayResult& result)
+	{
+		fprintf(stderr, "%s：总耗时 %.3f ms，新增命令 %zu，最大延迟 %.3f ms\n", pszName,
+			result.llTotalNs / 1e6, result.nCommandsAdded, result.llMaxLagNs / 1e6);
+		for (int i = 0; i < static_cast<int>(InputTraceEventType::Count); i++)
+		{
+			const CInputTraceEventStats& stats = result.stats[i];
+			if (stats.nCount > 0)
+			{
+				fprintf(stderr, "  %-14s %8zu 次  平均 %10.3f us  最大 %10.3f us\n", TRACE_EVENT_NAMES[i], stats.nCount,
+					stats.llTotalNs / 1e3 / stats.nCount, stats.llMaxNs / 1e3);
+			}
+		}
+	}
+
+	// 回放输入轨迹：每次迭代从空文档开始，在视口大小的位图上像视图一样绘制
+	void RunTraceBenchmark(CBenchRunner& runner, const std::string& strName, const CInputTrace& trace, bool bRealTime)
+	{
+		CBenchSurface surface(BENCH_VIEW_WIDTH, BENCH_VIEW_HEIGHT);
+		std::unique_ptr<CDocumentModel> pModel;
+		CInputTraceReplayResult result;
+		runner.Run(strName.c_str(), trace.GetCount(),
+			[&]()
+			{
+				pModel.reset(new CDocumentModel);
+				surface.Clear();
+			},
+			[&]()
+			{
+				CInputTraceReplayer replayer(*pModel, surface.GetDC());
+				replayer.Replay(trace, FALSE, result);
+			});
+
+		if (bRealTime)
+		{
+			pModel.reset(new CDocumentModel);
+			surface.Clear();
+			CInputTraceReplayer replayer(*pModel, surface.GetDC());
+			replayer.Replay(trace, TRUE, result);
+			PrintReplayResult(strName.c_str(), result);
+		}
+	}
+
+	// 鼠标拖动：一次笔画中的移动次数，少于 CStrokeCapture 预留的点数
+	const int MOUSE_MOVES_PER_STROKE = 2000;
+
+	// 第 i 次移动的位置：在视口内往返，相邻两点都不相同
+	CPoint GetMousePoint(int i)
+	{
+		return CPoint(100 + i * 7 % (BENCH_VIEW_WIDTH - 200), 100 + i * 13 % (BENCH_VIEW_HEIGHT - 200));
+	}
+
+	// 按视图的方式完成一次笔画：按下、移动、抬起，返回生成的命令（可能为 nullptr），颜色加入 palette
+	CDrawCommand* DrawStroke(CStrokeCapture& capture, DrawData::DrawType drawType, CDC* pDC, CColorPalette& palette)
+	{
+		capture.Begin(drawType, 3, RGB(200, 30, 30), RGB(30, 30, 200), GetMousePoint(0));
+		for (int i = 1; i <= MOUSE_MOVES_PER_STROKE; i++)
+			capture.Move(GetMousePoint(i), pDC);
+		return capture.End(GetMousePoint(MOUSE_MOVES_PER_STROKE), pDC, palette);
+	}
+
+	struct CMouseBenchTool
+	{
+		const char* pszName;
+		DrawData::DrawType drawType;
+	};
+
+	const CMouseBenchTool MOUSE_BENCH_TOOLS[] =
+	{
+		{ "mouse_move_pencil", DrawData::DrawType::Pencil },
+		{ "mouse_move_eraser", DrawData::DrawType::Eraser },
+		{ "mouse_move_line", DrawData::DrawType::LineSegment },
+		{ "mouse_move_rectangle", DrawData::DrawType::Rectangle },
+		{ "mouse_move_circle", DrawData::DrawType::Circle },
+	};
+
+	// 100% 时分块缓冲区拼出的画面与直接重放逐像素相同（块的边界上没有接缝）
+	void CheckTileCanvas(const CDocumentModel& model)
+	{
+		CBenchSurface expected(BENCH_VIEW_WIDTH, BENCH_VIEW_HEIGHT);
+		expected.Clear();
+		model.RedrawAll(expected.GetDC());
+
+		CBenchSurface actual(BENCH_VIEW_WIDTH, BENCH_VIEW_HEIGHT);
+		CTileCanvas canvas;
+		canvas.Draw(actual.GetDC(), CRect(0, 0, BENCH_VIEW_WIDTH, BENCH_VIEW_HEIGHT), model, CViewport(), BENCH_BK_COLOR,
+			std::numeric_limits<LONGLONG>::max());
+
+		size_t nBytes = static_cast<size_t>(BENCH_VIEW_WIDTH) * BENCH_VIEW_HEIGHT * 4;
+		fprintf(stderr, "%-24s %zu 块  位图 %zu 个  %.1f MB\n", "tile_canvas", canvas.GetTileCount(), canvas.GetBitmapCount(),
+			canvas.GetMemorySize() / (1024.0 * 1024.0));
+		if (memcmp(expected.GetBits(), actual.GetBits(), nBytes) != 0)
+			throw std::runtime_error("tile canvas output differs from direct replay");
+	}
+
+	// 点选和框选的查询点与选择框，均匀分布在合成文档的画布上
+	CPoint GetPickPoint(int i)
+	{
+		return CPoint(i * 7919 % SYNTHETIC_CANVAS_WIDTH, i * 6007 % SYNTHETIC_CANVAS_HEIGHT);
+	}
+
+	CRect GetMarqueeRect(int i)
+	{
+		return CRect(GetPickPoint(i), CSize(200, 150));
+	}
+
+	const double PICK_TOLERANCE = 3.0;
+
+	// 空间索引的点选和框选结果与逐条检查所有命令相同
+	void CheckHitTest(const CDocumentModel& model)
+	{
+		const CCommandVector& commands = model.GetCommands();
+		for (int i = 0; i < 200; i++)
+		{
+			CPoint point = GetPickPoint(i);
+			size_t nExpected = CDocumentModel::NO_COMMAND;
+			for (size_t j = commands.size(); j-- > 0; )
+			{
+				if (commands[j]->HitTest(point, PICK_TOLERANCE))
+				{
+					nExpected = j;
+					break;
+				}
+			}
+			if (model.HitTest(point, PICK_TOLERANCE) != nExpected)
+				throw std::runtime_error("hit test differs from linear scan");
+
+			CRect rect = GetMarqueeRect(i);
+			std::vector<size_t> expected, actual;
+			size_t j = 0;
+			for (const CDrawCommandPtr& cmd : commands)
+			{
+				if (cmd->GetData().drawType != DrawData::DrawType::Eraser && cmd->IntersectsRect(rect))
+					expected.push_back(j);
+				j++;
+			}
+			model.SelectInRect(rect, FALSE, actual);
+			if (actual != expected)
+				throw std::runtime_error("rectangle selection differs from linear scan");
+		}
+	}
+
+	// 事务：其中的添加和变换作为一个撤销单元，撤销、重做返回的区域为各操作影响区域的并集，嵌套的事务不单独成为撤销单元
+	void CheckTransactions(const std::vector<CSyntheticCommand>& commands)
+	{
+		CDocumentModel model;
+		const size_t nHalf = commands.size() / 2;
+		AppendSyntheticCommands(model, std::vector<CSyntheticCommand>(commands.begin(), commands.begin() + nHalf));
+		const CRect extentBefore = model.GetSnapshot().GetExtent();
+
+		CRect rectExpected;
+		rectExpected.SetRectEmpty();
+		model.BeginTransaction();
+		{
+			CTransactionScope<CDocumentModel> nested(model);
+			AppendSyntheticCommands(model, std::vector<CSyntheticCommand>(commands.begin() + nHalf, commands.end()));
+		}
+		for (size_t i = nHalf; i < model.GetCommandCount(); i++)
+			rectExpected.UnionRect(&rectExpected, &model.GetCommand(i)->GetBounds());
+
+		std::vector<size_t> selection(1, 0);
+		CRect rectTransformed;
+		DrawTransform transform;
+		transform.offset = CSize(15, 15);
+		model.TransformCommands(selection, transform, &rectTransformed);
+		rectExpected.UnionRect(&rectExpected, &rectTransformed);
+		CRect rectTransaction;
+		if (!model.EndTransaction(&rectTransaction) || rectTransaction != rectExpected)
+			throw std::runtime_error("transaction: changed region differs from the union of the operations");
+
+		CRect rectChanged;
+		if (!model.Undo(&rectChanged) || model.GetCommandCount() != nHalf || rectChanged != rectExpected)
+			throw std::runtime_error("transaction: undo did not revert the transaction as one unit");
+		if (model.GetSnapshot().GetExtent() != extentBefore)
+			throw std::runtime_error("transaction: undo did not restore the document");
+		if (!model.Redo(&rectChanged) || model.GetCommandCount() != commands.size() || rectChanged != rectExpected)
+			throw std::runtime_error("transaction: redo did not reapply the transaction as one unit");
+		CheckHitTest(model);
+
+		// 事务之后的单独一步仍然单独撤销
+		model.AddCommand(model.GetCommand(0)->CreateTransformed(DrawTransform()));
+		if (!model.Undo() || model.GetCommandCount() != commands.size())
+			throw std::runtime_error("transaction: single step after a transaction");
+		if (!model.Undo() || model.GetCommandCount() != nHalf)
+			throw std::runtime_error("transaction: undo after a single step");
+	}
+
+	// 把合成命令写成绘图记录（格式见 DrawRecordReader.h），画笔和画刷只在变化时写出
+	std::string WriteDrawRecords(const std::vector<CSyntheticCommand>& commands)
+	{
+		static const char* const TYPE_NAMES[] = { "line", "circle", "rect", "ellipse", "pencil", "text", "eraser" };
+		std::string records("# synthetic document\n\n");
+		char sz[64];
+		int nPenSize = 1;
+		COLORREF penColor = RGB(0, 0, 0);
+		COLORREF brushColor = RGB(0, 0, 0);
+		for (const CSyntheticCommand& command : commands)
+		{
+			const DrawData& data = command.data;
+			if (data.penSize != nPenSize || command.penColor != penColor)
+			{
+				nPenSize = data.penSize;
+				penColor = command.penColor;
+				snprintf(sz, sizeof(sz), "pen %d %02X%02X%02X\n", nPenSize, GetRValue(penColor), GetGValue(penColor), GetBValue(penColor));
+				records += sz;
+			}
+			if (command.brushColor != brushColor)
+			{
+				brushColor = command.brushColor;
+				snprintf(sz, sizeof(sz), "brush %02X%02X%02X\n", GetRValue(brushColor), GetGValue(brushColor), GetBValue(brushColor));
+				records += sz;
+			}
+
+			records += TYPE_NAMES[static_cast<int>(data.drawType)];
+			if (!data.pencilPoints.empty())
+			{
+				for (const CPoint& point : data.pencilPoints)
+				{
+					snprintf(sz, sizeof(sz), " %d %d", static_cast<int>(point.x), static_cast<int>(point.y));
+					records += sz;
+				}
+			}
+			else if (data.drawType == DrawData::DrawType::Text)
+			{
+				snprintf(sz, sizeof(sz), " %d %d ", static_cast<int>(data.pointBegin.x), static_cast<int>(data.pointBegin.y));
+				records += sz;
+				records += static_cast<const char*>(CW2A(command.text));
+			}
+			else
+			{
+				snprintf(sz, sizeof(sz), " %d %d %d %d", static_cast<int>(data.pointBegin.x), static_cast<int>(data.pointBegin.y),
+					static_cast<int>(data.pointEnd.x), static_cast<int>(data.pointEnd.y));
+				records += sz;
+			}
+			records += '\n';
+		}
+		return records;
+	}
+
+	// 两个文档的命令逐条相同（铅笔轨迹的起点和终点由点列表决定，不比较）
+	void CompareCommands(const char* pszName, const CDocumentModel& expected, const CDocumentModel& actual)
+	{
+		if (actual.GetCommandCount() != expected.GetCommandCount())
+			throw std::runtime_error(std::string(pszName) + ": command count differs");
+		for (size_t i = 0; i < expected.GetCommandCount(); i++)
+		{
+			const CDrawCommand* pExpected = expected.GetCommand(i);
+			const CDrawCommand* pActual = actual.GetCommand(i);
+			const DrawData& a = pExpected->GetData();
+			const DrawData& b = pActual->GetData();
+			if (a.drawType != b.drawType || a.penSize != b.penSize ||
+				a.GetPenColor(expected.GetColorPalette()) != b.GetPenColor(actual.GetColorPalette()) ||
+				a.GetBrushColor(expected.GetColorPalette()) != b.GetBrushColor(actual.GetColorPalette()) || a.pencilPoints != b.pencilPoints ||
+				pExpected->GetBounds() != pActual->GetBounds() || pExpected->GetText() != pActual->GetText())
+			{
+				throw std::runtime_error(std::string(pszName) + ": command " + std::to_string(i) + " differs");
+			}
+		}
+	}
+
+	// 批量添加和流式导入：命令与逐条添加相同，整批作为一个撤销单元；格式错误报告出错的行，之前的记录保留
+	void CheckBatchIngest(const std::vector<CSyntheticCommand>& commands)
+	{
+		CDocumentModel expected;
+		AppendSyntheticCommands(expected, commands);
+
+		CDocumentModel batch;
+		std::vector<DrawData> data;
+		data.reserve(commands.size());
+		for (const CSyntheticCommand& command : commands)
+			data.push_back(PrepareSyntheticData(batch, command));
+		CRect rectAdded;
+		batch.AddDrawData(data.data(), data.data() + data.size(), &rectAdded);
+		CompareCommands("add_draw_data", expected, batch);
+		if (rectAdded != expected.GetSnapshot().GetExtent())
+			throw std::runtime_error("add_draw_data: changed region differs from the document extent");
+		CheckHitTest(batch);
+
+		CDocumentModel moved;
+		for (DrawData& item : data)
+		{
+			if (item.drawType == DrawData::DrawType::Text)
+				item.nTextId = moved.InternText(batch.GetStringPool().Get(item.nTextId));
+			item.SetPenColor(moved.GetColorPalette(), item.GetPenColor(batch.GetColorPalette()));
+			item.SetBrushColor(moved.GetColorPalette(), item.GetBrushColor(batch.GetColorPalette()));
+		}
+		moved.AddDrawData(std::move(data));
+		CompareCommands("add_draw_data_move", expected, moved);
+
+		CDocumentModel imported;
+		std::istringstream in(WriteDrawRecords(commands));
+		size_t nImported = 0;
+		size_t nErrorLine = 0;
+		CRect rectImported;
+		if (!imported.ImportDrawRecords(in, &nImported, &nErrorLine, &rectImported) || nImported != commands.size() || nErrorLine != 0)
+			throw std::runtime_error("import_records: import failed at line " + std::to_string(nErrorLine));
+		CompareCommands("import_records", expected, imported);
+		if (rectImported != rectAdded)
+			throw std::runtime_error("import_records: changed region differs from the document extent");
+		CheckHitTest(imported);
+
+		CRect rectChanged;
+		if (!imported.Undo(&rectChanged) || imported.GetCommandCount() != 0 || rectChanged != rectImported || imported.CanUndo())
+			throw std::runtime_error("import_records: undo did not remove the import as one unit");
+		if (!imported.Redo(&rectChanged) || imported.GetCommandCount() != commands.size())
+			throw std::runtime_error("import_records: redo did not restore the import");
+
+		// 超过读取缓冲区的长行、Windows 换行符、没有换行符的最后一行
+		std::string records("pen 3 FF0000\r\npencil");
+		for (int i = 0; i < 20000; i++)
+			records += " " + std::to_string(i % 4000) + " " + std::to_string(i / 10);
+		records += "\r\ntext 10 20 \xE8\x8D\x89\xE5\x9B\xBE note\r\nline 0 0 100 100";
+		CDocumentModel longLines;
+		std::istringstream inLong(records);
+		if (!longLines.ImportDrawRecords(inLong, &nImported) || nImported != 3 ||
+			longLines.GetCommand(0)->GetData().pencilPoints.size() != 20000 || longLines.GetCommand(0)->GetData().GetPenColor(longLines.GetColorPalette()) != RGB(255, 0, 0) ||
+			longLines.GetCommand(1)->GetText() != CString(L"\x8349\x56FE note") || longLines.GetCommand(2)->GetBounds().right != 103)
+		{
+			throw std::runtime_error("import_records: long lines or line endings");
+		}
+
+		// 无效的 UTF-8：过长编码、代理区、F5 首字节（及其后多余的后续字节）、超出 U+10FFFF、截断的序列；有效的四字节序列转为代理对
+		CDocumentModel invalidUtf8;
+		std::istringstream inUtf8("text 0 0 a\xC0\xAF|\xED\xA0\x80|\xF5\x80\x80\x80|\xF4\x90\x80\x80|\xF0\x9F\x98\x80|\xE8\x8Dx\n");
+		if (!invalidUtf8.ImportDrawRecords(inUtf8) || invalidUtf8.GetCommandCount() != 1 ||
+			invalidUtf8.GetCommand(0)->GetText() != CString(L"a\xFFFD|\xFFFD|\xFFFD\xFFFD\xFFFD\xFFFD|\xFFFD|\xD83D\xDE00|\xFFFDx"))
+		{
+			throw std::runtime_error("import_records: invalid UTF-8 not replaced with U+FFFD");
+		}
+
+		CDocumentModel errors;
+		std::istringstream inErrors("line 0 0 10 10\n\n# comment\nrect 5 5 20\nline 1 1 2 2\n");
+		if (errors.ImportDrawRecords(inErrors, &nImported, &nErrorLine) || nImported != 1 || nErrorLine != 4 || errors.GetCommandCount() != 1)
+			throw std::runtime_error("import_records: format error not reported at the right line");
+		if (!errors.Undo() || errors.GetCommandCount() != 0)
+			throw std::runtime_error("import_records: partial import is not undoable");
+	}
+
+	// 撤销树中的一段命令：[nBegin, nEnd) 的合成命令和它们外接矩形的并集
+	std::vector<CSyntheticCommand> SliceCommands(const std::vector<CSyntheticCommand>& commands, size_t nBegin, size_t nEnd)
+	{
+		return std::vector<CSyntheticCommand>(commands.begin() + nBegin, commands.begin() + nEnd);
+	}
+
+	CRect UnionBounds(const CDocumentModel& model, size_t nBegin, size_t nEnd)
+	{
+		CRect rect(0, 0, 0, 0);
+		for (size_t i = nBegin; i < nEnd; i++)
+			rect.UnionRect(&rect, &model.GetCommand(i)->GetBounds());
+		return rect;
+	}
+
+	// 撤销树：撤销后的新操作不丢弃原来的操作，切换分支后文档与直接画出该分支相同，返回的区域只包含两个分支不同的部分；
+	// 切换前获取的快照不受影响，分组（事务）在各分支中仍然作为一个撤销单元
+	void CheckUndoTree(const std::vector<CSyntheticCommand>& commands)
+	{
+		const size_t nPrefix = commands.size() / 2;
+		const size_t nSplit = nPrefix + commands.size() / 4;
+		CDocumentModel expectedA;
+		AppendSyntheticCommands(expectedA, SliceCommands(commands, 0, nSplit));
+		CDocumentModel expectedB;
+		AppendSyntheticCommands(expectedB, SliceCommands(commands, 0, nPrefix));
+		AppendSyntheticCommands(expectedB, SliceCommands(commands, nSplit, commands.size()));
+		const CRect rectA = UnionBounds(expectedA, nPrefix, expectedA.GetCommandCount());
+		const CRect rectB = UnionBounds(expectedB, nPrefix, expectedB.GetCommandCount());
+		CRect rectExpected;
+		rectExpected.UnionRect(&rectA, &rectB);
+
+		// 分支 A 逐条画出后全部撤销，分支 B 在一个事务中加入
+		CDocumentModel model;
+		AppendSyntheticCommands(model, SliceCommands(commands, 0, nSplit));
+		while (model.GetCommandCount() > nPrefix)
+			model.Undo();
+		if (model.CanSwitchBranch())
+			throw std::runtime_error("undo_tree: a single branch reported as a fork");
+		{
+			CTransactionScope<CDocumentModel> transaction(model);
+			AppendSyntheticCommands(model, SliceCommands(commands, nSplit, commands.size()));
+		}
+		const CDocumentSnapshot snapshotB = model.GetSnapshot();
+		size_t nBranch = 0, nBranches = 0;
+		if (model.CanRedo() || !model.GetBranchPosition(nBranch, nBranches) || nBranch != 2 || nBranches != 2)
+			throw std::runtime_error("undo_tree: new branch not recorded");
+
+		CRect rectChanged;
+		if (!model.SwitchBranch(FALSE, &rectChanged) || rectChanged != rectExpected)
+			throw std::runtime_error("undo_tree: switching branches did not return the differing region");
+		CompareCommands("undo_tree_branch_a", expectedA, model);
+		CheckHitTest(model);
+		if (snapshotB.GetCommandCount() != expectedB.GetCommandCount() || snapshotB.GetExtent() != expectedB.GetSnapshot().GetExtent())
+			throw std::runtime_error("undo_tree: snapshot changed by switching branches");
+
+		// 分支 A 中逐步撤销和重做，之后再切换回 B，B 的事务仍然一次撤销
+		if (!model.Undo() || model.GetCommandCount() != nSplit - 1 || !model.Redo() || model.GetCommandCount() != nSplit)
+			throw std::runtime_error("undo_tree: undo inside a branch");
+
+		// 在分支中撤销一步后切换离开再切换回来，停在离开时的状态，已撤销的一步不会重做
+		model.Undo();
+		CRect rectPartial = UnionBounds(expectedA, nPrefix, nSplit - 1);
+		rectPartial.UnionRect(&rectPartial, &rectB);
+		if (!model.SwitchBranch(TRUE) || !model.SwitchBranch(FALSE, &rectChanged) || model.GetCommandCount() != nSplit - 1 ||
+			rectChanged != rectPartial)
+		{
+			throw std::runtime_error("undo_tree: switching back did not return to the state the branch was left in");
+		}
+		if (!model.Redo() || model.GetCommandCount() != nSplit)
+			throw std::runtime_error("undo_tree: redo after switching back");
+		if (!model.SwitchBranch(TRUE, &rectChanged) || rectChanged != rectExpected)
+			throw std::runtime_error("undo_tree: switching back did not return the differing region");
+		CompareCommands("undo_tree_branch_b", expectedB, model);
+		if (!model.Undo(&rectChanged) || model.GetCommandCount() != nPrefix || rectChanged != rectB)
+			throw std::runtime_error("undo_tree: transaction not undone as one unit after switching");
+
+		// 第三个分支：变换一条命令；切换在三个分支之间循环
+		std::vector<size_t> selection(1, 0);
+		DrawTransform transform;
+		transform.offset = CSize(20, 10);
+		CRect rectTransformed;
+		model.TransformCommands(selection, transform, &rectTransformed);
+		if (!model.GetBranchPosition(nBranch, nBranches) || nBranch != 3 || nBranches != 3)
+			throw std::runtime_error("undo_tree: third branch not recorded");
+		CRect rectWrap;
+		rectWrap.UnionRect(&rectTransformed, &rectA);
+		if (!model.SwitchBranch(TRUE, &rectChanged) || rectChanged != rectWrap)
+			throw std::runtime_error("undo_tree: next branch did not wrap around");
+		CompareCommands("undo_tree_wrap", expectedA, model);
+		CRect rectMoved = expectedA.GetCommand(0)->GetBounds();
+		rectMoved.OffsetRect(transform.offset);
+		if (!model.SwitchBranch(FALSE, &rectChanged) || model.GetCommand(0)->GetBounds() != rectMoved ||
+			model.GetCommandCount() != nPrefix)
+		{
+			throw std::runtime_error("undo_tree: previous branch did not wrap around");
+		}
+	}
+
+	// 移动和缩放的选择区域（视口内）与变换：以选中区域左上角为不动点放大 1.25 × 0.8 倍，再平移
+	const CRect TRANSFORM_SELECT_RECT(600, 300, 1000, 600);
+
+	DrawTransform GetBenchTransform(const CRect& rectSelection)
+	{
+		DrawTransform transform;
+		transform.ptAnchor = rectSelection.TopLeft();
+		transform.dScaleX = 1.25;
+		transform.dScaleY = 0.8;
+		transform.offset = CSize(40, -25);
+		return transform;
+	}
+
+	// 变换、撤销和重做后：只使变化区域失效的分块缓冲区与直接重放逐像素相同，空间索引与逐条检查相同
+	void CheckTransform(const std::vector<CSyntheticCommand>& commands, const std::vector<size_t>& selection)
+	{
+		CDocumentModel model;
+		AppendSyntheticCommands(model, commands);
+		const CRect extent = model.GetSnapshot().GetExtent();
+		const CRect rectView(0, 0, BENCH_VIEW_WIDTH, BENCH_VIEW_HEIGHT);
+		const size_t nBytes = static_cast<size_t>(BENCH_VIEW_WIDTH) * BENCH_VIEW_HEIGHT * 4;
+		CBenchSurface expected(BENCH_VIEW_WIDTH, BENCH_VIEW_HEIGHT);
+		CBenchSurface actual(BENCH_VIEW_WIDTH, BENCH_VIEW_HEIGHT);
+		CTileCanvas canvas;
+		CViewport viewport;
+		canvas.Draw(actual.GetDC(), rectView, model, viewport, BENCH_BK_COLOR, std::numeric_limits<LONGLONG>::max());
+
+		auto compare = [&](const char* pszStep, const CRect& rectChanged)
+		{
+			if (rectChanged.IsRectEmpty())
+				throw std::runtime_error(std::string(pszStep) + ": no changed region reported");
+			canvas.Invalidate(rectChanged, viewport);
+			canvas.Draw(actual.GetDC(), rectView, model, viewport, BENCH_BK_COLOR, std::numeric_limits<LONGLONG>::max());
+			expected.Clear();
+			model.RedrawAll(expected.GetDC());
+			if (memcmp(expected.GetBits(), actual.GetBits(), nBytes) != 0)
+				throw std::runtime_error(std::string(pszStep) + ": tile canvas differs from direct replay");
+			CheckHitTest(model);
+		};
+
+		CRect rectSelection;
+		rectSelection.SetRectEmpty();
+		for (size_t i : selection)
+			rectSelection.UnionRect(&rectSelection, &model.GetCommand(i)->GetBounds());
+		CRect rectChanged;
+		if (!model.TransformCommands(selection, GetBenchTransform(rectSelection), &rectChanged))
+			throw std::runtime_error("transform: nothing transformed");
+		compare("transform", rectChanged);
+		if (model.GetCommandCount() != commands.size())
+			throw std::runtime_error("transform: command count changed");
+
+		if (!model.Undo(&rectChanged))
+			throw std::runtime_error("transform: undo failed");
+		compare("transform undo", rectChanged);
+		if (model.GetSnapshot().GetExtent() != extent)
+			throw std::runtime_error("transform undo: extent differs from the original document");
+
+		if (!model.Redo(&rectChanged))
+			throw std::runtime_error("transform: redo failed");
+		compare("transform redo", rectChanged);
+
+		fprintf(stderr, "%-24s 选中 %zu 条命令\n", "transform", selection.size());
+	}
+
+	// 已经建立金字塔的笔迹数量
+	size_t CountBuiltPyramids(const CDocumentModel& model)
+	{
+		size_t nBuilt = 0;
+		for (size_t i = 0; i < model.GetCommandCount(); i++)
+		{
+			const CDrawCommand* pCommand = model.GetCommand(i);
+			if (CStrokeCommand::IsStroke(pCommand->GetData())
+				&& static_cast<const CStrokeCommand*>(pCommand)->GetBuiltStrokePyramid() != nullptr)
+				nBuilt++;
+		}
+		return nBuilt;
+	}
+
+	// 保存时只写入已经建立的金字塔，不为其余的笔迹建立金字塔；读取后这些笔迹直接带有金字塔
+	void CheckStoredPyramids(const std::vector<CSyntheticCommand>& commands)
+	{
+		CDocumentModel model;
+		AppendSyntheticCommands(model, commands);
+		size_t nExpected = 0;
+		for (size_t i = 0; i < model.GetCommandCount(); i += 2)
+		{
+			const CDrawCommand* pCommand = model.GetCommand(i);
+			if (CStrokeCommand::IsStroke(pCommand->GetData())
+				&& static_cast<const CStrokeCommand*>(pCommand)->GetStrokePyramid() != nullptr)
+				nExpected++;
+		}
+		if (nExpected == 0)
+			throw std::runtime_error("stored pyramids: no stroke needs a pyramid");
+
+		CMemFile file;
+		{
+			CArchive ar(&file, CArchive::store);
+			model.StoreCommands(ar, model.GetSnapshot(), TRUE);
+		}
+		if (CountBuiltPyramids(model) != nExpected)
+			throw std::runtime_error("stored pyramids: storing built new pyramids");
+
+		CDocumentModel loaded;
+		file.SeekToBegin();
+		{
+			CArchive ar(&file, CArchive::load);
+			loaded.LoadCommands(ar);
+		}
+		if (loaded.GetCommandCount() != model.GetCommandCount() || CountBuiltPyramids(loaded) != nExpected)
+			throw std::runtime_error("stored pyramids: loaded pyramids differ from the stored ones");
+	}
+
+	// 读取的命令是历史的起点：读取后不能撤销，之后的编辑撤销后回到读取的内容
+	void CheckLoadedHistory(const std::vector<CSyntheticCommand>& commands)
+	{
+		CDocumentModel model;
+		AppendSyntheticCommands(model, commands);
+		CMemFile file;
+		{
+			CArchive ar(&file, CArchive::store);
+			model.StoreCommands(ar, model.GetSnapshot(), FALSE);
+		}
+		CDocumentModel loaded;
+		file.SeekToBegin();
+		{
+			CArchive ar(&file, CArchive::load);
+			loaded.LoadCommands(ar);
+		}
+		if (loaded.CanUndo() || loaded.CanRedo())
+			throw std::runtime_error("loaded history: loaded commands can be undone");
+
+		DrawData data;
+		data.drawType = DrawData::DrawType::Rectangle;
+		data.pointEnd = CPoint(50, 50);
+		loaded.AddCommand(CreateDrawCommand(data, loaded.GetStringPool()));
+		CRect rectChanged;
+		if (!loaded.Undo(&rectChanged) || loaded.CanUndo())
+			throw std::runtime_error("loaded history: undo did not stop at the loaded commands");
+		CompareCommands("loaded history", model, loaded);
+	}
+
+	// 文件中的数量不可信：声明了大量命令和轨迹点、实际只有几个点的文件读到文件结尾时失败，不预先分配声明的数量
+	void CheckCorruptCounts()
+	{
+		CMemFile file;
+		{
+			CArchive ar(&file, CArchive::store);
+			ar << static_cast<DWORD>(0);  // 字符串表
+			ar << static_cast<DWORD>(1) << static_cast<COLORREF>(RGB(0, 0, 0));  // 颜色表
+			ar << static_cast<DWORD>(0xFFFFFFFF);  // 命令数量
+			ar << static_cast<BYTE>(DrawData::DrawType::Pencil) << CPoint(0, 0) << CPoint(0, 0) << static_cast<LONG>(1);
+			ar << static_cast<BYTE>(0) << static_cast<BYTE>(0) << static_cast<DWORD>(0);  // 颜色序号和文本序号
+			ar << static_cast<DWORD>(0xFFFFFFFF);  // 轨迹点数
+			for (int i = 0; i < 4; i++)
+				ar << CPoint(i, i);
+		}
+
+		CDocumentModel model;
+		file.SeekToBegin();
+		try
+		{
+			CArchive ar(&file, CArchive::load);
+			model.LoadCommands(ar);
+		}
+		catch (CArchiveException* e)
+		{
+			const int nCause = e->m_cause;
+			e->Delete();
+			if (nCause == CArchiveException::endOfFile)
+				return;
+		}
+		throw std::runtime_error("corrupt counts: truncated file not reported as end of file");
+	}
+
+	// 每个文档有自己的颜色表，内存随用到的颜色增长；超过 16 位序号的颜色不被其他颜色代替，保存和读取后不变
+	void CheckColorPalette()
+	{
+		const UINT COLOR_COUNT = 70000;
+		CDocumentModel model;
+		CDocumentModel other;
+		if (model.GetColorPalette().GetMemorySize() >= 1024)
+			throw std::runtime_error("color palette: empty palette allocates too much memory");
+
+		DrawData data;
+		data.drawType = DrawData::DrawType::LineSegment;
+		data.pointEnd = CPoint(100, 100);
+		for (UINT i = 1; i <= COLOR_COUNT; i++)
+		{
+			const COLORREF color = RGB(i & 0xFF, (i >> 8) & 0xFF, i >> 16);
+			data.SetPenColor(model.GetColorPalette(), color);
+			data.SetBrushColor(model.GetColorPalette(), color);
+			model.AddCommand(CreateDrawCommand(data, model.GetStringPool()));
+			const DrawData& added = model.GetCommand(model.GetCommandCount() - 1)->GetData();
+			if (added.GetPenColorIndex() != i || added.GetPenColor(model.GetColorPalette()) != color ||
+				added.GetBrushColor(model.GetColorPalette()) != color)
+				throw std::runtime_error("color palette: color was substituted or got a wrong index");
+		}
+		const CColorPalette& palette = model.GetColorPalette();
+		if (palette.GetCount() != COLOR_COUNT + 1 || palette.GetMemorySize() > 2 * palette.GetCount() * sizeof(COLORREF))
+			throw std::runtime_error("color palette: memory does not follow the number of colors");
+		if (other.GetColorPalette().GetCount() != 1)
+			throw std::runtime_error("color palette: documents share a palette");
+
+		CMemFile file;
+		{
+			CArchive ar(&file, CArchive::store);
+			model.StoreCommands(ar, model.GetSnapshot(), FALSE);
+		}
+		file.SeekToBegin();
+		{
+			CArchive ar(&file, CArchive::load);
+			other.LoadCommands(ar);
+		}
+		CompareCommands("color palette", model, other);
+
+		const CDocumentSnapshot snapshot = model.GetSnapshot();
+		model.Clear();
+		if (model.GetColorPalette().GetCount() != 1 ||
+			snapshot.GetCommand(snapshot.GetCommandCount() - 1)->GetData().GetPenColor(snapshot.GetColorPalette()) !=
+			RGB(COLOR_COUNT & 0xFF, (COLOR_COUNT >> 8) & 0xFF, COLOR_COUNT >> 16))
+		{
+			throw std::runtime_error("color palette: clearing the document changed its snapshot");
+		}
+	}
+
+	// 轨迹中的移动缩放、复制粘贴和导入：保存读取后回放，与回放绘制部分后直接在文档上执行相同的操作结果相同，
+	// 之后的撤销、重做和切换分支作用于相同的历史
+	void CheckTraceEditing(const std::vector<CSyntheticCommand>& commands)
+	{
+		const std::vector<CSyntheticCommand> prefix(commands.begin(), commands.begin() + std::min<size_t>(commands.size(), 200));
+		CInputTrace trace = GenerateSyntheticTrace(prefix);
+		CDocumentModel expected;
+		CInputTraceReplayResult result;
+		CInputTraceReplayer(expected).Replay(trace, FALSE, result);
+		LONGLONG llTime = trace.GetDuration();
+		auto add = [&](InputTraceEventType type, const std::vector<size_t>& indices, const DrawTransform& transform)
+		{
+			CInputTraceEvent event;
+			event.type = type;
+			event.llTime = (llTime += 100000);
+			event.indices = indices;
+			event.transform = transform;
+			trace.Add(event);
+		};
+
+		DrawTransform scale;
+		scale.ptAnchor = CPoint(120, 80);
+		scale.dScaleX = 1.5;
+		scale.dScaleY = 0.75;
+		scale.offset = CSize(-30, 45);
+		const std::vector<size_t> moved = { 1, 5, 9, 150 };
+		add(InputTraceEventType::Transform, moved, scale);
+		expected.TransformCommands(moved, scale);
+
+		const std::vector<size_t> copied = { 2, 3, 7 };
+		DrawTransform paste;
+		paste.offset = CSize(10, 10);
+		add(InputTraceEventType::Copy, copied, DrawTransform());
+		add(InputTraceEventType::Paste, std::vector<size_t>(), paste);
+		std::vector<CDrawCommandPtr> clipboard;
+		for (size_t i : copied)
+			clipboard.push_back(expected.GetCommands()[i]);
+		expected.PasteCommands(clipboard, expected.GetColorPalette(), paste);
+
+		CInputTraceEvent import;
+		import.type = InputTraceEventType::Import;
+		import.llTime = (llTime += 100000);
+		import.records = "pen 2 00FF00\nline 0 0 50 50\ntext 5 5 imported\n";
+		trace.Add(import);
+		std::istringstream in(import.records);
+		expected.ImportDrawRecords(in);
+
+		// 撤销导入后移动另一个图形形成新分支，切换回导入所在的分支，再撤销和重做
+		DrawTransform offset;
+		offset.offset = CSize(5, 5);
+		const std::vector<size_t> first = { 0 };
+		add(InputTraceEventType::Undo, std::vector<size_t>(), DrawTransform());
+		add(InputTraceEventType::Transform, first, offset);
+		add(InputTraceEventType::Undo, std::vector<size_t>(), DrawTransform());
+		CInputTraceEvent branch;
+		branch.type = InputTraceEventType::SwitchBranch;
+		branch.llTime = (llTime += 100000);
+		branch.nValue = 0;
+		trace.Add(branch);
+		add(InputTraceEventType::Undo, std::vector<size_t>(), DrawTransform());
+		add(InputTraceEventType::Redo, std::vector<size_t>(), DrawTransform());
+		if (!expected.Undo() || !expected.TransformCommands(first, offset) || !expected.Undo() || !expected.SwitchBranch(FALSE) ||
+			!expected.Undo() || !expected.Redo())
+		{
+			throw std::runtime_error("trace editing: expected history is missing a step");
+		}
+
+		CMemFile file;
+		{
+			CArchive ar(&file, CArchive::store);
+			trace.Serialize(ar);
+		}
+		file.SeekToBegin();
+		CInputTrace loaded;
+		{
+			CArchive ar(&file, CArchive::load);
+			loaded.Serialize(ar);
+		}
+		CDocumentModel replayed;
+		CInputTraceReplayer(replayed).Replay(loaded, FALSE, result);
+		CompareCommands("trace editing", expected, replayed);
+		if (replayed.CanUndo() != expected.CanUndo() || replayed.CanRedo() != expected.CanRedo())
+			throw std::runtime_error("trace editing: replayed history differs");
+	}
+
+	// 稳定状态（已完成一次笔画，预览画笔和点缓冲区已经就绪）下，鼠标移动不分配内存
+	void CheckMouseMoveAllocations(CDC* pDC)
+	{
+		if (!CAllocationCounter::IsActive())
+			throw std::runtime_error("allocation hook is not installed");
+
+		CColorPalette palette;
+		for (const CMouseBenchTool& tool : MOUSE_BENCH_TOOLS)
+		{
+			CStrokeCapture capture;
+			delete DrawStroke(capture, tool.drawType, pDC, palette);
+
+			capture.Begin(tool.drawType, 3, RGB(200, 30, 30), RGB(30, 30, 200), GetMousePoint(0));
+			CAllocationScope scope;
+			for (int i = 1; i <= MOUSE_MOVES_PER_STROKE; i++)
+				capture.Move(GetMousePoint(i), pDC);
+			size_t nAllocations = scope.GetCount();
+			delete capture.End(GetMousePoint(MOUSE_MOVES_PER_STROKE), pDC, palette);
+
+			fprintf(stderr, "%-24s %6d 次移动  堆分配 %zu 次\n", tool.pszName, MOUSE_MOVES_PER_STROKE, nAllocations);
+			if (nAllocations != 0)
+				throw std::runtime_error(std::string(tool.pszName) + ": steady-state mouse moves allocate memory");
+		}
+	}
+
+	void RunBenchmarks(CBenchRunner& runner, const CBenchOptions& options)
+	{
+		const std::vector<CSyntheticCommand> commands = GenerateSyntheticCommands(options.nCommands, options.nSeed);
+		const size_t nCommands = commands.size();
+
+		// 编辑：添加命令、撤销/重做
+		std::unique_ptr<CDocumentModel> pModel;
+		runner.Run("add_commands", nCommands,
+			[&]() { pModel.reset(new CDocumentModel); },
+			[&]() { AppendSyntheticCommands(*pModel, commands); });
+
+		CDocumentModel model;
+		AppendSyntheticCommands(model, commands);
+		runner.Run("undo_redo_all", nCommands * 2, [&]()
+		{
+			while (model.Undo()) {}
+			while (model.Redo()) {}
+		});
+
+		// 事务：所有命令在一个事务中加入，撤销和重做各一次完成
+		CheckTransactions(commands);
+		CDocumentModel transactionModel;
+		{
+			CTransactionScope<CDocumentModel> transaction(transactionModel);
+			AppendSyntheticCommands(transactionModel, commands);
+		}
+		runner.Run("undo_redo_transaction", nCommands * 2, [&]()
+		{
+			CRect rectChanged;
+			transactionModel.Undo(&rectChanged);
+			transactionModel.Redo(&rectChanged);
+		});
+
+		// 批量添加：预先准备好的绘图数据一次移入；流式导入：从内存中的绘图记录文本解析并加入
+		CheckBatchIngest(commands);
+
+		// 撤销树：前一半命令共用，后两个四分之一分别是两个分支，每次在两个分支之间来回切换
+		CheckUndoTree(commands);
+		CDocumentModel branchModel;
+		AppendSyntheticCommands(branchModel, SliceCommands(commands, 0, nCommands / 2 + nCommands / 4));
+		while (branchModel.GetCommandCount() > nCommands / 2)
+			branchModel.Undo();
+		AppendSyntheticCommands(branchModel, SliceCommands(commands, nCommands / 2 + nCommands / 4, nCommands));
+		runner.Run("undo_tree_switch_branch", (nCommands - nCommands / 2) * 2, [&]()
+		{
+			CRect rectChanged;
+			branchModel.SwitchBranch(FALSE, &rectChanged);
+			branchModel.SwitchBranch(TRUE, &rectChanged);
+		});
+		std::vector<DrawData> batchData;
+		runner.Run("add_draw_data", nCommands,
+			[&]()
+			{
+				pModel.reset(new CDocumentModel);
+				batchData.clear();
+				batchData.reserve(nCommands);
+				for (const CSyntheticCommand& command : commands)
+					batchData.push_back(PrepareSyntheticData(*pModel, command));
+			},
+			[&]() { pModel->AddDrawData(std::move(batchData)); });
+
+		const std::string records = WriteDrawRecords(commands);
+		runner.Run("import_records", nCommands,
+			[&]() { pModel.reset(new CDocumentModel); },
+			[&]()
+			{
+				std::istringstream in(records);
+				pModel->ImportDrawRecords(in);
+			});
+		pModel.reset();
+
+		// 查询：文档范围、按视口筛选命令、文本查找
+		const CDocumentSnapshot snapshot = model.GetSnapshot();
+		runner.Run("snapshot_extent", nCommands, [&]()
+		{
+			volatile LONG nWidth = model.GetSnapshot().GetExtent().Width();
+			(void)nWidth;
+		});
+
+		runner.Run("bounds_query_16_views", nCommands * 16, [&]()
+		{
+			size_t nVisible = 0;
+			for (int i = 0; i < 16; i++)
+			{
+				CRect rectView(CPoint((i % 4) * 1000, (i / 4) * 750), CSize(BENCH_VIEW_WIDTH / 2, BENCH_VIEW_HEIGHT / 2));
+				for (const CDrawCommandPtr& cmd : snapshot.GetCommands())
+				{
+					const CRect& bounds = cmd->GetBounds();
+					if (bounds.left < rectView.right && rectView.left < bounds.right && bounds.top < rectView.bottom && rectView.top < bounds.bottom)
+						nVisible++;
+				}
+			}
+			volatile size_t nResult = nVisible;
+			(void)nResult;
+		});
+
+		std::vector<size_t> found;
+		runner.Run("find_text", 1, [&]() { model.FindText(_T("注释"), found); });
+
+		// 选择：点选和 200×150 的框选，经过空间索引和精确的几何判断
+		CheckHitTest(model);
+		runner.Run("hit_test_64_points", 64, [&]()
+		{
+			size_t nHits = 0;
+			for (int i = 0; i < 64; i++)
+				nHits += model.HitTest(GetPickPoint(i), PICK_TOLERANCE) != CDocumentModel::NO_COMMAND;
+			volatile size_t nResult = nHits;
+			(void)nResult;
+		});
+		runner.Run("select_rect_64_marquees", 64, [&]()
+		{
+			for (int i = 0; i < 64; i++)
+				model.SelectInRect(GetMarqueeRect(i), FALSE, found);
+		});
+
+		// 绘制：视口大小的全部重放
+		CBenchSurface surface(BENCH_VIEW_WIDTH, BENCH_VIEW_HEIGHT);
+		runner.Run("replay_viewport", nCommands, [&]()
+		{
+			surface.Clear();
+			model.RedrawAll(surface.GetDC());
+		});
+
+		// 缩小显示：整个文档缩放到视口中（约 35%）和 1/16，按低细节规则重放；
+		// replay_fit_full_detail 使用相同的变换但不跳过、不简化，作为对照；
+		// replay_fit_cold 每次迭代使用新的文档，包含第一次缩小显示时建立笔迹金字塔的开销
+		CViewport viewportFit;
+		viewportFit.FitRect(snapshot.GetExtent(), CSize(BENCH_VIEW_WIDTH, BENCH_VIEW_HEIGHT));
+		CViewport viewportSixteenth;
+		viewportSixteenth.SetZoomLevel(-8, CPoint(0, 0));
+		auto replayViewport = [&](const CDocumentModel& target, const CViewport& viewport, double dScale)
+		{
+			surface.Clear();
+			CDC* pDC = surface.GetDC();
+			int nSavedDC = pDC->SaveDC();
+			viewport.Prepare(pDC);
+			target.RedrawAll(pDC, dScale);
+			pDC->RestoreDC(nSavedDC);
+		};
+		runner.Run("replay_fit_document", nCommands, [&]() { replayViewport(model, viewportFit, viewportFit.GetZoom()); });
+		runner.Run("replay_fit_full_detail", nCommands, [&]() { replayViewport(model, viewportFit, 1.0); });
+		runner.Run("replay_zoom_1_16", nCommands, [&]() { replayViewport(model, viewportSixteenth, viewportSixteenth.GetZoom()); });
+		runner.Run("replay_fit_cold", nCommands,
+			[&]()
+			{
+				pModel.reset(new CDocumentModel);
+				AppendSyntheticCommands(*pModel, commands);
+			},
+			[&]() { replayViewport(*pModel, viewportFit, viewportFit.GetZoom()); });
+
+		// 分块缓冲区：tile_canvas_cold 每次丢弃所有块后重放可见的块；
+		// tile_canvas_pan 每次平移 64 像素（先向右 16 次再向左 16 次），已完成的块直接复制，只重放新露出的块
+		CheckTileCanvas(model);
+		const CRect rectView(0, 0, BENCH_VIEW_WIDTH, BENCH_VIEW_HEIGHT);
+		const LONGLONG llNoDeadline = std::numeric_limits<LONGLONG>::max();
+		CTileCanvas canvas;
+		CViewport viewportTiles;
+		runner.Run("tile_canvas_cold", nCommands, [&]()
+		{
+			canvas.Clear();
+			canvas.Draw(surface.GetDC(), rectView, model, viewportTiles, BENCH_BK_COLOR, llNoDeadline);
+		});
+		int nPanStep = 0;
+		runner.Run("tile_canvas_pan", nCommands, [&]()
+		{
+			viewportTiles.Pan(CSize((nPanStep++ / 16) % 2 == 0 ? -64 : 64, 0));
+			canvas.Draw(surface.GetDC(), rectView, model, viewportTiles, BENCH_BK_COLOR, llNoDeadline);
+		});
+
+		// 移动和缩放：transform_drag_64_frames 为拖动预览的 64 帧（背景和精灵已缓存，与命令数量无关）；
+		// transform_commit_undo 提交变换和撤销各一次，每次只重放变化区域覆盖的块（对照 tile_canvas_cold 的两次全部重放）
+		std::vector<size_t> selection;
+		model.SelectInRect(TRANSFORM_SELECT_RECT, TRUE, selection);
+		CheckTransform(commands, selection);
+		CRect rectSelection;
+		rectSelection.SetRectEmpty();
+		for (size_t i : selection)
+			rectSelection.UnionRect(&rectSelection, &model.GetCommand(i)->GetBounds());
+		if (!selection.empty())
+		{
+			CTransformPreview preview;
+			preview.Begin(surface.GetDC(), rectView, model, selection, rectSelection, CViewport(), BENCH_BK_COLOR);
+			runner.Run("transform_drag_64_frames", 64, [&]()
+			{
+				for (int i = 0; i < 64; i++)
+				{
+					DrawTransform transform;
+					transform.offset = CSize(i * 5, i * 3);
+					preview.Draw(surface.GetDC(), transform);
+				}
+			});
+			preview.End();
+
+			CViewport viewportEdit;
+			canvas.Clear();
+			canvas.Draw(surface.GetDC(), rectView, model, viewportEdit, BENCH_BK_COLOR, llNoDeadline);
+			const DrawTransform transform = GetBenchTransform(rectSelection);
+			runner.Run("transform_commit_undo", nCommands * 2, [&]()
+			{
+				CRect rectChanged;
+				model.TransformCommands(selection, transform, &rectChanged);
+				canvas.Invalidate(rectChanged, viewportEdit);
+				canvas.Draw(surface.GetDC(), rectView, model, viewportEdit, BENCH_BK_COLOR, llNoDeadline);
+				model.Undo(&rectChanged);
+				canvas.Invalidate(rectChanged, viewportEdit);
+				canvas.Draw(surface.GetDC(), rectView, model, viewportEdit, BENCH_BK_COLOR, llNoDeadline);
+			});
+		}
+
+		// 输入：鼠标拖动绘制（含橡皮筋预览），每次迭代完成一次笔画
+		CheckMouseMoveAllocations(surface.GetDC());
+		CStrokeCapture capture;
+		CColorPalette palette;
+		for (const CMouseBenchTool& tool : MOUSE_BENCH_TOOLS)
+		{
+			runner.Run(tool.pszName, MOUSE_MOVES_PER_STROKE, [&]()
+			{
+				delete DrawStroke(capture, tool.drawType, surface.GetDC(), palette);
+			});
+		}
+
+		// 序列化：写入与读取命令部分
+		CheckStoredPyramids(commands);
+		CheckCorruptCounts();
+		CheckLoadedHistory(commands);
+		CheckColorPalette();
+		CMemFile stored;
+		{
+			CArchive ar(&stored, CArchive::store);
+			model.StoreCommands(ar, snapshot);
+		}
+		runner.Run("store_commands", nCommands, [&]()
+		{
+			CMemFile file;
+			CArchive ar(&file, CArchive::store);
+			model.StoreCommands(ar, snapshot);
+			ar.Close();
+		});
+
+		std::unique_ptr<CDocumentModel> pLoaded;
+		runner.Run("load_commands", nCommands,
+			[&]()
+			{
+				pLoaded.reset(new CDocumentModel);
+				stored.SeekToBegin();
+			},
+			[&]()
+			{
+				CArchive ar(&stored, CArchive::load);
+				pLoaded->LoadCommands(ar);
+			});
+
+		// 与程序保存的文档一样带有笔迹金字塔（缩小显示的基准已经建立了所有金字塔）
+		CMemFile storedPyramids;
+		{
+			CArchive ar(&storedPyramids, CArchive::store);
+			model.StoreCommands(ar, snapshot, TRUE);
+		}
+		runner.Run("load_commands_pyramids", nCommands,
+			[&]()
+			{
+				pLoaded.reset(new CDocumentModel);
+				storedPyramids.SeekToBegin();
+			},
+			[&]()
+			{
+				CArchive ar(&storedPyramids, CArchive::load);
+				pLoaded->LoadCommands(ar);
+			});
+
+		// 导出：SVG、视口大小的 PNG、缩略图
+		const CRect extent = snapshot.GetExtent();
+		runner.Run("export_svg", nCommands, [&]()
+		{
+			CCountingStreamBuf buffer;
+			std::ostream out(&buffer);
+			CSvgWriter writer(out);
+			writer.Begin(extent, extent.Size(), BENCH_BK_COLOR);
+			for (const CDrawCommandPtr& cmd : snapshot.GetCommands())
+				writer.WriteCommand(cmd->GetData(), cmd->GetText(), snapshot.GetColorPalette());
+			writer.End();
+		});
+
+		runner.Run("encode_png_viewport", static_cast<size_t>(BENCH_VIEW_WIDTH) * BENCH_VIEW_HEIGHT, [&]()
+		{
+			CCountingStreamBuf buffer;
+			std::ostream out(&buffer);
+			CPngRowWriter writer(out);
+			writer.Begin(surface.GetWidth(), surface.GetHeight());
+			writer.WriteRows(surface.GetBits(), surface.GetHeight(), surface.GetWidth() * 4);
+			writer.End();
+		});
+
+		std::vector<uint8_t> png;
+		runner.Run("thumbnail_png", nCommands, [&]()
+		{
+			CThumbnailRenderer::RenderPng(snapshot, CThumbnailRenderer::THUMBNAIL_SIZE, BENCH_BK_COLOR, png);
+		});
+
+		// 输入轨迹：合成轨迹先经过一次保存和读取，回放结果必须与直接加入命令的文档一致
+		CInputTrace synthetic = GenerateSyntheticTrace(commands);
+		{
+			CMemFile file;
+			CArchive arStore(&file, CArchive::store);
+			synthetic.Serialize(arStore);
+			arStore.Close();
+			file.SeekToBegin();
+			CArchive arLoad(&file, CArchive::load);
+			synthetic.Serialize(arLoad);
+		}
+		CDocumentModel replayed;
+		CInputTraceReplayResult result;
+		CInputTraceReplayer(replayed).Replay(synthetic, FALSE, result);
+		if (replayed.GetCommandCount() != nCommands
+			|| replayed.GetSnapshot().GetExtent() != snapshot.GetExtent())
+		{
+			throw std::runtime_error("synthetic trace replay does not reproduce the document");
+		}
+		CheckTraceEditing(commands);
+		RunTraceBenchmark(runner, "trace_replay_synthetic", synthetic, false);
+
+		for (const std::string& strPath : options.traces)
+		{
+			CInputTrace trace;
+			if (!trace.Load(CString(strPath.c_str())))
+				throw std::runtime_error("failed to load trace " + strPath);
+			std::string strName = strPath.substr(strPath.find_last_of("/\\") + 1);
+			RunTraceBenchmark(runner, "trace:" + strName, trace, options.bTraceRealTime);
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	CBenchOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 2;
+	}
+
+	CBenchRunner runner(options);
+	if (!options.strProfile.empty())
+		CTraceProfiler::Start();
+	try
+	{
+		RunBenchmarks(runner, options);
+	}
+	catch (const std::exception& e)
+	{
+		fprintf(stderr, "✗ %s\n", e.what());
+		return 1;
+	}
+	catch (CException* e)
+	{
+		fprintf(stderr, "✗ 序列化失败\n");
+		e->Delete();
+		return 1;
+	}
+
+	if (!options.strProfile.empty())
+	{
+		CTraceProfiler::Stop();
+		std::ofstream file(options.strProfile, std::ios::binary | std::ios::trunc);
+		if (!file || !CTraceProfiler::WriteJson(file))
+		{
+			fprintf(stderr, "✗ 无法写入 %s\n", options.strProfile.c_str());
+			return 1;
+		}
+		fprintf(stderr, "性能跟踪：%zu 个事件 -> %s\n", CTraceProfiler::GetEventCount(), options.strProfile.c_str());
+	}
+
+	if (options.strOutput.empty())
+	{
+		WriteJson(std::cout, options, runner.GetResults());
+	}
+	else
+	{
+		std::ofstream file(options.strOutput);
+		WriteJson(file, options, runner.GetResults());
+		if (!file)
+		{
+			fprintf(stderr, "✗ 无法写入 %s\n", options.strOutput.c_str());
+			return 1;
+		}
+	}
+
+	if (!options.strBaseline.empty())
+	{
+		std::map<std::string, double> baseline;
+		if (!ReadBaseline(options.strBaseline, baseline))
+		{
+			fprintf(stderr, "✗ 无法读取基线 %s\n", options.strBaseline.c_str());
+			return 2;
+		}
+		if (CompareWithBaseline(runner.GetResults(), baseline, options.dMaxRegression) > 0)
+			return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,169 @@
+// GdiResourceTest.cpp: GDI 资源峰值测试
+// 在定义 GDI_RESOURCE_ACCOUNTING 的绘图核心上重放一个大文档（逐块重放整个画布、分片重绘、缩略图），
+// 检查包装类同时持有的各类 GDI 对象数量有上限，并且重放结束后画笔、画刷、字体全部释放。
+// 进程的 GDI 句柄上限默认为 10000，峰值超过下面的上限说明出现了泄漏或缓存失控。
+//
+
+#include "pch.h"
+#include "SyntheticDocument.h"
+#include "DocumentModel.h"
+#include "GdiObjectWrapper.h"
+#include "TextRunCache.h"
+#include "ThumbnailRenderer.h"
+
+#include <memory>
+
+#ifndef GDI_RESOURCE_ACCOUNTING
+#error GdiResourceTest 需要定义 GDI_RESOURCE_ACCOUNTING
+#endif
+
+namespace
+{
+	const size_t TEST_COMMANDS = 20000;
+	const int TILE_WIDTH = 1920;
+	const int TILE_HEIGHT = 1080;
+	const COLORREF TEST_BK_COLOR = RGB(255, 255, 255);
+
+	// 绘制一条命令时同时持有的画笔、画刷、字体和内存 DC 不应超过几个
+	const long MAX_PEAK_PER_COMMAND = 4;
+	// 位图：文本缓存的上限，加上画布和缩略图等临时位图
+	const long MAX_PEAK_BITMAPS = static_cast<long>(CTextRunCache::MAX_ENTRIES) + 8;
+	// 所有类型合计，远低于进程的 10000 个句柄上限
+	const long MAX_PEAK_TOTAL = MAX_PEAK_BITMAPS + 4 * MAX_PEAK_PER_COMMAND;
+
+	int g_nFailures = 0;
+
+	void Check(bool bCondition, const char* pszMessage)
+	{
+		fprintf(stderr, "%s %s\n", bCondition ? "✓" : "✗", pszMessage);
+		if (!bCondition)
+			g_nFailures++;
+	}
+
+	long GetPeak(GdiResourceType type)
+	{
+		return CGdiResourceStats::GetPeak(type);
+	}
+
+	void PrintStats()
+	{
+		for (int i = 0; i < static_cast<int>(GdiResourceType::Count); i++)
+		{
+			GdiResourceType type = static_cast<GdiResourceType>(i);
+			fprintf(stderr, "  %-8ls 持有 %6ld  峰值 %6ld  累计创建 %10lld\n", CGdiResourceStats::GetTypeName(type),
+				CGdiResourceStats::GetLive(type), CGdiResourceStats::GetPeak(type), CGdiResourceStats::GetCreated(type));
+		}
+	}
+
+	// 与视图的重绘缓冲区一样的 32 位位图表面
+	class CTestSurface
+	{
+	private:
+		std::unique_ptr<CBitmapWrapper> m_bitmap;
+		std::unique_ptr<CDCWrapper> m_dc;
+
+	public:
+		CTestSurface(int nWidth, int nHeight)
+		{
+			BITMAPINFO bmi;
+			ZeroMemory(&bmi, sizeof(bmi));
+			bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+			bmi.bmiHeader.biWidth = nWidth;
+			bmi.bmiHeader.biHeight = -nHeight;
+			bmi.bmiHeader.biPlanes = 1;
+			bmi.bmiHeader.biBitCount = 32;
+			bmi.bmiHeader.biCompression = BI_RGB;
+
+			void* pBits = nullptr;
+			HBITMAP hBitmap = CreateDIBSection(nullptr, &bmi, DIB_RGB_COLORS, &pBits, nullptr, 0);
+			if (hBitmap == nullptr)
+				throw CGdiObjectException(_T("Failed to create test DIB section"));
+			m_bitmap.reset(new CBitmapWrapper(hBitmap, TRUE));
+
+			HDC hMemDC = CreateCompatibleDC(nullptr);
+			if (hMemDC == nullptr)
+				throw CGdiObjectException(_T("Failed to create memory DC"));
+			m_dc.reset(new CDCWrapper(hMemDC, TRUE));
+			SelectObject(*m_dc, m_bitmap->Get());
+		}
+
+		CDC* GetDC() const { return CDC::FromHandle(*m_dc); }
+	};
+
+	void RunTest()
+	{
+		CDocumentModel model;
+		AppendSyntheticCommands(model, GenerateSyntheticCommands(TEST_COMMANDS, 1));
+		CGdiResourceStats::ResetPeaks();
+
+		{
+			CTestSurface surface(TILE_WIDTH, TILE_HEIGHT);
+			CDC* pDC = surface.GetDC();
+
+			// 逐块重放整个画布，文本缓存会被填满并开始淘汰
+			for (int y = 0; y < SYNTHETIC_CANVAS_HEIGHT; y += TILE_HEIGHT)
+			{
+				for (int x = 0; x < SYNTHETIC_CANVAS_WIDTH; x += TILE_WIDTH)
+				{
+					pDC->SetViewportOrg(0, 0);
+					pDC->FillSolidRect(0, 0, TILE_WIDTH, TILE_HEIGHT, TEST_BK_COLOR);
+					pDC->SetViewportOrg(-x, -y);
+					model.RedrawAll(pDC);
+				}
+			}
+
+			// 与视图的渐进式重绘相同，按时间片分多次重放
+			pDC->SetViewportOrg(0, 0);
+			LARGE_INTEGER frequency;
+			QueryPerformanceFrequency(&frequency);
+			size_t nPos = 0;
+			while (nPos < model.GetCommandCount())
+			{
+				LARGE_INTEGER now;
+				QueryPerformanceCounter(&now);
+				nPos = model.RedrawSlice(pDC, nPos, now.QuadPart + frequency.QuadPart * 8 / 1000);
+			}
+		}
+
+		std::vector<uint8_t> png;
+		CThumbnailRenderer::RenderPng(model.GetSnapshot(), CThumbnailRenderer::THUMBNAIL_SIZE, TEST_BK_COLOR, png);
+
+		fprintf(stderr, "重放 %zu 条命令后：\n", model.GetCommandCount());
+		PrintStats();
+
+		Check(CGdiResourceStats::GetCreated(GdiResourceType::Pen) > 0, "统计到了画笔的创建");
+		Check(GetPeak(GdiResourceType::Pen) <= MAX_PEAK_PER_COMMAND, "画笔峰值有上限");
+		Check(GetPeak(GdiResourceType::Brush) <= MAX_PEAK_PER_COMMAND, "画刷峰值有上限");
+		Check(GetPeak(GdiResourceType::Font) <= MAX_PEAK_PER_COMMAND, "字体峰值有上限");
+		Check(GetPeak(GdiResourceType::DC) <= MAX_PEAK_PER_COMMAND, "DC 峰值有上限");
+		Check(GetPeak(GdiResourceType::Bitmap) <= MAX_PEAK_BITMAPS, "位图峰值不超过文本缓存上限");
+
+		long nPeakTotal = 0;
+		for (int i = 0; i < static_cast<int>(GdiResourceType::Count); i++)
+			nPeakTotal += GetPeak(static_cast<GdiResourceType>(i));
+		Check(nPeakTotal <= MAX_PEAK_TOTAL, "所有类型的峰值合计有上限");
+
+		Check(CGdiResourceStats::GetLive(GdiResourceType::Pen) == 0
+			&& CGdiResourceStats::GetLive(GdiResourceType::Brush) == 0
+			&& CGdiResourceStats::GetLive(GdiResourceType::Font) == 0, "重放结束后画笔、画刷、字体全部释放");
+
+		// 清空文本缓存后只剩缓存自己的内存 DC
+		CTextRunCache::ForCurrentThread().Clear();
+		Check(CGdiResourceStats::GetLive(GdiResourceType::Bitmap) == 0
+			&& CGdiResourceStats::GetLive(GdiResourceType::DC) <= 1, "清空文本缓存后不再持有位图");
+	}
+}
+
+int main()
+{
+	try
+	{
+		RunTest();
+	}
+	catch (const std::exception& e)
+	{
+		fprintf(stderr, "✗ %s\n", e.what());
+		return 1;
+	}
+	return g_nFailures == 0 ? 0 : 1;
+}
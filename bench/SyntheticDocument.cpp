@@ -0,0 +1,191 @@
+// SyntheticDocument.cpp: 合成文档的实现
+//
+
+#include "pch.h"
+#include "SyntheticDocument.h"
+
+#include <cmath>
+#include <random>
+
+namespace
+{
+	const COLORREF SYNTHETIC_COLORS[] =
+	{
+		RGB(0, 0, 0), RGB(255, 0, 0), RGB(0, 128, 0), RGB(0, 0, 255), RGB(255, 128, 0),
+		RGB(128, 0, 128), RGB(0, 128, 128), RGB(128, 128, 128), RGB(192, 0, 64), RGB(64, 64, 192),
+		RGB(255, 255, 0), RGB(0, 255, 255), RGB(255, 0, 255), RGB(96, 48, 0), RGB(0, 64, 32),
+	};
+
+	const wchar_t* const SYNTHETIC_WORDS[] =
+	{
+		L"草图", L"注释", L"边界", L"benchmark", L"Layer", L"审阅", L"TODO", L"尺寸",
+		L"区域 A", L"连接线", L"version 2", L"说明文字", L"Note", L"起点", L"终点",
+	};
+
+	class CSyntheticGenerator
+	{
+	private:
+		std::mt19937 m_random;
+
+		int Uniform(int nMin, int nMax) { return std::uniform_int_distribution<int>(nMin, nMax)(m_random); }
+
+		CPoint RandomPoint() { return CPoint(Uniform(0, SYNTHETIC_CANVAS_WIDTH), Uniform(0, SYNTHETIC_CANVAS_HEIGHT)); }
+
+		COLORREF RandomColor() { return SYNTHETIC_COLORS[Uniform(0, static_cast<int>(_countof(SYNTHETIC_COLORS)) - 1)]; }
+
+		// 随机游走的轨迹，模拟鼠标拖动时每次移动几个像素
+		void RandomStroke(std::vector<CPoint>& points, int nPoints)
+		{
+			CPoint point = RandomPoint();
+			double dAngle = Uniform(0, 359) * 3.14159265 / 180;
+			points.reserve(nPoints);
+			for (int i = 0; i < nPoints; i++)
+			{
+				points.push_back(point);
+				dAngle += Uniform(-20, 20) * 3.14159265 / 180;
+				int nStep = Uniform(1, 6);
+				point.x = std::max(0, std::min(SYNTHETIC_CANVAS_WIDTH, point.x + static_cast<int>(nStep * cos(dAngle))));
+				point.y = std::max(0, std::min(SYNTHETIC_CANVAS_HEIGHT, point.y + static_cast<int>(nStep * sin(dAngle))));
+			}
+		}
+
+	public:
+		explicit CSyntheticGenerator(unsigned nSeed) : m_random(nSeed) {}
+
+		CSyntheticCommand Next()
+		{
+			CSyntheticCommand command;
+			DrawData& data = command.data;
+			data.penSize = Uniform(1, 8);
+			command.penColor = RandomColor();
+			command.brushColor = RandomColor();
+			data.pointBegin = RandomPoint();
+			data.pointEnd = data.pointBegin + CSize(Uniform(-400, 400), Uniform(-300, 300));
+
+			// 命令比例：铅笔 30%，线段 25%，矩形 15%，文本 10%，圆和椭圆各 8%，橡皮擦 4%
+			int nKind = Uniform(0, 99);
+			if (nKind < 30)
+			{
+				data.drawType = DrawData::DrawType::Pencil;
+				RandomStroke(data.pencilPoints, Uniform(20, 400));
+			}
+			else if (nKind < 55)
+			{
+				data.drawType = DrawData::DrawType::LineSegment;
+			}
+			else if (nKind < 70)
+			{
+				data.drawType = DrawData::DrawType::Rectangle;
+			}
+			else if (nKind < 80)
+			{
+				data.drawType = DrawData::DrawType::Text;
+				int nWords = Uniform(1, 4);
+				for (int i = 0; i < nWords; i++)
+				{
+					if (i > 0)
+						command.text += L' ';
+					command.text += SYNTHETIC_WORDS[Uniform(0, static_cast<int>(_countof(SYNTHETIC_WORDS)) - 1)];
+				}
+			}
+			else if (nKind < 88)
+			{
+				data.drawType = DrawData::DrawType::Circle;
+			}
+			else if (nKind < 96)
+			{
+				data.drawType = DrawData::DrawType::Ellipse;
+			}
+			else
+			{
+				data.drawType = DrawData::DrawType::Eraser;
+				data.penSize = Uniform(10, 30);
+				RandomStroke(data.pencilPoints, Uniform(20, 200));
+			}
+			return command;
+		}
+	};
+}
+
+std::vector<CSyntheticCommand> GenerateSyntheticCommands(size_t nCommands, unsigned nSeed)
+{
+	CSyntheticGenerator generator(nSeed);
+	std::vector<CSyntheticCommand> commands;
+	commands.reserve(nCommands);
+	for (size_t i = 0; i < nCommands; i++)
+		commands.push_back(generator.Next());
+	return commands;
+}
+
+CInputTrace GenerateSyntheticTrace(const std::vector<CSyntheticCommand>& commands)
+{
+	const LONGLONG MOVE_INTERVAL_US = 8000;
+	CInputTrace trace;
+	LONGLONG llTime = 0;
+	auto add = [&](InputTraceEventType type, CPoint point, DWORD nValue, LONGLONG llDelay)
+	{
+		CInputTraceEvent event;
+		event.type = type;
+		event.llTime = (llTime += llDelay);
+		event.point = point;
+		event.nValue = nValue;
+		trace.Add(event);
+	};
+
+	for (size_t i = 0; i < commands.size(); i++)
+	{
+		const DrawData& data = commands[i].data;
+		add(InputTraceEventType::SetTool, CPoint(), static_cast<DWORD>(data.drawType), 200000);
+		add(InputTraceEventType::SetPenSize, CPoint(), static_cast<DWORD>(data.penSize), 1000);
+		add(InputTraceEventType::SetPenColor, CPoint(), commands[i].penColor, 1000);
+
+		if (data.drawType == DrawData::DrawType::Text)
+		{
+			CInputTraceEvent event;
+			event.type = InputTraceEventType::Text;
+			event.llTime = (llTime += 500000);
+			event.point = data.pointBegin;
+			event.text = commands[i].text;
+			trace.Add(event);
+		}
+		else if (!data.pencilPoints.empty())
+		{
+			add(InputTraceEventType::MouseDown, data.pencilPoints.front(), 0, 100000);
+			for (size_t j = 1; j < data.pencilPoints.size(); j++)
+				add(InputTraceEventType::MouseMove, data.pencilPoints[j], 0, MOVE_INTERVAL_US);
+			add(InputTraceEventType::MouseUp, data.pencilPoints.back(), 0, MOVE_INTERVAL_US);
+		}
+		else
+		{
+			// 图形：从起点拖到终点，中间 16 次移动
+			add(InputTraceEventType::MouseDown, data.pointBegin, 0, 100000);
+			CSize sizeDrag = data.pointEnd - data.pointBegin;
+			for (int j = 1; j <= 16; j++)
+				add(InputTraceEventType::MouseMove, data.pointBegin + CSize(sizeDrag.cx * j / 16, sizeDrag.cy * j / 16), 0, MOVE_INTERVAL_US);
+			add(InputTraceEventType::MouseUp, data.pointEnd, 0, MOVE_INTERVAL_US);
+		}
+
+		if (i % 50 == 49)
+		{
+			add(InputTraceEventType::Undo, CPoint(), 0, 300000);
+			add(InputTraceEventType::Redo, CPoint(), 0, 300000);
+		}
+	}
+	return trace;
+}
+
+DrawData PrepareSyntheticData(CDocumentModel& model, const CSyntheticCommand& command)
+{
+	DrawData data(command.data);
+	data.SetPenColor(model.GetColorPalette(), command.penColor);
+	data.SetBrushColor(model.GetColorPalette(), command.brushColor);
+	if (!command.text.IsEmpty())
+		data.nTextId = model.InternText(command.text);
+	return data;
+}
+
+void AppendSyntheticCommands(CDocumentModel& model, const std::vector<CSyntheticCommand>& commands)
+{
+	for (const CSyntheticCommand& command : commands)
+		model.AddCommand(CreateDrawCommand(PrepareSyntheticData(model, command), model.GetStringPool()));
+}
@@ -0,0 +1,37 @@
+// SyntheticDocument.h: 基准测试使用的合成文档
+// 按固定的随机种子生成与实际绘图相近的命令组合：线段、矩形、圆、椭圆、长铅笔轨迹、橡皮擦轨迹和文本。
+// 同一种子总是生成相同的文档，不同次运行的结果可以直接比较。
+//
+
+#pragma once
+
+#include <afxwin.h>
+#include <vector>
+#include "DrawCommand.h"
+#include "DocumentModel.h"
+#include "InputTrace.h"
+
+// 一条合成命令：绘图数据、文本命令的内容和颜色（nTextId 和颜色序号在加入文档时才确定）
+struct CSyntheticCommand
+{
+	DrawData data;
+	CString text;
+	COLORREF penColor;
+	COLORREF brushColor;
+};
+
+// 合成文档的画布大小（逻辑坐标）
+const int SYNTHETIC_CANVAS_WIDTH = 4000;
+const int SYNTHETIC_CANVAS_HEIGHT = 3000;
+
+// 生成 nCommands 条命令
+std::vector<CSyntheticCommand> GenerateSyntheticCommands(size_t nCommands, unsigned nSeed);
+
+// 生成加入 model 的绘图数据：文本加入文档的字符串池，颜色加入文档的颜色表
+DrawData PrepareSyntheticData(CDocumentModel& model, const CSyntheticCommand& command);
+// 按顺序把命令加入文档（文本先加入文档的字符串池）
+void AppendSyntheticCommands(CDocumentModel& model, const std::vector<CSyntheticCommand>& commands);
+
+// 生成画出这些命令的输入轨迹：每条命令前切换工具和画笔，鼠标按约 125Hz 的频率移动，
+// 每 50 条命令撤销并重做一次
+CInputTrace GenerateSyntheticTrace(const std::vector<CSyntheticCommand>& commands);
@@ -0,0 +1,1058 @@
+// GdiRaster.cpp: 无界面构建中 GDI 函数的软件实现
+// 在 32 位内存位图（与 DIB 相同的 BGRX 像素格式）上光栅化线段、矩形、椭圆和文本。
+// 目标是让基准测试中的绘图耗时与图形量成正比、结果确定：几何上与 GDI 大致一致，
+// 文本没有真正的字形，每个字符按字号画成固定图案的色块。
+//
+
+#include <afxwin.h>
+
+#include <cmath>
+
+namespace
+{
+	// 所有 GDI 对象的公共头部
+	struct CRasterObject
+	{
+		DWORD nType;
+		bool bStock;
+
+		CRasterObject(DWORD type, bool stock) : nType(type), bStock(stock) {}
+		virtual ~CRasterObject() {}
+	};
+
+	struct CRasterPen : CRasterObject
+	{
+		int nStyle;
+		int nWidth;
+		COLORREF color;
+
+		CRasterPen(int style, int width, COLORREF clr, bool stock = false)
+			: CRasterObject(OBJ_PEN, stock), nStyle(style), nWidth(width), color(clr) {}
+	};
+
+	struct CRasterBrush : CRasterObject
+	{
+		int nStyle;
+		COLORREF color;
+
+		CRasterBrush(int style, COLORREF clr, bool stock = false)
+			: CRasterObject(OBJ_BRUSH, stock), nStyle(style), color(clr) {}
+	};
+
+	struct CRasterFont : CRasterObject
+	{
+		LOGFONT lf;
+
+		CRasterFont(const LOGFONT& logFont, bool stock = false) : CRasterObject(OBJ_FONT, stock), lf(logFont) {}
+	};
+
+	struct CRasterBitmap : CRasterObject
+	{
+		int nWidth;
+		int nHeight;
+		std::vector<uint32_t> pixels;
+		bool bBottomUp;  // 自下而上的 DIB：内存中第一行是图像最后一行
+
+		CRasterBitmap(int width, int height, bool bottomUp, bool stock = false)
+			: CRasterObject(OBJ_BITMAP, stock), nWidth(width), nHeight(height),
+			pixels(static_cast<size_t>(width) * height), bBottomUp(bottomUp) {}
+
+		uint32_t* Row(int y)
+		{
+			return pixels.data() + static_cast<size_t>(bBottomUp ? nHeight - 1 - y : y) * nWidth;
+		}
+	};
+
+	LOGFONT MakeSystemFont()
+	{
+		LOGFONT lf;
+		memset(&lf, 0, sizeof(lf));
+		lf.lfHeight = 16;
+		lf.lfWeight = FW_BOLD;
+		wcscpy(lf.lfFaceName, L"System");
+		return lf;
+	}
+
+	CRasterBrush g_stockBrushes[] =
+	{
+		CRasterBrush(BS_SOLID, RGB(255, 255, 255), true),
+		CRasterBrush(BS_SOLID, RGB(192, 192, 192), true),
+		CRasterBrush(BS_SOLID, RGB(128, 128, 128), true),
+		CRasterBrush(BS_SOLID, RGB(64, 64, 64), true),
+		CRasterBrush(BS_SOLID, RGB(0, 0, 0), true),
+		CRasterBrush(BS_NULL, 0, true),
+	};
+	CRasterPen g_stockWhitePen(PS_SOLID, 0, RGB(255, 255, 255), true);
+	CRasterPen g_stockBlackPen(PS_SOLID, 0, RGB(0, 0, 0), true);
+	CRasterPen g_stockNullPen(PS_NULL, 0, 0, true);
+	CRasterFont g_stockSystemFont(MakeSystemFont(), true);
+	CRasterBitmap g_stockBitmap(1, 1, false, true);  // 内存 DC 默认选入的 1x1 位图
+
+	// 设备上下文的状态（SaveDC 保存的内容）
+	struct CRasterDCState
+	{
+		CRasterPen* pPen = &g_stockBlackPen;
+		CRasterBrush* pBrush = &g_stockBrushes[WHITE_BRUSH];
+		CRasterFont* pFont = &g_stockSystemFont;
+		CRasterBitmap* pBitmap = &g_stockBitmap;
+		COLORREF textColor = RGB(0, 0, 0);
+		COLORREF bkColor = RGB(255, 255, 255);
+		int nBkMode = OPAQUE;
+		int nRop2 = R2_COPYPEN;
+		int nMapMode = MM_TEXT;
+		int nGraphicsMode = GM_COMPATIBLE;
+		int nStretchMode = BLACKONWHITE;
+		UINT nTextAlign = TA_LEFT | TA_TOP;
+		POINT ptWindowOrg = { 0, 0 };
+		POINT ptViewportOrg = { 0, 0 };
+		SIZE sizeWindowExt = { 1, 1 };
+		SIZE sizeViewportExt = { 1, 1 };
+		POINT ptCurrent = { 0, 0 };
+		bool bClip = false;
+		RECT rectClip = { 0, 0, 0, 0 };  // 设备坐标
+	};
+
+	// 像素取整：向上舍入 0.5，与 GDI 一样平移整数像素后结果不变（std::lround 对负数向远离 0 舍入）
+	inline int RoundPixel(double x)
+	{
+		return static_cast<int>(std::floor(x + 0.5));
+	}
+
+	inline uint32_t ToPixel(COLORREF color)
+	{
+		return static_cast<uint32_t>(GetBValue(color)) | (static_cast<uint32_t>(GetGValue(color)) << 8) | (static_cast<uint32_t>(GetRValue(color)) << 16);
+	}
+
+	inline COLORREF FromPixel(uint32_t pixel)
+	{
+		return RGB((pixel >> 16) & 0xFF, (pixel >> 8) & 0xFF, pixel & 0xFF);
+	}
+}
+
+struct HDC__
+{
+	DWORD nType = OBJ_MEMDC;
+	CRasterDCState state;
+	std::vector<CRasterDCState> saved;
+
+	// 逻辑坐标到设备坐标
+	bool IsScaled() const { return state.nMapMode != MM_TEXT; }
+
+	int ToDeviceX(int x) const
+	{
+		if (!IsScaled())
+			return x - state.ptWindowOrg.x + state.ptViewportOrg.x;
+		return static_cast<int>(std::floor((static_cast<double>(x) - state.ptWindowOrg.x) * state.sizeViewportExt.cx / state.sizeWindowExt.cx + 0.5)) + state.ptViewportOrg.x;
+	}
+
+	int ToDeviceY(int y) const
+	{
+		if (!IsScaled())
+			return y - state.ptWindowOrg.y + state.ptViewportOrg.y;
+		return static_cast<int>(std::floor((static_cast<double>(y) - state.ptWindowOrg.y) * state.sizeViewportExt.cy / state.sizeWindowExt.cy + 0.5)) + state.ptViewportOrg.y;
+	}
+
+	int ToLogicalX(int x) const
+	{
+		if (!IsScaled())
+			return x - state.ptViewportOrg.x + state.ptWindowOrg.x;
+		return static_cast<int>(std::floor((static_cast<double>(x) - state.ptViewportOrg.x) * state.sizeWindowExt.cx / state.sizeViewportExt.cx + 0.5)) + state.ptWindowOrg.x;
+	}
+
+	int ToLogicalY(int y) const
+	{
+		if (!IsScaled())
+			return y - state.ptViewportOrg.y + state.ptWindowOrg.y;
+		return static_cast<int>(std::floor((static_cast<double>(y) - state.ptViewportOrg.y) * state.sizeWindowExt.cy / state.sizeViewportExt.cy + 0.5)) + state.ptWindowOrg.y;
+	}
+
+	// 逻辑长度到设备长度（画笔宽度、字号）
+	double ScaleX() const { return IsScaled() ? std::fabs(static_cast<double>(state.sizeViewportExt.cx) / state.sizeWindowExt.cx) : 1.0; }
+	double ScaleY() const { return IsScaled() ? std::fabs(static_cast<double>(state.sizeViewportExt.cy) / state.sizeWindowExt.cy) : 1.0; }
+
+	// 可绘制区域（设备坐标，已与位图范围相交）
+	RECT Clip() const
+	{
+		RECT rect = { 0, 0, state.pBitmap->nWidth, state.pBitmap->nHeight };
+		if (state.bClip)
+		{
+			rect.left = std::max(rect.left, state.rectClip.left);
+			rect.top = std::max(rect.top, state.rectClip.top);
+			rect.right = std::min(rect.right, state.rectClip.right);
+			rect.bottom = std::min(rect.bottom, state.rectClip.bottom);
+		}
+		return rect;
+	}
+
+	// 用当前 ROP2 写一段水平像素 [x0, x1)
+	void Span(int y, int x0, int x1, COLORREF color, int nRop2)
+	{
+		RECT clip = Clip();
+		if (y < clip.top || y >= clip.bottom)
+			return;
+		x0 = std::max(x0, static_cast<int>(clip.left));
+		x1 = std::min(x1, static_cast<int>(clip.right));
+		if (x0 >= x1)
+			return;
+
+		uint32_t* pRow = state.pBitmap->Row(y);
+		const uint32_t pixel = ToPixel(color);
+		switch (nRop2)
+		{
+		case R2_COPYPEN:
+			std::fill(pRow + x0, pRow + x1, pixel);
+			break;
+		case R2_BLACK:
+			std::fill(pRow + x0, pRow + x1, 0u);
+			break;
+		case R2_WHITE:
+			std::fill(pRow + x0, pRow + x1, 0xFFFFFFu);
+			break;
+		case R2_NOT:
+			for (int x = x0; x < x1; x++) pRow[x] = ~pRow[x] & 0xFFFFFFu;
+			break;
+		case R2_XORPEN:
+			for (int x = x0; x < x1; x++) pRow[x] ^= pixel;
+			break;
+		case R2_NOTXORPEN:
+			for (int x = x0; x < x1; x++) pRow[x] = ~(pRow[x] ^ pixel) & 0xFFFFFFu;
+			break;
+		default:
+			break;
+		}
+	}
+
+	void FillDeviceRect(int left, int top, int right, int bottom, COLORREF color, int nRop2)
+	{
+		if (left > right) std::swap(left, right);
+		if (top > bottom) std::swap(top, bottom);
+		for (int y = top; y < bottom; y++)
+			Span(y, left, right, color, nRop2);
+	}
+
+	// 实心圆（粗线段的圆头）；坐标相对于设备点 (ox, oy)
+	void Disc(double cx, double cy, double r, COLORREF color, int ox, int oy)
+	{
+		int y0 = static_cast<int>(std::ceil(cy - r - 0.5));
+		int y1 = static_cast<int>(std::floor(cy + r - 0.5));
+		for (int y = y0; y <= y1; y++)
+		{
+			double dy = y + 0.5 - cy;
+			double dx = std::sqrt(std::max(0.0, r * r - dy * dy));
+			Span(oy + y, ox + RoundPixel(cx - dx), ox + RoundPixel(cx + dx), color, state.nRop2);
+		}
+	}
+
+	// 凸多边形扫描线填充；坐标相对于设备点 (ox, oy)
+	void FillConvex(const double* xs, const double* ys, int n, COLORREF color, int ox, int oy)
+	{
+		double yMin = ys[0], yMax = ys[0];
+		for (int i = 1; i < n; i++)
+		{
+			yMin = std::min(yMin, ys[i]);
+			yMax = std::max(yMax, ys[i]);
+		}
+		RECT clip = Clip();
+		int y0 = std::max(static_cast<int>(std::ceil(yMin - 0.5)), static_cast<int>(clip.top) - oy);
+		int y1 = std::min(static_cast<int>(std::floor(yMax - 0.5)), static_cast<int>(clip.bottom) - 1 - oy);
+		for (int y = y0; y <= y1; y++)
+		{
+			double fy = y + 0.5;
+			double xLeft = 1e300, xRight = -1e300;
+			for (int i = 0; i < n; i++)
+			{
+				int j = (i + 1) % n;
+				double ya = ys[i], yb = ys[j];
+				if ((fy < ya) == (fy < yb))
+					continue;
+				double x = xs[i] + (fy - ya) * (xs[j] - xs[i]) / (yb - ya);
+				xLeft = std::min(xLeft, x);
+				xRight = std::max(xRight, x);
+			}
+			if (xLeft <= xRight)
+				Span(oy + y, ox + RoundPixel(xLeft), ox + RoundPixel(xRight), color, state.nRop2);
+		}
+	}
+
+	// 用当前画笔画一条设备坐标线段；bLast 为 FALSE 时与 GDI 一样不画终点
+	void DeviceLine(int x0, int y0, int x1, int y1, bool bLast)
+	{
+		const CRasterPen& pen = *state.pPen;
+		if (pen.nStyle == PS_NULL)
+			return;
+
+		int nWidth = static_cast<int>(std::lround(pen.nWidth * ScaleX()));
+		if (nWidth <= 1)
+		{
+			// 单像素线：Bresenham
+			int dx = std::abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+			int dy = -std::abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+			int err = dx + dy;
+			for (;;)
+			{
+				if (x0 == x1 && y0 == y1)
+				{
+					if (bLast)
+						Span(y0, x0, x0 + 1, pen.color, state.nRop2);
+					break;
+				}
+				Span(y0, x0, x0 + 1, pen.color, state.nRop2);
+				int e2 = 2 * err;
+				if (e2 >= dy) { err += dy; x0 += sx; }
+				if (e2 <= dx) { err += dx; y0 += sy; }
+			}
+			return;
+		}
+
+		// 粗线：线段矩形加两端的圆头（GDI 几何画笔的默认端点样式）
+		// 以起点为原点计算，与 GDI 的定点运算一样，平移整数像素后结果不变
+		const double r = nWidth / 2.0;
+		const double ax = 0.5, ay = 0.5, bx = x1 - x0 + 0.5, by = y1 - y0 + 0.5;
+		const double len = std::hypot(bx - ax, by - ay);
+		if (len > 0)
+		{
+			double nx = -(by - ay) / len * r, ny = (bx - ax) / len * r;
+			double xs[4] = { ax + nx, bx + nx, bx - nx, ax - nx };
+			double ys[4] = { ay + ny, by + ny, by - ny, ay - ny };
+			FillConvex(xs, ys, 4, pen.color, x0, y0);
+		}
+		Disc(ax, ay, r, pen.color, x0, y0);
+		Disc(bx, by, r, pen.color, x0, y0);
+	}
+
+	int FontHeight() const
+	{
+		int nHeight = std::abs(static_cast<int>(state.pFont->lf.lfHeight));
+		return nHeight == 0 ? 16 : nHeight;
+	}
+
+	// 字符宽度（逻辑单位）：ASCII 半角，其余全角
+	int CharWidth(wchar_t ch) const
+	{
+		int nHeight = FontHeight();
+		return ch < 0x80 ? (nHeight + 1) / 2 : nHeight;
+	}
+};
+
+namespace
+{
+	inline bool IsDC(HDC hdc) { return hdc != nullptr; }
+
+	template<typename T>
+	T* CastObject(HGDIOBJ h, DWORD nType)
+	{
+		CRasterObject* pObject = static_cast<CRasterObject*>(h);
+		return pObject != nullptr && pObject->nType == nType ? static_cast<T*>(pObject) : nullptr;
+	}
+}
+
+// 对象
+HGDIOBJ GetStockObject(int i)
+{
+	switch (i)
+	{
+	case WHITE_BRUSH: case LTGRAY_BRUSH: case GRAY_BRUSH: case DKGRAY_BRUSH: case BLACK_BRUSH: case NULL_BRUSH:
+		return &g_stockBrushes[i];
+	case WHITE_PEN: return &g_stockWhitePen;
+	case BLACK_PEN: return &g_stockBlackPen;
+	case NULL_PEN: return &g_stockNullPen;
+	case SYSTEM_FONT: case DEFAULT_GUI_FONT: return &g_stockSystemFont;
+	default: return nullptr;
+	}
+}
+
+BOOL DeleteObject(HGDIOBJ ho)
+{
+	CRasterObject* pObject = static_cast<CRasterObject*>(ho);
+	if (pObject == nullptr)
+		return FALSE;
+	if (!pObject->bStock)
+		delete pObject;
+	return TRUE;
+}
+
+DWORD GetObjectType(HGDIOBJ h)
+{
+	return h == nullptr ? 0 : static_cast<CRasterObject*>(h)->nType;
+}
+
+int GetObject(HGDIOBJ h, int c, LPVOID pv)
+{
+	CRasterObject* pObject = static_cast<CRasterObject*>(h);
+	if (pObject == nullptr)
+		return 0;
+
+	switch (pObject->nType)
+	{
+	case OBJ_PEN:
+	{
+		const CRasterPen* pPen = static_cast<CRasterPen*>(pObject);
+		LOGPEN lp = { static_cast<UINT>(pPen->nStyle), { pPen->nWidth, 0 }, pPen->color };
+		if (pv == nullptr) return sizeof(lp);
+		memcpy(pv, &lp, std::min(static_cast<size_t>(c), sizeof(lp)));
+		return std::min(c, static_cast<int>(sizeof(lp)));
+	}
+	case OBJ_BRUSH:
+	{
+		const CRasterBrush* pBrush = static_cast<CRasterBrush*>(pObject);
+		LOGBRUSH lb = { static_cast<UINT>(pBrush->nStyle), pBrush->color, 0 };
+		if (pv == nullptr) return sizeof(lb);
+		memcpy(pv, &lb, std::min(static_cast<size_t>(c), sizeof(lb)));
+		return std::min(c, static_cast<int>(sizeof(lb)));
+	}
+	case OBJ_FONT:
+	{
+		const CRasterFont* pFont = static_cast<CRasterFont*>(pObject);
+		if (pv == nullptr) return sizeof(LOGFONT);
+		memcpy(pv, &pFont->lf, std::min(static_cast<size_t>(c), sizeof(LOGFONT)));
+		return std::min(c, static_cast<int>(sizeof(LOGFONT)));
+	}
+	case OBJ_BITMAP:
+	{
+		CRasterBitmap* pBitmap = static_cast<CRasterBitmap*>(pObject);
+		BITMAP bm = { 0, pBitmap->nWidth, pBitmap->nHeight, pBitmap->nWidth * 4, 1, 32, pBitmap->pixels.data() };
+		if (pv == nullptr) return sizeof(bm);
+		memcpy(pv, &bm, std::min(static_cast<size_t>(c), sizeof(bm)));
+		return std::min(c, static_cast<int>(sizeof(bm)));
+	}
+	default:
+		return 0;
+	}
+}
+
+HPEN CreatePen(int iStyle, int cWidth, COLORREF color)
+{
+	return new CRasterPen(iStyle, std::max(0, cWidth), color);
+}
+
+HBRUSH CreateSolidBrush(COLORREF color)
+{
+	return new CRasterBrush(BS_SOLID, color);
+}
+
+HBRUSH CreatePatternBrush(HBITMAP hbm)
+{
+	// 图案画刷按位图左上角像素的颜色实心填充
+	CRasterBitmap* pBitmap = CastObject<CRasterBitmap>(hbm, OBJ_BITMAP);
+	if (pBitmap == nullptr)
+		return nullptr;
+	COLORREF color = pBitmap->pixels.empty() ? 0 : FromPixel(pBitmap->Row(0)[0]);
+	return new CRasterBrush(BS_SOLID, color);
+}
+
+HFONT CreateFontIndirect(const LOGFONT* lplf)
+{
+	return lplf == nullptr ? nullptr : new CRasterFont(*lplf);
+}
+
+HBITMAP CreateCompatibleBitmap(HDC hdc, int cx, int cy)
+{
+	(void)hdc;
+	if (cx <= 0 || cy <= 0)
+		return nullptr;
+	return new CRasterBitmap(cx, cy, false);
+}
+
+HBITMAP CreateDIBSection(HDC hdc, const BITMAPINFO* pbmi, UINT usage, void** ppvBits, HANDLE hSection, DWORD offset)
+{
+	(void)hdc; (void)usage; (void)hSection; (void)offset;
+	if (pbmi == nullptr || pbmi->bmiHeader.biBitCount != 32 || pbmi->bmiHeader.biWidth <= 0 || pbmi->bmiHeader.biHeight == 0)
+		return nullptr;
+	CRasterBitmap* pBitmap = new CRasterBitmap(pbmi->bmiHeader.biWidth, std::abs(pbmi->bmiHeader.biHeight), pbmi->bmiHeader.biHeight > 0);
+	if (ppvBits != nullptr)
+		*ppvBits = pBitmap->pixels.data();
+	return pBitmap;
+}
+
+// 设备上下文
+HDC CreateCompatibleDC(HDC hdc)
+{
+	(void)hdc;
+	return new HDC__;
+}
+
+BOOL DeleteDC(HDC hdc)
+{
+	if (hdc == nullptr)
+		return FALSE;
+	delete hdc;
+	return TRUE;
+}
+
+HGDIOBJ SelectObject(HDC hdc, HGDIOBJ h)
+{
+	if (!IsDC(hdc) || h == nullptr)
+		return nullptr;
+
+	CRasterDCState& state = hdc->state;
+	HGDIOBJ hOld = nullptr;
+	switch (static_cast<CRasterObject*>(h)->nType)
+	{
+	case OBJ_PEN: hOld = state.pPen; state.pPen = static_cast<CRasterPen*>(h); break;
+	case OBJ_BRUSH: hOld = state.pBrush; state.pBrush = static_cast<CRasterBrush*>(h); break;
+	case OBJ_FONT: hOld = state.pFont; state.pFont = static_cast<CRasterFont*>(h); break;
+	case OBJ_BITMAP: hOld = state.pBitmap; state.pBitmap = static_cast<CRasterBitmap*>(h); break;
+	default: break;
+	}
+	return hOld;
+}
+
+HGDIOBJ GetCurrentObject(HDC hdc, UINT type)
+{
+	if (!IsDC(hdc))
+		return nullptr;
+	switch (type)
+	{
+	case OBJ_PEN: return hdc->state.pPen;
+	case OBJ_BRUSH: return hdc->state.pBrush;
+	case OBJ_FONT: return hdc->state.pFont;
+	case OBJ_BITMAP: return hdc->state.pBitmap;
+	default: return nullptr;
+	}
+}
+
+int SaveDC(HDC hdc)
+{
+	if (!IsDC(hdc))
+		return 0;
+	hdc->saved.push_back(hdc->state);
+	return static_cast<int>(hdc->saved.size());
+}
+
+BOOL RestoreDC(HDC hdc, int nSavedDC)
+{
+	if (!IsDC(hdc))
+		return FALSE;
+	int nCount = static_cast<int>(hdc->saved.size());
+	int nIndex = nSavedDC < 0 ? nCount + nSavedDC + 1 : nSavedDC;
+	if (nIndex <= 0 || nIndex > nCount)
+		return FALSE;
+	hdc->state = hdc->saved[nIndex - 1];
+	hdc->saved.resize(nIndex - 1);
+	return TRUE;
+}
+
+BOOL GdiFlush()
+{
+	return TRUE;
+}
+
+int GetDeviceCaps(HDC hdc, int index)
+{
+	switch (index)
+	{
+	case LOGPIXELSX: case LOGPIXELSY: return 96;
+	case HORZRES: return IsDC(hdc) ? hdc->state.pBitmap->nWidth : 0;
+	case VERTRES: return IsDC(hdc) ? hdc->state.pBitmap->nHeight : 0;
+	case BITSPIXEL: return 32;
+	default: return 0;
+	}
+}
+
+DWORD GetSysColor(int nIndex)
+{
+	return nIndex == COLOR_WINDOWTEXT ? RGB(0, 0, 0) : RGB(255, 255, 255);
+}
+
+// 属性
+#define DEFINE_DC_ATTRIBUTE(Type, Set, Get, member) \
+	Type Set(HDC hdc, Type value) { if (!IsDC(hdc)) return 0; Type old = hdc->state.member; hdc->state.member = value; return old; } \
+	Type Get(HDC hdc) { return IsDC(hdc) ? hdc->state.member : 0; }
+
+DEFINE_DC_ATTRIBUTE(COLORREF, SetTextColor, GetTextColor, textColor)
+DEFINE_DC_ATTRIBUTE(COLORREF, SetBkColor, GetBkColor, bkColor)
+DEFINE_DC_ATTRIBUTE(int, SetBkMode, GetBkMode, nBkMode)
+DEFINE_DC_ATTRIBUTE(int, SetROP2, GetROP2, nRop2)
+DEFINE_DC_ATTRIBUTE(UINT, SetTextAlign, GetTextAlign, nTextAlign)
+DEFINE_DC_ATTRIBUTE(int, SetGraphicsMode, GetGraphicsMode, nGraphicsMode)
+
+#undef DEFINE_DC_ATTRIBUTE
+
+int SetStretchBltMode(HDC hdc, int mode)
+{
+	if (!IsDC(hdc))
+		return 0;
+	int nOld = hdc->state.nStretchMode;
+	hdc->state.nStretchMode = mode;
+	return nOld;
+}
+
+// 映射模式：只支持 MM_TEXT 和 MM_ANISOTROPIC（MM_ISOTROPIC 按 MM_ANISOTROPIC 处理）
+int SetMapMode(HDC hdc, int iMode)
+{
+	if (!IsDC(hdc))
+		return 0;
+	int nOld = hdc->state.nMapMode;
+	hdc->state.nMapMode = iMode;
+	if (iMode == MM_TEXT)
+	{
+		hdc->state.sizeWindowExt = { 1, 1 };
+		hdc->state.sizeViewportExt = { 1, 1 };
+	}
+	return nOld;
+}
+
+int GetMapMode(HDC hdc)
+{
+	return IsDC(hdc) ? hdc->state.nMapMode : 0;
+}
+
+BOOL SetWindowOrgEx(HDC hdc, int x, int y, LPPOINT lppt)
+{
+	if (!IsDC(hdc))
+		return FALSE;
+	if (lppt != nullptr)
+		*lppt = hdc->state.ptWindowOrg;
+	hdc->state.ptWindowOrg = { x, y };
+	return TRUE;
+}
+
+BOOL SetViewportOrgEx(HDC hdc, int x, int y, LPPOINT lppt)
+{
+	if (!IsDC(hdc))
+		return FALSE;
+	if (lppt != nullptr)
+		*lppt = hdc->state.ptViewportOrg;
+	hdc->state.ptViewportOrg = { x, y };
+	return TRUE;
+}
+
+BOOL SetWindowExtEx(HDC hdc, int x, int y, LPSIZE lpsz)
+{
+	if (!IsDC(hdc))
+		return FALSE;
+	if (lpsz != nullptr)
+		*lpsz = hdc->state.sizeWindowExt;
+	if (hdc->state.nMapMode == MM_TEXT || x == 0 || y == 0)
+		return hdc->state.nMapMode == MM_TEXT;
+	hdc->state.sizeWindowExt = { x, y };
+	return TRUE;
+}
+
+BOOL SetViewportExtEx(HDC hdc, int x, int y, LPSIZE lpsz)
+{
+	if (!IsDC(hdc))
+		return FALSE;
+	if (lpsz != nullptr)
+		*lpsz = hdc->state.sizeViewportExt;
+	if (hdc->state.nMapMode == MM_TEXT || x == 0 || y == 0)
+		return hdc->state.nMapMode == MM_TEXT;
+	hdc->state.sizeViewportExt = { x, y };
+	return TRUE;
+}
+
+BOOL GetWindowOrgEx(HDC hdc, LPPOINT lppoint)
+{
+	if (!IsDC(hdc))
+		return FALSE;
+	*lppoint = hdc->state.ptWindowOrg;
+	return TRUE;
+}
+
+BOOL GetViewportOrgEx(HDC hdc, LPPOINT lppoint)
+{
+	if (!IsDC(hdc))
+		return FALSE;
+	*lppoint = hdc->state.ptViewportOrg;
+	return TRUE;
+}
+
+BOOL LPtoDP(HDC hdc, LPPOINT lppt, int c)
+{
+	if (!IsDC(hdc))
+		return FALSE;
+	for (int i = 0; i < c; i++)
+		lppt[i] = { hdc->ToDeviceX(lppt[i].x), hdc->ToDeviceY(lppt[i].y) };
+	return TRUE;
+}
+
+BOOL DPtoLP(HDC hdc, LPPOINT lppt, int c)
+{
+	if (!IsDC(hdc))
+		return FALSE;
+	for (int i = 0; i < c; i++)
+		lppt[i] = { hdc->ToLogicalX(lppt[i].x), hdc->ToLogicalY(lppt[i].y) };
+	return TRUE;
+}
+
+// 裁剪
+int IntersectClipRect(HDC hdc, int left, int top, int right, int bottom)
+{
+	if (!IsDC(hdc))
+		return ERROR;
+	RECT rect = { hdc->ToDeviceX(left), hdc->ToDeviceY(top), hdc->ToDeviceX(right), hdc->ToDeviceY(bottom) };
+	if (rect.left > rect.right) std::swap(rect.left, rect.right);
+	if (rect.top > rect.bottom) std::swap(rect.top, rect.bottom);
+	CRasterDCState& state = hdc->state;
+	if (state.bClip)
+	{
+		rect.left = std::max(rect.left, state.rectClip.left);
+		rect.top = std::max(rect.top, state.rectClip.top);
+		rect.right = std::min(rect.right, state.rectClip.right);
+		rect.bottom = std::min(rect.bottom, state.rectClip.bottom);
+	}
+	state.bClip = true;
+	state.rectClip = rect;
+	return rect.left < rect.right && rect.top < rect.bottom ? SIMPLEREGION : NULLREGION;
+}
+
+int SelectClipRgn(HDC hdc, HRGN hrgn)
+{
+	if (!IsDC(hdc) || hrgn != nullptr)
+		return ERROR;
+	hdc->state.bClip = false;
+	return SIMPLEREGION;
+}
+
+int GetClipBox(HDC hdc, LPRECT lprect)
+{
+	if (!IsDC(hdc))
+		return ERROR;
+	RECT clip = hdc->Clip();
+	POINT pts[2] = { { clip.left, clip.top }, { clip.right, clip.bottom } };
+	DPtoLP(hdc, pts, 2);
+	*lprect = { std::min(pts[0].x, pts[1].x), std::min(pts[0].y, pts[1].y), std::max(pts[0].x, pts[1].x), std::max(pts[0].y, pts[1].y) };
+	return clip.left < clip.right && clip.top < clip.bottom ? SIMPLEREGION : NULLREGION;
+}
+
+// 绘图
+BOOL MoveToEx(HDC hdc, int x, int y, LPPOINT lppt)
+{
+	if (!IsDC(hdc))
+		return FALSE;
+	if (lppt != nullptr)
+		*lppt = hdc->state.ptCurrent;
+	hdc->state.ptCurrent = { x, y };
+	return TRUE;
+}
+
+BOOL LineTo(HDC hdc, int x, int y)
+{
+	if (!IsDC(hdc))
+		return FALSE;
+	POINT& pt = hdc->state.ptCurrent;
+	hdc->DeviceLine(hdc->ToDeviceX(pt.x), hdc->ToDeviceY(pt.y), hdc->ToDeviceX(x), hdc->ToDeviceY(y), false);
+	pt = { x, y };
+	return TRUE;
+}
+
+BOOL Polyline(HDC hdc, const POINT* apt, int cpt)
+{
+	if (!IsDC(hdc) || apt == nullptr || cpt < 2)
+		return FALSE;
+	int x0 = hdc->ToDeviceX(apt[0].x), y0 = hdc->ToDeviceY(apt[0].y);
+	for (int i = 1; i < cpt; i++)
+	{
+		int x1 = hdc->ToDeviceX(apt[i].x), y1 = hdc->ToDeviceY(apt[i].y);
+		hdc->DeviceLine(x0, y0, x1, y1, false);
+		x0 = x1;
+		y0 = y1;
+	}
+	return TRUE;
+}
+
+BOOL Rectangle(HDC hdc, int left, int top, int right, int bottom)
+{
+	if (!IsDC(hdc))
+		return FALSE;
+	int l = hdc->ToDeviceX(left), t = hdc->ToDeviceY(top), r = hdc->ToDeviceX(right), b = hdc->ToDeviceY(bottom);
+	if (l > r) std::swap(l, r);
+	if (t > b) std::swap(t, b);
+	if (r - l < 1 || b - t < 1)
+		return TRUE;
+
+	// GDI 的矩形不含右边和下边
+	const CRasterDCState& state = hdc->state;
+	if (state.pBrush->nStyle != BS_NULL)
+		hdc->FillDeviceRect(l, t, r, b, state.pBrush->color, state.nRop2);
+	if (state.pPen->nStyle != PS_NULL)
+	{
+		hdc->DeviceLine(l, t, r - 1, t, false);
+		hdc->DeviceLine(r - 1, t, r - 1, b - 1, false);
+		hdc->DeviceLine(r - 1, b - 1, l, b - 1, false);
+		hdc->DeviceLine(l, b - 1, l, t, false);
+	}
+	return TRUE;
+}
+
+BOOL Ellipse(HDC hdc, int left, int top, int right, int bottom)
+{
+	if (!IsDC(hdc))
+		return FALSE;
+	int l = hdc->ToDeviceX(left), t = hdc->ToDeviceY(top), r = hdc->ToDeviceX(right), b = hdc->ToDeviceY(bottom);
+	if (l > r) std::swap(l, r);
+	if (t > b) std::swap(t, b);
+	if (r - l < 1 || b - t < 1)
+		return TRUE;
+
+	const CRasterDCState& state = hdc->state;
+	const bool bFill = state.pBrush->nStyle != BS_NULL;
+	const bool bOutline = state.pPen->nStyle != PS_NULL;
+	const double w = bOutline ? std::max(1.0, std::round(state.pPen->nWidth * hdc->ScaleX())) : 0.0;
+
+	// 外椭圆的半轴（中心线上的椭圆向外扩半个画笔宽度），内椭圆向内缩半个画笔宽度
+	const double cx = (l + r) / 2.0, cy = (t + b) / 2.0;
+	const double ax = (r - l - 1) / 2.0, ay = (b - t - 1) / 2.0;
+	const double axOut = ax + w / 2, ayOut = ay + w / 2;
+	const double axIn = ax - w / 2, ayIn = ay - w / 2;
+
+	int y0 = static_cast<int>(std::floor(cy - ayOut)), y1 = static_cast<int>(std::ceil(cy + ayOut));
+	for (int y = y0; y < y1; y++)
+	{
+		double dy = y + 0.5 - cy;
+		if (std::fabs(dy) > ayOut)
+			continue;
+		double dxOut = axOut * std::sqrt(std::max(0.0, 1.0 - (dy * dy) / (ayOut * ayOut)));
+		int xo0 = RoundPixel(cx - dxOut), xo1 = RoundPixel(cx + dxOut);
+		if (axIn > 0 && ayIn > 0 && std::fabs(dy) < ayIn)
+		{
+			double dxIn = axIn * std::sqrt(std::max(0.0, 1.0 - (dy * dy) / (ayIn * ayIn)));
+			int xi0 = RoundPixel(cx - dxIn), xi1 = RoundPixel(cx + dxIn);
+			if (bFill)
+				hdc->Span(y, xi0, xi1, state.pBrush->color, state.nRop2);
+			if (bOutline)
+			{
+				hdc->Span(y, xo0, xi0, state.pPen->color, state.nRop2);
+				hdc->Span(y, xi1, xo1, state.pPen->color, state.nRop2);
+			}
+		}
+		else if (bOutline)
+		{
+			hdc->Span(y, xo0, xo1, state.pPen->color, state.nRop2);
+		}
+		else if (bFill)
+		{
+			hdc->Span(y, xo0, xo1, state.pBrush->color, state.nRop2);
+		}
+	}
+	return TRUE;
+}
+
+int FillRect(HDC hdc, const RECT* lprc, HBRUSH hbr)
+{
+	CRasterBrush* pBrush = CastObject<CRasterBrush>(hbr, OBJ_BRUSH);
+	if (!IsDC(hdc) || lprc == nullptr || pBrush == nullptr)
+		return FALSE;
+	if (pBrush->nStyle != BS_NULL)
+	{
+		hdc->FillDeviceRect(hdc->ToDeviceX(lprc->left), hdc->ToDeviceY(lprc->top),
+			hdc->ToDeviceX(lprc->right), hdc->ToDeviceY(lprc->bottom), pBrush->color, R2_COPYPEN);
+	}
+	return TRUE;
+}
+
+COLORREF SetPixel(HDC hdc, int x, int y, COLORREF color)
+{
+	if (!IsDC(hdc))
+		return static_cast<COLORREF>(-1);
+	int dx = hdc->ToDeviceX(x);
+	hdc->Span(hdc->ToDeviceY(y), dx, dx + 1, color, R2_COPYPEN);
+	return color;
+}
+
+COLORREF GetPixel(HDC hdc, int x, int y)
+{
+	if (!IsDC(hdc))
+		return static_cast<COLORREF>(-1);
+	int dx = hdc->ToDeviceX(x), dy = hdc->ToDeviceY(y);
+	RECT clip = hdc->Clip();
+	if (dx < clip.left || dx >= clip.right || dy < clip.top || dy >= clip.bottom)
+		return static_cast<COLORREF>(-1);
+	return FromPixel(hdc->state.pBitmap->Row(dy)[dx]);
+}
+
+BOOL GetTextExtentPoint32W(HDC hdc, LPCWSTR lpString, int c, LPSIZE psizl)
+{
+	if (!IsDC(hdc) || psizl == nullptr)
+		return FALSE;
+	int cx = 0;
+	for (int i = 0; i < c; i++)
+		cx += hdc->CharWidth(lpString[i]);
+	*psizl = { cx, hdc->FontHeight() };
+	return TRUE;
+}
+
+BOOL ExtTextOutW(HDC hdc, int x, int y, UINT options, const RECT* lprect, LPCWSTR lpString, UINT c, const INT* lpDx)
+{
+	(void)lpDx;
+	if (!IsDC(hdc))
+		return FALSE;
+	const CRasterDCState& state = hdc->state;
+
+	if ((options & ETO_OPAQUE) && lprect != nullptr)
+	{
+		hdc->FillDeviceRect(hdc->ToDeviceX(lprect->left), hdc->ToDeviceY(lprect->top),
+			hdc->ToDeviceX(lprect->right), hdc->ToDeviceY(lprect->bottom), state.bkColor, R2_COPYPEN);
+	}
+	if (lpString == nullptr || c == 0)
+		return TRUE;
+
+	// 按对齐方式求文本左上角（逻辑坐标）
+	SIZE size;
+	GetTextExtentPoint32W(hdc, lpString, static_cast<int>(c), &size);
+	UINT nAlign = state.nTextAlign;
+	if ((nAlign & TA_CENTER) == TA_CENTER)
+		x -= size.cx / 2;
+	else if (nAlign & TA_RIGHT)
+		x -= size.cx;
+	if ((nAlign & TA_BASELINE) == TA_BASELINE)
+		y -= size.cy * 4 / 5;
+	else if (nAlign & TA_BOTTOM)
+		y -= size.cy;
+
+	const int nTop = hdc->ToDeviceY(y), nBottom = hdc->ToDeviceY(y + size.cy);
+	for (UINT i = 0; i < c; i++)
+	{
+		wchar_t ch = lpString[i];
+		int nWidth = hdc->CharWidth(ch);
+		int nLeft = hdc->ToDeviceX(x), nRight = hdc->ToDeviceX(x + nWidth);
+		if (state.nBkMode == OPAQUE)
+			hdc->FillDeviceRect(nLeft, nTop, nRight, nBottom, state.bkColor, R2_COPYPEN);
+
+		// 字形：字符单元内 4x4 的块图案，由字符编码决定
+		if (ch != L' ' && ch != L'\t')
+		{
+			uint32_t nPattern = (static_cast<uint32_t>(ch) * 2654435761u) >> 16 | 0x0660;
+			int cellW = nRight - nLeft, cellH = nBottom - nTop;
+			for (int row = 0; row < 4; row++)
+			{
+				for (int col = 0; col < 4; col++)
+				{
+					if (nPattern & (1u << (row * 4 + col)))
+					{
+						hdc->FillDeviceRect(nLeft + cellW * col / 4, nTop + cellH * row / 4,
+							nLeft + cellW * (col + 1) / 4, nTop + cellH * (row + 1) / 4, state.textColor, R2_COPYPEN);
+					}
+				}
+			}
+		}
+		x += nWidth;
+	}
+	return TRUE;
+}
+
+BOOL TextOutW(HDC hdc, int x, int y, LPCWSTR lpString, int c)
+{
+	return ExtTextOutW(hdc, x, y, 0, nullptr, lpString, static_cast<UINT>(std::max(c, 0)), nullptr);
+}
+
+BOOL StretchBlt(HDC hdcDest, int xDest, int yDest, int wDest, int hDest, HDC hdcSrc, int xSrc, int ySrc, int wSrc, int hSrc, DWORD rop)
+{
+	if (!IsDC(hdcDest))
+		return FALSE;
+
+	int dl = hdcDest->ToDeviceX(xDest), dt = hdcDest->ToDeviceY(yDest);
+	int dr = hdcDest->ToDeviceX(xDest + wDest), db = hdcDest->ToDeviceY(yDest + hDest);
+	if (dl > dr) std::swap(dl, dr);
+	if (dt > db) std::swap(dt, db);
+
+	switch (rop)
+	{
+	case BLACKNESS:
+		hdcDest->FillDeviceRect(dl, dt, dr, db, RGB(0, 0, 0), R2_COPYPEN);
+		return TRUE;
+	case WHITENESS:
+		hdcDest->FillDeviceRect(dl, dt, dr, db, RGB(255, 255, 255), R2_COPYPEN);
+		return TRUE;
+	case PATCOPY:
+		if (hdcDest->state.pBrush->nStyle != BS_NULL)
+			hdcDest->FillDeviceRect(dl, dt, dr, db, hdcDest->state.pBrush->color, R2_COPYPEN);
+		return TRUE;
+	default:
+		break;
+	}
+	if (!IsDC(hdcSrc) || dr <= dl || db <= dt)
+		return IsDC(hdcSrc);
+
+	int sl = hdcSrc->ToDeviceX(xSrc), st = hdcSrc->ToDeviceY(ySrc);
+	int sw = hdcSrc->ToDeviceX(xSrc + wSrc) - sl, sh = hdcSrc->ToDeviceY(ySrc + hSrc) - st;
+	CRasterBitmap* pSrc = hdcSrc->state.pBitmap;
+	CRasterBitmap* pDest = hdcDest->state.pBitmap;
+	const RECT clip = hdcDest->Clip();
+	const int nWidth = dr - dl, nHeight = db - dt;
+	const bool bScaled = sw != nWidth || sh != nHeight;
+
+	for (int y = std::max(dt, static_cast<int>(clip.top)); y < std::min(db, static_cast<int>(clip.bottom)); y++)
+	{
+		int sy = st + (bScaled ? static_cast<int>(static_cast<long long>(y - dt) * sh / nHeight) : y - dt);
+		if (sy < 0 || sy >= pSrc->nHeight)
+			continue;
+		const uint32_t* pSrcRow = pSrc->Row(sy);
+		uint32_t* pDestRow = pDest->Row(y);
+		int x0 = std::max(dl, static_cast<int>(clip.left)), x1 = std::min(dr, static_cast<int>(clip.right));
+		if (!bScaled)
+		{
+			// 未缩放时按行整段处理
+			x0 = std::max(x0, dl - sl);
+			x1 = std::min(x1, dl - sl + pSrc->nWidth);
+			if (x0 >= x1)
+				continue;
+			const uint32_t* s = pSrcRow + (x0 - dl + sl);
+			uint32_t* d = pDestRow + x0;
+			switch (rop)
+			{
+			case SRCCOPY: memcpy(d, s, (x1 - x0) * sizeof(uint32_t)); break;
+			case SRCAND: for (int i = 0; i < x1 - x0; i++) d[i] &= s[i]; break;
+			case SRCPAINT: for (int i = 0; i < x1 - x0; i++) d[i] |= s[i]; break;
+			case SRCINVERT: for (int i = 0; i < x1 - x0; i++) d[i] ^= s[i]; break;
+			default: memcpy(d, s, (x1 - x0) * sizeof(uint32_t)); break;
+			}
+			continue;
+		}
+		for (int x = x0; x < x1; x++)
+		{
+			int sx = sl + static_cast<int>(static_cast<long long>(x - dl) * sw / nWidth);
+			if (sx < 0 || sx >= pSrc->nWidth)
+				continue;
+			uint32_t s = pSrcRow[sx];
+			switch (rop)
+			{
+			case SRCAND: pDestRow[x] &= s; break;
+			case SRCPAINT: pDestRow[x] |= s; break;
+			case SRCINVERT: pDestRow[x] ^= s; break;
+			default: pDestRow[x] = s; break;
+			}
+		}
+	}
+	return TRUE;
+}
+
+BOOL TransparentBlt(HDC hdcDest, int xDest, int yDest, int wDest, int hDest, HDC hdcSrc, int xSrc, int ySrc, int wSrc, int hSrc, UINT crTransparent)
+{
+	// 与 StretchBlt 的 SRCCOPY 相同，但跳过颜色为 crTransparent 的源像素
+	if (!IsDC(hdcDest) || !IsDC(hdcSrc) || wDest <= 0 || hDest <= 0 || wSrc <= 0 || hSrc <= 0)
+		return FALSE;
+
+	int dl = hdcDest->ToDeviceX(xDest), dt = hdcDest->ToDeviceY(yDest);
+	int dr = hdcDest->ToDeviceX(xDest + wDest), db = hdcDest->ToDeviceY(yDest + hDest);
+	int sl = hdcSrc->ToDeviceX(xSrc), st = hdcSrc->ToDeviceY(ySrc);
+	int sw = hdcSrc->ToDeviceX(xSrc + wSrc) - sl, sh = hdcSrc->ToDeviceY(ySrc + hSrc) - st;
+	CRasterBitmap* pSrc = hdcSrc->state.pBitmap;
+	CRasterBitmap* pDest = hdcDest->state.pBitmap;
+	const RECT clip = hdcDest->Clip();
+	const int nWidth = dr - dl, nHeight = db - dt;
+	if (nWidth <= 0 || nHeight <= 0)
+		return TRUE;
+	const uint32_t key = ToPixel(crTransparent);
+
+	for (int y = std::max(dt, static_cast<int>(clip.top)); y < std::min(db, static_cast<int>(clip.bottom)); y++)
+	{
+		int sy = st + static_cast<int>(static_cast<long long>(y - dt) * sh / nHeight);
+		if (sy < 0 || sy >= pSrc->nHeight)
+			continue;
+		const uint32_t* pSrcRow = pSrc->Row(sy);
+		uint32_t* pDestRow = pDest->Row(y);
+		for (int x = std::max(dl, static_cast<int>(clip.left)); x < std::min(dr, static_cast<int>(clip.right)); x++)
+		{
+			int sx = sl + static_cast<int>(static_cast<long long>(x - dl) * sw / nWidth);
+			if (sx >= 0 && sx < pSrc->nWidth && pSrcRow[sx] != key)
+				pDestRow[x] = pSrcRow[sx];
+		}
+	}
+	return TRUE;
+}
+
+BOOL BitBlt(HDC hdc, int x, int y, int cx, int cy, HDC hdcSrc, int x1, int y1, DWORD rop)
+{
+	return StretchBlt(hdc, x, y, cx, cy, hdcSrc, x1, y1, cx, cy, rop);
+}
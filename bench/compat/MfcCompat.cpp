@@ -0,0 +1,780 @@
+// MfcCompat.cpp: 无界面构建中 CString、CFile、CArchive 等 MFC 类的实现
+// CArchive 的二进制格式（小端、CString 的长度前缀与 Unicode 标记）与 MFC 相同，
+// 在这里保存的文档可以直接由 Windows 版程序打开。
+//
+
+#include <afxwin.h>
+
+#include <chrono>
+#include <cwctype>
+#include <thread>
+#include <unordered_map>
+
+// 计时
+BOOL QueryPerformanceCounter(LARGE_INTEGER* pCounter)
+{
+	pCounter->QuadPart = std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+	return TRUE;
+}
+
+BOOL QueryPerformanceFrequency(LARGE_INTEGER* pFrequency)
+{
+	pFrequency->QuadPart = 1000000000LL;
+	return TRUE;
+}
+
+ULONGLONG GetTickCount64()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+DWORD GetTickCount()
+{
+	return static_cast<DWORD>(GetTickCount64());
+}
+
+void Sleep(DWORD dwMilliseconds)
+{
+	std::this_thread::sleep_for(std::chrono::milliseconds(dwMilliseconds));
+}
+
+DWORD GetCurrentThreadId()
+{
+	return static_cast<DWORD>(std::hash<std::thread::id>()(std::this_thread::get_id()));
+}
+
+DWORD GetCurrentProcessId()
+{
+	return 1;
+}
+
+// CString
+std::wstring& CString::Mutable()
+{
+	if (!m_pData)
+		m_pData = std::make_shared<const std::wstring>();
+	else if (m_pData.use_count() > 1)
+		m_pData = std::make_shared<const std::wstring>(*m_pData);
+	return const_cast<std::wstring&>(*m_pData);
+}
+
+CString::CString(const char* psz)
+{
+	if (psz != nullptr && *psz != 0)
+		m_pData = std::make_shared<const std::wstring>(static_cast<const wchar_t*>(CA2W(psz)));
+}
+
+void CString::Truncate(int nNewLength)
+{
+	if (nNewLength < GetLength())
+		Mutable().resize(nNewLength);
+}
+
+wchar_t* CString::GetBuffer(int nMinBufLength)
+{
+	std::wstring& str = Mutable();
+	if (static_cast<int>(str.size()) < nMinBufLength)
+		str.resize(nMinBufLength);
+	return &str[0];
+}
+
+wchar_t* CString::GetBufferSetLength(int nNewLength)
+{
+	std::wstring& str = Mutable();
+	str.resize(nNewLength);
+	return &str[0];
+}
+
+void CString::ReleaseBuffer(int nNewLength)
+{
+	if (!m_pData)
+		return;
+	std::wstring& str = Mutable();
+	if (nNewLength < 0)
+		nNewLength = static_cast<int>(wcslen(str.c_str()));
+	str.resize(nNewLength);
+}
+
+CString& CString::operator+=(const CString& str)
+{
+	if (!str.IsEmpty())
+	{
+		if (IsEmpty())
+			*this = str;
+		else
+			Mutable().append(*str.m_pData);
+	}
+	return *this;
+}
+
+CString& CString::operator+=(const wchar_t* psz)
+{
+	if (psz != nullptr && *psz != 0)
+		Mutable().append(psz);
+	return *this;
+}
+
+CString& CString::operator+=(wchar_t ch)
+{
+	Mutable().push_back(ch);
+	return *this;
+}
+
+void CString::Append(const wchar_t* pch, int nLength)
+{
+	if (pch != nullptr && nLength > 0)
+		Mutable().append(pch, nLength);
+}
+
+int CString::CompareNoCase(const wchar_t* psz) const
+{
+	const wchar_t* p = GetString();
+	for (;; p++, psz++)
+	{
+		wint_t a = towlower(*p), b = towlower(*psz);
+		if (a != b)
+			return a < b ? -1 : 1;
+		if (a == 0)
+			return 0;
+	}
+}
+
+CString CString::Left(int nCount) const
+{
+	nCount = std::max(0, std::min(nCount, GetLength()));
+	return CString(GetString(), nCount);
+}
+
+CString CString::Right(int nCount) const
+{
+	nCount = std::max(0, std::min(nCount, GetLength()));
+	return CString(GetString() + GetLength() - nCount, nCount);
+}
+
+CString CString::Mid(int iFirst) const
+{
+	return Mid(iFirst, GetLength() - iFirst);
+}
+
+CString CString::Mid(int iFirst, int nCount) const
+{
+	iFirst = std::max(0, std::min(iFirst, GetLength()));
+	nCount = std::max(0, std::min(nCount, GetLength() - iFirst));
+	return CString(GetString() + iFirst, nCount);
+}
+
+CString& CString::MakeLower()
+{
+	if (!IsEmpty())
+	{
+		for (wchar_t& ch : Mutable())
+			ch = static_cast<wchar_t>(towlower(ch));
+	}
+	return *this;
+}
+
+CString& CString::MakeUpper()
+{
+	if (!IsEmpty())
+	{
+		for (wchar_t& ch : Mutable())
+			ch = static_cast<wchar_t>(towupper(ch));
+	}
+	return *this;
+}
+
+CString& CString::Trim()
+{
+	const wchar_t* p = GetString();
+	int nBegin = 0, nEnd = GetLength();
+	while (nBegin < nEnd && iswspace(p[nBegin]))
+		nBegin++;
+	while (nEnd > nBegin && iswspace(p[nEnd - 1]))
+		nEnd--;
+	if (nBegin > 0 || nEnd < GetLength())
+		*this = CString(p + nBegin, nEnd - nBegin);
+	return *this;
+}
+
+int CString::Find(const wchar_t* pszSub, int iStart) const
+{
+	if (iStart < 0 || iStart > GetLength())
+		return -1;
+	const wchar_t* p = wcsstr(GetString() + iStart, pszSub);
+	return p == nullptr ? -1 : static_cast<int>(p - GetString());
+}
+
+int CString::Find(wchar_t ch, int iStart) const
+{
+	if (iStart < 0 || iStart >= GetLength())
+		return -1;
+	const wchar_t* p = wcschr(GetString() + iStart, ch);
+	return p == nullptr ? -1 : static_cast<int>(p - GetString());
+}
+
+int CString::ReverseFind(wchar_t ch) const
+{
+	const wchar_t* p = wcsrchr(GetString(), ch);
+	return p == nullptr ? -1 : static_cast<int>(p - GetString());
+}
+
+int CString::Replace(const wchar_t* pszOld, const wchar_t* pszNew)
+{
+	size_t nOldLength = wcslen(pszOld);
+	if (nOldLength == 0 || IsEmpty())
+		return 0;
+
+	std::wstring result;
+	const std::wstring& str = *m_pData;
+	int nCount = 0;
+	size_t nPos = 0, nFound;
+	while ((nFound = str.find(pszOld, nPos, nOldLength)) != std::wstring::npos)
+	{
+		result.append(str, nPos, nFound - nPos).append(pszNew);
+		nPos = nFound + nOldLength;
+		nCount++;
+	}
+	if (nCount > 0)
+	{
+		result.append(str, nPos, std::wstring::npos);
+		*this = CString(result.c_str(), static_cast<int>(result.size()));
+	}
+	return nCount;
+}
+
+// 把 MFC（Windows）格式字符串转换为 C 库的宽字符格式：%s、%c 为宽字符，%S、%hs 为窄字符，%I64 为 64 位整数
+static std::wstring TranslateFormat(const wchar_t* pszFormat)
+{
+	std::wstring result;
+	for (const wchar_t* p = pszFormat; *p != 0; p++)
+	{
+		result.push_back(*p);
+		if (*p != L'%')
+			continue;
+		if (p[1] == L'%')
+		{
+			result.push_back(*++p);
+			continue;
+		}
+		// 标志、宽度和精度原样保留
+		while (p[1] != 0 && wcschr(L"-+ #0123456789.*", p[1]) != nullptr)
+			result.push_back(*++p);
+		if (p[1] == L'I' && p[2] == L'6' && p[3] == L'4')
+		{
+			result.append(L"ll");
+			p += 3;
+		}
+		else if (p[1] == L'h' && (p[2] == L's' || p[2] == L'c'))
+		{
+			result.push_back(*(p += 2));
+			continue;
+		}
+		else if (p[1] == L'S' || p[1] == L'C')
+		{
+			result.push_back(static_cast<wchar_t>(towlower(*++p)));
+			continue;
+		}
+		else if (p[1] == L's' || p[1] == L'c')
+		{
+			result.push_back(L'l');
+		}
+	}
+	return result;
+}
+
+void CString::FormatV(const wchar_t* pszFormat, va_list args)
+{
+	std::wstring format = TranslateFormat(pszFormat);
+	std::vector<wchar_t> buffer(256);
+	for (;;)
+	{
+		va_list argsCopy;
+		va_copy(argsCopy, args);
+		int n = vswprintf(buffer.data(), buffer.size(), format.c_str(), argsCopy);
+		va_end(argsCopy);
+		if (n >= 0 && static_cast<size_t>(n) < buffer.size())
+		{
+			*this = CString(buffer.data(), n);
+			return;
+		}
+		if (buffer.size() >= (1u << 24))
+		{
+			Empty();
+			return;
+		}
+		buffer.resize(buffer.size() * 4);
+	}
+}
+
+void CString::Format(const wchar_t* pszFormat, ...)
+{
+	va_list args;
+	va_start(args, pszFormat);
+	FormatV(pszFormat, args);
+	va_end(args);
+}
+
+void CString::AppendFormat(const wchar_t* pszFormat, ...)
+{
+	CString str;
+	va_list args;
+	va_start(args, pszFormat);
+	str.FormatV(pszFormat, args);
+	va_end(args);
+	*this += str;
+}
+
+// 字符串转换（UTF-8）
+CW2A::CW2A(const wchar_t* psz)
+{
+	for (; psz != nullptr && *psz != 0; psz++)
+	{
+		uint32_t ch = static_cast<uint32_t>(*psz);
+		if (ch < 0x80)
+		{
+			m_str.push_back(static_cast<char>(ch));
+		}
+		else if (ch < 0x800)
+		{
+			m_str.push_back(static_cast<char>(0xC0 | (ch >> 6)));
+			m_str.push_back(static_cast<char>(0x80 | (ch & 0x3F)));
+		}
+		else if (ch < 0x10000)
+		{
+			m_str.push_back(static_cast<char>(0xE0 | (ch >> 12)));
+			m_str.push_back(static_cast<char>(0x80 | ((ch >> 6) & 0x3F)));
+			m_str.push_back(static_cast<char>(0x80 | (ch & 0x3F)));
+		}
+		else
+		{
+			m_str.push_back(static_cast<char>(0xF0 | (ch >> 18)));
+			m_str.push_back(static_cast<char>(0x80 | ((ch >> 12) & 0x3F)));
+			m_str.push_back(static_cast<char>(0x80 | ((ch >> 6) & 0x3F)));
+			m_str.push_back(static_cast<char>(0x80 | (ch & 0x3F)));
+		}
+	}
+}
+
+CA2W::CA2W(const char* psz)
+{
+	const unsigned char* p = reinterpret_cast<const unsigned char*>(psz);
+	while (p != nullptr && *p != 0)
+	{
+		uint32_t ch = *p++;
+		int nTrail = ch >= 0xF0 ? 3 : ch >= 0xE0 ? 2 : ch >= 0xC0 ? 1 : 0;
+		if (nTrail > 0)
+			ch &= 0x3F >> nTrail;
+		for (; nTrail > 0 && (*p & 0xC0) == 0x80; nTrail--)
+			ch = (ch << 6) | (*p++ & 0x3F);
+		m_str.push_back(static_cast<wchar_t>(ch));
+	}
+}
+
+// 异常
+BOOL CException::GetErrorMessage(LPTSTR lpszError, UINT nMaxError, UINT* pnHelpContext) const
+{
+	if (pnHelpContext != nullptr)
+		*pnHelpContext = 0;
+	if (lpszError == nullptr || nMaxError == 0)
+		return FALSE;
+	swprintf(lpszError, nMaxError, L"%ls", L"Unknown error");
+	return TRUE;
+}
+
+void AfxThrowArchiveException(int cause, LPCTSTR lpszArchiveName)
+{
+	throw new CArchiveException(cause, lpszArchiveName);
+}
+
+void AfxThrowFileException(int cause, LONG lOsError, LPCTSTR lpszFileName)
+{
+	(void)lOsError;
+	throw new CFileException(cause, lpszFileName);
+}
+
+void AfxThrowResourceException()
+{
+	throw new CResourceException();
+}
+
+void AfxThrowMemoryException()
+{
+	throw new CMemoryException();
+}
+
+// 临时对象映射：与 MFC 一样每个线程一份，临时对象不拥有句柄
+template<typename T>
+class CTempHandleMap
+{
+private:
+	struct CTempObjectDeleter
+	{
+		void operator()(T* pObject) const
+		{
+			pObject->Detach();
+			delete pObject;
+		}
+	};
+
+	std::unordered_map<const void*, std::unique_ptr<T, CTempObjectDeleter>> m_map;
+
+public:
+	template<typename THandle>
+	T* FromHandle(THandle h)
+	{
+		if (h == nullptr)
+			return nullptr;
+		auto& pObject = m_map[h];
+		if (!pObject)
+		{
+			pObject.reset(new T);
+			pObject->Attach(h);
+		}
+		return pObject.get();
+	}
+};
+
+static thread_local CTempHandleMap<CGdiObject> t_tempGdiObjects;
+static thread_local CTempHandleMap<CDC> t_tempDCs;
+
+// 与 MFC 相同：各类型的 FromHandle 共用同一个 CGdiObject 临时对象
+CGdiObject* CGdiObject::FromHandle(HGDIOBJ hObject) { return t_tempGdiObjects.FromHandle(hObject); }
+CPen* CPen::FromHandle(HPEN hPen) { return static_cast<CPen*>(CGdiObject::FromHandle(hPen)); }
+CBrush* CBrush::FromHandle(HBRUSH hBrush) { return static_cast<CBrush*>(CGdiObject::FromHandle(hBrush)); }
+CFont* CFont::FromHandle(HFONT hFont) { return static_cast<CFont*>(CGdiObject::FromHandle(hFont)); }
+CBitmap* CBitmap::FromHandle(HBITMAP hBitmap) { return static_cast<CBitmap*>(CGdiObject::FromHandle(hBitmap)); }
+CDC* CDC::FromHandle(HDC hDC) { return t_tempDCs.FromHandle(hDC); }
+
+BOOL CFont::CreatePointFont(int nPointSize, LPCTSTR lpszFaceName, CDC* pDC)
+{
+	(void)pDC;
+	LOGFONT lf;
+	memset(&lf, 0, sizeof(lf));
+	lf.lfHeight = -MulDiv(nPointSize, 96, 720);
+	lf.lfWeight = FW_NORMAL;
+	if (lpszFaceName != nullptr)
+		wcsncpy(lf.lfFaceName, lpszFaceName, LF_FACESIZE - 1);
+	return CreateFontIndirect(&lf);
+}
+
+// CFile
+CFile::CFile(LPCTSTR lpszFileName, UINT nOpenFlags) : m_pFile(nullptr)
+{
+	CFileException* pError = new CFileException;
+	if (!Open(lpszFileName, nOpenFlags, pError))
+		throw pError;
+	pError->Delete();
+}
+
+CFile::~CFile()
+{
+	if (m_pFile != nullptr)
+		fclose(m_pFile);
+}
+
+BOOL CFile::Open(LPCTSTR lpszFileName, UINT nOpenFlags, CFileException* pError)
+{
+	const char* pszMode;
+	if ((nOpenFlags & 0x3) == modeRead)
+		pszMode = "rb";
+	else if (nOpenFlags & modeCreate)
+		pszMode = (nOpenFlags & modeNoTruncate) ? "a+b" : ((nOpenFlags & modeReadWrite) ? "w+b" : "wb");
+	else
+		pszMode = "r+b";
+
+	m_strFileName = lpszFileName;
+	m_pFile = fopen(CW2A(lpszFileName), pszMode);
+	if (m_pFile == nullptr)
+	{
+		if (pError != nullptr)
+		{
+			pError->m_cause = CFileException::fileNotFound;
+			pError->m_strFileName = lpszFileName;
+		}
+		return FALSE;
+	}
+	return TRUE;
+}
+
+UINT CFile::Read(void* lpBuf, UINT nCount)
+{
+	return static_cast<UINT>(fread(lpBuf, 1, nCount, m_pFile));
+}
+
+void CFile::Write(const void* lpBuf, UINT nCount)
+{
+	if (fwrite(lpBuf, 1, nCount, m_pFile) != nCount)
+		AfxThrowFileException(CFileException::diskFull, -1, m_strFileName);
+}
+
+ULONGLONG CFile::Seek(LONGLONG lOff, UINT nFrom)
+{
+	static const int origins[] = { SEEK_SET, SEEK_CUR, SEEK_END };
+	if (fseek(m_pFile, static_cast<long>(lOff), origins[nFrom]) != 0)
+		AfxThrowFileException(CFileException::badSeek, -1, m_strFileName);
+	return GetPosition();
+}
+
+ULONGLONG CFile::GetPosition() const
+{
+	return static_cast<ULONGLONG>(ftell(m_pFile));
+}
+
+ULONGLONG CFile::GetLength() const
+{
+	long nPosition = ftell(m_pFile);
+	fseek(m_pFile, 0, SEEK_END);
+	long nLength = ftell(m_pFile);
+	fseek(m_pFile, nPosition, SEEK_SET);
+	return static_cast<ULONGLONG>(nLength);
+}
+
+void CFile::Flush()
+{
+	if (m_pFile != nullptr)
+		fflush(m_pFile);
+}
+
+void CFile::Close()
+{
+	if (m_pFile != nullptr)
+	{
+		fclose(m_pFile);
+		m_pFile = nullptr;
+	}
+}
+
+// CMemFile
+UINT CMemFile::Read(void* lpBuf, UINT nCount)
+{
+	size_t nRead = std::min(static_cast<size_t>(nCount), m_data.size() - m_nPosition);
+	memcpy(lpBuf, m_data.data() + m_nPosition, nRead);
+	m_nPosition += nRead;
+	return static_cast<UINT>(nRead);
+}
+
+void CMemFile::Write(const void* lpBuf, UINT nCount)
+{
+	if (m_nPosition + nCount > m_data.size())
+		m_data.resize(m_nPosition + nCount);
+	memcpy(m_data.data() + m_nPosition, lpBuf, nCount);
+	m_nPosition += nCount;
+}
+
+ULONGLONG CMemFile::Seek(LONGLONG lOff, UINT nFrom)
+{
+	LONGLONG nBase = nFrom == begin ? 0 : nFrom == current ? static_cast<LONGLONG>(m_nPosition) : static_cast<LONGLONG>(m_data.size());
+	if (nBase + lOff < 0)
+		AfxThrowFileException(CFileException::badSeek);
+	m_nPosition = static_cast<size_t>(nBase + lOff);
+	return m_nPosition;
+}
+
+// CArchive
+CArchive::CArchive(CFile* pFile, UINT nMode, int nBufSize, void* lpBuf)
+	: m_strFileName(pFile->GetFilePath()), m_pFile(pFile), m_bLoading((nMode & load) != 0),
+	m_buffer(std::max(nBufSize, 128)), m_nCur(0), m_nMax(0)
+{
+	(void)lpBuf;
+}
+
+CArchive::~CArchive()
+{
+	if (m_pFile != nullptr)
+		Close();
+}
+
+void CArchive::Flush()
+{
+	if (!m_bLoading && m_pFile != nullptr && m_nCur > 0)
+	{
+		m_pFile->Write(m_buffer.data(), static_cast<UINT>(m_nCur));
+		m_nCur = 0;
+	}
+}
+
+void CArchive::Close()
+{
+	Flush();
+	m_pFile = nullptr;
+}
+
+void CArchive::FillBuffer(size_t nBytesNeeded)
+{
+	if (!m_bLoading)
+		AfxThrowArchiveException(CArchiveException::writeOnly, m_strFileName);
+
+	// 把未读完的字节移到缓冲区开头，再从文件补满
+	size_t nLeft = m_nMax - m_nCur;
+	memmove(m_buffer.data(), m_buffer.data() + m_nCur, nLeft);
+	m_nCur = 0;
+	m_nMax = nLeft;
+	while (m_nMax < nBytesNeeded)
+	{
+		UINT nRead = m_pFile->Read(m_buffer.data() + m_nMax, static_cast<UINT>(m_buffer.size() - m_nMax));
+		if (nRead == 0)
+			AfxThrowArchiveException(CArchiveException::endOfFile, m_strFileName);
+		m_nMax += nRead;
+	}
+}
+
+UINT CArchive::Read(void* lpBuf, UINT nMax)
+{
+	BYTE* pDest = static_cast<BYTE*>(lpBuf);
+	UINT nRead = 0;
+	while (nRead < nMax)
+	{
+		if (m_nCur == m_nMax)
+		{
+			// 大块数据直接从文件读取，不经过缓冲区
+			if (nMax - nRead >= m_buffer.size())
+			{
+				UINT n = m_pFile->Read(pDest + nRead, nMax - nRead);
+				nRead += n;
+				break;
+			}
+			m_nCur = m_nMax = 0;
+			UINT n = m_pFile->Read(m_buffer.data(), static_cast<UINT>(m_buffer.size()));
+			if (n == 0)
+				break;
+			m_nMax = n;
+		}
+		size_t nCopy = std::min(static_cast<size_t>(nMax - nRead), m_nMax - m_nCur);
+		memcpy(pDest + nRead, m_buffer.data() + m_nCur, nCopy);
+		m_nCur += nCopy;
+		nRead += static_cast<UINT>(nCopy);
+	}
+	return nRead;
+}
+
+void CArchive::Write(const void* lpBuf, UINT nMax)
+{
+	if (m_bLoading)
+		AfxThrowArchiveException(CArchiveException::readOnly, m_strFileName);
+
+	if (m_nCur + nMax > m_buffer.size())
+	{
+		Flush();
+		if (nMax >= m_buffer.size())
+		{
+			m_pFile->Write(lpBuf, nMax);
+			return;
+		}
+	}
+	memcpy(m_buffer.data() + m_nCur, lpBuf, nMax);
+	m_nCur += nMax;
+}
+
+// CString 的格式与 MFC（Unicode 版本）相同：0xFF、0xFFFE 标记，随后是逐级扩展的长度和 UTF-16 字符
+CArchive& CArchive::operator<<(const CString& str)
+{
+	const wchar_t* p = str.GetString();
+	std::vector<uint16_t> utf16;
+	utf16.reserve(str.GetLength());
+	for (int i = 0; i < str.GetLength(); i++)
+	{
+		uint32_t ch = static_cast<uint32_t>(p[i]);
+		if (ch >= 0x10000)
+		{
+			ch -= 0x10000;
+			utf16.push_back(static_cast<uint16_t>(0xD800 | (ch >> 10)));
+			utf16.push_back(static_cast<uint16_t>(0xDC00 | (ch & 0x3FF)));
+		}
+		else
+		{
+			utf16.push_back(static_cast<uint16_t>(ch));
+		}
+	}
+
+	*this << static_cast<BYTE>(0xFF) << static_cast<WORD>(0xFFFE);
+	size_t nLength = utf16.size();
+	if (nLength < 0xFF)
+	{
+		*this << static_cast<BYTE>(nLength);
+	}
+	else
+	{
+		*this << static_cast<BYTE>(0xFF);
+		if (nLength < 0xFFFE)
+		{
+			*this << static_cast<WORD>(nLength);
+		}
+		else
+		{
+			*this << static_cast<WORD>(0xFFFF) << static_cast<DWORD>(nLength);
+		}
+	}
+	if (!utf16.empty())
+		Write(utf16.data(), static_cast<UINT>(utf16.size() * sizeof(uint16_t)));
+	return *this;
+}
+
+CArchive& CArchive::operator>>(CString& str)
+{
+	// 读取长度，并确定字符宽度（没有 Unicode 标记时为单字节字符）
+	size_t nCharSize = 1;
+	size_t nLength;
+	for (;;)
+	{
+		BYTE bLength;
+		*this >> bLength;
+		if (bLength < 0xFF)
+		{
+			nLength = bLength;
+			break;
+		}
+		WORD wLength;
+		*this >> wLength;
+		if (wLength == 0xFFFE)
+		{
+			nCharSize = 2;
+			continue;
+		}
+		if (wLength < 0xFFFF)
+		{
+			nLength = wLength;
+			break;
+		}
+		DWORD dwLength;
+		*this >> dwLength;
+		if (dwLength == 0xFFFFFFFF)
+		{
+			ULONGLONG qwLength;
+			*this >> qwLength;
+			nLength = static_cast<size_t>(qwLength);
+		}
+		else
+		{
+			nLength = dwLength;
+		}
+		break;
+	}
+
+	std::wstring text;
+	text.reserve(nLength);
+	if (nCharSize == 2)
+	{
+		std::vector<uint16_t> utf16(nLength);
+		if (nLength > 0 && Read(utf16.data(), static_cast<UINT>(nLength * 2)) != nLength * 2)
+			AfxThrowArchiveException(CArchiveException::endOfFile, m_strFileName);
+		for (size_t i = 0; i < nLength; i++)
+		{
+			uint32_t ch = utf16[i];
+			if (ch >= 0xD800 && ch < 0xDC00 && i + 1 < nLength && utf16[i + 1] >= 0xDC00 && utf16[i + 1] < 0xE000)
+				ch = 0x10000 + ((ch - 0xD800) << 10) + (utf16[++i] - 0xDC00);
+			text.push_back(static_cast<wchar_t>(ch));
+		}
+	}
+	else
+	{
+		std::vector<BYTE> bytes(nLength);
+		if (nLength > 0 && Read(bytes.data(), static_cast<UINT>(nLength)) != nLength)
+			AfxThrowArchiveException(CArchiveException::endOfFile, m_strFileName);
+		for (BYTE by : bytes)
+			text.push_back(static_cast<wchar_t>(by));
+	}
+	str = CString(text.c_str(), static_cast<int>(text.size()));
+	return *this;
+}
@@ -0,0 +1,974 @@
+// afxwin.h: 无界面构建使用的 MFC/GDI 最小替代
+// 只实现绘图核心（DrawCommand、CommandHistory、DocumentModel 及导出写入器等）用到的部分，
+// 接口与 MFC/Win32 保持一致，绘图核心的源文件不需要为无界面构建做任何修改。
+// GDI 绘图由 GdiRaster.cpp 在内存位图上用软件光栅化实现（只求结果合理、耗时稳定，不追求与 GDI 逐像素一致），
+// CString、CFile、CArchive 等由 MfcCompat.cpp 实现，CArchive 的文件格式与 MFC 相同。
+// 只在 DRAW_HEADLESS 构建中使用（见 MFC _draw/pch.h）。
+//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// 基本类型（与 Windows 的位宽一致）
+typedef int BOOL;
+typedef unsigned char BYTE;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+typedef unsigned int UINT;
+typedef int INT;
+typedef int32_t LONG;
+typedef uint32_t ULONG;
+typedef long long LONGLONG;
+typedef unsigned long long ULONGLONG;
+typedef uintptr_t UINT_PTR;
+typedef intptr_t INT_PTR;
+typedef uintptr_t WPARAM;
+typedef intptr_t LPARAM;
+typedef intptr_t LRESULT;
+typedef int32_t HRESULT;
+typedef DWORD COLORREF;
+typedef wchar_t WCHAR;
+typedef wchar_t TCHAR;
+typedef const wchar_t* LPCWSTR;
+typedef const wchar_t* LPCTSTR;
+typedef wchar_t* LPWSTR;
+typedef wchar_t* LPTSTR;
+typedef const char* LPCSTR;
+typedef void* LPVOID;
+typedef void* HANDLE;
+typedef void* HWND;
+
+// GDI 句柄
+typedef void* HGDIOBJ;
+typedef void* HPEN;
+typedef void* HBRUSH;
+typedef void* HFONT;
+typedef void* HBITMAP;
+typedef void* HRGN;
+typedef struct HDC__* HDC;
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+#define _T(x) L##x
+#define _TEXT(x) L##x
+
+#define RGB(r, g, b) ((COLORREF)(((BYTE)(r) | ((WORD)((BYTE)(g)) << 8)) | (((DWORD)(BYTE)(b)) << 16)))
+#define GetRValue(rgb) ((BYTE)(rgb))
+#define GetGValue(rgb) ((BYTE)(((WORD)(rgb)) >> 8))
+#define GetBValue(rgb) ((BYTE)((rgb) >> 16))
+
+#define TRACE(...) ((void)0)
+#define ASSERT(f) ((void)0)
+#define VERIFY(f) ((void)(f))
+#define ASSERT_VALID(p) ((void)0)
+#define UNREFERENCED_PARAMETER(p) ((void)(p))
+
+#define S_OK ((HRESULT)0)
+#define S_FALSE ((HRESULT)1)
+#define E_FAIL ((HRESULT)0x80004005L)
+#define E_OUTOFMEMORY ((HRESULT)0x8007000EL)
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+#define HRESULT_FROM_WIN32(x) ((HRESULT)(x) <= 0 ? ((HRESULT)(x)) : ((HRESULT)(((x) & 0x0000FFFF) | (7 << 16) | 0x80000000)))
+#define ERROR_OPEN_FAILED 110L
+
+#define _countof(a) (sizeof(a) / sizeof((a)[0]))
+
+#define ZeroMemory(p, n) memset((p), 0, (n))
+#define CopyMemory(d, s, n) memcpy((d), (s), (n))
+
+// Windows 头文件中的 min/max 宏；这里用函数模板代替，避免与标准库头文件冲突
+template<typename A, typename B>
+inline typename std::common_type<A, B>::type min(A a, B b)
+{
+	return a < b ? static_cast<typename std::common_type<A, B>::type>(a) : static_cast<typename std::common_type<A, B>::type>(b);
+}
+template<typename A, typename B>
+inline typename std::common_type<A, B>::type max(A a, B b)
+{
+	return a > b ? static_cast<typename std::common_type<A, B>::type>(a) : static_cast<typename std::common_type<A, B>::type>(b);
+}
+
+inline int MulDiv(int nNumber, int nNumerator, int nDenominator)
+{
+	if (nDenominator == 0)
+		return -1;
+	long long n = static_cast<long long>(nNumber) * nNumerator;
+	// 与 Windows 一样四舍五入
+	long long half = (nDenominator > 0 ? nDenominator : -nDenominator) / 2;
+	long long r = ((n < 0) != (nDenominator < 0)) ? (n - ((n < 0) ? half : -half)) / nDenominator : (n + ((n < 0) ? -half : half)) / nDenominator;
+	return static_cast<int>(r);
+}
+
+// 计时
+union LARGE_INTEGER
+{
+	struct { DWORD LowPart; LONG HighPart; };
+	LONGLONG QuadPart;
+};
+BOOL QueryPerformanceCounter(LARGE_INTEGER* pCounter);
+BOOL QueryPerformanceFrequency(LARGE_INTEGER* pFrequency);
+DWORD GetTickCount();
+ULONGLONG GetTickCount64();
+void Sleep(DWORD dwMilliseconds);
+DWORD GetCurrentThreadId();
+DWORD GetCurrentProcessId();
+
+// 几何类型
+struct POINT { LONG x; LONG y; };
+struct SIZE { LONG cx; LONG cy; };
+struct RECT { LONG left; LONG top; LONG right; LONG bottom; };
+typedef POINT* LPPOINT;
+typedef SIZE* LPSIZE;
+typedef RECT* LPRECT;
+typedef const RECT* LPCRECT;
+
+class CSize : public SIZE
+{
+public:
+	CSize() noexcept { cx = 0; cy = 0; }
+	CSize(int initCX, int initCY) noexcept { cx = initCX; cy = initCY; }
+	CSize(SIZE initSize) noexcept { cx = initSize.cx; cy = initSize.cy; }
+
+	bool operator==(SIZE size) const noexcept { return cx == size.cx && cy == size.cy; }
+	bool operator!=(SIZE size) const noexcept { return !(*this == size); }
+	void operator+=(SIZE size) noexcept { cx += size.cx; cy += size.cy; }
+	void operator-=(SIZE size) noexcept { cx -= size.cx; cy -= size.cy; }
+	CSize operator+(SIZE size) const noexcept { return CSize(cx + size.cx, cy + size.cy); }
+	CSize operator-(SIZE size) const noexcept { return CSize(cx - size.cx, cy - size.cy); }
+	CSize operator-() const noexcept { return CSize(-cx, -cy); }
+};
+
+class CPoint : public POINT
+{
+public:
+	CPoint() noexcept { x = 0; y = 0; }
+	CPoint(int initX, int initY) noexcept { x = initX; y = initY; }
+	CPoint(POINT initPt) noexcept { x = initPt.x; y = initPt.y; }
+	CPoint(SIZE initSize) noexcept { x = initSize.cx; y = initSize.cy; }
+
+	void Offset(int xOffset, int yOffset) noexcept { x += xOffset; y += yOffset; }
+	void Offset(POINT point) noexcept { x += point.x; y += point.y; }
+	void SetPoint(int X, int Y) noexcept { x = X; y = Y; }
+	bool operator==(POINT point) const noexcept { return x == point.x && y == point.y; }
+	bool operator!=(POINT point) const noexcept { return !(*this == point); }
+	void operator+=(SIZE size) noexcept { x += size.cx; y += size.cy; }
+	void operator-=(SIZE size) noexcept { x -= size.cx; y -= size.cy; }
+	void operator+=(POINT point) noexcept { x += point.x; y += point.y; }
+	void operator-=(POINT point) noexcept { x -= point.x; y -= point.y; }
+	CPoint operator+(SIZE size) const noexcept { return CPoint(x + size.cx, y + size.cy); }
+	CPoint operator-(SIZE size) const noexcept { return CPoint(x - size.cx, y - size.cy); }
+	CPoint operator+(POINT point) const noexcept { return CPoint(x + point.x, y + point.y); }
+	CSize operator-(POINT point) const noexcept { return CSize(x - point.x, y - point.y); }
+	CPoint operator-() const noexcept { return CPoint(-x, -y); }
+};
+
+class CRect : public RECT
+{
+public:
+	CRect() noexcept { left = 0; top = 0; right = 0; bottom = 0; }
+	CRect(int l, int t, int r, int b) noexcept { left = l; top = t; right = r; bottom = b; }
+	CRect(const RECT& srcRect) noexcept { left = srcRect.left; top = srcRect.top; right = srcRect.right; bottom = srcRect.bottom; }
+	CRect(LPCRECT lpSrcRect) noexcept { *this = *lpSrcRect; }
+	CRect(POINT point, SIZE size) noexcept { left = point.x; top = point.y; right = point.x + size.cx; bottom = point.y + size.cy; }
+	CRect(POINT topLeft, POINT bottomRight) noexcept { left = topLeft.x; top = topLeft.y; right = bottomRight.x; bottom = bottomRight.y; }
+
+	CRect& operator=(const RECT& srcRect) noexcept { left = srcRect.left; top = srcRect.top; right = srcRect.right; bottom = srcRect.bottom; return *this; }
+
+	int Width() const noexcept { return right - left; }
+	int Height() const noexcept { return bottom - top; }
+	CSize Size() const noexcept { return CSize(right - left, bottom - top); }
+	CPoint TopLeft() const noexcept { return CPoint(left, top); }
+	CPoint BottomRight() const noexcept { return CPoint(right, bottom); }
+	CPoint CenterPoint() const noexcept { return CPoint((left + right) / 2, (top + bottom) / 2); }
+	BOOL IsRectEmpty() const noexcept { return left >= right || top >= bottom; }
+	BOOL IsRectNull() const noexcept { return left == 0 && right == 0 && top == 0 && bottom == 0; }
+	BOOL PtInRect(POINT point) const noexcept { return point.x >= left && point.x < right && point.y >= top && point.y < bottom; }
+
+	void SetRect(int x1, int y1, int x2, int y2) noexcept { left = x1; top = y1; right = x2; bottom = y2; }
+	void SetRect(POINT topLeft, POINT bottomRight) noexcept { SetRect(topLeft.x, topLeft.y, bottomRight.x, bottomRight.y); }
+	void SetRectEmpty() noexcept { left = top = right = bottom = 0; }
+	void NormalizeRect() noexcept
+	{
+		if (left > right) std::swap(left, right);
+		if (top > bottom) std::swap(top, bottom);
+	}
+	void InflateRect(int x, int y) noexcept { left -= x; top -= y; right += x; bottom += y; }
+	void InflateRect(SIZE size) noexcept { InflateRect(size.cx, size.cy); }
+	void InflateRect(int l, int t, int r, int b) noexcept { left -= l; top -= t; right += r; bottom += b; }
+	void DeflateRect(int x, int y) noexcept { InflateRect(-x, -y); }
+	void DeflateRect(int l, int t, int r, int b) noexcept { InflateRect(-l, -t, -r, -b); }
+	void OffsetRect(int x, int y) noexcept { left += x; right += x; top += y; bottom += y; }
+	void OffsetRect(POINT point) noexcept { OffsetRect(point.x, point.y); }
+	void OffsetRect(SIZE size) noexcept { OffsetRect(size.cx, size.cy); }
+	void MoveToXY(int x, int y) noexcept { OffsetRect(x - left, y - top); }
+
+	BOOL IntersectRect(LPCRECT lpRect1, LPCRECT lpRect2) noexcept
+	{
+		CRect r(std::max(lpRect1->left, lpRect2->left), std::max(lpRect1->top, lpRect2->top),
+			std::min(lpRect1->right, lpRect2->right), std::min(lpRect1->bottom, lpRect2->bottom));
+		if (r.IsRectEmpty())
+		{
+			SetRectEmpty();
+			return FALSE;
+		}
+		*this = r;
+		return TRUE;
+	}
+	BOOL UnionRect(LPCRECT lpRect1, LPCRECT lpRect2) noexcept
+	{
+		CRect a(lpRect1), b(lpRect2);
+		if (a.IsRectEmpty()) { *this = b; return !b.IsRectEmpty(); }
+		if (b.IsRectEmpty()) { *this = a; return TRUE; }
+		SetRect(std::min(a.left, b.left), std::min(a.top, b.top), std::max(a.right, b.right), std::max(a.bottom, b.bottom));
+		return TRUE;
+	}
+
+	bool operator==(const RECT& rect) const noexcept { return left == rect.left && top == rect.top && right == rect.right && bottom == rect.bottom; }
+	bool operator!=(const RECT& rect) const noexcept { return !(*this == rect); }
+	void operator&=(const RECT& rect) noexcept { IntersectRect(this, &rect); }
+	void operator|=(const RECT& rect) noexcept { UnionRect(this, &rect); }
+	CRect operator&(const RECT& rect) const noexcept { CRect r; r.IntersectRect(this, &rect); return r; }
+	CRect operator|(const RECT& rect) const noexcept { CRect r; r.UnionRect(this, &rect); return r; }
+
+	operator LPRECT() noexcept { return this; }
+	operator LPCRECT() const noexcept { return this; }
+};
+
+// CString：与 MFC 一样采用写时复制，复制只增加引用计数
+class CString
+{
+private:
+	std::shared_ptr<const std::wstring> m_pData;  // 空字符串时为空指针（不分配内存）
+
+	std::wstring& Mutable();
+	static const wchar_t* EmptyString() { return L""; }
+
+public:
+	CString() noexcept {}
+	CString(const wchar_t* psz) { if (psz != nullptr && *psz != 0) m_pData = std::make_shared<const std::wstring>(psz); }
+	CString(const wchar_t* pch, int nLength) { if (pch != nullptr && nLength > 0) m_pData = std::make_shared<const std::wstring>(pch, nLength); }
+	CString(wchar_t ch, int nRepeat = 1) { if (nRepeat > 0) m_pData = std::make_shared<const std::wstring>(nRepeat, ch); }
+	explicit CString(const char* psz);
+	CString(const CString& other) noexcept = default;
+	CString(CString&& other) noexcept = default;
+	CString& operator=(const CString& other) noexcept = default;
+	CString& operator=(CString&& other) noexcept = default;
+	CString& operator=(const wchar_t* psz) { *this = CString(psz); return *this; }
+	CString& operator=(wchar_t ch) { *this = CString(ch); return *this; }
+
+	int GetLength() const noexcept { return m_pData ? static_cast<int>(m_pData->size()) : 0; }
+	BOOL IsEmpty() const noexcept { return !m_pData || m_pData->empty(); }
+	const wchar_t* GetString() const noexcept { return m_pData ? m_pData->c_str() : EmptyString(); }
+	operator const wchar_t*() const noexcept { return GetString(); }
+	wchar_t GetAt(int nIndex) const { return (*m_pData)[nIndex]; }
+	wchar_t operator[](int nIndex) const { return (*m_pData)[nIndex]; }
+	void SetAt(int nIndex, wchar_t ch) { Mutable()[nIndex] = ch; }
+
+	void Empty() noexcept { m_pData.reset(); }
+	void Truncate(int nNewLength);
+	wchar_t* GetBuffer(int nMinBufLength = 0);
+	wchar_t* GetBufferSetLength(int nNewLength);
+	void ReleaseBuffer(int nNewLength = -1);
+
+	CString& operator+=(const CString& str);
+	CString& operator+=(const wchar_t* psz);
+	CString& operator+=(wchar_t ch);
+	void Append(const wchar_t* pch, int nLength);
+	void AppendChar(wchar_t ch) { *this += ch; }
+
+	friend CString operator+(const CString& str1, const CString& str2) { CString r(str1); r += str2; return r; }
+	friend CString operator+(const CString& str1, const wchar_t* psz2) { CString r(str1); r += psz2; return r; }
+	friend CString operator+(const wchar_t* psz1, const CString& str2) { CString r(psz1); r += str2; return r; }
+	friend CString operator+(const CString& str1, wchar_t ch2) { CString r(str1); r += ch2; return r; }
+
+	int Compare(const wchar_t* psz) const { return wcscmp(GetString(), psz); }
+	int CompareNoCase(const wchar_t* psz) const;
+	friend bool operator==(const CString& str1, const CString& str2) noexcept
+	{
+		return str1.m_pData == str2.m_pData || (str1.GetLength() == str2.GetLength() && wmemcmp(str1.GetString(), str2.GetString(), str1.GetLength()) == 0);
+	}
+	friend bool operator==(const CString& str1, const wchar_t* psz2) { return wcscmp(str1.GetString(), psz2) == 0; }
+	friend bool operator==(const wchar_t* psz1, const CString& str2) { return wcscmp(psz1, str2.GetString()) == 0; }
+	friend bool operator!=(const CString& str1, const CString& str2) noexcept { return !(str1 == str2); }
+	friend bool operator!=(const CString& str1, const wchar_t* psz2) { return !(str1 == psz2); }
+	friend bool operator<(const CString& str1, const CString& str2) { return wcscmp(str1.GetString(), str2.GetString()) < 0; }
+
+	CString Left(int nCount) const;
+	CString Right(int nCount) const;
+	CString Mid(int iFirst) const;
+	CString Mid(int iFirst, int nCount) const;
+	CString& MakeLower();
+	CString& MakeUpper();
+	CString& Trim();
+	int Find(const wchar_t* pszSub, int iStart = 0) const;
+	int Find(wchar_t ch, int iStart = 0) const;
+	int ReverseFind(wchar_t ch) const;
+	int Replace(const wchar_t* pszOld, const wchar_t* pszNew);
+
+	// 格式字符串与 MFC 相同（%s、%c 为宽字符）
+	void Format(const wchar_t* pszFormat, ...);
+	void AppendFormat(const wchar_t* pszFormat, ...);
+	void FormatV(const wchar_t* pszFormat, va_list args);
+};
+
+// 字符串转换（只处理 ASCII/Latin-1 与 UTF-8）
+class CW2A
+{
+private:
+	std::string m_str;
+public:
+	explicit CW2A(const wchar_t* psz);
+	operator const char*() const { return m_str.c_str(); }
+};
+typedef CW2A CT2A;
+
+class CA2W
+{
+private:
+	std::wstring m_str;
+public:
+	explicit CA2W(const char* psz);
+	operator const wchar_t*() const { return m_str.c_str(); }
+};
+typedef CA2W CA2T;
+
+// 异常（与 MFC 一样以指针抛出，捕获后调用 Delete）
+class CException
+{
+public:
+	virtual ~CException() {}
+	void Delete() { delete this; }
+	virtual BOOL GetErrorMessage(LPTSTR lpszError, UINT nMaxError, UINT* pnHelpContext = nullptr) const;
+};
+
+class CArchiveException : public CException
+{
+public:
+	enum
+	{
+		none, genericException, readOnly, endOfFile, writeOnly, badIndex, badClass, badSchema, bufferFull
+	};
+	int m_cause;
+	CString m_strFileName;
+
+	explicit CArchiveException(int cause = none, LPCTSTR lpszArchiveName = nullptr) : m_cause(cause), m_strFileName(lpszArchiveName) {}
+};
+
+class CFileException : public CException
+{
+public:
+	enum
+	{
+		none, genericException, fileNotFound, badPath, tooManyOpenFiles, accessDenied, invalidFile, removeCurrentDir,
+		directoryFull, badSeek, hardIO, sharingViolation, lockViolation, diskFull, endOfFile
+	};
+	int m_cause;
+	CString m_strFileName;
+
+	explicit CFileException(int cause = none, LPCTSTR lpszFileName = nullptr) : m_cause(cause), m_strFileName(lpszFileName) {}
+};
+
+class CResourceException : public CException
+{
+};
+
+class CMemoryException : public CException
+{
+};
+
+[[noreturn]] void AfxThrowArchiveException(int cause, LPCTSTR lpszArchiveName = nullptr);
+[[noreturn]] void AfxThrowFileException(int cause, LONG lOsError = -1, LPCTSTR lpszFileName = nullptr);
+[[noreturn]] void AfxThrowResourceException();
+[[noreturn]] void AfxThrowMemoryException();
+
+// GDI 常量
+#define PS_SOLID 0
+#define PS_DASH 1
+#define PS_DOT 2
+#define PS_NULL 5
+
+#define BS_SOLID 0
+#define BS_NULL 1
+#define BS_HOLLOW BS_NULL
+#define BS_PATTERN 3
+
+#define WHITE_BRUSH 0
+#define LTGRAY_BRUSH 1
+#define GRAY_BRUSH 2
+#define DKGRAY_BRUSH 3
+#define BLACK_BRUSH 4
+#define NULL_BRUSH 5
+#define HOLLOW_BRUSH NULL_BRUSH
+#define WHITE_PEN 6
+#define BLACK_PEN 7
+#define NULL_PEN 8
+#define SYSTEM_FONT 13
+#define DEFAULT_GUI_FONT 17
+
+#define OBJ_PEN 1
+#define OBJ_BRUSH 2
+#define OBJ_DC 3
+#define OBJ_FONT 6
+#define OBJ_BITMAP 7
+#define OBJ_MEMDC 10
+
+#define TRANSPARENT 1
+#define OPAQUE 2
+
+#define MM_TEXT 1
+#define MM_ISOTROPIC 7
+#define MM_ANISOTROPIC 8
+
+#define GM_COMPATIBLE 1
+#define GM_ADVANCED 2
+
+#define TA_NOUPDATECP 0
+#define TA_UPDATECP 1
+#define TA_LEFT 0
+#define TA_RIGHT 2
+#define TA_CENTER 6
+#define TA_TOP 0
+#define TA_BOTTOM 8
+#define TA_BASELINE 24
+
+#define R2_BLACK 1
+#define R2_NOT 6
+#define R2_XORPEN 7
+#define R2_NOTXORPEN 10
+#define R2_NOP 11
+#define R2_COPYPEN 13
+#define R2_WHITE 16
+
+#define SRCCOPY 0x00CC0020
+#define SRCPAINT 0x00EE0086
+#define SRCAND 0x008800C6
+#define SRCINVERT 0x00660046
+#define PATCOPY 0x00F00021
+#define BLACKNESS 0x00000042
+#define WHITENESS 0x00FF0062
+
+#define ETO_OPAQUE 0x0002
+#define ETO_CLIPPED 0x0004
+
+#define ERROR 0
+#define NULLREGION 1
+#define SIMPLEREGION 2
+#define COMPLEXREGION 3
+
+#define BI_RGB 0
+#define DIB_RGB_COLORS 0
+
+#define BLACKONWHITE 1
+#define COLORONCOLOR 3
+#define HALFTONE 4
+
+#define LOGPIXELSX 88
+#define LOGPIXELSY 90
+#define HORZRES 8
+#define VERTRES 10
+#define BITSPIXEL 12
+
+#define COLOR_WINDOW 5
+#define COLOR_WINDOWTEXT 8
+
+#define LF_FACESIZE 32
+#define FW_NORMAL 400
+#define FW_BOLD 700
+
+struct LOGFONT
+{
+	LONG lfHeight;
+	LONG lfWidth;
+	LONG lfEscapement;
+	LONG lfOrientation;
+	LONG lfWeight;
+	BYTE lfItalic;
+	BYTE lfUnderline;
+	BYTE lfStrikeOut;
+	BYTE lfCharSet;
+	BYTE lfOutPrecision;
+	BYTE lfClipPrecision;
+	BYTE lfQuality;
+	BYTE lfPitchAndFamily;
+	WCHAR lfFaceName[LF_FACESIZE];
+};
+typedef LOGFONT LOGFONTW;
+
+struct LOGPEN
+{
+	UINT lopnStyle;
+	POINT lopnWidth;
+	COLORREF lopnColor;
+};
+
+struct LOGBRUSH
+{
+	UINT lbStyle;
+	COLORREF lbColor;
+	UINT_PTR lbHatch;
+};
+
+struct BITMAP
+{
+	LONG bmType;
+	LONG bmWidth;
+	LONG bmHeight;
+	LONG bmWidthBytes;
+	WORD bmPlanes;
+	WORD bmBitsPixel;
+	void* bmBits;
+};
+
+struct BITMAPINFOHEADER
+{
+	DWORD biSize;
+	LONG biWidth;
+	LONG biHeight;
+	WORD biPlanes;
+	WORD biBitCount;
+	DWORD biCompression;
+	DWORD biSizeImage;
+	LONG biXPelsPerMeter;
+	LONG biYPelsPerMeter;
+	DWORD biClrUsed;
+	DWORD biClrImportant;
+};
+
+struct RGBQUAD
+{
+	BYTE rgbBlue;
+	BYTE rgbGreen;
+	BYTE rgbRed;
+	BYTE rgbReserved;
+};
+
+struct BITMAPINFO
+{
+	BITMAPINFOHEADER bmiHeader;
+	RGBQUAD bmiColors[1];
+};
+
+// GDI 函数（GdiRaster.cpp）
+HGDIOBJ GetStockObject(int i);
+BOOL DeleteObject(HGDIOBJ ho);
+int GetObject(HGDIOBJ h, int c, LPVOID pv);
+DWORD GetObjectType(HGDIOBJ h);
+HPEN CreatePen(int iStyle, int cWidth, COLORREF color);
+HBRUSH CreateSolidBrush(COLORREF color);
+HBRUSH CreatePatternBrush(HBITMAP hbm);
+HFONT CreateFontIndirect(const LOGFONT* lplf);
+HBITMAP CreateCompatibleBitmap(HDC hdc, int cx, int cy);
+HBITMAP CreateDIBSection(HDC hdc, const BITMAPINFO* pbmi, UINT usage, void** ppvBits, HANDLE hSection, DWORD offset);
+
+HDC CreateCompatibleDC(HDC hdc);
+BOOL DeleteDC(HDC hdc);
+HGDIOBJ SelectObject(HDC hdc, HGDIOBJ h);
+HGDIOBJ GetCurrentObject(HDC hdc, UINT type);
+int SaveDC(HDC hdc);
+BOOL RestoreDC(HDC hdc, int nSavedDC);
+BOOL GdiFlush();
+int GetDeviceCaps(HDC hdc, int index);
+DWORD GetSysColor(int nIndex);
+
+COLORREF SetTextColor(HDC hdc, COLORREF color);
+COLORREF GetTextColor(HDC hdc);
+COLORREF SetBkColor(HDC hdc, COLORREF color);
+COLORREF GetBkColor(HDC hdc);
+int SetBkMode(HDC hdc, int mode);
+int GetBkMode(HDC hdc);
+int SetROP2(HDC hdc, int rop2);
+int GetROP2(HDC hdc);
+UINT SetTextAlign(HDC hdc, UINT align);
+UINT GetTextAlign(HDC hdc);
+int SetGraphicsMode(HDC hdc, int iMode);
+int GetGraphicsMode(HDC hdc);
+int SetStretchBltMode(HDC hdc, int mode);
+
+int SetMapMode(HDC hdc, int iMode);
+int GetMapMode(HDC hdc);
+BOOL SetWindowOrgEx(HDC hdc, int x, int y, LPPOINT lppt);
+BOOL SetViewportOrgEx(HDC hdc, int x, int y, LPPOINT lppt);
+BOOL SetWindowExtEx(HDC hdc, int x, int y, LPSIZE lpsz);
+BOOL SetViewportExtEx(HDC hdc, int x, int y, LPSIZE lpsz);
+BOOL GetWindowOrgEx(HDC hdc, LPPOINT lppoint);
+BOOL GetViewportOrgEx(HDC hdc, LPPOINT lppoint);
+BOOL LPtoDP(HDC hdc, LPPOINT lppt, int c);
+BOOL DPtoLP(HDC hdc, LPPOINT lppt, int c);
+
+int IntersectClipRect(HDC hdc, int left, int top, int right, int bottom);
+int SelectClipRgn(HDC hdc, HRGN hrgn);
+int GetClipBox(HDC hdc, LPRECT lprect);
+
+BOOL MoveToEx(HDC hdc, int x, int y, LPPOINT lppt);
+BOOL LineTo(HDC hdc, int x, int y);
+BOOL Polyline(HDC hdc, const POINT* apt, int cpt);
+BOOL Rectangle(HDC hdc, int left, int top, int right, int bottom);
+BOOL Ellipse(HDC hdc, int left, int top, int right, int bottom);
+int FillRect(HDC hdc, const RECT* lprc, HBRUSH hbr);
+COLORREF SetPixel(HDC hdc, int x, int y, COLORREF color);
+COLORREF GetPixel(HDC hdc, int x, int y);
+BOOL TextOutW(HDC hdc, int x, int y, LPCWSTR lpString, int c);
+BOOL ExtTextOutW(HDC hdc, int x, int y, UINT options, const RECT* lprect, LPCWSTR lpString, UINT c, const INT* lpDx);
+BOOL GetTextExtentPoint32W(HDC hdc, LPCWSTR lpString, int c, LPSIZE psizl);
+BOOL BitBlt(HDC hdc, int x, int y, int cx, int cy, HDC hdcSrc, int x1, int y1, DWORD rop);
+BOOL StretchBlt(HDC hdcDest, int xDest, int yDest, int wDest, int hDest, HDC hdcSrc, int xSrc, int ySrc, int wSrc, int hSrc, DWORD rop);
+BOOL TransparentBlt(HDC hdcDest, int xDest, int yDest, int wDest, int hDest, HDC hdcSrc, int xSrc, int ySrc, int wSrc, int hSrc, UINT crTransparent);
+
+#define TextOut TextOutW
+#define ExtTextOut ExtTextOutW
+#define GetTextExtentPoint32 GetTextExtentPoint32W
+
+// MFC GDI 对象
+class CGdiObject
+{
+public:
+	HGDIOBJ m_hObject;
+
+	CGdiObject() noexcept : m_hObject(nullptr) {}
+	virtual ~CGdiObject() { DeleteObject(); }
+
+	operator HGDIOBJ() const noexcept { return m_hObject; }
+	HGDIOBJ GetSafeHandle() const noexcept { return m_hObject; }
+
+	BOOL Attach(HGDIOBJ hObject) noexcept { if (hObject == nullptr) return FALSE; m_hObject = hObject; return TRUE; }
+	HGDIOBJ Detach() noexcept { HGDIOBJ h = m_hObject; m_hObject = nullptr; return h; }
+	BOOL DeleteObject()
+	{
+		if (m_hObject == nullptr)
+			return FALSE;
+		return ::DeleteObject(Detach());
+	}
+	int GetObject(int nCount, LPVOID lpObject) const { return ::GetObject(m_hObject, nCount, lpObject); }
+
+	// 临时对象（与 MFC 的临时映射相同：由框架持有，不删除句柄）
+	static CGdiObject* FromHandle(HGDIOBJ hObject);
+
+private:
+	CGdiObject(const CGdiObject&) = delete;
+	CGdiObject& operator=(const CGdiObject&) = delete;
+};
+
+class CPen : public CGdiObject
+{
+public:
+	CPen() noexcept {}
+	CPen(int nPenStyle, int nWidth, COLORREF crColor) { if (!CreatePen(nPenStyle, nWidth, crColor)) AfxThrowResourceException(); }
+	BOOL CreatePen(int nPenStyle, int nWidth, COLORREF crColor) { return Attach(::CreatePen(nPenStyle, nWidth, crColor)); }
+	operator HPEN() const noexcept { return m_hObject; }
+	static CPen* FromHandle(HPEN hPen);
+};
+
+class CBitmap;
+
+class CBrush : public CGdiObject
+{
+public:
+	CBrush() noexcept {}
+	explicit CBrush(COLORREF crColor) { if (!CreateSolidBrush(crColor)) AfxThrowResourceException(); }
+	BOOL CreateSolidBrush(COLORREF crColor) { return Attach(::CreateSolidBrush(crColor)); }
+	BOOL CreatePatternBrush(CBitmap* pBitmap);
+	BOOL CreateStockObject(int nIndex) { return Attach(::GetStockObject(nIndex)); }
+	operator HBRUSH() const noexcept { return m_hObject; }
+	static CBrush* FromHandle(HBRUSH hBrush);
+};
+
+class CFont : public CGdiObject
+{
+public:
+	BOOL CreateFontIndirect(const LOGFONT* lpLogFont) { return Attach(::CreateFontIndirect(lpLogFont)); }
+	BOOL CreatePointFont(int nPointSize, LPCTSTR lpszFaceName, class CDC* pDC = nullptr);
+	int GetLogFont(LOGFONT* pLogFont) { return ::GetObject(m_hObject, sizeof(LOGFONT), pLogFont); }
+	operator HFONT() const noexcept { return m_hObject; }
+	static CFont* FromHandle(HFONT hFont);
+};
+
+class CBitmap : public CGdiObject
+{
+public:
+	BOOL CreateCompatibleBitmap(class CDC* pDC, int nWidth, int nHeight);
+	int GetBitmap(BITMAP* pBitMap) { return ::GetObject(m_hObject, sizeof(BITMAP), pBitMap); }
+	operator HBITMAP() const noexcept { return m_hObject; }
+	static CBitmap* FromHandle(HBITMAP hBitmap);
+};
+
+inline BOOL CBrush::CreatePatternBrush(CBitmap* pBitmap) { return Attach(::CreatePatternBrush(pBitmap->m_hObject)); }
+
+// 设备上下文
+class CDC
+{
+public:
+	HDC m_hDC;
+	HDC m_hAttribDC;
+	BOOL m_bPrinting;
+
+	CDC() noexcept : m_hDC(nullptr), m_hAttribDC(nullptr), m_bPrinting(FALSE) {}
+	virtual ~CDC() { if (m_hDC != nullptr) ::DeleteDC(Detach()); }
+
+	operator HDC() const noexcept { return m_hDC; }
+	HDC GetSafeHdc() const noexcept { return m_hDC; }
+	BOOL Attach(HDC hDC) noexcept { if (hDC == nullptr) return FALSE; m_hDC = m_hAttribDC = hDC; return TRUE; }
+	HDC Detach() noexcept { HDC h = m_hDC; m_hDC = m_hAttribDC = nullptr; return h; }
+	BOOL CreateCompatibleDC(CDC* pDC) { return Attach(::CreateCompatibleDC(pDC == nullptr ? nullptr : pDC->m_hDC)); }
+	BOOL DeleteDC() { if (m_hDC == nullptr) return FALSE; return ::DeleteDC(Detach()); }
+	BOOL IsPrinting() const noexcept { return m_bPrinting; }
+
+	// 临时对象（不删除 DC）
+	static CDC* FromHandle(HDC hDC);
+
+	CPen* SelectObject(CPen* pPen) { return CPen::FromHandle(::SelectObject(m_hDC, pPen->m_hObject)); }
+	CBrush* SelectObject(CBrush* pBrush) { return CBrush::FromHandle(::SelectObject(m_hDC, pBrush->m_hObject)); }
+	CFont* SelectObject(CFont* pFont) { return CFont::FromHandle(::SelectObject(m_hDC, pFont->m_hObject)); }
+	CBitmap* SelectObject(CBitmap* pBitmap) { return CBitmap::FromHandle(::SelectObject(m_hDC, pBitmap->m_hObject)); }
+	CGdiObject* SelectObject(CGdiObject* pObject) { return CGdiObject::FromHandle(::SelectObject(m_hDC, pObject->m_hObject)); }
+	CGdiObject* SelectStockObject(int nIndex) { return CGdiObject::FromHandle(::SelectObject(m_hDC, ::GetStockObject(nIndex))); }
+	CFont* GetCurrentFont() const { return CFont::FromHandle(::GetCurrentObject(m_hDC, OBJ_FONT)); }
+	CPen* GetCurrentPen() const { return CPen::FromHandle(::GetCurrentObject(m_hDC, OBJ_PEN)); }
+	CBrush* GetCurrentBrush() const { return CBrush::FromHandle(::GetCurrentObject(m_hDC, OBJ_BRUSH)); }
+	CBitmap* GetCurrentBitmap() const { return CBitmap::FromHandle(::GetCurrentObject(m_hDC, OBJ_BITMAP)); }
+
+	int SaveDC() { return ::SaveDC(m_hDC); }
+	BOOL RestoreDC(int nSavedDC) { return ::RestoreDC(m_hDC, nSavedDC); }
+	int GetDeviceCaps(int nIndex) const { return ::GetDeviceCaps(m_hDC, nIndex); }
+
+	COLORREF SetTextColor(COLORREF crColor) { return ::SetTextColor(m_hDC, crColor); }
+	COLORREF GetTextColor() const { return ::GetTextColor(m_hDC); }
+	COLORREF SetBkColor(COLORREF crColor) { return ::SetBkColor(m_hDC, crColor); }
+	COLORREF GetBkColor() const { return ::GetBkColor(m_hDC); }
+	int SetBkMode(int nBkMode) { return ::SetBkMode(m_hDC, nBkMode); }
+	int GetBkMode() const { return ::GetBkMode(m_hDC); }
+	int SetROP2(int nDrawMode) { return ::SetROP2(m_hDC, nDrawMode); }
+	int GetROP2() const { return ::GetROP2(m_hDC); }
+	UINT SetTextAlign(UINT nFlags) { return ::SetTextAlign(m_hDC, nFlags); }
+	UINT GetTextAlign() const { return ::GetTextAlign(m_hDC); }
+	int SetStretchBltMode(int nStretchMode) { return ::SetStretchBltMode(m_hDC, nStretchMode); }
+
+	int SetMapMode(int nMapMode) { return ::SetMapMode(m_hDC, nMapMode); }
+	int GetMapMode() const { return ::GetMapMode(m_hDC); }
+	CPoint SetWindowOrg(int x, int y) { CPoint pt; ::SetWindowOrgEx(m_hDC, x, y, &pt); return pt; }
+	CPoint SetWindowOrg(POINT point) { return SetWindowOrg(point.x, point.y); }
+	CPoint SetViewportOrg(int x, int y) { CPoint pt; ::SetViewportOrgEx(m_hDC, x, y, &pt); return pt; }
+	CPoint SetViewportOrg(POINT point) { return SetViewportOrg(point.x, point.y); }
+	CSize SetWindowExt(int cx, int cy) { CSize size; ::SetWindowExtEx(m_hDC, cx, cy, &size); return size; }
+	CSize SetWindowExt(SIZE size) { return SetWindowExt(size.cx, size.cy); }
+	CSize SetViewportExt(int cx, int cy) { CSize size; ::SetViewportExtEx(m_hDC, cx, cy, &size); return size; }
+	CSize SetViewportExt(SIZE size) { return SetViewportExt(size.cx, size.cy); }
+	CPoint GetWindowOrg() const { CPoint pt; ::GetWindowOrgEx(m_hDC, &pt); return pt; }
+	CPoint GetViewportOrg() const { CPoint pt; ::GetViewportOrgEx(m_hDC, &pt); return pt; }
+	void LPtoDP(LPPOINT lpPoints, int nCount = 1) const { ::LPtoDP(m_hDC, lpPoints, nCount); }
+	void LPtoDP(LPRECT lpRect) const { ::LPtoDP(m_hDC, reinterpret_cast<LPPOINT>(lpRect), 2); }
+	void DPtoLP(LPPOINT lpPoints, int nCount = 1) const { ::DPtoLP(m_hDC, lpPoints, nCount); }
+	void DPtoLP(LPRECT lpRect) const { ::DPtoLP(m_hDC, reinterpret_cast<LPPOINT>(lpRect), 2); }
+
+	int IntersectClipRect(int x1, int y1, int x2, int y2) { return ::IntersectClipRect(m_hDC, x1, y1, x2, y2); }
+	int IntersectClipRect(LPCRECT lpRect) { return ::IntersectClipRect(m_hDC, lpRect->left, lpRect->top, lpRect->right, lpRect->bottom); }
+	int GetClipBox(LPRECT lpRect) const { return ::GetClipBox(m_hDC, lpRect); }
+
+	CPoint MoveTo(int x, int y) { CPoint pt; ::MoveToEx(m_hDC, x, y, &pt); return pt; }
+	CPoint MoveTo(POINT point) { return MoveTo(point.x, point.y); }
+	BOOL LineTo(int x, int y) { return ::LineTo(m_hDC, x, y); }
+	BOOL LineTo(POINT point) { return LineTo(point.x, point.y); }
+	BOOL Polyline(const POINT* lpPoints, int nCount) { return ::Polyline(m_hDC, lpPoints, nCount); }
+	BOOL Rectangle(int x1, int y1, int x2, int y2) { return ::Rectangle(m_hDC, x1, y1, x2, y2); }
+	BOOL Rectangle(LPCRECT lpRect) { return ::Rectangle(m_hDC, lpRect->left, lpRect->top, lpRect->right, lpRect->bottom); }
+	BOOL Ellipse(int x1, int y1, int x2, int y2) { return ::Ellipse(m_hDC, x1, y1, x2, y2); }
+	BOOL Ellipse(LPCRECT lpRect) { return ::Ellipse(m_hDC, lpRect->left, lpRect->top, lpRect->right, lpRect->bottom); }
+	void FillRect(LPCRECT lpRect, CBrush* pBrush) { ::FillRect(m_hDC, lpRect, pBrush->m_hObject); }
+	void FillSolidRect(LPCRECT lpRect, COLORREF clr)
+	{
+		::SetBkColor(m_hDC, clr);
+		::ExtTextOutW(m_hDC, 0, 0, ETO_OPAQUE, lpRect, nullptr, 0, nullptr);
+	}
+	void FillSolidRect(int x, int y, int cx, int cy, COLORREF clr) { CRect rect(x, y, x + cx, y + cy); FillSolidRect(&rect, clr); }
+	COLORREF SetPixel(int x, int y, COLORREF crColor) { return ::SetPixel(m_hDC, x, y, crColor); }
+	COLORREF GetPixel(int x, int y) const { return ::GetPixel(m_hDC, x, y); }
+	BOOL TextOutW(int x, int y, LPCTSTR lpszString, int nCount) { return ::TextOutW(m_hDC, x, y, lpszString, nCount); }
+	BOOL TextOutW(int x, int y, const CString& str) { return ::TextOutW(m_hDC, x, y, str.GetString(), str.GetLength()); }
+	CSize GetTextExtent(LPCTSTR lpszString, int nCount) const { CSize size; ::GetTextExtentPoint32W(m_hDC, lpszString, nCount, &size); return size; }
+	CSize GetTextExtent(const CString& str) const { return GetTextExtent(str.GetString(), str.GetLength()); }
+	BOOL BitBlt(int x, int y, int nWidth, int nHeight, CDC* pSrcDC, int xSrc, int ySrc, DWORD dwRop)
+	{
+		return ::BitBlt(m_hDC, x, y, nWidth, nHeight, pSrcDC == nullptr ? nullptr : pSrcDC->m_hDC, xSrc, ySrc, dwRop);
+	}
+	BOOL StretchBlt(int x, int y, int nWidth, int nHeight, CDC* pSrcDC, int xSrc, int ySrc, int nSrcWidth, int nSrcHeight, DWORD dwRop)
+	{
+		return ::StretchBlt(m_hDC, x, y, nWidth, nHeight, pSrcDC == nullptr ? nullptr : pSrcDC->m_hDC, xSrc, ySrc, nSrcWidth, nSrcHeight, dwRop);
+	}
+
+private:
+	CDC(const CDC&) = delete;
+	CDC& operator=(const CDC&) = delete;
+};
+
+inline BOOL CBitmap::CreateCompatibleBitmap(CDC* pDC, int nWidth, int nHeight)
+{
+	return Attach(::CreateCompatibleBitmap(pDC == nullptr ? nullptr : pDC->m_hDC, nWidth, nHeight));
+}
+
+// 文件
+class CFile
+{
+public:
+	enum OpenFlags
+	{
+		modeRead = 0x0000, modeWrite = 0x0001, modeReadWrite = 0x0002, shareCompat = 0x0000,
+		shareExclusive = 0x0010, shareDenyWrite = 0x0020, shareDenyRead = 0x0030, shareDenyNone = 0x0040,
+		modeNoInherit = 0x0080, modeCreate = 0x1000, modeNoTruncate = 0x2000, typeText = 0x4000, typeBinary = 0x8000
+	};
+	enum SeekPosition { begin = 0x0, current = 0x1, end = 0x2 };
+
+	CFile() noexcept : m_pFile(nullptr) {}
+	CFile(LPCTSTR lpszFileName, UINT nOpenFlags);
+	virtual ~CFile();
+
+	virtual BOOL Open(LPCTSTR lpszFileName, UINT nOpenFlags, CFileException* pError = nullptr);
+	virtual UINT Read(void* lpBuf, UINT nCount);
+	virtual void Write(const void* lpBuf, UINT nCount);
+	virtual ULONGLONG Seek(LONGLONG lOff, UINT nFrom);
+	virtual ULONGLONG GetPosition() const;
+	virtual ULONGLONG GetLength() const;
+	virtual void Flush();
+	virtual void Close();
+	void SeekToBegin() { Seek(0, begin); }
+	ULONGLONG SeekToEnd() { return Seek(0, end); }
+	const CString& GetFilePath() const { return m_strFileName; }
+
+protected:
+	FILE* m_pFile;
+	CString m_strFileName;
+
+private:
+	CFile(const CFile&) = delete;
+	CFile& operator=(const CFile&) = delete;
+};
+
+// 内存文件：用于在内存中测量序列化，不涉及磁盘
+class CMemFile : public CFile
+{
+public:
+	explicit CMemFile(UINT nGrowBytes = 1024) noexcept : m_nPosition(0) { (void)nGrowBytes; }
+
+	BOOL Open(LPCTSTR, UINT, CFileException* = nullptr) override { return TRUE; }
+	UINT Read(void* lpBuf, UINT nCount) override;
+	void Write(const void* lpBuf, UINT nCount) override;
+	ULONGLONG Seek(LONGLONG lOff, UINT nFrom) override;
+	ULONGLONG GetPosition() const override { return m_nPosition; }
+	ULONGLONG GetLength() const override { return m_data.size(); }
+	void Flush() override {}
+	void Close() override {}
+
+	// 直接访问内容（MFC 中对应 Detach 后的缓冲区）
+	const std::vector<BYTE>& GetData() const noexcept { return m_data; }
+	void SetLength(ULONGLONG dwNewLen) { m_data.resize(static_cast<size_t>(dwNewLen)); if (m_nPosition > m_data.size()) m_nPosition = m_data.size(); }
+
+private:
+	std::vector<BYTE> m_data;
+	size_t m_nPosition;
+};
+
+// 归档：格式与 MFC 的 CArchive 相同（小端、CString 带长度前缀和 Unicode 标记）
+class CArchive
+{
+public:
+	enum Mode { store = 0, load = 1, bNoFlushOnDelete = 2, bNoByteSwap = 4 };
+
+	CString m_strFileName;
+
+	CArchive(CFile* pFile, UINT nMode, int nBufSize = 4096, void* lpBuf = nullptr);
+	~CArchive();
+
+	BOOL IsLoading() const noexcept { return m_bLoading; }
+	BOOL IsStoring() const noexcept { return !m_bLoading; }
+	CFile* GetFile() const noexcept { return m_pFile; }
+
+	UINT Read(void* lpBuf, UINT nMax);
+	void Write(const void* lpBuf, UINT nMax);
+	void Flush();
+	void Close();
+	void Abort() { m_pFile = nullptr; }
+
+	CArchive& operator<<(BYTE by) { return WriteValue(by); }
+	CArchive& operator<<(WORD w) { return WriteValue(w); }
+	CArchive& operator<<(LONG l) { return WriteValue(l); }
+	CArchive& operator<<(DWORD dw) { return WriteValue(dw); }
+	CArchive& operator<<(LONGLONG dwdw) { return WriteValue(dwdw); }
+	CArchive& operator<<(ULONGLONG dwdw) { return WriteValue(dwdw); }
+	CArchive& operator<<(float f) { return WriteValue(f); }
+	CArchive& operator<<(double d) { return WriteValue(d); }
+	CArchive& operator<<(short w) { return WriteValue(w); }
+	CArchive& operator<<(char ch) { return WriteValue(ch); }
+	CArchive& operator<<(bool b) { return WriteValue(static_cast<BYTE>(b ? 1 : 0)); }
+	CArchive& operator<<(wchar_t ch) { return WriteValue(static_cast<WORD>(ch)); }
+	CArchive& operator<<(POINT point) { return WriteValue(point); }
+	CArchive& operator<<(SIZE size) { return WriteValue(size); }
+	CArchive& operator<<(const RECT& rect) { return WriteValue(rect); }
+	CArchive& operator<<(const CString& str);
+
+	CArchive& operator>>(BYTE& by) { return ReadValue(by); }
+	CArchive& operator>>(WORD& w) { return ReadValue(w); }
+	CArchive& operator>>(LONG& l) { return ReadValue(l); }
+	CArchive& operator>>(DWORD& dw) { return ReadValue(dw); }
+	CArchive& operator>>(LONGLONG& dwdw) { return ReadValue(dwdw); }
+	CArchive& operator>>(ULONGLONG& dwdw) { return ReadValue(dwdw); }
+	CArchive& operator>>(float& f) { return ReadValue(f); }
+	CArchive& operator>>(double& d) { return ReadValue(d); }
+	CArchive& operator>>(short& w) { return ReadValue(w); }
+	CArchive& operator>>(char& ch) { return ReadValue(ch); }
+	CArchive& operator>>(bool& b) { BYTE by; ReadValue(by); b = by != 0; return *this; }
+	CArchive& operator>>(wchar_t& ch) { WORD w; ReadValue(w); ch = w; return *this; }
+	CArchive& operator>>(POINT& point) { return ReadValue(point); }
+	CArchive& operator>>(SIZE& size) { return ReadValue(size); }
+	CArchive& operator>>(RECT& rect) { return ReadValue(rect); }
+	CArchive& operator>>(CString& str);
+
+private:
+	CFile* m_pFile;
+	BOOL m_bLoading;
+	std::vector<BYTE> m_buffer;
+	size_t m_nCur;  // 缓冲区中的当前位置
+	size_t m_nMax;  // 读取时缓冲区中的有效字节数
+
+	void FillBuffer(size_t nBytesNeeded);
+
+	template<typename T>
+	CArchive& WriteValue(const T& value)
+	{
+		if (m_nCur + sizeof(T) > m_buffer.size())
+			Flush();
+		memcpy(m_buffer.data() + m_nCur, &value, sizeof(T));
+		m_nCur += sizeof(T);
+		return *this;
+	}
+
+	template<typename T>
+	CArchive& ReadValue(T& value)
+	{
+		if (m_nCur + sizeof(T) > m_nMax)
+			FillBuffer(sizeof(T));
+		memcpy(&value, m_buffer.data() + m_nCur, sizeof(T));
+		m_nCur += sizeof(T);
+		return *this;
+	}
+
+	CArchive(const CArchive&) = delete;
+	CArchive& operator=(const CArchive&) = delete;
+};